@@ -7,6 +7,14 @@ import os
 
 delivery_bp = Blueprint('delivery', __name__)
 
+# The C++ engine (implementation/python, built with `pip install ./implementation/python`)
+# runs the real heaps in-process; without it the pure-Python queues below are used
+try:
+    import sqs_engine
+    engine = sqs_engine.Engine()
+except ImportError:
+    engine = None
+
 # In-memory storage for deliveries (in a real app, this would be a database)
 deliveries = {
     'urgent': [],
@@ -19,6 +27,11 @@ processed_deliveries = []
 @cross_origin()
 def get_deliveries():
     """Get all deliveries in queues"""
+    if engine is not None:
+        return jsonify({
+            'deliveries': engine.queues(),
+            'processed': engine.processed(10)
+        })
     return jsonify({
         'deliveries': deliveries,
         'processed': processed_deliveries
@@ -37,6 +50,17 @@ def add_delivery():
             if field not in data:
                 return jsonify({'error': f'Missing required field: {field}'}), 400
         
+        if engine is not None:
+            try:
+                delivery = engine.add(str(data['id']), str(data['destination']), str(data['type']),
+                                      int(data['estimatedTime']))
+            except ValueError:
+                return jsonify({'error': 'Invalid delivery type'}), 400
+            return jsonify({
+                'message': f'Delivery {delivery["id"]} added successfully',
+                'delivery': delivery
+            }), 201
+
         # Calculate priority score
         priority_score = calculate_priority_score(data['type'], data['estimatedTime'])
         
@@ -75,7 +99,11 @@ def process_delivery():
         next_delivery = None
         source_queue = None
         
-        if deliveries['urgent']:
+        if engine is not None:
+            result = engine.process()
+            if result is not None:
+                next_delivery, source_queue = result
+        elif deliveries['urgent']:
             next_delivery = deliveries['urgent'].pop(0)
             source_queue = 'urgent'
         elif deliveries['fragile']:
@@ -86,12 +114,13 @@ def process_delivery():
             source_queue = 'standard'
         
         if next_delivery:
-            # Add to processed deliveries
-            processed_deliveries.insert(0, next_delivery)
-            
-            # Keep only last 10 processed deliveries
-            if len(processed_deliveries) > 10:
-                processed_deliveries.pop()
+            if engine is None:
+                # Add to processed deliveries
+                processed_deliveries.insert(0, next_delivery)
+                
+                # Keep only last 10 processed deliveries
+                if len(processed_deliveries) > 10:
+                    processed_deliveries.pop()
             
             return jsonify({
                 'message': f'Processing delivery {next_delivery["id"]}',
@@ -109,6 +138,9 @@ def process_delivery():
 def get_stats():
     """Get delivery statistics"""
     try:
+        if engine is not None:
+            return jsonify(engine.stats()), 200
+
         total_pending = sum(len(queue) for queue in deliveries.values())
         total_processed = len(processed_deliveries)
         
@@ -131,10 +163,11 @@ def get_stats():
 @delivery_bp.route('/deliveries/cpp-process', methods=['POST'])
 @cross_origin()
 def cpp_process_delivery():
-    """Process delivery using the C++ backend (demonstration)"""
+    """Process delivery using the C++ backend"""
     try:
-        # This would compile and run the C++ code with current deliveries
-        # For now, we'll simulate it by calling the regular process function
+        # process_delivery() already dispatches through the C++ engine when it is installed
+        if engine is None:
+            return jsonify({'error': 'C++ engine not installed (pip install ./implementation/python)'}), 501
         return process_delivery()
         
     except Exception as e:
@@ -9,6 +9,9 @@ class DeliveryGUI {
         };
         this.processedDeliveries = [];
         this.currentDelivery = null;
+        this.queueSizes = null;       // Full queue sizes when only the top cards are kept
+        this.processedTotal = null;
+        this.streaming = false;
         
         this.initializeEventListeners();
         this.updateTime();
@@ -17,10 +20,108 @@ class DeliveryGUI {
         // Update time every second
         setInterval(() => this.updateTime(), 1000);
         
+        // Follow queue changes as they happen where the server streams them
+        this.startLiveUpdates();
+    }
+
+    startPolling() {
         // Refresh data every 5 seconds
         setInterval(() => this.loadDeliveries(), 5000);
     }
 
+    // The C++ server pushes queue changes on /api/deliveries/events (a
+    // snapshot first, then coalesced deltas). The Flask backend has no such
+    // route, so the dashboard falls back to polling there.
+    startLiveUpdates() {
+        if (!window.EventSource) {
+            this.startPolling();
+            return;
+        }
+        this.queueMaps = { urgent: new Map(), fragile: new Map(), standard: new Map() };
+        const source = new EventSource('/api/deliveries/events');
+        let opened = false;
+        source.onopen = () => { opened = true; };
+        source.addEventListener('snapshot', (e) => this.applySnapshot(JSON.parse(e.data)));
+        source.addEventListener('delta', (e) => this.applyDelta(JSON.parse(e.data)));
+        source.onerror = () => {
+            if (!opened) {
+                source.close();
+                this.startPolling();
+            }
+            // Otherwise EventSource reconnects by itself and resumes from the last event id
+        };
+    }
+
+    rowToDelivery(row) {
+        return {
+            id: row[0],
+            destination: row[1],
+            type: row[2],
+            estimatedTime: row[3],
+            priorityScore: row[4],
+            timestamp: new Date(row[5] * 1000).toISOString()
+        };
+    }
+
+    applySnapshot(snapshot) {
+        this.streaming = true;
+        Object.keys(this.queueMaps).forEach(queue => {
+            const map = this.queueMaps[queue];
+            map.clear();
+            snapshot.queues[queue].forEach(row => map.set(row[0], this.rowToDelivery(row)));
+        });
+        this.processedDeliveries = snapshot.processed.map(row => this.rowToDelivery(row));
+        this.processedTotal = snapshot.processedTotal;
+        this.scheduleRender();
+    }
+
+    applyDelta(delta) {
+        const maps = Object.values(this.queueMaps);
+        delta.upsert.forEach(row => {
+            maps.forEach(map => map.delete(row[0])); // It may have moved queues
+            this.queueMaps[row[6]].set(row[0], this.rowToDelivery(row));
+        });
+        delta.dispatched.forEach(row => {
+            maps.forEach(map => map.delete(row[0]));
+            this.processedDeliveries.unshift(this.rowToDelivery(row));
+        });
+        delta.cancelled.forEach(id => maps.forEach(map => map.delete(id)));
+        this.processedDeliveries = this.processedDeliveries.slice(0, 10);
+        this.processedTotal = delta.processedTotal;
+        this.scheduleRender();
+    }
+
+    // Highest-scoring `limit` deliveries without sorting the whole queue
+    topDeliveries(map, limit) {
+        let best = [];
+        let threshold = -Infinity;
+        for (const delivery of map.values()) {
+            if (delivery.priorityScore < threshold) continue;
+            best.push(delivery);
+            if (best.length >= limit * 2) {
+                best.sort((a, b) => b.priorityScore - a.priorityScore);
+                best.length = limit;
+                threshold = best[limit - 1].priorityScore;
+            }
+        }
+        best.sort((a, b) => b.priorityScore - a.priorityScore);
+        return best.slice(0, limit);
+    }
+
+    scheduleRender() {
+        if (this.renderPending) return;
+        this.renderPending = true;
+        requestAnimationFrame(() => {
+            this.renderPending = false;
+            this.queueSizes = {};
+            Object.keys(this.queueMaps).forEach(queue => {
+                this.deliveries[queue] = this.topDeliveries(this.queueMaps[queue], 200);
+                this.queueSizes[queue] = this.queueMaps[queue].size;
+            });
+            this.updateDisplay();
+        });
+    }
+
     initializeEventListeners() {
         // Form submission
         document.getElementById('delivery-form').addEventListener('submit', (e) => {
@@ -40,6 +141,7 @@ class DeliveryGUI {
     }
 
     async loadDeliveries() {
+        if (this.streaming) return; // The event stream keeps the queues current
         try {
             const response = await fetch('/api/deliveries');
             if (response.ok) {
@@ -143,7 +245,7 @@ class DeliveryGUI {
             const sizeElement = document.getElementById(`${type}-size`);
             
             container.innerHTML = '';
-            sizeElement.textContent = this.deliveries[type].length;
+            sizeElement.textContent = this.queueSizes ? this.queueSizes[type] : this.deliveries[type].length;
             
             this.deliveries[type].forEach(delivery => {
                 const card = this.createDeliveryCard(delivery);
@@ -204,13 +306,17 @@ class DeliveryGUI {
     }
 
     updateStatistics() {
-        const totalPending = this.deliveries.urgent.length + 
-                           this.deliveries.fragile.length + 
-                           this.deliveries.standard.length;
+        const sizes = this.queueSizes || {
+            urgent: this.deliveries.urgent.length,
+            fragile: this.deliveries.fragile.length,
+            standard: this.deliveries.standard.length
+        };
+        const totalPending = sizes.urgent + sizes.fragile + sizes.standard;
+        const processedCount = this.processedTotal !== null ? this.processedTotal : this.processedDeliveries.length;
         
-        document.getElementById('processed-count').textContent = this.processedDeliveries.length;
+        document.getElementById('processed-count').textContent = processedCount;
         document.getElementById('pending-count').textContent = totalPending;
-        document.getElementById('total-deliveries').textContent = `Total Deliveries: ${totalPending + this.processedDeliveries.length}`;
+        document.getElementById('total-deliveries').textContent = `Total Deliveries: ${totalPending + processedCount}`;
     }
 
     clearForm() {
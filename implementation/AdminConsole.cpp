@@ -1,6 +1,7 @@
 ﻿#include "AdminConsole.h"
 #include "ConfigurationManager.h"
 #include <iostream>
+#include <cstdlib>
 
 AdminConsole::AdminConsole(DeliveryManager &dm, SimulationManager &sm, ReportManager &rm)
     : deliveryManager(dm), simulationManager(sm), reportManager(rm) {}
@@ -21,8 +22,11 @@ void AdminConsole::start()
         std::cout << "6. Add Delivery\n";
         std::cout << "7. Cancel Delivery\n";               // New menu option
         std::cout << "8. View Cancelled Deliveries Log\n"; //  New menu option
-        std::cout << "9. Exit\n";
+        std::cout << "9. Find Delivery\n";
+        std::cout << "10. Export Latency Metrics\n";
+        std::cout << "11. Exit\n";
         std::cout << "Enter your choice: ";
+        deliveryManager.syncLog(); // Commit the last command's log records before waiting on input
         std::cin >> choice;
 
         switch (choice)
@@ -49,15 +53,21 @@ void AdminConsole::start()
             cancelDelivery(); // Cancel delivery
             break;
         case 8:
-            deliveryManager.viewCancelledDeliveries(); //  View cancelled log
+            viewCancelledLog(); //  View cancelled log
             break;
         case 9:
+            findDelivery();
+            break;
+        case 10:
+            exportLatencyMetrics();
+            break;
+        case 11:
             std::cout << "Exiting Admin Console.\n";
             break;
         default:
             std::cout << "Invalid choice.\n";
         }
-    } while (choice != 9);
+    } while (choice != 11);
 }
 
 void AdminConsole::viewStats()
@@ -68,6 +78,22 @@ void AdminConsole::viewStats()
     std::cout << "Urgent Queue Size: " << deliveryManager.getUrgentQueueSize() << "\n";
     std::cout << "Standard Queue Size: " << deliveryManager.getStandardQueueSize() << "\n";
     std::cout << "Fragile Queue Size: " << deliveryManager.getFragileQueueSize() << "\n";
+    deliveryManager.getLatency().printSummary(std::cout);
+}
+
+void AdminConsole::exportLatencyMetrics()
+{
+    std::string path;
+    std::cout << "\nEnter output file (leave empty for sqs_latency.prom): ";
+    std::cin.ignore(); // Clear input buffer
+    std::getline(std::cin, path);
+    if (path.empty()) path = "sqs_latency.prom";
+
+    if (deliveryManager.getLatency().writePrometheusFile(path)) {
+        std::cout << "Latency metrics written to " << path << " (Prometheus text format).\n";
+    } else {
+        std::cout << "Could not write " << path << ".\n";
+    }
 }
 
 void AdminConsole::modifyQueuePolicies()
@@ -95,7 +121,22 @@ void AdminConsole::generateReport()
     std::cout << "Enter sort criteria (waiting_time or leave empty for priority): ";
     std::getline(std::cin, sortCriteria);
 
-    reportManager.generateReport(filterType, sortCriteria);
+    std::string topInput, echoInput;
+    std::cout << "Only the top N rows (number or leave empty for all): ";
+    std::getline(std::cin, topInput);
+    std::cout << "Print rows to the console? (y/n, leave empty for yes): ";
+    std::getline(std::cin, echoInput);
+
+    size_t topN = topInput.empty() ? 0 : static_cast<size_t>(std::strtoul(topInput.c_str(), nullptr, 10));
+    bool echoRows = echoInput.empty() || echoInput[0] == 'y' || echoInput[0] == 'Y';
+    reportManager.generateReport(filterType, sortCriteria, topN, echoRows);
+
+    std::string exportInput;
+    std::cout << "Also export columnar .sqc files? (y/n): ";
+    std::getline(std::cin, exportInput);
+    if (!exportInput.empty() && (exportInput[0] == 'y' || exportInput[0] == 'Y')) {
+        reportManager.exportColumnar();
+    }
 }
 
 void AdminConsole::addDelivery()
@@ -134,3 +175,61 @@ void AdminConsole::cancelDelivery()
         std::cout << "Delivery ID not found in any active queue.\n";
     }
 }
+
+void AdminConsole::findDelivery()
+{
+    std::string id;
+    std::cout << "Enter Delivery ID to find: ";
+    std::cin >> id;
+
+    DeliveryLookup lookup = deliveryManager.findDelivery(id);
+    switch (lookup.status)
+    {
+    case STATUS_QUEUED:
+    {
+        static const char *queueNames[] = {"urgent", "standard", "fragile"};
+        std::cout << "Delivery " << id << " is queued in the " << queueNames[lookup.queue]
+                  << " queue (heap slot " << lookup.slot << "), score " << lookup.priorityScore << ".\n";
+        QueuePosition position = deliveryManager.getQueuePosition(id);
+        std::cout << "Position " << position.rank + 1 << " of " << position.queueSize;
+        if (position.etaMinutes >= 0.0) std::cout << ", expected at a counter in about " << position.etaMinutes << " minutes";
+        std::cout << ".\n";
+        break;
+    }
+    case STATUS_PROCESSED:
+        std::cout << "Delivery " << id << " has been processed.\n";
+        break;
+    case STATUS_CANCELLED:
+        std::cout << "Delivery " << id << " has been cancelled.\n";
+        break;
+    default:
+        std::cout << "Delivery ID not found.\n";
+    }
+}
+
+void AdminConsole::viewCancelledLog()
+{
+    deliveryManager.viewCancelledDeliveries();
+
+    const size_t pageSize = 20;
+    uint64_t total = deliveryManager.getCancelledCount();
+    if (total <= pageSize)
+    {
+        return;
+    }
+    uint64_t pages = (total + pageSize - 1) / pageSize;
+    std::cout << "Browse full history (" << total << " cancellations, " << pages
+              << " pages) - enter page number (0 to skip): ";
+    uint64_t pageNumber = 0;
+    std::cin >> pageNumber;
+    while (pageNumber > 0 && pageNumber <= pages)
+    {
+        std::cout << "\n--- Cancelled Deliveries, page " << pageNumber << " of " << pages << " ---\n";
+        for (const Delivery &d : deliveryManager.getCancelledPage((pageNumber - 1) * pageSize, pageSize))
+        {
+            d.print();
+        }
+        std::cout << "Next page number (0 to stop): ";
+        std::cin >> pageNumber;
+    }
+}
@@ -24,7 +24,9 @@ public:
 
     //  New features
     void cancelDelivery(); // Cancel a delivery by ID
-    // (No need to declare viewCancelledDeliveries here, it is directly called via deliveryManager)
+    void findDelivery();   // Look up where a delivery is by ID
+    void viewCancelledLog(); // Recent cancellations, then paged full history
+    void exportLatencyMetrics(); // Operation latency histograms as a Prometheus text file
 };
 
 #endif
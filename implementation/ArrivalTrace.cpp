@@ -0,0 +1,196 @@
+#include "ArrivalTrace.h"
+#include "BinaryIO.h"
+#include "Delivery.h"
+
+namespace {
+
+const size_t FLUSH_BYTES = 64 * 1024;
+
+} // namespace
+
+bool ArrivalTraceWriter::open(const std::string &path)
+{
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    pending.clear();
+    lastOffset = 0;
+    eventCount = 0;
+    batchCount = 0;
+    failed = false;
+    origin = std::chrono::steady_clock::now();
+
+    int64_t startUnixNanos = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                 std::chrono::system_clock::now().time_since_epoch()).count();
+    putU32(pending, MAGIC);
+    putU16(pending, VERSION);
+    putU16(pending, 0);
+    putI64(pending, startUnixNanos);
+    flush();
+    return !failed;
+}
+
+bool ArrivalTraceWriter::close()
+{
+    if (!file) return !failed;
+    flush();
+    if (std::fclose(file) != 0) failed = true;
+    file = nullptr;
+    return !failed;
+}
+
+void ArrivalTraceWriter::flush()
+{
+    if (!file || pending.empty()) return;
+    if (std::fwrite(pending.data(), 1, pending.size(), file) != pending.size()) failed = true;
+    std::fflush(file);
+    pending.clear();
+}
+
+void ArrivalTraceWriter::flushIfFull()
+{
+    if (pending.size() >= FLUSH_BYTES) flush();
+}
+
+void ArrivalTraceWriter::beginRecord(ArrivalTraceEventType type)
+{
+    uint64_t offset = static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count());
+    if (offset < lastOffset) offset = lastOffset;
+    putU8(pending, type);
+    putVarint(pending, offset - lastOffset);
+    lastOffset = offset;
+    ++eventCount;
+}
+
+void ArrivalTraceWriter::putAddBody(const Delivery &delivery, time_t now)
+{
+    putU8(pending, static_cast<uint8_t>(delivery.deliveryType));
+    putVarintSigned(pending, delivery.estimatedDeliveryTime);
+    putVarintSigned(pending, static_cast<int64_t>(delivery.entryTime) - static_cast<int64_t>(now));
+    putStringVar(pending, delivery.deliveryId);
+    putStringVar(pending, delivery.destination);
+}
+
+void ArrivalTraceWriter::recordAdd(const Delivery &delivery)
+{
+    if (!file) return;
+    beginRecord(TRACE_ADD);
+    putAddBody(delivery, time(0));
+    flushIfFull();
+}
+
+void ArrivalTraceWriter::recordDispatch()
+{
+    if (!file) return;
+    beginRecord(TRACE_DISPATCH);
+    flushIfFull();
+}
+
+void ArrivalTraceWriter::recordCancel(const std::string &id)
+{
+    if (!file) return;
+    beginRecord(TRACE_CANCEL);
+    putStringVar(pending, id);
+    flushIfFull();
+}
+
+void ArrivalTraceWriter::beginBatch()
+{
+    if (!file) return;
+    beginRecord(TRACE_BATCH);
+    batchCountPos = pending.size();
+    batchCount = 0;
+    putU32(pending, 0); // Patched by endBatch()
+}
+
+void ArrivalTraceWriter::recordBatchAdd(const Delivery &delivery)
+{
+    if (!file) return;
+    putAddBody(delivery, time(0));
+    ++batchCount;
+    ++eventCount;
+}
+
+void ArrivalTraceWriter::endBatch()
+{
+    if (!file) return;
+    for (int i = 0; i < 4; ++i) {
+        pending[batchCountPos + i] = static_cast<char>(batchCount >> (8 * i));
+    }
+    flushIfFull(); // Never inside a batch, so the count is always patched first
+}
+
+static bool readAddBody(ByteReader &in, ArrivalTraceEvent &event)
+{
+    uint8_t type = in.u8();
+    event.estimatedDeliveryTime = static_cast<int>(in.varintSigned());
+    event.entryOffsetSeconds = in.varintSigned();
+    event.deliveryId = in.viewVar();
+    event.destination = in.viewVar();
+    if (!in.ok() || type > FRAGILE) return false;
+    event.deliveryType = static_cast<DeliveryType>(type);
+    return true;
+}
+
+bool ArrivalTraceWriter::read(const std::string &path, const std::function<void(const ArrivalTraceEvent &)> &apply,
+                              int64_t &startUnixNanos)
+{
+    std::FILE *in = std::fopen(path.c_str(), "rb");
+    if (!in) return false;
+    std::vector<char> data;
+    char chunk[1 << 16];
+    size_t n;
+    while ((n = std::fread(chunk, 1, sizeof(chunk), in)) > 0) {
+        data.insert(data.end(), chunk, chunk + n);
+    }
+    bool readError = std::ferror(in) != 0;
+    std::fclose(in);
+    if (readError) return false;
+
+    ByteReader reader(data.data(), data.size());
+    if (reader.u32() != MAGIC || reader.u16() != VERSION) return false;
+    reader.u16();
+    startUnixNanos = reader.i64();
+    if (!reader.ok()) return false;
+
+    uint64_t offset = 0;
+    while (reader.remaining() > 0) {
+        ArrivalTraceEvent event;
+        event.type = static_cast<ArrivalTraceEventType>(reader.u8());
+        offset += reader.varint();
+        event.offsetNanos = offset;
+        switch (event.type) {
+        case TRACE_ADD:
+            if (!readAddBody(reader, event)) return true;
+            apply(event);
+            break;
+        case TRACE_DISPATCH:
+            if (!reader.ok()) return true;
+            apply(event);
+            break;
+        case TRACE_CANCEL:
+            event.deliveryId = reader.viewVar();
+            if (!reader.ok()) return true;
+            apply(event);
+            break;
+        case TRACE_BATCH: {
+            event.batchSize = reader.u32();
+            if (!reader.ok()) return true;
+            apply(event);
+            ArrivalTraceEvent add;
+            add.type = TRACE_ADD;
+            add.offsetNanos = offset;
+            add.inBatch = true;
+            for (uint32_t i = 0; i < event.batchSize; ++i) {
+                if (!readAddBody(reader, add)) return true;
+                apply(add);
+            }
+            break;
+        }
+        default:
+            return true; // Unknown type: treat like a torn tail
+        }
+    }
+    return true;
+}
@@ -0,0 +1,94 @@
+#ifndef ARRIVAL_TRACE_H
+#define ARRIVAL_TRACE_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DeliveryTypes.h"
+
+class Delivery;
+
+enum ArrivalTraceEventType : uint8_t {
+    TRACE_ADD = 1,      // addDelivery()
+    TRACE_DISPATCH = 2, // A delivery left a queue through processNextDelivery()
+    TRACE_CANCEL = 3,   // cancelDeliveryById(), whether or not the ID was queued
+    TRACE_BATCH = 4     // addDeliveries(); the batch's TRACE_ADD events follow
+};
+
+// One decoded trace event. The string views point into the read buffer and
+// are valid during the callback only.
+struct ArrivalTraceEvent {
+    ArrivalTraceEventType type = TRACE_DISPATCH;
+    uint64_t offsetNanos = 0;  // Since recording started
+    bool inBatch = false;      // TRACE_ADD that belongs to the preceding TRACE_BATCH
+    uint32_t batchSize = 0;    // TRACE_BATCH only
+    std::string_view deliveryId;
+    std::string_view destination;
+    DeliveryType deliveryType = STANDARD;
+    int estimatedDeliveryTime = 0;
+    int64_t entryOffsetSeconds = 0; // entryTime minus the wall clock at the event (0 for fresh deliveries)
+};
+
+// Compact binary capture of the operations applied to a DeliveryManager, for
+// replaying real traffic against a fresh one (bench/trace_replay.cpp).
+//
+// File: [u32 magic "SQTR"][u16 version][u16 reserved][i64 start, Unix ns],
+// then records of [u8 type][varint ns since the previous record] and a body:
+//   TRACE_ADD       u8 type, zigzag estimatedTime, zigzag entry offset (s),
+//                   varint-length id, varint-length destination
+//   TRACE_CANCEL    varint-length id
+//   TRACE_BATCH     u32 count, then count TRACE_ADD bodies
+//   TRACE_DISPATCH  nothing
+// A typical add is about 30 bytes. There are no checksums; reading stops at
+// the first truncated record, so a trace cut short by a crash is still usable.
+class ArrivalTraceWriter {
+private:
+    std::FILE *file;
+    std::vector<char> pending;
+    std::chrono::steady_clock::time_point origin;
+    uint64_t lastOffset;
+    uint64_t eventCount;
+    size_t batchCountPos; // Where the open batch's count goes
+    uint32_t batchCount;
+    bool failed;
+
+    void beginRecord(ArrivalTraceEventType type);
+    void putAddBody(const Delivery &delivery, time_t now);
+    void flushIfFull();
+
+public:
+    static const uint32_t MAGIC = 0x52545153; // "SQTR" little-endian
+    static const uint16_t VERSION = 1;
+
+    ArrivalTraceWriter()
+        : file(nullptr), lastOffset(0), eventCount(0), batchCountPos(0), batchCount(0), failed(false) {}
+    ~ArrivalTraceWriter() { close(); }
+    ArrivalTraceWriter(const ArrivalTraceWriter &) = delete;
+    ArrivalTraceWriter &operator=(const ArrivalTraceWriter &) = delete;
+
+    bool open(const std::string &path); // Truncates
+    bool close();                       // False if any write failed
+    bool isOpen() const { return file != nullptr; }
+
+    void recordAdd(const Delivery &delivery);
+    void recordDispatch();
+    void recordCancel(const std::string &id);
+    void beginBatch();
+    void recordBatchAdd(const Delivery &delivery);
+    void endBatch();
+    void flush();
+
+    uint64_t getEventCount() const { return eventCount; }
+
+    // Calls apply for every event in order; false if the file cannot be read
+    // or is not a trace. startUnixNanos is the recording's wall-clock start.
+    static bool read(const std::string &path, const std::function<void(const ArrivalTraceEvent &)> &apply,
+                     int64_t &startUnixNanos);
+};
+
+#endif // ARRIVAL_TRACE_H
@@ -0,0 +1,224 @@
+#ifndef BINARY_IO_H
+#define BINARY_IO_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Little-endian encoding helpers and CRC-32 shared by the on-disk formats
+// (write-ahead log, snapshots, spill segments).
+
+inline void putU8(std::vector<char> &out, uint8_t v) { out.push_back(static_cast<char>(v)); }
+
+inline void putU16(std::vector<char> &out, uint16_t v)
+{
+    for (int i = 0; i < 2; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+inline void putU32(std::vector<char> &out, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+inline void putU64(std::vector<char> &out, uint64_t v)
+{
+    for (int i = 0; i < 8; ++i) out.push_back(static_cast<char>(v >> (8 * i)));
+}
+
+inline void putI32(std::vector<char> &out, int32_t v) { putU32(out, static_cast<uint32_t>(v)); }
+inline void putI64(std::vector<char> &out, int64_t v) { putU64(out, static_cast<uint64_t>(v)); }
+
+inline void putF64(std::vector<char> &out, double v)
+{
+    uint64_t bits;
+    std::memcpy(&bits, &v, sizeof(bits));
+    putU64(out, bits);
+}
+
+// Length-prefixed (u16) string; longer strings are truncated
+inline void putString16(std::vector<char> &out, const std::string &s)
+{
+    uint16_t len = static_cast<uint16_t>(s.size() > 0xFFFF ? 0xFFFF : s.size());
+    putU16(out, len);
+    out.insert(out.end(), s.data(), s.data() + len);
+}
+
+// LEB128: 7 bits per byte, low group first
+inline void putVarint(std::vector<char> &out, uint64_t v)
+{
+    while (v >= 0x80) {
+        out.push_back(static_cast<char>((v & 0x7F) | 0x80));
+        v >>= 7;
+    }
+    out.push_back(static_cast<char>(v));
+}
+
+// Signed values zigzag-encoded so small negatives stay short
+inline void putVarintSigned(std::vector<char> &out, int64_t v)
+{
+    putVarint(out, (static_cast<uint64_t>(v) << 1) ^ static_cast<uint64_t>(v >> 63));
+}
+
+// Length-prefixed (varint) string
+inline void putStringVar(std::vector<char> &out, const std::string &s)
+{
+    putVarint(out, s.size());
+    out.insert(out.end(), s.data(), s.data() + s.size());
+}
+
+// Bounds-checked reader over a byte range; ok() turns false on overrun
+class ByteReader
+{
+private:
+    const unsigned char *p;
+    const unsigned char *end;
+    bool good;
+
+    bool need(size_t n)
+    {
+        if (!good || static_cast<size_t>(end - p) < n) {
+            good = false;
+            return false;
+        }
+        return true;
+    }
+
+public:
+    ByteReader(const void *data, size_t size)
+        : p(static_cast<const unsigned char *>(data)), end(static_cast<const unsigned char *>(data) + size), good(true) {}
+
+    bool ok() const { return good; }
+    size_t remaining() const { return end - p; }
+
+    uint8_t u8() { return need(1) ? *p++ : 0; }
+
+    uint16_t u16()
+    {
+        if (!need(2)) return 0;
+        uint16_t v = static_cast<uint16_t>(p[0] | (p[1] << 8));
+        p += 2;
+        return v;
+    }
+
+    uint32_t u32()
+    {
+        if (!need(4)) return 0;
+        uint32_t v = 0;
+        for (int i = 3; i >= 0; --i) v = (v << 8) | p[i];
+        p += 4;
+        return v;
+    }
+
+    uint64_t u64()
+    {
+        if (!need(8)) return 0;
+        uint64_t v = 0;
+        for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+        p += 8;
+        return v;
+    }
+
+    int32_t i32() { return static_cast<int32_t>(u32()); }
+    int64_t i64() { return static_cast<int64_t>(u64()); }
+
+    double f64()
+    {
+        uint64_t bits = u64();
+        double v;
+        std::memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+
+    uint64_t varint()
+    {
+        uint64_t v = 0;
+        for (int shift = 0; shift < 64; shift += 7) {
+            if (!need(1)) return 0;
+            uint8_t b = *p++;
+            v |= static_cast<uint64_t>(b & 0x7F) << shift;
+            if (!(b & 0x80)) return v;
+        }
+        good = false; // More than 10 bytes
+        return 0;
+    }
+
+    int64_t varintSigned()
+    {
+        uint64_t v = varint();
+        return static_cast<int64_t>(v >> 1) ^ -static_cast<int64_t>(v & 1);
+    }
+
+    std::string_view viewVar()
+    {
+        uint64_t len = varint();
+        if (!need(len)) return std::string_view();
+        std::string_view s(reinterpret_cast<const char *>(p), len);
+        p += len;
+        return s;
+    }
+
+    std::string string16() { return std::string(view16()); }
+
+    // Like string16() but points into the underlying buffer
+    std::string_view view16()
+    {
+        uint16_t len = u16();
+        if (!need(len)) return std::string_view();
+        std::string_view s(reinterpret_cast<const char *>(p), len);
+        p += len;
+        return s;
+    }
+};
+
+// 64-bit FNV-1a, used for ID hashing
+inline uint64_t fnv1a64(const char *data, size_t size)
+{
+    uint64_t h = 14695981039346656037ull;
+    for (size_t i = 0; i < size; ++i) {
+        h ^= static_cast<unsigned char>(data[i]);
+        h *= 1099511628211ull;
+    }
+    return h;
+}
+
+// CRC-32 (IEEE 802.3, reflected), slicing-by-8
+struct Crc32Table
+{
+    uint32_t entries[8][256];
+
+    Crc32Table()
+    {
+        for (uint32_t i = 0; i < 256; ++i) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; ++k) c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+            entries[0][i] = c;
+        }
+        for (uint32_t i = 0; i < 256; ++i) {
+            for (int t = 1; t < 8; ++t) {
+                entries[t][i] = (entries[t - 1][i] >> 8) ^ entries[0][entries[t - 1][i] & 0xFF];
+            }
+        }
+    }
+};
+
+inline uint32_t crc32(const void *data, size_t size, uint32_t crc = 0)
+{
+    static const Crc32Table table;
+    const uint32_t (*t)[256] = table.entries;
+    const unsigned char *bytes = static_cast<const unsigned char *>(data);
+    crc = ~crc;
+    while (size >= 8) {
+        uint32_t lo = crc ^ (bytes[0] | (bytes[1] << 8) | (bytes[2] << 16) | (uint32_t(bytes[3]) << 24));
+        uint32_t hi = bytes[4] | (bytes[5] << 8) | (bytes[6] << 16) | (uint32_t(bytes[7]) << 24);
+        crc = t[7][lo & 0xFF] ^ t[6][(lo >> 8) & 0xFF] ^ t[5][(lo >> 16) & 0xFF] ^ t[4][lo >> 24] ^
+              t[3][hi & 0xFF] ^ t[2][(hi >> 8) & 0xFF] ^ t[1][(hi >> 16) & 0xFF] ^ t[0][hi >> 24];
+        bytes += 8;
+        size -= 8;
+    }
+    while (size-- > 0) crc = t[0][(crc ^ *bytes++) & 0xFF] ^ (crc >> 8);
+    return ~crc;
+}
+
+#endif // BINARY_IO_H
@@ -0,0 +1,227 @@
+#include "CancelledLog.h"
+#include "BinaryIO.h"
+#include <algorithm>
+#include <filesystem>
+#include <system_error>
+
+namespace {
+
+void encodeDelivery(std::vector<char> &out, const Delivery &d)
+{
+    putU8(out, static_cast<uint8_t>(d.deliveryType));
+    putI32(out, d.estimatedDeliveryTime);
+    putF64(out, d.priorityScore);
+    putI64(out, d.entryTime);
+    putString16(out, d.deliveryId);
+    putString16(out, d.destination);
+}
+
+bool decodeDelivery(ByteReader &in, std::vector<Delivery> &out)
+{
+    uint8_t type = in.u8();
+    int32_t estimatedTime = in.i32();
+    double score = in.f64();
+    int64_t entryTime = in.i64();
+    std::string id = in.string16();
+    std::string destination = in.string16();
+    if (!in.ok() || type > FRAGILE) return false;
+    out.emplace_back(id, destination, static_cast<DeliveryType>(type), estimatedTime);
+    out.back().priorityScore = score;
+    out.back().entryTime = static_cast<time_t>(entryTime);
+    return true;
+}
+
+uint64_t loadU64(const unsigned char *p)
+{
+    uint64_t v = 0;
+    for (int i = 7; i >= 0; --i) v = (v << 8) | p[i];
+    return v;
+}
+
+} // namespace
+
+CancelledLog::CancelledLog(size_t capacity, size_t spillBatch)
+    : capacity(capacity > 0 ? capacity : 1), head(0), count(0), spillBatch(spillBatch > 0 ? spillBatch : 1),
+      spillSuspended(false), segment(nullptr), segmentIndex(nullptr), segmentBytes(0), spilledCount(0)
+{
+    ring.reserve(this->capacity);
+}
+
+CancelledLog::~CancelledLog()
+{
+    close();
+}
+
+bool CancelledLog::open(const std::string &path)
+{
+    close();
+    std::string indexPath = path + ".idx";
+    std::error_code ec;
+    uint64_t dataBytes = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+    uint64_t indexBytes = std::filesystem::exists(indexPath, ec) ? std::filesystem::file_size(indexPath, ec) : 0;
+
+    // The segment is written before its index, so a crash leaves at most
+    // unindexed segment bytes or a partial offset; trim back to the last
+    // record both files agree on
+    uint64_t records = indexBytes / 8;
+    uint64_t end = 0;
+    if (records > 0) {
+        std::FILE *in = std::fopen(indexPath.c_str(), "rb");
+        unsigned char raw[8];
+        while (in && records > 0) {
+            std::fseek(in, static_cast<long>((records - 1) * 8), SEEK_SET);
+            if (std::fread(raw, 1, 8, in) != 8) break;
+            end = loadU64(raw);
+            if (end <= dataBytes) break;
+            --records;
+            end = 0;
+        }
+        if (in) std::fclose(in);
+    }
+    if (indexBytes != records * 8) std::filesystem::resize_file(indexPath, records * 8, ec);
+    if (dataBytes != end) std::filesystem::resize_file(path, end, ec);
+
+    segment = std::fopen(path.c_str(), "ab");
+    segmentIndex = std::fopen(indexPath.c_str(), "ab");
+    if (!segment || !segmentIndex) {
+        close();
+        return false;
+    }
+    segmentPath = path;
+    segmentBytes = end;
+    spilledCount = records;
+    return true;
+}
+
+void CancelledLog::close()
+{
+    if (segment && segmentIndex) flush();
+    if (segment) std::fclose(segment);
+    if (segmentIndex) std::fclose(segmentIndex);
+    segment = nullptr;
+    segmentIndex = nullptr;
+}
+
+void CancelledLog::push(const Delivery &delivery)
+{
+    if (count < capacity) {
+        if (ring.size() < capacity) {
+            ring.push_back(delivery);
+        } else {
+            ring[(head + count) % capacity] = delivery;
+        }
+        ++count;
+        return;
+    }
+
+    // Full: the oldest entry makes room, overwritten in place
+    if (segment && !spillSuspended) {
+        spillBuffer.push_back(std::move(ring[head]));
+    }
+    ring[head] = delivery;
+    head = (head + 1) % capacity;
+    if (spillBuffer.size() >= spillBatch) {
+        writeSpill();
+    }
+}
+
+void CancelledLog::flush()
+{
+    if (!spillBuffer.empty()) writeSpill();
+    if (segment) std::fflush(segment);
+    if (segmentIndex) std::fflush(segmentIndex);
+}
+
+void CancelledLog::writeSpill()
+{
+    if (!segment || !segmentIndex) {
+        spillBuffer.clear();
+        return;
+    }
+    std::vector<char> data, offsets;
+    data.reserve(spillBuffer.size() * 64);
+    offsets.reserve(spillBuffer.size() * 8);
+    for (const Delivery &d : spillBuffer) {
+        encodeDelivery(data, d);
+        putU64(offsets, segmentBytes + data.size());
+    }
+    if (std::fwrite(data.data(), 1, data.size(), segment) != data.size()) return; // Keep buffered, retry next batch
+    std::fflush(segment);
+    std::fwrite(offsets.data(), 1, offsets.size(), segmentIndex);
+    std::fflush(segmentIndex);
+    segmentBytes += data.size();
+    spilledCount += spillBuffer.size();
+    spillBuffer.clear();
+}
+
+void CancelledLog::clear()
+{
+    ring.clear();
+    head = 0;
+    count = 0;
+    spillBuffer.clear();
+}
+
+bool CancelledLog::readSpilled(uint64_t first, uint64_t last, std::vector<Delivery> &out) const
+{
+    if (first >= last) return true;
+    std::FILE *index = std::fopen((segmentPath + ".idx").c_str(), "rb");
+    std::FILE *data = std::fopen(segmentPath.c_str(), "rb");
+    bool ok = index && data;
+
+    // Offsets of the records before `first` and of the last one bound the byte range
+    std::vector<unsigned char> ends((last - first) * 8);
+    uint64_t begin = 0;
+    if (ok && first > 0) {
+        unsigned char raw[8];
+        ok = std::fseek(index, static_cast<long>((first - 1) * 8), SEEK_SET) == 0 && std::fread(raw, 1, 8, index) == 8;
+        begin = loadU64(raw);
+    }
+    ok = ok && std::fseek(index, static_cast<long>(first * 8), SEEK_SET) == 0 &&
+         std::fread(ends.data(), 1, ends.size(), index) == ends.size();
+
+    std::vector<unsigned char> bytes;
+    if (ok) {
+        uint64_t end = loadU64(&ends[ends.size() - 8]);
+        bytes.resize(end - begin);
+        ok = end >= begin && std::fseek(data, static_cast<long>(begin), SEEK_SET) == 0 &&
+             std::fread(bytes.data(), 1, bytes.size(), data) == bytes.size();
+    }
+    if (ok) {
+        ByteReader in(bytes.data(), bytes.size());
+        for (uint64_t i = first; ok && i < last; ++i) {
+            ok = decodeDelivery(in, out);
+        }
+    }
+    if (index) std::fclose(index);
+    if (data) std::fclose(data);
+    return ok;
+}
+
+std::vector<Delivery> CancelledLog::page(uint64_t offset, size_t limit) const
+{
+    std::vector<Delivery> result;
+    uint64_t total = totalSize();
+    if (offset >= total || limit == 0) return result;
+    uint64_t stop = std::min<uint64_t>(total, offset + limit);
+    result.reserve(static_cast<size_t>(stop - offset));
+
+    uint64_t i = offset;
+    for (; i < stop && i < count; ++i) {
+        result.push_back(recent(static_cast<size_t>(i)));
+    }
+    uint64_t buffered = count + spillBuffer.size();
+    for (; i < stop && i < buffered; ++i) {
+        result.push_back(spillBuffer[spillBuffer.size() - 1 - static_cast<size_t>(i - count)]);
+    }
+    if (i < stop && segment) {
+        // Newest-first positions map to a contiguous, oldest-first range on disk
+        uint64_t last = spilledCount - (i - buffered);
+        uint64_t first = spilledCount - (stop - buffered);
+        std::vector<Delivery> older;
+        if (readSpilled(first, last, older)) {
+            result.insert(result.end(), older.rbegin(), older.rend());
+        }
+    }
+    return result;
+}
@@ -0,0 +1,66 @@
+#ifndef CANCELLED_LOG_H
+#define CANCELLED_LOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+#include "Delivery.h"
+
+// Log of cancelled deliveries.
+//
+// The most recent `capacity` cancellations live in a fixed ring and are read
+// newest first in place. Older entries are evicted into a spill buffer that is
+// appended in batches to an on-disk segment (`path`) plus an index file
+// (`path + ".idx"`, one u64 end offset per record), so any page of the full
+// history can be read without scanning. Without a segment, evicted entries
+// are dropped. DeliveryManager flushes the buffer before each log commit.
+class CancelledLog {
+private:
+    std::vector<Delivery> ring;
+    size_t capacity;
+    size_t head;                  // Slot of the oldest entry
+    size_t count;
+
+    std::vector<Delivery> spillBuffer; // Evicted, not yet written (oldest first)
+    size_t spillBatch;
+    bool spillSuspended;          // While replaying, evictions are already on disk
+
+    std::string segmentPath;
+    std::FILE *segment;
+    std::FILE *segmentIndex;
+    uint64_t segmentBytes;
+    uint64_t spilledCount;
+
+    void writeSpill();
+    bool readSpilled(uint64_t first, uint64_t last, std::vector<Delivery> &out) const; // [first, last), oldest first
+
+public:
+    explicit CancelledLog(size_t capacity = 1024, size_t spillBatch = 256);
+    ~CancelledLog();
+    CancelledLog(const CancelledLog &) = delete;
+    CancelledLog &operator=(const CancelledLog &) = delete;
+
+    // Opens (or creates) the spill segment and index, dropping a torn tail
+    bool open(const std::string &path);
+    void close();
+
+    void push(const Delivery &delivery);
+    void flush();   // Writes any buffered spill to the segment
+    void clear();   // Forgets the in-memory entries; the segment is kept
+
+    // Recovery re-pushes cancellations whose evictions were spilled before
+    void setSpillSuspended(bool suspended) { spillSuspended = suspended; }
+
+    // In-memory window, 0 = newest
+    size_t recentSize() const { return count; }
+    const Delivery &recent(size_t i) const { return ring[(head + count - 1 - i) % capacity]; }
+    bool empty() const { return count == 0; }
+
+    // Full history: ring, spill buffer and segment
+    uint64_t totalSize() const { return count + spillBuffer.size() + spilledCount; }
+    uint64_t getSpilledCount() const { return spilledCount; }
+    std::vector<Delivery> page(uint64_t offset, size_t limit) const; // Newest first
+};
+
+#endif // CANCELLED_LOG_H
@@ -0,0 +1,331 @@
+#include "ColumnarExport.h"
+#include "Delivery.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <unordered_map>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char COLUMNAR_MAGIC[8] = {'S', 'Q', 'C', 'O', 'L', 'U', 'M', 'N'};
+const uint32_t COLUMNAR_VERSION = 1;
+const uint32_t ENDIAN_MARKER = 0x01020304;
+
+uint64_t align8(uint64_t value) {
+    return (value + 7) & ~uint64_t(7);
+}
+
+// Buffered sequential writer that tracks the file position for padding
+class ColumnWriter {
+private:
+    std::FILE *file;
+    std::vector<char> buffer;
+    size_t used;
+    uint64_t position;
+    bool failed;
+
+public:
+    explicit ColumnWriter(std::FILE *f) : file(f), buffer(1 << 20), used(0), position(0), failed(false) {}
+
+    void write(const void *data, size_t bytes) {
+        const char *p = static_cast<const char *>(data);
+        while (bytes > 0) {
+            size_t n = std::min(bytes, buffer.size() - used);
+            std::memcpy(buffer.data() + used, p, n);
+            used += n;
+            p += n;
+            bytes -= n;
+            position += n;
+            if (used == buffer.size()) flush();
+        }
+    }
+
+    template <typename T>
+    void put(T value) { write(&value, sizeof(T)); }
+
+    void padTo(uint64_t offset) {
+        static const char zeros[8] = {0};
+        while (position < offset) write(zeros, std::min<uint64_t>(8, offset - position));
+    }
+
+    void flush() {
+        if (used > 0 && std::fwrite(buffer.data(), 1, used, file) != used) failed = true;
+        used = 0;
+    }
+
+    bool ok() const { return !failed; }
+};
+
+// Sizes every section must have for the header's row and dictionary counts
+bool expectedSectionBytes(const ColumnarHeader &h, uint64_t fileBytes, uint64_t (&bytes)[SECTION_COUNT])
+{
+    // Any count a file of this size can hold keeps the products below from overflowing
+    if (h.rowCount > fileBytes || h.dictionarySize > fileBytes) return false;
+    const uint64_t n = h.rowCount;
+    bytes[SECTION_ID_OFFSETS] = (n + 1) * sizeof(uint64_t);
+    bytes[SECTION_ID_BLOB] = h.sectionBytes[SECTION_ID_BLOB]; // Checked against the offsets
+    bytes[SECTION_TYPE] = n * sizeof(uint8_t);
+    bytes[SECTION_SCORE] = n * sizeof(double);
+    bytes[SECTION_ESTIMATED_TIME] = n * sizeof(int32_t);
+    bytes[SECTION_ENTRY_TIME] = n * sizeof(int64_t);
+    bytes[SECTION_START_TIME] = n * sizeof(int64_t);
+    bytes[SECTION_END_TIME] = n * sizeof(int64_t);
+    bytes[SECTION_DESTINATION_CODE] = n * sizeof(uint32_t);
+    bytes[SECTION_DICT_OFFSETS] = (h.dictionarySize + 1) * sizeof(uint64_t);
+    bytes[SECTION_DICT_BLOB] = h.sectionBytes[SECTION_DICT_BLOB];
+    return true;
+}
+
+// String offsets must start at 0, never decrease and end inside the blob
+bool validStringOffsets(const uint64_t *offsets, uint64_t count, uint64_t blobBytes)
+{
+    if (offsets[0] != 0) return false;
+    for (uint64_t i = 0; i < count; ++i) {
+        if (offsets[i + 1] < offsets[i]) return false;
+    }
+    return offsets[count] <= blobBytes;
+}
+
+} // namespace
+
+bool writeColumnarFile(const std::string &path, const std::vector<const Delivery *> &rows, ColumnarSource source)
+{
+    // Pass 1: dictionary encode destinations and size the string blobs
+    std::unordered_map<std::string, uint32_t> dictionary;
+    std::vector<const std::string *> dictionaryOrder;
+    uint64_t idBlobBytes = 0;
+    uint64_t dictBlobBytes = 0;
+    for (const Delivery *d : rows) {
+        idBlobBytes += d->deliveryId.size();
+        auto inserted = dictionary.emplace(d->destination, static_cast<uint32_t>(dictionaryOrder.size()));
+        if (inserted.second) {
+            dictionaryOrder.push_back(&inserted.first->first);
+            dictBlobBytes += d->destination.size();
+        }
+    }
+
+    const uint64_t n = rows.size();
+    ColumnarHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC));
+    header.version = COLUMNAR_VERSION;
+    header.endianMarker = ENDIAN_MARKER;
+    header.source = source;
+    header.rowCount = n;
+    header.dictionarySize = dictionaryOrder.size();
+
+    header.sectionBytes[SECTION_ID_OFFSETS] = (n + 1) * sizeof(uint64_t);
+    header.sectionBytes[SECTION_ID_BLOB] = idBlobBytes;
+    header.sectionBytes[SECTION_TYPE] = n * sizeof(uint8_t);
+    header.sectionBytes[SECTION_SCORE] = n * sizeof(double);
+    header.sectionBytes[SECTION_ESTIMATED_TIME] = n * sizeof(int32_t);
+    header.sectionBytes[SECTION_ENTRY_TIME] = n * sizeof(int64_t);
+    header.sectionBytes[SECTION_START_TIME] = n * sizeof(int64_t);
+    header.sectionBytes[SECTION_END_TIME] = n * sizeof(int64_t);
+    header.sectionBytes[SECTION_DESTINATION_CODE] = n * sizeof(uint32_t);
+    header.sectionBytes[SECTION_DICT_OFFSETS] = (dictionaryOrder.size() + 1) * sizeof(uint64_t);
+    header.sectionBytes[SECTION_DICT_BLOB] = dictBlobBytes;
+
+    uint64_t offset = align8(sizeof(ColumnarHeader));
+    for (int s = 0; s < SECTION_COUNT; ++s) {
+        header.sectionOffset[s] = offset;
+        offset = align8(offset + header.sectionBytes[s]);
+    }
+
+    std::FILE *file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    ColumnWriter out(file);
+    out.write(&header, sizeof(header));
+
+    // Pass 2: one sequential sweep per column
+    out.padTo(header.sectionOffset[SECTION_ID_OFFSETS]);
+    uint64_t idOffset = 0;
+    out.put(idOffset);
+    for (const Delivery *d : rows) {
+        idOffset += d->deliveryId.size();
+        out.put(idOffset);
+    }
+    out.padTo(header.sectionOffset[SECTION_ID_BLOB]);
+    for (const Delivery *d : rows) out.write(d->deliveryId.data(), d->deliveryId.size());
+
+    out.padTo(header.sectionOffset[SECTION_TYPE]);
+    for (const Delivery *d : rows) out.put(static_cast<uint8_t>(d->deliveryType));
+    out.padTo(header.sectionOffset[SECTION_SCORE]);
+    for (const Delivery *d : rows) out.put(d->priorityScore);
+    out.padTo(header.sectionOffset[SECTION_ESTIMATED_TIME]);
+    for (const Delivery *d : rows) out.put(static_cast<int32_t>(d->estimatedDeliveryTime));
+    out.padTo(header.sectionOffset[SECTION_ENTRY_TIME]);
+    for (const Delivery *d : rows) out.put(static_cast<int64_t>(d->entryTime));
+    out.padTo(header.sectionOffset[SECTION_START_TIME]);
+    for (const Delivery *d : rows) out.put(static_cast<int64_t>(d->serviceStartTime));
+    out.padTo(header.sectionOffset[SECTION_END_TIME]);
+    for (const Delivery *d : rows) out.put(static_cast<int64_t>(d->serviceEndTime));
+    out.padTo(header.sectionOffset[SECTION_DESTINATION_CODE]);
+    for (const Delivery *d : rows) out.put(dictionary.find(d->destination)->second);
+
+    out.padTo(header.sectionOffset[SECTION_DICT_OFFSETS]);
+    uint64_t dictOffset = 0;
+    out.put(dictOffset);
+    for (const std::string *name : dictionaryOrder) {
+        dictOffset += name->size();
+        out.put(dictOffset);
+    }
+    out.padTo(header.sectionOffset[SECTION_DICT_BLOB]);
+    for (const std::string *name : dictionaryOrder) out.write(name->data(), name->size());
+    out.padTo(offset);
+
+    out.flush();
+    bool ok = out.ok();
+    if (std::fclose(file) != 0) ok = false;
+    return ok;
+}
+
+bool ColumnarFile::open(const std::string &path)
+{
+    close();
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(ColumnarHeader))) {
+        ::close(fd);
+        return false;
+    }
+    void *addr = mmap(nullptr, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) return false;
+    base = static_cast<const unsigned char *>(addr);
+    mappedBytes = st.st_size;
+    mapped = true;
+#else
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::fseek(file, 0, SEEK_END);
+    long size = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (size < static_cast<long>(sizeof(ColumnarHeader))) {
+        std::fclose(file);
+        return false;
+    }
+    fallbackData.resize(size);
+    size_t got = std::fread(fallbackData.data(), 1, size, file);
+    std::fclose(file);
+    if (got != static_cast<size_t>(size)) return false;
+    base = fallbackData.data();
+    mappedBytes = size;
+#endif
+
+    // Every later access trusts the header, so a truncated or damaged file is
+    // rejected here: section sizes must match the counts, lie inside the file,
+    // and the string offsets and dictionary codes must stay in range
+    const ColumnarHeader *h = reinterpret_cast<const ColumnarHeader *>(base);
+    uint64_t expected[SECTION_COUNT];
+    bool valid = std::memcmp(h->magic, COLUMNAR_MAGIC, sizeof(COLUMNAR_MAGIC)) == 0 &&
+                 h->version == COLUMNAR_VERSION && h->endianMarker == ENDIAN_MARKER &&
+                 expectedSectionBytes(*h, mappedBytes, expected);
+    for (int s = 0; valid && s < SECTION_COUNT; ++s) {
+        valid = h->sectionBytes[s] == expected[s] && h->sectionOffset[s] % 8 == 0 &&
+                h->sectionBytes[s] <= mappedBytes && h->sectionOffset[s] <= mappedBytes - h->sectionBytes[s];
+    }
+    if (valid) {
+        header = h;
+        valid = validStringOffsets(column<uint64_t>(SECTION_ID_OFFSETS), h->rowCount, h->sectionBytes[SECTION_ID_BLOB]) &&
+                validStringOffsets(column<uint64_t>(SECTION_DICT_OFFSETS), h->dictionarySize,
+                                   h->sectionBytes[SECTION_DICT_BLOB]);
+        const uint32_t *codes = destinationCodes();
+        for (uint64_t i = 0; valid && i < h->rowCount; ++i) {
+            valid = codes[i] < h->dictionarySize;
+        }
+    }
+    if (!valid) {
+        close();
+        return false;
+    }
+    return true;
+}
+
+void ColumnarFile::close()
+{
+#ifndef _WIN32
+    if (mapped && base) munmap(const_cast<unsigned char *>(base), mappedBytes);
+#endif
+    fallbackData.clear();
+    base = nullptr;
+    mappedBytes = 0;
+    mapped = false;
+    header = nullptr;
+}
+
+std::string_view ColumnarFile::id(uint64_t row) const
+{
+    const uint64_t *offsets = column<uint64_t>(SECTION_ID_OFFSETS);
+    const char *blob = column<char>(SECTION_ID_BLOB);
+    return std::string_view(blob + offsets[row], offsets[row + 1] - offsets[row]);
+}
+
+std::string_view ColumnarFile::dictionaryEntry(uint64_t code) const
+{
+    const uint64_t *offsets = column<uint64_t>(SECTION_DICT_OFFSETS);
+    const char *blob = column<char>(SECTION_DICT_BLOB);
+    return std::string_view(blob + offsets[code], offsets[code + 1] - offsets[code]);
+}
+
+int64_t ColumnarFile::findDestinationCode(const std::string &name) const
+{
+    for (uint64_t code = 0; code < header->dictionarySize; ++code) {
+        if (dictionaryEntry(code) == name) return static_cast<int64_t>(code);
+    }
+    return -1;
+}
+
+ColumnarAggregate ColumnarFile::aggregate(const ColumnarFilter &filter) const
+{
+    ColumnarAggregate result;
+    int64_t destinationCode = -1;
+    if (!filter.destination.empty()) {
+        destinationCode = findDestinationCode(filter.destination);
+        if (destinationCode < 0) return result;
+    }
+
+    const uint8_t *type = types();
+    const double *score = scores();
+    const int64_t *entry = entryTimes();
+    const int64_t *start = startTimes();
+    const int64_t *end = endTimes();
+    const uint32_t *dest = destinationCodes();
+
+    double scoreSum = 0.0, waitSum = 0.0, serviceSum = 0.0;
+    uint64_t served = 0; // Cancelled rows never started service
+    const uint64_t n = header->rowCount;
+    for (uint64_t i = 0; i < n; ++i) {
+        if (filter.type >= 0 && type[i] != filter.type) continue;
+        if (destinationCode >= 0 && dest[i] != static_cast<uint32_t>(destinationCode)) continue;
+        if (score[i] < filter.minScore) continue;
+
+        if (result.count == 0 || score[i] > result.maxScore) result.maxScore = score[i];
+        ++result.count;
+        scoreSum += score[i];
+        if (start[i] != 0) {
+            ++served;
+            waitSum += static_cast<double>(start[i] - entry[i]);
+            serviceSum += static_cast<double>(end[i] - start[i]);
+        }
+    }
+
+    if (result.count > 0) {
+        result.meanScore = scoreSum / result.count;
+    }
+    if (served > 0) {
+        result.meanWaitMinutes = waitSum / 60.0 / served;
+        result.meanServiceMinutes = serviceSum / 60.0 / served;
+    }
+    return result;
+}
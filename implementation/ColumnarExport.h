@@ -0,0 +1,115 @@
+#ifndef COLUMNAR_EXPORT_H
+#define COLUMNAR_EXPORT_H
+
+#include <cstdint>
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DeliveryTypes.h"
+
+class Delivery;
+
+// Columnar binary export of delivery records (".sqc" files).
+//
+// Layout: a fixed header with a section table, followed by one 8-byte aligned
+// array per column. Strings are stored as an offset array plus a byte blob;
+// destinations are dictionary encoded. Everything is written in host byte
+// order and the header records an endianness marker, so the reader can use
+// the mapped arrays directly without parsing.
+enum ColumnarSource : uint32_t {
+    COLUMNAR_PROCESSED = 1,
+    COLUMNAR_CANCELLED = 2
+};
+
+enum ColumnarSection {
+    SECTION_ID_OFFSETS,         // uint64[rows + 1]
+    SECTION_ID_BLOB,            // char[]
+    SECTION_TYPE,               // uint8[rows]
+    SECTION_SCORE,              // double[rows]
+    SECTION_ESTIMATED_TIME,     // int32[rows]
+    SECTION_ENTRY_TIME,         // int64[rows]
+    SECTION_START_TIME,         // int64[rows]
+    SECTION_END_TIME,           // int64[rows]
+    SECTION_DESTINATION_CODE,   // uint32[rows]
+    SECTION_DICT_OFFSETS,       // uint64[dictionary + 1]
+    SECTION_DICT_BLOB,          // char[]
+    SECTION_COUNT
+};
+
+struct ColumnarHeader {
+    char magic[8];              // "SQCOLUMN"
+    uint32_t version;
+    uint32_t endianMarker;      // 0x01020304 as written by the host
+    uint32_t source;            // ColumnarSource
+    uint32_t reserved;
+    uint64_t rowCount;
+    uint64_t dictionarySize;
+    uint64_t sectionOffset[SECTION_COUNT];
+    uint64_t sectionBytes[SECTION_COUNT];
+};
+
+// Writes rows column by column; memory use is the destination dictionary only
+bool writeColumnarFile(const std::string &path, const std::vector<const Delivery *> &rows, ColumnarSource source);
+
+// Filter for ColumnarFile::aggregate; negative / empty fields are ignored
+struct ColumnarFilter {
+    int type = -1;              // DeliveryType
+    std::string destination;
+    double minScore = -1e300;
+};
+
+struct ColumnarAggregate {
+    uint64_t count = 0;
+    double meanScore = 0.0;
+    double maxScore = 0.0;
+    double meanWaitMinutes = 0.0;
+    double meanServiceMinutes = 0.0;
+};
+
+// Read-only view of a .sqc file mapped into memory
+class ColumnarFile {
+private:
+    const unsigned char *base;
+    size_t mappedBytes;
+    bool mapped;                // false when the file was read into fallbackData
+    std::vector<unsigned char> fallbackData;
+    const ColumnarHeader *header;
+
+    template <typename T>
+    const T *column(ColumnarSection section) const {
+        return reinterpret_cast<const T *>(base + header->sectionOffset[section]);
+    }
+
+public:
+    ColumnarFile() : base(nullptr), mappedBytes(0), mapped(false), header(nullptr) {}
+    ~ColumnarFile() { close(); }
+    ColumnarFile(const ColumnarFile &) = delete;
+    ColumnarFile &operator=(const ColumnarFile &) = delete;
+
+    bool open(const std::string &path);
+    void close();
+    bool isOpen() const { return header != nullptr; }
+
+    uint64_t rowCount() const { return header->rowCount; }
+    ColumnarSource source() const { return static_cast<ColumnarSource>(header->source); }
+
+    // Raw column access
+    const uint8_t *types() const { return column<uint8_t>(SECTION_TYPE); }
+    const double *scores() const { return column<double>(SECTION_SCORE); }
+    const int32_t *estimatedTimes() const { return column<int32_t>(SECTION_ESTIMATED_TIME); }
+    const int64_t *entryTimes() const { return column<int64_t>(SECTION_ENTRY_TIME); }
+    const int64_t *startTimes() const { return column<int64_t>(SECTION_START_TIME); }
+    const int64_t *endTimes() const { return column<int64_t>(SECTION_END_TIME); }
+    const uint32_t *destinationCodes() const { return column<uint32_t>(SECTION_DESTINATION_CODE); }
+
+    std::string_view id(uint64_t row) const;
+    std::string_view destination(uint64_t row) const { return dictionaryEntry(destinationCodes()[row]); }
+    uint64_t dictionarySize() const { return header->dictionarySize; }
+    std::string_view dictionaryEntry(uint64_t code) const;
+    int64_t findDestinationCode(const std::string &name) const; // -1 when absent
+
+    ColumnarAggregate aggregate(const ColumnarFilter &filter) const;
+};
+
+#endif // COLUMNAR_EXPORT_H
@@ -9,6 +9,17 @@ float ConfigurationManager::boostMultiplier = 0.5f;
 int ConfigurationManager::simulationDuration = 60;
 float ConfigurationManager::simulationArrivalRate = 0.5f;
 int ConfigurationManager::simulationCounters = 3;
+int ConfigurationManager::processedHistoryLimit = 10000;
+int ConfigurationManager::schedulerMode = SCHEDULER_STRICT;
+std::map<DeliveryType, float> ConfigurationManager::classShares;
+std::map<DeliveryType, int> ConfigurationManager::slaMinutes;
+int ConfigurationManager::overloadPolicy = OVERLOAD_DEFER;
+float ConfigurationManager::sjfAging = 0.1f;
+int ConfigurationManager::batchMaxExtra = 0;
+float ConfigurationManager::batchMaxGap = 5.0f;
+unsigned long long ConfigurationManager::version = 0;
+ConfigurationManager::ChangeListener ConfigurationManager::changeListener = nullptr;
+void *ConfigurationManager::changeListenerContext = nullptr;
 
 void ConfigurationManager::initialize()
 {
@@ -27,6 +38,20 @@ void ConfigurationManager::initialize()
     simulationDuration = 60;
     simulationArrivalRate = 0.5f;
     simulationCounters = 3;
+    processedHistoryLimit = 10000;
+
+    schedulerMode = SCHEDULER_STRICT;
+    classShares[URGENT] = 0.5f;
+    classShares[FRAGILE] = 0.3f;
+    classShares[STANDARD] = 0.2f;
+
+    slaMinutes[URGENT] = 180;
+    slaMinutes[FRAGILE] = 360;
+    slaMinutes[STANDARD] = 720;
+    overloadPolicy = OVERLOAD_DEFER;
+    sjfAging = 0.1f;
+    batchMaxExtra = 0;
+    batchMaxGap = 5.0f;
 }
 
 float ConfigurationManager::getWeight(const std::string &key)
@@ -42,6 +67,7 @@ float ConfigurationManager::getWeight(const std::string &key)
 void ConfigurationManager::setWeight(const std::string &key, float value)
 {
     weights[key] = value;
+    notifyChange("weight." + key, value);
 }
 
 int ConfigurationManager::getServiceTypeScore(DeliveryType type)
@@ -57,6 +83,173 @@ int ConfigurationManager::getServiceTypeScore(DeliveryType type)
 void ConfigurationManager::setServiceTypeScore(DeliveryType type, int score)
 {
     serviceTypeScores[type] = score;
+    switch (type)
+    {
+    case URGENT:
+        notifyChange("score.urgent", score);
+        break;
+    case STANDARD:
+        notifyChange("score.standard", score);
+        break;
+    case FRAGILE:
+        notifyChange("score.fragile", score);
+        break;
+    }
+}
+
+float ConfigurationManager::getClassShare(DeliveryType type)
+{
+    auto it = classShares.find(type);
+    if (it != classShares.end())
+    {
+        return it->second;
+    }
+    return 0.0f;
+}
+
+void ConfigurationManager::setClassShare(DeliveryType type, float share)
+{
+    classShares[type] = share;
+    switch (type)
+    {
+    case URGENT:
+        notifyChange("share.urgent", share);
+        break;
+    case STANDARD:
+        notifyChange("share.standard", share);
+        break;
+    case FRAGILE:
+        notifyChange("share.fragile", share);
+        break;
+    }
+}
+
+int ConfigurationManager::getSlaMinutes(DeliveryType type)
+{
+    auto it = slaMinutes.find(type);
+    if (it != slaMinutes.end())
+    {
+        return it->second;
+    }
+    return 0;
+}
+
+void ConfigurationManager::setSlaMinutes(DeliveryType type, int minutes)
+{
+    slaMinutes[type] = minutes;
+    switch (type)
+    {
+    case URGENT:
+        notifyChange("sla.urgent", minutes);
+        break;
+    case STANDARD:
+        notifyChange("sla.standard", minutes);
+        break;
+    case FRAGILE:
+        notifyChange("sla.fragile", minutes);
+        break;
+    }
+}
+
+bool ConfigurationManager::applySetting(const std::string &key, double value)
+{
+    if (key.compare(0, 7, "weight.") == 0)
+        weights[key.substr(7)] = static_cast<float>(value);
+    else if (key == "score.urgent")
+        serviceTypeScores[URGENT] = static_cast<int>(value);
+    else if (key == "score.standard")
+        serviceTypeScores[STANDARD] = static_cast<int>(value);
+    else if (key == "score.fragile")
+        serviceTypeScores[FRAGILE] = static_cast<int>(value);
+    else if (key == "max_wait_time")
+        maxWaitTime = static_cast<int>(value);
+    else if (key == "boost_multiplier")
+        boostMultiplier = static_cast<float>(value);
+    else if (key == "simulation_duration")
+        simulationDuration = static_cast<int>(value);
+    else if (key == "simulation_arrival_rate")
+        simulationArrivalRate = static_cast<float>(value);
+    else if (key == "simulation_counters")
+        simulationCounters = static_cast<int>(value);
+    else if (key == "processed_history_limit")
+        processedHistoryLimit = static_cast<int>(value);
+    else if (key == "scheduler_mode")
+    {
+        int mode = static_cast<int>(value);
+        schedulerMode = mode == SCHEDULER_DRR || mode == SCHEDULER_EDF || mode == SCHEDULER_SJF ? mode : SCHEDULER_STRICT;
+    }
+    else if (key == "share.urgent")
+        classShares[URGENT] = static_cast<float>(value);
+    else if (key == "share.standard")
+        classShares[STANDARD] = static_cast<float>(value);
+    else if (key == "share.fragile")
+        classShares[FRAGILE] = static_cast<float>(value);
+    else if (key == "sla.urgent")
+        slaMinutes[URGENT] = static_cast<int>(value);
+    else if (key == "sla.standard")
+        slaMinutes[STANDARD] = static_cast<int>(value);
+    else if (key == "sla.fragile")
+        slaMinutes[FRAGILE] = static_cast<int>(value);
+    else if (key == "edf_overload")
+        overloadPolicy = static_cast<int>(value) == OVERLOAD_DROP ? OVERLOAD_DROP : OVERLOAD_DEFER;
+    else if (key == "sjf_aging")
+        sjfAging = static_cast<float>(value);
+    else if (key == "batch_max_extra")
+        batchMaxExtra = static_cast<int>(value);
+    else if (key == "batch_max_gap")
+        batchMaxGap = static_cast<float>(value);
+    else
+        return false;
+    return true;
+}
+
+bool ConfigurationManager::updateSetting(const std::string &key, double value)
+{
+    if (!applySetting(key, value))
+        return false;
+    notifyChange(key, value);
+    return true;
+}
+
+std::vector<std::pair<std::string, double>> ConfigurationManager::getSettings()
+{
+    std::vector<std::pair<std::string, double>> settings;
+    for (const auto &w : weights)
+        settings.emplace_back("weight." + w.first, w.second);
+    settings.emplace_back("score.urgent", getServiceTypeScore(URGENT));
+    settings.emplace_back("score.standard", getServiceTypeScore(STANDARD));
+    settings.emplace_back("score.fragile", getServiceTypeScore(FRAGILE));
+    settings.emplace_back("max_wait_time", maxWaitTime);
+    settings.emplace_back("boost_multiplier", boostMultiplier);
+    settings.emplace_back("simulation_duration", simulationDuration);
+    settings.emplace_back("simulation_arrival_rate", simulationArrivalRate);
+    settings.emplace_back("simulation_counters", simulationCounters);
+    settings.emplace_back("processed_history_limit", processedHistoryLimit);
+    settings.emplace_back("scheduler_mode", schedulerMode);
+    settings.emplace_back("share.urgent", getClassShare(URGENT));
+    settings.emplace_back("share.standard", getClassShare(STANDARD));
+    settings.emplace_back("share.fragile", getClassShare(FRAGILE));
+    settings.emplace_back("sla.urgent", getSlaMinutes(URGENT));
+    settings.emplace_back("sla.standard", getSlaMinutes(STANDARD));
+    settings.emplace_back("sla.fragile", getSlaMinutes(FRAGILE));
+    settings.emplace_back("edf_overload", overloadPolicy);
+    settings.emplace_back("sjf_aging", sjfAging);
+    settings.emplace_back("batch_max_extra", batchMaxExtra);
+    settings.emplace_back("batch_max_gap", batchMaxGap);
+    return settings;
+}
+
+void ConfigurationManager::setChangeListener(ChangeListener listener, void *context)
+{
+    changeListener = listener;
+    changeListenerContext = context;
+}
+
+void ConfigurationManager::notifyChange(const std::string &key, double value)
+{
+    ++version;
+    if (changeListener)
+        changeListener(changeListenerContext, key, value);
 }
 
 void ConfigurationManager::configure()
@@ -87,6 +280,9 @@ void ConfigurationManager::configure()
     std::cout << "Enter number of service counters (current: " << simulationCounters << "): ";
     std::cin >> simulationCounters;
 
+    std::cout << "Enter processed deliveries kept for reports, 0 = all (current: " << processedHistoryLimit << "): ";
+    std::cin >> processedHistoryLimit;
+
     std::cout << "Enter URGENT service type score (current: " << serviceTypeScores[URGENT] << "): ";
     std::cin >> serviceTypeScores[URGENT];
     std::cout << "Enter STANDARD service type score (current: " << serviceTypeScores[STANDARD] << "): ";
@@ -94,5 +290,32 @@ void ConfigurationManager::configure()
     std::cout << "Enter FRAGILE service type score (current: " << serviceTypeScores[FRAGILE] << "): ";
     std::cin >> serviceTypeScores[FRAGILE];
 
+    std::cout << "Enter scheduler, 0 = strict priority, 1 = deficit round robin, 2 = earliest deadline first, 3 = shortest job first (current: "
+              << schedulerMode << "): ";
+    std::cin >> schedulerMode;
+    std::cout << "Enter URGENT capacity share (current: " << classShares[URGENT] << "): ";
+    std::cin >> classShares[URGENT];
+    std::cout << "Enter STANDARD capacity share (current: " << classShares[STANDARD] << "): ";
+    std::cin >> classShares[STANDARD];
+    std::cout << "Enter FRAGILE capacity share (current: " << classShares[FRAGILE] << "): ";
+    std::cin >> classShares[FRAGILE];
+    std::cout << "Enter URGENT SLA in minutes (current: " << slaMinutes[URGENT] << "): ";
+    std::cin >> slaMinutes[URGENT];
+    std::cout << "Enter STANDARD SLA in minutes (current: " << slaMinutes[STANDARD] << "): ";
+    std::cin >> slaMinutes[STANDARD];
+    std::cout << "Enter FRAGILE SLA in minutes (current: " << slaMinutes[FRAGILE] << "): ";
+    std::cin >> slaMinutes[FRAGILE];
+    std::cout << "Enter late deliveries under EDF, 0 = defer, 1 = drop (current: " << overloadPolicy << "): ";
+    std::cin >> overloadPolicy;
+    std::cout << "Enter SJF aging, estimate minutes forgiven per minute waited (current: " << sjfAging << "): ";
+    std::cin >> sjfAging;
+    std::cout << "Enter same-destination deliveries added to a trip, 0 = off (current: " << batchMaxExtra << "): ";
+    std::cin >> batchMaxExtra;
+    std::cout << "Enter largest priority score gap within a trip (current: " << batchMaxGap << "): ";
+    std::cin >> batchMaxGap;
+
+    for (const auto &setting : getSettings())
+        notifyChange(setting.first, setting.second);
+
     std::cout << "Configuration updated successfully.\n";
 }
@@ -3,11 +3,30 @@
 
 #include <map>
 #include <string>
+#include <utility>
+#include <vector>
 #include "DeliveryTypes.h" // For DeliveryType enum
 
+// How DeliveryManager::processNextDelivery() picks the class to serve
+enum SchedulerMode {
+    SCHEDULER_STRICT = 0, // Urgent, then fragile, then standard
+    SCHEDULER_DRR = 1,    // Deficit round robin over estimated minutes, weighted by class share
+    SCHEDULER_EDF = 2,    // Earliest deadline (entry time + class SLA) first
+    SCHEDULER_SJF = 3     // Shortest estimate first, aged by time waited
+};
+
+// What SCHEDULER_EDF does with deliveries that can no longer meet their deadline
+enum OverloadPolicy {
+    OVERLOAD_DEFER = 0, // Serve them, least late first, once nothing on time is waiting
+    OVERLOAD_DROP = 1   // Cancel them as soon as something on time is dispatched instead
+};
+
 class ConfigurationManager
 {
 public:
+    // Called after every setting change (e.g. so the write-ahead log can record it)
+    typedef void (*ChangeListener)(void *context, const std::string &key, double value);
+
     static std::map<std::string, float> weights;
     static std::map<DeliveryType, int> serviceTypeScores;
     static int maxWaitTime;
@@ -15,6 +34,14 @@ public:
     static int simulationDuration;
     static float simulationArrivalRate;
     static int simulationCounters;
+    static int processedHistoryLimit; // 0 keeps every processed delivery
+    static int schedulerMode;         // SchedulerMode
+    static std::map<DeliveryType, float> classShares; // Relative counter capacity per class under SCHEDULER_DRR
+    static std::map<DeliveryType, int> slaMinutes;    // Deadline after entry, per class
+    static int overloadPolicy;                        // OverloadPolicy
+    static float sjfAging;                            // SCHEDULER_SJF: estimate minutes forgiven per minute waited
+    static int batchMaxExtra;                         // Same-destination deliveries a counter may add to a trip, 0 = off
+    static float batchMaxGap;                         // Largest score gap below the trip's first delivery
 
     static void initialize();
 
@@ -30,19 +57,58 @@ public:
 
     // Getters and Setters for Fairness Thresholds
     static int getMaxWaitTime() { return maxWaitTime; }
-    static void setMaxWaitTime(int value) { maxWaitTime = value; }
+    static void setMaxWaitTime(int value) { maxWaitTime = value; notifyChange("max_wait_time", value); }
     static float getBoostMultiplier() { return boostMultiplier; }
-    static void setBoostMultiplier(float value) { boostMultiplier = value; }
+    static void setBoostMultiplier(float value) { boostMultiplier = value; notifyChange("boost_multiplier", value); }
 
     // Getters and Setters for Simulation Parameters
     static int getSimulationDuration() { return simulationDuration; }
-    static void setSimulationDuration(int value) { simulationDuration = value; }
+    static void setSimulationDuration(int value) { simulationDuration = value; notifyChange("simulation_duration", value); }
     static float getSimulationArrivalRate() { return simulationArrivalRate; }
-    static void setSimulationArrivalRate(float value) { simulationArrivalRate = value; }
+    static void setSimulationArrivalRate(float value) { simulationArrivalRate = value; notifyChange("simulation_arrival_rate", value); }
     static int getSimulationCounters() { return simulationCounters; }
-    static void setServiceCounters(int value) { simulationCounters = value; }
+    static void setServiceCounters(int value) { simulationCounters = value; notifyChange("simulation_counters", value); }
+
+    // Number of processed deliveries kept for detailed reports (statistics cover all of them)
+    static int getProcessedHistoryLimit() { return processedHistoryLimit; }
+    static void setProcessedHistoryLimit(int value) { processedHistoryLimit = value; notifyChange("processed_history_limit", value); }
+
+    // Class scheduling
+    static SchedulerMode getSchedulerMode() { return static_cast<SchedulerMode>(schedulerMode); }
+    static void setSchedulerMode(SchedulerMode mode) { schedulerMode = mode; notifyChange("scheduler_mode", mode); }
+    static float getClassShare(DeliveryType type);
+    static void setClassShare(DeliveryType type, float share);
+    static int getSlaMinutes(DeliveryType type);
+    static void setSlaMinutes(DeliveryType type, int minutes);
+    static OverloadPolicy getOverloadPolicy() { return static_cast<OverloadPolicy>(overloadPolicy); }
+    static void setOverloadPolicy(OverloadPolicy policy) { overloadPolicy = policy; notifyChange("edf_overload", policy); }
+    static float getSjfAging() { return sjfAging; }
+    static void setSjfAging(float value) { sjfAging = value; notifyChange("sjf_aging", value); }
+
+    // Destination batching (DeliveryManager::processNextBatch)
+    static int getBatchMaxExtra() { return batchMaxExtra; }
+    static void setBatchMaxExtra(int value) { batchMaxExtra = value; notifyChange("batch_max_extra", value); }
+    static float getBatchMaxGap() { return batchMaxGap; }
+    static void setBatchMaxGap(float value) { batchMaxGap = value; notifyChange("batch_max_gap", value); }
 
     static void configure(); // New method for admin console configuration
+
+    // Generic access by key ("weight.urgency", "score.fragile", "max_wait_time", ...)
+    static bool applySetting(const std::string &key, double value); // Does not notify the listener
+    static bool updateSetting(const std::string &key, double value); // applySetting + notify
+    static std::vector<std::pair<std::string, double>> getSettings();
+
+    static void setChangeListener(ChangeListener listener, void *context);
+
+    // Bumped on every change; stored in snapshots
+    static unsigned long long getVersion() { return version; }
+    static void restoreVersion(unsigned long long value) { version = value; }
+
+private:
+    static unsigned long long version;
+    static ChangeListener changeListener;
+    static void *changeListenerContext;
+    static void notifyChange(const std::string &key, double value);
 };
 
 #endif // CONFIGURATION_MANAGER_H
@@ -6,8 +6,31 @@
 #include <ostream>
 #include <ctime>
 #include "ConfigurationManager.h"
+#include "DeliveryClock.h"
 #include "DeliveryTypes.h" // Include the common enum definition
 
+// Scoring inputs read once from ConfigurationManager, so batches can score
+// many deliveries without a settings lookup per delivery
+struct ScoringWeights
+{
+    float urgency;
+    float waitingTime;
+    float serviceType;
+    int serviceTypeScore[3]; // Indexed by DeliveryType
+
+    static ScoringWeights current()
+    {
+        ScoringWeights w;
+        w.urgency = ConfigurationManager::getWeight("urgency");
+        w.waitingTime = ConfigurationManager::getWeight("waiting_time");
+        w.serviceType = ConfigurationManager::getWeight("service_type");
+        w.serviceTypeScore[URGENT] = ConfigurationManager::getServiceTypeScore(URGENT);
+        w.serviceTypeScore[STANDARD] = ConfigurationManager::getServiceTypeScore(STANDARD);
+        w.serviceTypeScore[FRAGILE] = ConfigurationManager::getServiceTypeScore(FRAGILE);
+        return w;
+    }
+};
+
 class Delivery
 {
 public:
@@ -25,7 +48,7 @@ public:
                                                                                  deliveryType(type),
                                                                                  estimatedDeliveryTime(estTime),
                                                                                  priorityScore(0.0),
-                                                                                 entryTime(time(0)),
+                                                                                 entryTime(DeliveryClock::now()),
                                                                                  serviceStartTime(0),
                                                                                  serviceEndTime(0)
     {
@@ -47,13 +70,17 @@ public:
     // New methods for priority calculation and boosting
     void calculatePriorityScore()
     {
-        float urgency_weight = ConfigurationManager::getWeight("urgency");
-        float waiting_time_weight = ConfigurationManager::getWeight("waiting_time");
-        float service_type_weight = ConfigurationManager::getWeight("service_type");
+        calculatePriorityScore(ScoringWeights::current(), DeliveryClock::now());
+    }
+
+    void calculatePriorityScore(const ScoringWeights &weights, time_t current_time)
+    {
+        float urgency_weight = weights.urgency;
+        float waiting_time_weight = weights.waitingTime;
+        float service_type_weight = weights.serviceType;
 
-        int service_type_score = ConfigurationManager::getServiceTypeScore(this->deliveryType);
+        int service_type_score = weights.serviceTypeScore[this->deliveryType];
 
-        time_t current_time = time(0);
         double seconds_waited = difftime(current_time, this->entryTime);
         int current_waiting_time = static_cast<int>(seconds_waited / 60.0);
 
@@ -79,7 +106,7 @@ public:
 
     void boostPriority()
     {
-        time_t current_time = time(0);
+        time_t current_time = DeliveryClock::now();
         double seconds_waited = difftime(current_time, this->entryTime);
         int current_waiting_time = static_cast<int>(seconds_waited / 60.0);
 
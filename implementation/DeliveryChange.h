@@ -0,0 +1,27 @@
+#ifndef DELIVERY_CHANGE_H
+#define DELIVERY_CHANGE_H
+
+#include <cstdint>
+
+class Delivery;
+
+enum DeliveryChangeType : uint8_t {
+    CHANGE_ADD,
+    CHANGE_DISPATCH,
+    CHANGE_CANCEL,
+    CHANGE_RESCORE,   // New score (updatePriorities also returns merged deliveries to their own queue)
+    CHANGE_MERGE      // Moved to another queue by mergeQueues()
+};
+
+// One entry of DeliveryManager's change stream
+struct DeliveryChange {
+    uint64_t seq;                 // 1, 2, 3... per DeliveryManager, no gaps
+    DeliveryChangeType type;
+    const Delivery *delivery;     // State after the change; valid only during the callback
+    int queue;                    // Queue holding it afterwards, -1 once dispatched or cancelled
+    int fromQueue;                // Queue it was in before, -1 for adds
+};
+
+typedef void (*DeliveryChangeListener)(void *context, const DeliveryChange &change);
+
+#endif // DELIVERY_CHANGE_H
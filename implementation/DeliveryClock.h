@@ -0,0 +1,21 @@
+#ifndef DELIVERY_CLOCK_H
+#define DELIVERY_CLOCK_H
+
+#include <ctime>
+
+// Current time for entry stamps, scoring and dispatch. The wall clock unless
+// a simulation installs its own source (e.g. bench/policy_compare), so
+// waiting times can be driven in simulated minutes.
+class DeliveryClock
+{
+public:
+    typedef time_t (*Source)();
+
+    static time_t now() { return source ? source() : time(0); }
+    static void setSource(Source clock) { source = clock; } // Null restores the wall clock
+
+private:
+    inline static Source source = nullptr;
+};
+
+#endif // DELIVERY_CLOCK_H
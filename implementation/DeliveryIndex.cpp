@@ -0,0 +1,131 @@
+#include "DeliveryIndex.h"
+#include "BinaryIO.h"
+
+namespace {
+
+const size_t INITIAL_CAPACITY = 1024;
+
+// Grow at 80% load: ~16-20 bytes per tracked delivery
+bool overLoaded(size_t used, size_t capacity) {
+    return used * 5 >= capacity * 4;
+}
+
+} // namespace
+
+uint64_t DeliveryIndex::hashId(const std::string &id)
+{
+    uint64_t h = fnv1a64(id.data(), id.size());
+    h ^= h >> 33; // FNV's low bits are weak for short keys; mix before masking
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    return h == 0 ? 1 : h;
+}
+
+DeliveryIndexEntry &DeliveryIndex::slotFor(uint64_t hash)
+{
+    if (overLoaded(used + 1, entries.size())) {
+        grow();
+    }
+    size_t mask = entries.size() - 1;
+    size_t i = hash & mask;
+    while (entries[i].hash != 0 && entries[i].hash != hash) {
+        i = (i + 1) & mask;
+    }
+    if (entries[i].hash == 0) {
+        entries[i].hash = hash;
+        ++used;
+    }
+    return entries[i];
+}
+
+size_t DeliveryIndex::findSlot(uint64_t hash) const
+{
+    size_t mask = entries.size() - 1;
+    size_t i = hash & mask;
+    while (entries[i].hash != 0) {
+        if (entries[i].hash == hash) return i;
+        i = (i + 1) & mask;
+    }
+    return entries.size();
+}
+
+void DeliveryIndex::eraseSlot(size_t i)
+{
+    // Backward-shift deletion: pull later entries of the probe run into the
+    // hole unless their home slot lies between the hole and them
+    size_t mask = entries.size() - 1;
+    size_t hole = i;
+    for (size_t j = (i + 1) & mask; entries[j].hash != 0; j = (j + 1) & mask) {
+        size_t home = entries[j].hash & mask;
+        bool stays = hole <= j ? (hole < home && home <= j) : (hole < home || home <= j);
+        if (!stays) {
+            entries[hole] = entries[j];
+            hole = j;
+        }
+    }
+    entries[hole] = DeliveryIndexEntry();
+    --used;
+}
+
+void DeliveryIndex::grow()
+{
+    std::vector<DeliveryIndexEntry> old;
+    old.swap(entries);
+    entries.assign(old.size() * 2, DeliveryIndexEntry());
+    size_t mask = entries.size() - 1;
+    for (const DeliveryIndexEntry &e : old) {
+        if (e.hash == 0) continue;
+        size_t i = e.hash & mask;
+        while (entries[i].hash != 0) i = (i + 1) & mask;
+        entries[i] = e;
+    }
+}
+
+void DeliveryIndex::setQueued(const std::string &id, int queue, int slot)
+{
+    DeliveryIndexEntry &e = slotFor(hashId(id));
+    e.status = STATUS_QUEUED;
+    e.queue = static_cast<uint8_t>(queue);
+    e.slot = slot;
+}
+
+void DeliveryIndex::setStatus(const std::string &id, DeliveryStatus status)
+{
+    // Evict the ID this ring position held, unless its entry has moved on
+    // (queued again, or terminal again at a newer position)
+    int32_t position = static_cast<int32_t>(terminalNext);
+    if (terminalIds.size() < terminalLimit) {
+        terminalIds.push_back(id);
+    } else {
+        size_t old = findSlot(hashId(terminalIds[terminalNext]));
+        if (old < entries.size() && entries[old].status != STATUS_QUEUED && entries[old].slot == position) {
+            eraseSlot(old);
+        }
+        terminalIds[terminalNext] = id;
+    }
+    terminalNext = (terminalNext + 1) % terminalLimit;
+
+    DeliveryIndexEntry &e = slotFor(hashId(id));
+    e.status = status;
+    e.slot = position;
+}
+
+bool DeliveryIndex::find(const std::string &id, DeliveryIndexEntry &entry) const
+{
+    size_t i = findSlot(hashId(id));
+    if (i == entries.size()) return false;
+    const DeliveryIndexEntry &e = entries[i];
+    if (e.status != STATUS_QUEUED && terminalIds[e.slot] != id) {
+        return false; // Another ID with the same hash
+    }
+    entry = e;
+    return true;
+}
+
+void DeliveryIndex::clear()
+{
+    entries.assign(INITIAL_CAPACITY, DeliveryIndexEntry());
+    used = 0;
+    terminalIds.clear();
+    terminalNext = 0;
+}
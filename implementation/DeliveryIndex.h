@@ -0,0 +1,74 @@
+#ifndef DELIVERY_INDEX_H
+#define DELIVERY_INDEX_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+class Delivery;
+
+enum DeliveryStatus : uint8_t {
+    STATUS_UNKNOWN,
+    STATUS_QUEUED,
+    STATUS_PROCESSED,
+    STATUS_CANCELLED
+};
+
+// Result of DeliveryManager::findDelivery
+struct DeliveryLookup {
+    DeliveryStatus status = STATUS_UNKNOWN;
+    int queue = -1;                       // DeliveryType of the queue holding it (after merges this can differ from its own type)
+    int slot = -1;                        // Heap index inside that queue
+    double priorityScore = 0.0;
+    const Delivery *delivery = nullptr;   // Valid until the next queue operation; queued deliveries only
+};
+
+// 16-byte slot of the open-addressing table
+struct DeliveryIndexEntry {
+    uint64_t hash;                        // 64-bit ID hash, 0 marks an empty slot
+    int32_t slot;                         // Heap index when queued, terminal ring position when processed/cancelled
+    uint8_t status;                       // DeliveryStatus
+    uint8_t queue;
+    uint16_t reserved;
+};
+static_assert(sizeof(DeliveryIndexEntry) == 16, "DeliveryIndexEntry must stay 16 bytes");
+
+// Open-addressing (linear probing) hash index from delivery ID to its current
+// state. Entries are keyed by a 64-bit hash of the ID only; callers verify
+// queued hits against the heap slot, and processed/cancelled hits are checked
+// against the ID kept in a ring of the most recent terminalLimit terminal
+// IDs, so two IDs sharing a hash never answer for each other. When an ID
+// drops out of the ring its entry is erased, which keeps the table bounded
+// by the queued deliveries plus that history. IDs are expected to be unique:
+// when an ID is reused the entry follows the most recent event for it.
+class DeliveryIndex {
+public:
+    static const size_t DEFAULT_TERMINAL_LIMIT = 1 << 16;
+
+private:
+    std::vector<DeliveryIndexEntry> entries;
+    size_t used;
+    std::vector<std::string> terminalIds; // Ring, oldest overwritten first
+    size_t terminalLimit;
+    size_t terminalNext;
+
+    static uint64_t hashId(const std::string &id);
+    DeliveryIndexEntry &slotFor(uint64_t hash); // Inserts when absent
+    size_t findSlot(uint64_t hash) const;        // entries.size() when absent
+    void eraseSlot(size_t i);
+    void grow();
+
+public:
+    explicit DeliveryIndex(size_t terminalHistory = DEFAULT_TERMINAL_LIMIT)
+        : used(0), terminalLimit(terminalHistory > 0 ? terminalHistory : 1), terminalNext(0) { clear(); }
+
+    void setQueued(const std::string &id, int queue, int slot);
+    void setStatus(const std::string &id, DeliveryStatus status);
+    bool find(const std::string &id, DeliveryIndexEntry &entry) const;
+    void clear();
+
+    size_t size() const { return used; }
+    size_t memoryBytes() const { return entries.size() * sizeof(DeliveryIndexEntry); }
+};
+
+#endif // DELIVERY_INDEX_H
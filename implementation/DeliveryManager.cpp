@@ -1,82 +1,599 @@
 ﻿#include "DeliveryManager.h"
 #include <iostream>
 #include <algorithm>
+#include <cmath>
+#include <filesystem>
+#include "BinaryIO.h"
+#include "QueueSnapshot.h"
+
+#ifndef _WIN32
+#include <sys/wait.h>
+#include <unistd.h>
+#endif
 
 DeliveryManager::DeliveryManager() :
     urgentDeliveries(MAX_HEAP),
     standardDeliveries(MAX_HEAP),
-    fragileDeliveries(MAX_HEAP) {
+    fragileDeliveries(MAX_HEAP),
+    restoredLsn(0),
+    snapshotInterval(0),
+    operationsSinceSnapshot(0),
+    snapshotWriterPid(0),
+    verbose(true),
+    drrDeficit{0.0, 0.0, 0.0},
+    drrTurn(0),
+    drrCredited(false),
+    lastDispatchQueue(URGENT),
+    orderSequence(0),
+    orderMode(-1),
+    orderVersion(0),
+    destinationEntries(0),
+    destinationsKept(false),
+    ranksKept(false),
+    queueDispatches{0, 0, 0},
+    changeListener(nullptr),
+    changeContext(nullptr),
+    changeSeq(0) {
     ConfigurationManager::initialize(); // Ensure ConfigurationManager is initialized
+    for (int queue = URGENT; queue <= FRAGILE; ++queue) {
+        queueBindings[queue].manager = this;
+        queueBindings[queue].queue = queue;
+        queueFor(queue).setPositionObserver(&DeliveryManager::onHeapMove, &queueBindings[queue]);
+    }
+}
+
+void DeliveryManager::onHeapMove(void* context, const Delivery& delivery, int slot) {
+    QueueBinding* binding = static_cast<QueueBinding*>(context);
+    binding->manager->index.setQueued(delivery.deliveryId, binding->queue, slot);
+}
+
+PriorityQueue<Delivery>& DeliveryManager::queueFor(int queue) {
+    switch (queue) {
+    case URGENT: return urgentDeliveries;
+    case STANDARD: return standardDeliveries;
+    default: return fragileDeliveries;
+    }
+}
+
+void DeliveryManager::setChangeListener(DeliveryChangeListener listener, void* context) {
+    changeListener = listener;
+    changeContext = context;
+}
+
+bool DeliveryManager::startTraceCapture(const std::string& path) {
+    std::unique_ptr<ArrivalTraceWriter> writer(new ArrivalTraceWriter());
+    if (!writer->open(path)) {
+        return false;
+    }
+    capture = std::move(writer);
+    return true;
+}
+
+bool DeliveryManager::stopTraceCapture() {
+    if (!capture) return true;
+    bool ok = capture->close();
+    capture.reset();
+    return ok;
+}
+
+void DeliveryManager::emitChange(DeliveryChangeType type, const Delivery& delivery, int queue, int fromQueue) {
+    ++changeSeq;
+    if (!changeListener) return;
+    DeliveryChange change;
+    change.seq = changeSeq;
+    change.type = type;
+    change.delivery = &delivery;
+    change.queue = queue;
+    change.fromQueue = fromQueue;
+    changeListener(changeContext, change);
+}
+
+DeliveryManager::~DeliveryManager() {
+#ifndef _WIN32
+    if (snapshotWriterPid > 0) {
+        waitpid(static_cast<pid_t>(snapshotWriterPid), nullptr, 0); // Let the snapshot finish
+    }
+#endif
+    if (wal) {
+        ConfigurationManager::setChangeListener(nullptr, nullptr);
+    }
 }
 
 void DeliveryManager::addDelivery(Delivery& delivery) {
+    LatencyScope timed(latency, LATENCY_ADD);
+    if (capture) capture->recordAdd(delivery);
     delivery.calculatePriorityScore(); // Calculate initial priority score
+    metrics.recordArrival(delivery.getType());
+    if (wal) wal->logAdd(delivery);
+    countOperation();
+    emitChange(CHANGE_ADD, delivery, delivery.getType(), -1);
+    trackOrder(delivery);
+    trackDestination(delivery);
+    rankInsert(delivery.getType(), delivery);
     switch (delivery.getType()) {
     case URGENT:
         urgentDeliveries.enqueue(delivery);
-        std::cout << "Added urgent delivery: " << delivery.getId() << std::endl;
+        if (verbose) std::cout << "Added urgent delivery: " << delivery.getId() << std::endl;
         break;
     case STANDARD:
         standardDeliveries.enqueue(delivery);
-        std::cout << "Added standard delivery: " << delivery.getId() << std::endl;
+        if (verbose) std::cout << "Added standard delivery: " << delivery.getId() << std::endl;
         break;
     case FRAGILE:
         fragileDeliveries.enqueue(delivery);
-        std::cout << "Added fragile delivery: " << delivery.getId() << std::endl;
+        if (verbose) std::cout << "Added fragile delivery: " << delivery.getId() << std::endl;
         break;
     }
+    if (wal) maybeCheckpoint(); // After the enqueue, so a compaction restates this delivery
 }
 
-Delivery DeliveryManager::processNextDelivery() {
-    if (!urgentDeliveries.isEmpty()) {
-        Delivery processed = urgentDeliveries.dequeue();
-        processed.setServiceStartTime(time(0));
-        time_t serviceEndTime = time(0) + (rand() % 10 + 5);
-        processed.setServiceEndTime(serviceEndTime);
-        processedDeliveries.push_back(processed);
-        return processed;
+size_t DeliveryManager::addDeliveries(const WireDelivery* records, size_t count) {
+    // Weights and the clock are read once, so every record in the batch scores against the same settings
+    ScoringWeights weights = ScoringWeights::current();
+    time_t now = DeliveryClock::now();
+    std::vector<Delivery> batch;
+    batch.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        const WireDelivery& record = records[i];
+        if (!isValidWireDelivery(record)) continue;
+        batch.push_back(decodeWireDelivery(record, now));
+        batch.back().calculatePriorityScore(weights, now);
     }
-    else if (!fragileDeliveries.isEmpty()) {
-        Delivery processed = fragileDeliveries.dequeue();
-        processed.setServiceStartTime(time(0));
-        time_t serviceEndTime = time(0) + (rand() % 10 + 5);
-        processed.setServiceEndTime(serviceEndTime);
-        processedDeliveries.push_back(processed);
-        return processed;
+    size_t accepted = addScoredDeliveries(batch);
+    if (verbose) std::cout << "Added batch of " << accepted << " deliveries (" << count - accepted << " rejected)" << std::endl;
+    return accepted;
+}
+
+size_t DeliveryManager::addScoredDeliveries(std::vector<Delivery>& deliveries) {
+    std::vector<Delivery> batches[3];
+    size_t accepted = deliveries.size();
+    if (capture) capture->beginBatch();
+    for (Delivery& delivery : deliveries) {
+        DeliveryType type = delivery.getType();
+        metrics.recordArrival(type);
+        if (wal) wal->logAdd(delivery);
+        if (capture) capture->recordBatchAdd(delivery);
+        batches[type].push_back(std::move(delivery));
+    }
+    deliveries.clear();
+    if (capture) capture->endBatch();
+    for (int queue = URGENT; queue <= FRAGILE; ++queue) {
+        if (batches[queue].empty()) continue;
+        for (const Delivery& delivery : batches[queue]) {
+            emitChange(CHANGE_ADD, delivery, queue, -1);
+            trackOrder(delivery);
+            trackDestination(delivery);
+            rankInsert(queue, delivery);
+        }
+        queueFor(queue).enqueueBatch(std::move(batches[queue]));
+    }
+    if (wal) maybeCheckpoint(); // After the enqueue, so a compaction sees the whole batch
+    countOperation(static_cast<int>(accepted));
+    return accepted;
+}
+
+Delivery DeliveryManager::decodeWireDelivery(const WireDelivery& record, time_t now) {
+    Delivery delivery(wireString(record.id), wireString(record.destination),
+                      static_cast<DeliveryType>(record.deliveryType), record.estimatedDeliveryTime);
+    delivery.entryTime = record.entryTime != 0 ? static_cast<time_t>(record.entryTime) : now;
+    return delivery;
+}
+
+void DeliveryManager::completeDispatch(Delivery& processed, int queue) {
+    processed.setServiceStartTime(DeliveryClock::now());
+    time_t serviceEndTime = processed.getServiceStartTime() + (rand() % 10 + 5);
+    processed.setServiceEndTime(serviceEndTime);
+    metrics.recordDispatch(processed);
+    time_t projectedFinish = processed.getServiceStartTime() + static_cast<time_t>(processed.estimatedDeliveryTime) * 60;
+    metrics.recordLateness(processed.getType(), std::difftime(projectedFinish, deadlineFor(processed)));
+    retainProcessed(processed);
+    index.setStatus(processed.deliveryId, STATUS_PROCESSED);
+    rankErase(queue, processed);
+    ++queueDispatches[queue];
+    lastDispatchQueue = queue;
+    if (capture) capture->recordDispatch();
+    if (wal) {
+        wal->logDispatch(processed);
+        maybeCheckpoint();
+    }
+    countOperation();
+    emitChange(CHANGE_DISPATCH, processed, -1, queue);
+}
+
+void DeliveryManager::retainProcessed(const Delivery& processed) {
+    int historyLimit = ConfigurationManager::getProcessedHistoryLimit();
+    processedDeliveries.push_back(processed);
+    if (historyLimit > 0 && processedDeliveries.size() > static_cast<size_t>(historyLimit)) {
+        processedDeliveries.pop_front();
+    }
+}
+
+namespace {
+
+const int DRR_ORDER[3] = {URGENT, FRAGILE, STANDARD};
+const double DRR_QUANTUM_MINUTES = 120.0; // Quantum of the largest-share class; smaller shares scale down
+
+// Dispatch cost: the delivery's estimated counter time, at least one minute
+double drrCost(const Delivery& delivery) {
+    return delivery.estimatedDeliveryTime > 1 ? delivery.estimatedDeliveryTime : 1.0;
+}
+
+} // namespace
+
+int DeliveryManager::nextDeficitRoundRobinQueue(unsigned char classes) {
+    // Each turn a non-empty class is credited its quantum and dispatches
+    // while its head fits in the deficit; an empty class forfeits its
+    // deficit. A full round that dispatches nothing (heads larger than the
+    // quanta) is followed by crediting every class the remaining whole
+    // rounds at once, so a call costs O(1) whatever the estimates. Classes
+    // the caller left out are passed over and keep their deficit.
+    double quantum[3];
+    double largestShare = 0.0;
+    for (int i = 0; i < 3; ++i) {
+        double share = ConfigurationManager::getClassShare(static_cast<DeliveryType>(DRR_ORDER[i]));
+        quantum[i] = share > 0.0 ? share : 0.0;
+        if (quantum[i] > largestShare) largestShare = quantum[i];
+    }
+    for (int i = 0; i < 3; ++i) {
+        // A zero share still gets a trickle so the class cannot starve outright
+        quantum[i] = largestShare > 0.0 ? DRR_QUANTUM_MINUTES * quantum[i] / largestShare : DRR_QUANTUM_MINUTES;
+        if (quantum[i] < 0.01) quantum[i] = 0.01;
+    }
+
+    for (int visited = 0;; ++visited) {
+        if (visited == 3) {
+            double rounds = -1.0;
+            for (int i = 0; i < 3; ++i) {
+                PriorityQueue<Delivery>& queue = queueFor(DRR_ORDER[i]);
+                if (queue.isEmpty() || !(classes & (1 << DRR_ORDER[i]))) continue;
+                double needed = std::ceil((drrCost(queue.at(0)) - drrDeficit[i]) / quantum[i]);
+                if (rounds < 0.0 || needed < rounds) rounds = needed;
+            }
+            for (int i = 0; rounds > 1.0 && i < 3; ++i) {
+                if (!queueFor(DRR_ORDER[i]).isEmpty() && (classes & (1 << DRR_ORDER[i]))) {
+                    drrDeficit[i] += (rounds - 1.0) * quantum[i];
+                }
+            }
+            visited = 0;
+        }
+        PriorityQueue<Delivery>& queue = queueFor(DRR_ORDER[drrTurn]);
+        if (!(classes & (1 << DRR_ORDER[drrTurn]))) {
+            // Not wanted this time
+        } else if (!queue.isEmpty()) {
+            if (!drrCredited) {
+                drrDeficit[drrTurn] += quantum[drrTurn];
+                drrCredited = true;
+            }
+            double cost = drrCost(queue.at(0));
+            if (cost <= drrDeficit[drrTurn]) {
+                drrDeficit[drrTurn] -= cost;
+                return DRR_ORDER[drrTurn];
+            }
+        } else {
+            drrDeficit[drrTurn] = 0.0;
+        }
+        drrTurn = (drrTurn + 1) % 3;
+        drrCredited = false;
+    }
+}
+
+time_t DeliveryManager::deadlineFor(const Delivery& delivery) {
+    return delivery.entryTime + static_cast<time_t>(ConfigurationManager::getSlaMinutes(delivery.getType())) * 60;
+}
+
+double DeliveryManager::orderKey(const Delivery& delivery) const {
+    if (orderMode == SCHEDULER_EDF) return static_cast<double>(deadlineFor(delivery));
+    // Shortest job first with aging: rank by estimate - aging * minutes waited.
+    // Everything queued ages at the same rate, so that order equals the
+    // order of estimate + aging * entry minute, which never changes while
+    // the delivery waits and can key a heap.
+    return delivery.estimatedDeliveryTime + ConfigurationManager::getSjfAging() * (delivery.entryTime / 60.0);
+}
+
+void DeliveryManager::trackOrder(const Delivery& delivery) {
+    // Adds always go to the queue of their own class
+    if (orderMode >= 0) {
+        dispatchOrder[delivery.getType()].insert(DispatchOrderEntry{orderKey(delivery), orderSequence++, delivery.deliveryId});
+    }
+}
+
+void DeliveryManager::prepareOrder(int mode) {
+    // Stale entries cost memory until they surface; past twice the live
+    // count, after a settings change (SLAs, aging) or if some adds bypassed
+    // the order, it is rebuilt in O(n)
+    size_t live = static_cast<size_t>(getTotalQueueSize());
+    size_t tracked = 0;
+    for (int queue = URGENT; queue <= FRAGILE; ++queue) {
+        tracked += static_cast<size_t>(dispatchOrder[queue].size() + lateOrder[queue].size());
+    }
+    if (orderMode == mode && orderVersion == ConfigurationManager::getVersion() && tracked >= live &&
+        tracked <= 2 * live + 1024) {
+        return;
+    }
+    orderMode = mode;
+    orderVersion = ConfigurationManager::getVersion();
+    std::vector<std::pair<int, DispatchOrderEntry>> entries; // Queue, entry
+    entries.reserve(live);
+    for (int queue = URGENT; queue <= FRAGILE; ++queue) {
+        for (const Delivery& delivery : queueFor(queue).getInternalData()) {
+            entries.emplace_back(queue, DispatchOrderEntry{orderKey(delivery), static_cast<uint64_t>(delivery.entryTime), delivery.deliveryId});
+        }
+    }
+    // Heap order is not arrival order; entry time is the closest tie-break there is
+    std::stable_sort(entries.begin(), entries.end(),
+                     [](const std::pair<int, DispatchOrderEntry>& a, const std::pair<int, DispatchOrderEntry>& b) {
+                         return a.second.sequence < b.second.sequence;
+                     });
+    std::vector<DispatchOrderEntry> perQueue[3];
+    for (auto& entry : entries) {
+        entry.second.sequence = orderSequence++;
+        perQueue[entry.first].push_back(std::move(entry.second));
+    }
+    for (int queue = URGENT; queue <= FRAGILE; ++queue) {
+        dispatchOrder[queue].buildHeap(std::move(perQueue[queue]));
+        lateOrder[queue].buildHeap(std::vector<DispatchOrderEntry>());
+    }
+}
+
+bool DeliveryManager::locateInOrder(MinHeap<DispatchOrderEntry>& heap, int queue, int& slot) {
+    while (!heap.isEmpty()) {
+        const DispatchOrderEntry& top = heap.at(0);
+        DeliveryIndexEntry entry;
+        if (index.find(top.deliveryId, entry) && entry.status == STATUS_QUEUED && entry.queue == queue) {
+            PriorityQueue<Delivery>& q = queueFor(queue);
+            if (entry.slot >= 0 && entry.slot < q.size() && q.at(entry.slot).deliveryId == top.deliveryId &&
+                orderKey(q.at(entry.slot)) == top.key) {
+                slot = entry.slot;
+                return true;
+            }
+        }
+        heap.extractMin(); // Dispatched, cancelled, moved or re-added since
+    }
+    return false;
+}
+
+int DeliveryManager::frontOfOrder(MinHeap<DispatchOrderEntry>* heaps, unsigned char classes, int& slot) {
+    int front = -1;
+    for (int queue = URGENT; queue <= FRAGILE; ++queue) {
+        int top;
+        if (!(classes & (1 << queue)) || !locateInOrder(heaps[queue], queue, top)) continue;
+        if (front < 0 || heaps[queue].at(0) < heaps[front].at(0)) {
+            front = queue;
+            slot = top;
+        }
+    }
+    return front;
+}
+
+Delivery DeliveryManager::dispatchAt(int queue, int slot) {
+    Delivery processed = queueFor(queue).removeAt(slot);
+    completeDispatch(processed, queue);
+    return processed;
+}
+
+Delivery DeliveryManager::dispatchEarliestDeadline(unsigned char classes) {
+    prepareOrder(SCHEDULER_EDF);
+
+    // EDF minimises the number of misses only while every deadline is
+    // reachable. A delivery that can no longer finish in time is set aside
+    // instead of pushing the ones behind it past their deadlines too, and is
+    // only served (least late first) when nothing on time is waiting.
+    time_t now = DeliveryClock::now();
+    int queue, slot = -1;
+    bool dropLate = ConfigurationManager::getOverloadPolicy() == OVERLOAD_DROP;
+    while ((queue = frontOfOrder(dispatchOrder, classes, slot)) >= 0) {
+        const Delivery& head = queueFor(queue).at(slot);
+        if (now + static_cast<time_t>(head.estimatedDeliveryTime) * 60 <= dispatchOrder[queue].at(0).key) break;
+        lateOrder[queue].insert(dispatchOrder[queue].extractMin());
     }
-    else if (!standardDeliveries.isEmpty()) {
-        Delivery processed = standardDeliveries.dequeue();
-        processed.setServiceStartTime(time(0));
-        time_t serviceEndTime = time(0) + (rand() % 10 + 5);
-        processed.setServiceEndTime(serviceEndTime);
-        processedDeliveries.push_back(processed);
+    if (queue >= 0) {
+        dispatchOrder[queue].extractMin();
+        Delivery processed = dispatchAt(queue, slot);
+        if (dropLate) {
+            // Something on time went out, so the late ones are not needed to keep the counters busy
+            for (int lateQueue = URGENT; lateQueue <= FRAGILE; ++lateQueue) {
+                int lateSlot;
+                while ((classes & (1 << lateQueue)) && locateInOrder(lateOrder[lateQueue], lateQueue, lateSlot)) {
+                    metrics.recordDeadlineDrop(queueFor(lateQueue).at(lateSlot).getType());
+                    lateOrder[lateQueue].extractMin();
+                    cancelAt(lateQueue, lateSlot);
+                }
+            }
+        }
         return processed;
     }
-    else {
+    queue = frontOfOrder(lateOrder, classes, slot);
+    if (queue < 0) {
+        throw std::out_of_range("No deliveries to process."); // Unreachable while the order is complete
+    }
+    lateOrder[queue].extractMin();
+    return dispatchAt(queue, slot);
+}
+
+Delivery DeliveryManager::dispatchShortestJob(unsigned char classes) {
+    prepareOrder(SCHEDULER_SJF);
+    int slot;
+    int queue = frontOfOrder(dispatchOrder, classes, slot);
+    if (queue < 0) {
+        throw std::out_of_range("No deliveries to process."); // Unreachable while the order is complete
+    }
+    dispatchOrder[queue].extractMin();
+    return dispatchAt(queue, slot);
+}
+
+Delivery DeliveryManager::processNextDelivery(unsigned char classes) {
+    LatencyScope timed(latency, LATENCY_PROCESS);
+    if (!hasDeliveries(classes)) {
         throw std::out_of_range("No deliveries to process.");
     }
+    SchedulerMode mode = ConfigurationManager::getSchedulerMode();
+    if (mode == SCHEDULER_EDF) return dispatchEarliestDeadline(classes);
+    if (mode == SCHEDULER_SJF) return dispatchShortestJob(classes);
+    if (orderMode >= 0) {
+        // Left EDF/SJF: stop maintaining the order until it is used again
+        for (int queue = URGENT; queue <= FRAGILE; ++queue) {
+            dispatchOrder[queue].buildHeap(std::vector<DispatchOrderEntry>());
+            lateOrder[queue].buildHeap(std::vector<DispatchOrderEntry>());
+        }
+        orderMode = -1;
+    }
+    int queue;
+    if (mode == SCHEDULER_DRR) {
+        queue = nextDeficitRoundRobinQueue(classes);
+    } else if ((classes & (1 << URGENT)) && !urgentDeliveries.isEmpty()) {
+        queue = URGENT;
+    } else if ((classes & (1 << FRAGILE)) && !fragileDeliveries.isEmpty()) {
+        queue = FRAGILE;
+    } else {
+        queue = STANDARD;
+    }
+    Delivery processed = queueFor(queue).dequeue();
+    completeDispatch(processed, queue);
+    return processed;
+}
+
+void DeliveryManager::trackDestination(const Delivery& delivery) {
+    if (destinationsKept) {
+        destinationGroups[delivery.getType()][delivery.destination].insert(
+            DispatchOrderEntry{static_cast<double>(delivery.entryTime), orderSequence++, delivery.deliveryId});
+        ++destinationEntries;
+    }
 }
 
-bool DeliveryManager::hasDeliveries() const {
-    return !urgentDeliveries.isEmpty() || !standardDeliveries.isEmpty() || !fragileDeliveries.isEmpty();
+void DeliveryManager::prepareDestinations() {
+    // Same rebuild rule as the dispatch order: stale entries past twice the
+    // live count, or fewer entries than deliveries (restores and replays
+    // bypass the adds)
+    size_t live = static_cast<size_t>(getTotalQueueSize());
+    if (destinationsKept && destinationEntries >= live && destinationEntries <= 2 * live + 1024) return;
+    destinationsKept = true;
+    destinationEntries = 0;
+    std::vector<const Delivery*> queued;
+    queued.reserve(live);
+    for (int queue = URGENT; queue <= FRAGILE; ++queue) {
+        destinationGroups[queue].clear();
+        for (const Delivery& delivery : queueFor(queue).getInternalData()) queued.push_back(&delivery);
+    }
+    std::stable_sort(queued.begin(), queued.end(),
+                     [](const Delivery* a, const Delivery* b) { return a->entryTime < b->entryTime; });
+    std::unordered_map<std::string, std::vector<DispatchOrderEntry>> members[3];
+    for (const Delivery* delivery : queued) {
+        members[delivery->getType()][delivery->destination].push_back(
+            DispatchOrderEntry{static_cast<double>(delivery->entryTime), orderSequence++, delivery->deliveryId});
+    }
+    for (int type = URGENT; type <= FRAGILE; ++type) {
+        for (auto& member : members[type]) {
+            destinationEntries += member.second.size();
+            destinationGroups[type][member.first].buildHeap(std::move(member.second));
+        }
+    }
+}
+
+bool DeliveryManager::locateInGroup(MinHeap<DispatchOrderEntry>& group, int& queue, int& slot) {
+    // A group is keyed by class, not queue: a delivery a merge moved into
+    // the urgent queue is still found, in whichever queue it now sits
+    while (!group.isEmpty()) {
+        const DispatchOrderEntry& top = group.at(0);
+        DeliveryIndexEntry entry;
+        if (index.find(top.deliveryId, entry) && entry.status == STATUS_QUEUED) {
+            PriorityQueue<Delivery>& q = queueFor(entry.queue);
+            if (entry.slot >= 0 && entry.slot < q.size() && q.at(entry.slot).deliveryId == top.deliveryId &&
+                static_cast<double>(q.at(entry.slot).entryTime) == top.key) {
+                queue = entry.queue;
+                slot = entry.slot;
+                return true;
+            }
+        }
+        group.extractMin(); // Dispatched, cancelled or re-added since
+        --destinationEntries;
+    }
+    return false;
+}
+
+std::vector<Delivery> DeliveryManager::processNextBatch(unsigned char classes) {
+    std::vector<Delivery> batch;
+    batch.push_back(processNextDelivery(classes));
+    int maxExtra = ConfigurationManager::getBatchMaxExtra();
+    if (maxExtra <= 0) {
+        if (destinationsKept) {
+            // Batching was switched off: stop maintaining the groups until it is used again
+            for (int type = URGENT; type <= FRAGILE; ++type) destinationGroups[type].clear();
+            destinationEntries = 0;
+            destinationsKept = false;
+        }
+        metrics.recordDispatchBatch(1);
+        return batch;
+    }
+    prepareDestinations();
+    int headQueue = lastDispatchQueue;
+    const Delivery& head = batch.front();
+    double floor = head.priorityScore - ConfigurationManager::getBatchMaxGap();
+    std::unordered_map<std::string, MinHeap<DispatchOrderEntry>>& groups = destinationGroups[head.getType()];
+    auto group = groups.find(head.destination);
+    if (group != groups.end()) {
+        int queue, slot;
+        std::vector<DispatchOrderEntry> skipped; // Queued where the caller's counter may not take them
+        while (static_cast<int>(batch.size()) <= maxExtra && locateInGroup(group->second, queue, slot)) {
+            if (!(classes & (1 << queue))) {
+                skipped.push_back(group->second.extractMin());
+                continue;
+            }
+            const Delivery& next = queueFor(queue).at(slot);
+            if (next.priorityScore < floor) break;
+            if (ConfigurationManager::getSchedulerMode() == SCHEDULER_DRR) {
+                // The trip's extra counter time is charged to the queue, and
+                // the trip ends once its deficit is spent, so batching does
+                // not widen the queue's share
+                int turn = 0;
+                while (DRR_ORDER[turn] != queue) ++turn;
+                double cost = drrCost(next);
+                if (cost > drrDeficit[turn]) break;
+                drrDeficit[turn] -= cost;
+            }
+            group->second.extractMin();
+            --destinationEntries;
+            batch.push_back(dispatchAt(queue, slot));
+        }
+        for (const DispatchOrderEntry& entry : skipped) group->second.insert(entry);
+        if (group->second.isEmpty()) groups.erase(group);
+    }
+    lastDispatchQueue = headQueue;
+    metrics.recordDispatchBatch(batch.size());
+    return batch;
+}
+
+bool DeliveryManager::hasDeliveries(unsigned char classes) const {
+    return ((classes & (1 << URGENT)) && !urgentDeliveries.isEmpty()) ||
+           ((classes & (1 << STANDARD)) && !standardDeliveries.isEmpty()) ||
+           ((classes & (1 << FRAGILE)) && !fragileDeliveries.isEmpty());
 }
 
 void DeliveryManager::updatePriorities() {
+    LatencyScope timed(latency, LATENCY_UPDATE_PRIORITIES);
     std::vector<Delivery> tempDeliveries;
+    std::vector<int> fromQueues; // Where each one sat, for the change stream
 
     while (!urgentDeliveries.isEmpty()) {
         tempDeliveries.push_back(urgentDeliveries.dequeue());
+        fromQueues.push_back(URGENT);
     }
     while (!standardDeliveries.isEmpty()) {
         tempDeliveries.push_back(standardDeliveries.dequeue());
+        fromQueues.push_back(STANDARD);
     }
     while (!fragileDeliveries.isEmpty()) {
         tempDeliveries.push_back(fragileDeliveries.dequeue());
+        fromQueues.push_back(FRAGILE);
     }
 
-    for (auto& delivery : tempDeliveries) {
+    for (size_t i = 0; i < tempDeliveries.size(); ++i) {
+        Delivery& delivery = tempDeliveries[i];
+        double previousScore = delivery.getPriorityScore();
         delivery.calculatePriorityScore();
         delivery.boostPriority();
+        if (delivery.getPriorityScore() != previousScore || fromQueues[i] != delivery.getType()) {
+            emitChange(CHANGE_RESCORE, delivery, delivery.getType(), fromQueues[i]);
+        }
 
         switch (delivery.getType()) {
         case URGENT:
@@ -90,19 +607,35 @@ void DeliveryManager::updatePriorities() {
             break;
         }
     }
+    if (ranksKept) {
+        // Every score moved; re-sorting once beats n erase/insert pairs
+        for (int queue = URGENT; queue <= FRAGILE; ++queue) queueRanks[queue].assign(queueFor(queue).getInternalData());
+    }
 }
 
 void DeliveryManager::mergeQueues() {
+    // Deficit round robin already hands an idle class's capacity to the
+    // others, and moving deliveries would charge them to the wrong share;
+    // EDF ignores the queues altogether
+    if (ConfigurationManager::getSchedulerMode() != SCHEDULER_STRICT) return;
     if (urgentDeliveries.isEmpty() && !standardDeliveries.isEmpty()) {
-        std::cout << "VIP queue is now empty. Redirecting individuals from regular queue to VIP service counter." << std::endl;
+        if (verbose) std::cout << "VIP queue is now empty. Redirecting individuals from regular queue to VIP service counter." << std::endl;
         while (!standardDeliveries.isEmpty()) {
-            urgentDeliveries.enqueue(standardDeliveries.dequeue());
+            Delivery moved = standardDeliveries.dequeue();
+            emitChange(CHANGE_MERGE, moved, URGENT, STANDARD);
+            rankErase(STANDARD, moved);
+            rankInsert(URGENT, moved);
+            urgentDeliveries.enqueue(std::move(moved));
         }
     }
     if (urgentDeliveries.isEmpty() && !fragileDeliveries.isEmpty()) {
-        std::cout << "Fragile queue is now empty. Redirecting individuals from fragile queue to urgent service counter." << std::endl;
+        if (verbose) std::cout << "Fragile queue is now empty. Redirecting individuals from fragile queue to urgent service counter." << std::endl;
         while (!fragileDeliveries.isEmpty()) {
-            urgentDeliveries.enqueue(fragileDeliveries.dequeue());
+            Delivery moved = fragileDeliveries.dequeue();
+            emitChange(CHANGE_MERGE, moved, URGENT, FRAGILE);
+            rankErase(FRAGILE, moved);
+            rankInsert(URGENT, moved);
+            urgentDeliveries.enqueue(std::move(moved));
         }
     }
 }
@@ -112,46 +645,169 @@ void DeliveryManager::applyFairnessBoost() {
 }
 
 //  Cancel delivery by ID
+void DeliveryManager::cancelAt(int queue, int slot) {
+    Delivery d = queueFor(queue).removeAt(slot);
+    rankErase(queue, d);
+    cancelledLog.push(d);
+    index.setStatus(d.deliveryId, STATUS_CANCELLED);
+    metrics.recordCancellation(d.getType());
+    if (wal) {
+        wal->logCancel(d);
+        maybeCheckpoint();
+    }
+    countOperation();
+    emitChange(CHANGE_CANCEL, d, -1, queue);
+}
+
 bool DeliveryManager::cancelDeliveryById(const std::string& id) {
-    std::vector<Delivery> tempUrgent, tempStandard, tempFragile;
-    bool found = false;
-
-    auto searchQueue = [&](PriorityQueue<Delivery>& queue, std::vector<Delivery>& temp) {
-        while (!queue.isEmpty()) {
-            Delivery d = queue.dequeue();
-            if (!found && d.getId() == id) {
-                cancelledStack.push(d);
-                found = true;
-            }
-            else {
-                temp.push_back(d);
+    LatencyScope timed(latency, LATENCY_CANCEL);
+    if (capture) capture->recordCancel(id);
+    // The heap observers keep every queued delivery in the index, so an unknown,
+    // processed or cancelled ID is answered here without touching the heaps
+    DeliveryIndexEntry entry;
+    if (!index.find(id, entry) || entry.status != STATUS_QUEUED) {
+        return false;
+    }
+    PriorityQueue<Delivery>& queue = queueFor(entry.queue);
+    if (entry.slot >= 0 && entry.slot < queue.size() && queue.at(entry.slot).deliveryId == id) {
+        cancelAt(entry.queue, entry.slot);
+        return true;
+    }
+
+    // The slot holds another delivery: only possible if two IDs share a 64-bit
+    // hash. Find it by a linear search instead of rebuilding the heaps.
+    for (int q = URGENT; q <= FRAGILE; ++q) {
+        const std::vector<Delivery>& data = queueFor(q).getInternalData();
+        for (size_t i = 0; i < data.size(); ++i) {
+            if (data[i].deliveryId == id) {
+                cancelAt(q, static_cast<int>(i));
+                return true;
             }
         }
-        };
-
-    searchQueue(urgentDeliveries, tempUrgent);
-    searchQueue(standardDeliveries, tempStandard);
-    searchQueue(fragileDeliveries, tempFragile);
-
-    for (const auto& d : tempUrgent) urgentDeliveries.enqueue(d);
-    for (const auto& d : tempStandard) standardDeliveries.enqueue(d);
-    for (const auto& d : tempFragile) fragileDeliveries.enqueue(d);
-
-    return found;
+    }
+    return false;
 }
 
 //  View cancelled deliveries log
 void DeliveryManager::viewCancelledDeliveries() const {
-    if (cancelledStack.empty()) {
+    if (cancelledLog.empty()) {
         std::cout << "No cancelled deliveries.\n";
         return;
     }
 
     std::cout << "\n--- Cancelled Deliveries Log (Most recent first) ---\n";
-    std::stack<Delivery> temp = cancelledStack;
-    while (!temp.empty()) {
-        temp.top().print();
-        temp.pop();
+    for (size_t i = 0; i < cancelledLog.recentSize(); ++i) {
+        cancelledLog.recent(i).print();
+    }
+    uint64_t older = cancelledLog.totalSize() - cancelledLog.recentSize();
+    if (older > 0) {
+        std::cout << older << " older cancellations are archived on disk.\n";
+    }
+}
+
+std::vector<Delivery> DeliveryManager::getCancelledPage(uint64_t offset, size_t limit) const {
+    return cancelledLog.page(offset, limit);
+}
+
+bool DeliveryManager::enableCancelledSpill(const std::string& path) {
+    return cancelledLog.open(path);
+}
+
+DeliveryLookup DeliveryManager::findDelivery(const std::string& id) const {
+    DeliveryLookup result;
+    DeliveryIndexEntry entry;
+    if (!index.find(id, entry)) {
+        return result;
+    }
+    if (entry.status != STATUS_QUEUED) {
+        result.status = static_cast<DeliveryStatus>(entry.status);
+        return result;
+    }
+    // The index is keyed by hash only, so confirm the slot really holds this ID
+    const PriorityQueue<Delivery>& queue = entry.queue == URGENT ? urgentDeliveries
+                                         : entry.queue == STANDARD ? standardDeliveries
+                                         : fragileDeliveries;
+    if (entry.slot < 0 || entry.slot >= queue.size() || queue.at(entry.slot).deliveryId != id) {
+        return result;
+    }
+    const Delivery& d = queue.at(entry.slot);
+    result.status = STATUS_QUEUED;
+    result.queue = entry.queue;
+    result.slot = entry.slot;
+    result.priorityScore = d.getPriorityScore();
+    result.delivery = &d;
+    return result;
+}
+
+void DeliveryManager::rankInsert(int queue, const Delivery& delivery) {
+    if (ranksKept) queueRanks[queue].insert(delivery);
+}
+
+void DeliveryManager::rankErase(int queue, const Delivery& delivery) {
+    if (ranksKept) queueRanks[queue].erase(delivery);
+}
+
+void DeliveryManager::prepareRanks() {
+    if (ranksKept) return;
+    for (int queue = URGENT; queue <= FRAGILE; ++queue) queueRanks[queue].assign(queueFor(queue).getInternalData());
+    ranksKept = true;
+}
+
+void DeliveryManager::dropRanks() {
+    for (int queue = URGENT; queue <= FRAGILE; ++queue) queueRanks[queue].clear();
+    ranksKept = false;
+}
+
+QueuePosition DeliveryManager::getQueuePosition(const std::string& id) {
+    QueuePosition position;
+    DeliveryLookup lookup = findDelivery(id);
+    if (lookup.status != STATUS_QUEUED) return position;
+    prepareRanks();
+    position.queued = true;
+    position.queue = lookup.queue;
+    position.rank = queueRanks[lookup.queue].rankOf(*lookup.delivery);
+    position.queueSize = queueRanks[lookup.queue].size();
+
+    // The queue's share of everything dispatched so far, times the overall rate
+    uint64_t dispatched = queueDispatches[URGENT] + queueDispatches[STANDARD] + queueDispatches[FRAGILE];
+    double rate = dispatched ? metrics.getThroughputPerMinute() * queueDispatches[lookup.queue] / dispatched : 0.0;
+    if (rate > 0.0) position.etaMinutes = (position.rank + 1) / rate;
+    return position;
+}
+
+size_t DeliveryManager::countAbove(DeliveryType queue, double score) {
+    prepareRanks();
+    return queueRanks[queue].countAbove(score);
+}
+
+std::vector<Delivery> DeliveryManager::getQueuePage(DeliveryType queue, size_t offset, size_t limit) {
+    prepareRanks();
+    std::vector<Delivery> page;
+    const PriorityQueue<Delivery>& q = queueFor(queue);
+    for (const std::string& id : queueRanks[queue].page(offset, limit)) {
+        DeliveryIndexEntry entry;
+        if (index.find(id, entry) && entry.status == STATUS_QUEUED && entry.queue == queue && entry.slot >= 0 &&
+            entry.slot < q.size() && q.at(entry.slot).deliveryId == id) {
+            page.push_back(q.at(entry.slot));
+        }
+    }
+    return page;
+}
+
+std::vector<Delivery> DeliveryManager::getCancelledDeliveries() const {
+    std::vector<Delivery> cancelled;
+    cancelled.reserve(cancelledLog.recentSize());
+    for (size_t i = 0; i < cancelledLog.recentSize(); ++i) {
+        cancelled.push_back(cancelledLog.recent(i));
+    }
+    return cancelled;
+}
+
+const std::vector<Delivery>& DeliveryManager::getQueueData(DeliveryType type) const {
+    switch (type) {
+    case URGENT: return urgentDeliveries.getInternalData();
+    case STANDARD: return standardDeliveries.getInternalData();
+    default: return fragileDeliveries.getInternalData();
     }
 }
 
@@ -168,3 +824,386 @@ void DeliveryManager::printQueuedDeliveriesWithScores() const {
     printQueue(standardDeliveries, "Standard");
     printQueue(fragileDeliveries, "Fragile");
 }
+
+//  Write-ahead log: recovery, checkpoints and config hook
+bool DeliveryManager::enableWriteAheadLog(const std::string& path, const WalOptions& options) {
+    uint64_t validBytes = 0, lastLsn = 0;
+    if (!replayLog(path, validBytes, lastLsn)) {
+        return false;
+    }
+
+    // A snapshot can record LSNs that never reached the log before a crash;
+    // numbering continues past them so new records are not taken for its own
+    std::unique_ptr<WriteAheadLog> log(new WriteAheadLog());
+    if (!log->open(path, options, validBytes, std::max(lastLsn, restoredLsn))) {
+        return false;
+    }
+    wal = std::move(log);
+    wal->setCommitHook(&DeliveryManager::onLogCommit, this);
+    ConfigurationManager::setChangeListener(&DeliveryManager::onConfigChange, this);
+    return true;
+}
+
+namespace {
+
+// Open-addressing table from ID hash to the newest delivery added with that
+// ID during replay. Older deliveries that reuse the ID are chained through
+// previousSameId, so duplicate IDs never need a per-key container.
+class ReplayIdTable {
+private:
+    static constexpr uint32_t EMPTY = 0xFFFFFFFFu;
+    std::vector<uint64_t> hashes;
+    std::vector<uint32_t> heads;
+    size_t used;
+
+    size_t findSlot(uint64_t hash, std::string_view id, const std::vector<Delivery>& live) const {
+        size_t mask = heads.size() - 1;
+        size_t slot = hash & mask;
+        while (heads[slot] != EMPTY &&
+               !(hashes[slot] == hash && live[heads[slot]].deliveryId == id)) {
+            slot = (slot + 1) & mask;
+        }
+        return slot;
+    }
+
+public:
+    std::vector<uint32_t> previousSameId;
+
+    explicit ReplayIdTable(size_t expected) : used(0) {
+        size_t capacity = 1024;
+        while (capacity < expected * 2) capacity <<= 1;
+        hashes.assign(capacity, 0);
+        heads.assign(capacity, EMPTY);
+    }
+
+    void insert(uint32_t index, const std::vector<Delivery>& live) {
+        if ((used + 1) * 2 > heads.size()) {
+            std::vector<uint32_t> oldHeads;
+            oldHeads.swap(heads);
+            hashes.assign(oldHeads.size() * 2, 0);
+            heads.assign(oldHeads.size() * 2, EMPTY);
+            for (uint32_t head : oldHeads) {
+                if (head == EMPTY) continue;
+                const std::string& key = live[head].deliveryId;
+                uint64_t hash = fnv1a64(key.data(), key.size());
+                size_t slot = findSlot(hash, key, live);
+                hashes[slot] = hash;
+                heads[slot] = head;
+            }
+        }
+        const std::string& id = live[index].deliveryId;
+        uint64_t hash = fnv1a64(id.data(), id.size());
+        size_t slot = findSlot(hash, id, live);
+        if (heads[slot] == EMPTY) {
+            ++used;
+            hashes[slot] = hash;
+            previousSameId.push_back(EMPTY);
+        } else {
+            previousSameId.push_back(heads[slot]);
+        }
+        heads[slot] = index;
+    }
+
+    // Newest live delivery with this ID, preferring one with a matching entry time
+    bool take(std::string_view id, time_t entryTime, const std::vector<Delivery>& live,
+              std::vector<bool>& alive, uint32_t& index) {
+        size_t slot = findSlot(fnv1a64(id.data(), id.size()), id, live);
+        if (heads[slot] == EMPTY) return false;
+        uint32_t pick = EMPTY;
+        for (uint32_t i = heads[slot]; i != EMPTY; i = previousSameId[i]) {
+            if (!alive[i]) continue;
+            if (pick == EMPTY) pick = i;
+            if (live[i].entryTime == entryTime) {
+                pick = i;
+                break;
+            }
+        }
+        if (pick == EMPTY) return false;
+        alive[pick] = false;
+        // Drop dead entries off the front of the chain, but keep the last one:
+        // emptying the slot would cut the probe sequence of keys stored past it
+        while (!alive[heads[slot]] && previousSameId[heads[slot]] != EMPTY) {
+            heads[slot] = previousSameId[heads[slot]];
+        }
+        index = pick;
+        return true;
+    }
+};
+
+} // namespace
+
+bool DeliveryManager::replayLog(const std::string& path, uint64_t& validBytes, uint64_t& lastLsn) {
+    // Live deliveries in log order; dispatch/cancel records find theirs by ID
+    // (and entry time, to tell apart deliveries that reuse an ID)
+    std::error_code ec;
+    uint64_t logBytes = std::filesystem::exists(path, ec) ? std::filesystem::file_size(path, ec) : 0;
+    std::vector<Delivery> live;
+    std::vector<bool> alive;
+    live.reserve(logBytes / 48);
+    alive.reserve(logBytes / 48);
+    ReplayIdTable byId(logBytes / 48);
+    byId.previousSameId.reserve(logBytes / 48);
+
+    // With a restored snapshot only the log tail after it is applied. The first
+    // tail record moves the snapshot's queued deliveries into the replay table
+    // so later dispatch/cancel records can find them.
+    bool seeded = false;
+    auto seedFromQueues = [&]() {
+        seeded = true;
+        for (const PriorityQueue<Delivery>* queue : {&urgentDeliveries, &standardDeliveries, &fragileDeliveries}) {
+            for (const Delivery& d : queue->getInternalData()) {
+                live.push_back(d);
+                alive.push_back(true);
+                byId.insert(static_cast<uint32_t>(live.size() - 1), live);
+            }
+        }
+    };
+
+    // Cancellations evicted from the ring were archived before the restart
+    cancelledLog.setSpillSuspended(true);
+    bool ok = WriteAheadLog::replay(path, [&](const WalRecord& record) {
+        if (record.lsn <= restoredLsn) return;
+        if (!seeded) seedFromQueues();
+        uint32_t slot = 0;
+        switch (record.type) {
+        case WAL_ADD: {
+            live.emplace_back(std::string(record.deliveryId), std::string(record.destination),
+                              record.deliveryType, record.estimatedDeliveryTime);
+            Delivery& d = live.back();
+            d.priorityScore = record.priorityScore;
+            d.entryTime = record.entryTime;
+            alive.push_back(true);
+            byId.insert(static_cast<uint32_t>(live.size() - 1), live);
+            metrics.recordArrival(record.deliveryType);
+            break;
+        }
+        case WAL_DISPATCH:
+            if (byId.take(record.deliveryId, record.entryTime, live, alive, slot)) {
+                Delivery& d = live[slot];
+                d.setServiceStartTime(record.serviceStartTime);
+                d.setServiceEndTime(record.serviceEndTime);
+                metrics.recordDispatch(d);
+                retainProcessed(d);
+                index.setStatus(d.deliveryId, STATUS_PROCESSED);
+            }
+            break;
+        case WAL_CANCEL:
+            if (byId.take(record.deliveryId, record.entryTime, live, alive, slot)) {
+                cancelledLog.push(live[slot]);
+                index.setStatus(live[slot].deliveryId, STATUS_CANCELLED);
+                metrics.recordCancellation(live[slot].getType());
+            }
+            break;
+        case WAL_CONFIG:
+            ConfigurationManager::applySetting(std::string(record.configKey), record.configValue);
+            break;
+        case WAL_CHECKPOINT:
+            // A compacted log restates the whole state from here on
+            std::fill(alive.begin(), alive.end(), false);
+            cancelledLog.clear();
+            processedDeliveries.clear();
+            metrics.reset();
+            break;
+        case WAL_METRICS:
+            // Lifetime counters as of the compaction, including the history it dropped
+            metrics.restoreTotals(record.totals);
+            break;
+        }
+    }, validBytes, lastLsn);
+    cancelledLog.setSpillSuspended(false);
+    if (!ok) return false;
+
+    if (!seeded) {
+        return true; // Nothing after the snapshot (or an empty log): keep the adopted heaps
+    }
+
+    // Rebuild each queue with a single bulk heapify
+    size_t typeCounts[3] = {0, 0, 0};
+    for (size_t i = 0; i < live.size(); ++i) {
+        if (alive[i]) ++typeCounts[live[i].getType()];
+    }
+    std::vector<Delivery> urgent, standard, fragile;
+    urgent.reserve(typeCounts[URGENT]);
+    standard.reserve(typeCounts[STANDARD]);
+    fragile.reserve(typeCounts[FRAGILE]);
+    for (size_t i = 0; i < live.size(); ++i) {
+        if (!alive[i]) continue;
+        switch (live[i].getType()) {
+        case URGENT: urgent.push_back(std::move(live[i])); break;
+        case STANDARD: standard.push_back(std::move(live[i])); break;
+        case FRAGILE: fragile.push_back(std::move(live[i])); break;
+        }
+    }
+    urgentDeliveries.assign(std::move(urgent));
+    standardDeliveries.assign(std::move(standard));
+    fragileDeliveries.assign(std::move(fragile));
+    dropRanks();
+    return true;
+}
+
+void DeliveryManager::checkpointLog() {
+    if (!wal) return;
+    std::string path = wal->getPath();
+    WalOptions options = wal->getOptions();
+    if (!wal->flush(true)) return; // Keep appending to the old log until it can be committed
+    uint64_t lastLsn = wal->getLastLsn();
+    wal->close();
+
+    // Write the current state to a fresh log, then swap it in atomically
+    std::string tempPath = path + ".tmp";
+    std::error_code ec;
+    WriteAheadLog compacted;
+    if (!compacted.open(tempPath, options, 0, lastLsn)) {
+        wal->open(path, options, std::filesystem::file_size(path, ec), lastLsn);
+        return;
+    }
+    compacted.logCheckpoint();
+    for (const auto& setting : ConfigurationManager::getSettings()) {
+        compacted.logConfig(setting.first, setting.second);
+    }
+    for (const Delivery& d : processedDeliveries) {
+        compacted.logAdd(d);
+        compacted.logDispatch(d);
+    }
+    std::vector<Delivery> cancelled = getCancelledDeliveries();
+    for (auto it = cancelled.rbegin(); it != cancelled.rend(); ++it) {
+        compacted.logAdd(*it);
+        compacted.logCancel(*it);
+    }
+    for (const PriorityQueue<Delivery>* queue : {&urgentDeliveries, &standardDeliveries, &fragileDeliveries}) {
+        for (const Delivery& d : queue->getInternalData()) {
+            compacted.logAdd(d);
+        }
+    }
+    // Last, so it overrides the counts rebuilt from the retained history above
+    compacted.logMetrics(metrics.getTotals());
+    bool written = compacted.flush(true);
+    compacted.close();
+    if (!written) {
+        std::filesystem::remove(tempPath, ec);
+        wal->open(path, options, std::filesystem::file_size(path, ec), lastLsn);
+        return;
+    }
+    lastLsn = compacted.getLastLsn();
+
+    std::filesystem::rename(tempPath, path, ec);
+    wal->open(path, options, std::filesystem::file_size(path, ec), lastLsn);
+}
+
+bool DeliveryManager::syncLog() {
+    bool ok = !wal || wal->flush(true);
+    cancelledLog.flush();
+    return ok;
+}
+
+void DeliveryManager::maybeCheckpoint() {
+    if (wal->needsCheckpoint()) {
+        checkpointLog();
+    }
+}
+
+void DeliveryManager::onConfigChange(void* context, const std::string& key, double value) {
+    DeliveryManager* manager = static_cast<DeliveryManager*>(context);
+    if (manager->wal) {
+        manager->wal->logConfig(key, value);
+    }
+}
+
+// Replay suspends spilling because evicted cancellations are expected on disk
+// already, so the spill buffer is written before any cancel that evicted into it
+void DeliveryManager::onLogCommit(void* context) {
+    static_cast<DeliveryManager*>(context)->cancelledLog.flush();
+}
+
+//  Snapshots
+bool DeliveryManager::restoreSnapshot(const std::string& path) {
+    SnapshotContents contents;
+    if (!readQueueSnapshot(path, contents)) {
+        return false;
+    }
+
+    for (const auto& setting : contents.settings) {
+        ConfigurationManager::applySetting(setting.first, setting.second);
+    }
+    ConfigurationManager::restoreVersion(contents.configVersion);
+
+    // The arrays were saved in heap order, so they are adopted without re-inserting
+    urgentDeliveries.adopt(std::move(contents.queues[SNAPSHOT_URGENT]));
+    standardDeliveries.adopt(std::move(contents.queues[SNAPSHOT_STANDARD]));
+    fragileDeliveries.adopt(std::move(contents.queues[SNAPSHOT_FRAGILE]));
+    dropRanks();
+    cancelledLog.clear();
+    cancelledLog.setSpillSuspended(true);
+    for (const Delivery& d : contents.cancelled) {
+        index.setStatus(d.deliveryId, STATUS_CANCELLED);
+        cancelledLog.push(d);
+    }
+    cancelledLog.setSpillSuspended(false);
+    processedDeliveries.clear();
+    for (const Delivery& d : contents.processed) {
+        index.setStatus(d.deliveryId, STATUS_PROCESSED);
+        retainProcessed(d);
+    }
+    metrics.restoreTotals(contents.totals);
+    restoredLsn = contents.walLsn;
+    return true;
+}
+
+bool DeliveryManager::writeSnapshotNow(const std::string& path) const {
+    const std::vector<Delivery>* queues[3] = {
+        &urgentDeliveries.getInternalData(),
+        &standardDeliveries.getInternalData(),
+        &fragileDeliveries.getInternalData()};
+    std::vector<Delivery> cancelled = getCancelledDeliveries();
+    std::reverse(cancelled.begin(), cancelled.end());
+    std::vector<Delivery> processed(processedDeliveries.begin(), processedDeliveries.end());
+    return writeQueueSnapshot(path, queues, cancelled, processed, metrics.getTotals(),
+                              wal ? wal->getLastLsn() : 0);
+}
+
+bool DeliveryManager::writeSnapshot(const std::string& path, bool background) {
+#ifndef _WIN32
+    if (background) {
+        if (isSnapshotInProgress()) {
+            return false;
+        }
+        // The child writes from its copy-on-write view of memory while this
+        // process keeps dispatching; _exit skips stdio and log buffers it shares
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(writeSnapshotNow(path) ? 0 : 1);
+        }
+        if (pid > 0) {
+            snapshotWriterPid = pid;
+            return true;
+        }
+        // fork failed: fall back to writing in place
+    }
+#else
+    (void)background;
+#endif
+    return writeSnapshotNow(path);
+}
+
+void DeliveryManager::setSnapshotPolicy(const std::string& path, int everyOperations) {
+    snapshotPath = path;
+    snapshotInterval = everyOperations;
+    operationsSinceSnapshot = 0;
+}
+
+bool DeliveryManager::isSnapshotInProgress() {
+#ifndef _WIN32
+    if (snapshotWriterPid > 0 && waitpid(static_cast<pid_t>(snapshotWriterPid), nullptr, WNOHANG) != 0) {
+        snapshotWriterPid = 0;
+    }
+#endif
+    return snapshotWriterPid > 0;
+}
+
+void DeliveryManager::countOperation(int count) {
+    if (snapshotInterval <= 0) return;
+    operationsSinceSnapshot += count;
+    if (operationsSinceSnapshot >= snapshotInterval && writeSnapshot(snapshotPath, true)) {
+        operationsSinceSnapshot = 0;
+    }
+}
@@ -4,10 +4,24 @@
 #include "Delivery.h"
 #include "PriorityQueue.h"
 #include "ConfigurationManager.h"
+#include "DeliveryMetrics.h"
+#include "WriteAheadLog.h"
+#include "DeliveryIndex.h"
+#include "CancelledLog.h"
+#include "WireFormat.h"
+#include "DeliveryChange.h"
+#include "OperationLatency.h"
+#include "ArrivalTrace.h"
+#include "DispatchOrder.h"
+#include "DeliveryClock.h"
+#include "MinHeap.h"
+#include "QueueRank.h"
+#include <memory>
 #include <string>
 #include <vector>
 #include <map>
-#include <stack> //  For Cancelled Deliveries Log
+#include <deque>
+#include <unordered_map>
 
 class DeliveryManager
 {
@@ -15,18 +29,121 @@ private:
     PriorityQueue<Delivery> urgentDeliveries;
     PriorityQueue<Delivery> standardDeliveries;
     PriorityQueue<Delivery> fragileDeliveries;
-    std::vector<Delivery> processedDeliveries; // To store processed deliveries for reporting
+    std::deque<Delivery> processedDeliveries; // Most recent processed deliveries (bounded, for detailed reports)
+    DeliveryMetrics metrics;                  // Streaming statistics over every processed delivery
+    OperationLatency latency;                 // Time spent in add/process/update/cancel
 
-    std::stack<Delivery> cancelledStack; //  Stack to store cancelled deliveries in LIFO order
+    CancelledLog cancelledLog; //  Recent cancellations in a ring, older ones spilled to disk
+
+    // ID -> queue/slot or final status, kept current by the heaps' position observers
+    struct QueueBinding {
+        DeliveryManager *manager;
+        int queue;
+    };
+    DeliveryIndex index;
+    QueueBinding queueBindings[3];
+
+    std::unique_ptr<WriteAheadLog> wal; // Set once enableWriteAheadLog() succeeds
+    std::unique_ptr<ArrivalTraceWriter> capture; // Set while startTraceCapture() is recording
+    uint64_t restoredLsn;               // Log records up to here are already in the restored snapshot
+
+    std::string snapshotPath;
+    int snapshotInterval;               // Operations between periodic snapshots (0 = off)
+    int operationsSinceSnapshot;
+    long snapshotWriterPid;             // Background snapshot process, 0 when idle
+    bool verbose;                       // Console messages for adds and merges
+
+    // Deficit round robin (SCHEDULER_DRR): estimated minutes each class may
+    // still dispatch in the current round, and whose turn it is
+    double drrDeficit[3];
+    int drrTurn;       // Index into the round order urgent, fragile, standard
+    bool drrCredited;  // The current class already got its quantum this turn
+    int lastDispatchQueue; // Queue the most recent processNextDelivery() took from
+
+    // Earliest deadline first and shortest job first: an order over the
+    // queued deliveries of each queue, built when the mode is first used
+    // and then kept up by the adds; the next delivery is the least of the
+    // (up to three) tops. Entries are dropped lazily once their delivery
+    // is gone.
+    MinHeap<DispatchOrderEntry> dispatchOrder[3];
+    MinHeap<DispatchOrderEntry> lateOrder[3]; // EDF: could no longer finish in time when they reached the top
+    uint64_t orderSequence;
+    int orderMode;                         // Scheduler the order is keyed for, -1 when not kept
+    unsigned long long orderVersion;       // Configuration version it was keyed with
+
+    // Destination batching: per class, the queued deliveries bound for each
+    // destination, oldest first. Within a class the score only grows with
+    // the time waited, so oldest first is highest score first through any
+    // re-scoring. Kept only while batch_max_extra is set; stale entries are
+    // dropped as they surface, like the dispatch order's.
+    std::unordered_map<std::string, MinHeap<DispatchOrderEntry>> destinationGroups[3];
+    size_t destinationEntries;             // Across all groups, stale ones included
+    bool destinationsKept;
+
+    // Position queries: an order-statistic tree per queue, built on the
+    // first query and from then on updated by every add, dispatch, cancel,
+    // merge and re-score
+    QueueRank queueRanks[3];
+    bool ranksKept;
+    uint64_t queueDispatches[3];           // Per queue, for the ETA's dispatch rate
+
+    DeliveryChangeListener changeListener; // Receives every queue change, or null
+    void *changeContext;
+    uint64_t changeSeq;                    // Sequence number of the last change
+
+    int nextDeficitRoundRobinQueue(unsigned char classes); // Queue to serve next under SCHEDULER_DRR; needs one of classes queued
+    static time_t deadlineFor(const Delivery &delivery); // entryTime + the SLA of its class
+    double orderKey(const Delivery &delivery) const;
+    void trackOrder(const Delivery &delivery);
+    void prepareOrder(int mode); // Builds or compacts the order for mode
+    bool locateInOrder(MinHeap<DispatchOrderEntry> &heap, int queue, int &slot); // Skips stale tops
+    int frontOfOrder(MinHeap<DispatchOrderEntry> *heaps, unsigned char classes, int &slot); // Queue with the least top, -1 if none
+    Delivery dispatchAt(int queue, int slot);
+    Delivery dispatchEarliestDeadline(unsigned char classes);
+    Delivery dispatchShortestJob(unsigned char classes);
+    void trackDestination(const Delivery &delivery);
+    void prepareDestinations(); // Builds or compacts the destination groups
+    bool locateInGroup(MinHeap<DispatchOrderEntry> &group, int &queue, int &slot); // Skips stale tops
+    void cancelAt(int queue, int slot); // Cancels the queued delivery at a heap slot
+    void rankInsert(int queue, const Delivery &delivery);
+    void rankErase(int queue, const Delivery &delivery);
+    void prepareRanks();
+    void dropRanks(); // After the queues were replaced wholesale (replay, restore)
+    void completeDispatch(Delivery &processed, int queue); // Stamps service times, records metrics and history
+    void retainProcessed(const Delivery &processed);
+    bool replayLog(const std::string &path, uint64_t &validBytes, uint64_t &lastLsn);
+    void maybeCheckpoint();
+    void countOperation(int count = 1);
+    bool writeSnapshotNow(const std::string &path) const;
+    static void onConfigChange(void *context, const std::string &key, double value);
+    static void onLogCommit(void *context);
+    static void onHeapMove(void *context, const Delivery &delivery, int slot);
+    PriorityQueue<Delivery> &queueFor(int queue);
+    void emitChange(DeliveryChangeType type, const Delivery &delivery, int queue, int fromQueue);
 
 public:
     void printQueuedDeliveriesWithScores() const;
     DeliveryManager();
+    ~DeliveryManager();
+    DeliveryManager(const DeliveryManager &) = delete; // The heaps hold observer pointers back to this
+    DeliveryManager &operator=(const DeliveryManager &) = delete;
 
     // === Core Delivery Operations ===
     void addDelivery(Delivery &delivery);
-    Delivery processNextDelivery();
-    bool hasDeliveries() const;
+    size_t addDeliveries(const WireDelivery *records, size_t count); // Scores and heap-builds a batch; returns accepted
+    size_t addScoredDeliveries(std::vector<Delivery> &deliveries);   // A batch decoded and scored elsewhere; empties it
+    static Delivery decodeWireDelivery(const WireDelivery &record, time_t now); // Valid record; entryTime 0 becomes now
+    // classes restricts the dispatch to some queues, e.g. the ones an idle
+    // service counter can take; each scheduler keeps its order among them
+    Delivery processNextDelivery(unsigned char classes = ALL_DELIVERY_CLASSES);
+    bool hasDeliveries(unsigned char classes = ALL_DELIVERY_CLASSES) const;
+    // processNextDelivery(classes), then up to batch_max_extra more queued
+    // deliveries of the same class and destination, highest score first,
+    // while they score within batch_max_gap of the first. O(K log n) for K
+    // extras; just the one delivery while batch_max_extra is 0.
+    std::vector<Delivery> processNextBatch(unsigned char classes = ALL_DELIVERY_CLASSES);
+    DeliveryType getLastDispatchQueue() const { return static_cast<DeliveryType>(lastDispatchQueue); }
+    void setVerbose(bool enabled) { verbose = enabled; } // Off for servers and batch tools
 
     // === Queue Management ===
     void updatePriorities();   // Recalculates and repositions based on score
@@ -35,14 +152,61 @@ public:
 
     // === Cancelled Delivery Feature ===
     bool cancelDeliveryById(const std::string &id); //  Cancels and logs
-    void viewCancelledDeliveries() const;           //  Displays from stack
+    void viewCancelledDeliveries() const;           //  Displays the in-memory ring
+    std::vector<Delivery> getCancelledDeliveries() const; // In-memory ring, most recent first
+    std::vector<Delivery> getCancelledPage(uint64_t offset, size_t limit) const; // Full history, most recent first
+    uint64_t getCancelledCount() const { return cancelledLog.totalSize(); }
+    bool enableCancelledSpill(const std::string &path); // Archive evicted cancellations to path (+ ".idx")
+
+    // === Change Stream ===
+    // Called after every add, dispatch, cancel, re-score and merge (not during
+    // log replay or snapshot restore). One listener at a time; null detaches.
+    void setChangeListener(DeliveryChangeListener listener, void *context);
+    uint64_t getChangeSequence() const { return changeSeq; }
+
+    // === Trace Capture ===
+    // Records every add, dispatch and cancel request with its timestamp, for
+    // replay with bench/trace_replay (see ArrivalTrace.h)
+    bool startTraceCapture(const std::string &path);
+    bool stopTraceCapture(); // False if the trace could not be written completely
+    bool isCapturingTrace() const { return capture != nullptr; }
+
+    // === Lookup ===
+    DeliveryLookup findDelivery(const std::string &id) const; // O(1) through the ID index
+
+    // === Queue Position ===
+    // Rank within the queue holding a delivery, in that queue's own order
+    // (highest score, then oldest, first), which is the order strict
+    // priority and DRR take it in; EDF and SJF reorder across it. The ETA
+    // divides the rank by the rate the queue has been dispatching at.
+    QueuePosition getQueuePosition(const std::string &id); // O(log n)
+    size_t countAbove(DeliveryType queue, double score);    // O(log n): queued there with a higher score
+    std::vector<Delivery> getQueuePage(DeliveryType queue, size_t offset, size_t limit); // O(log n + limit)
+    size_t getIndexMemoryBytes() const { return index.memoryBytes(); }
+
+    // === Durability ===
+    // Replays an existing log into the (empty) queues, then logs every add,
+    // dispatch, cancel and configuration change to it
+    bool enableWriteAheadLog(const std::string &path, const WalOptions &options = WalOptions());
+    void checkpointLog(); // Compacts the log down to the current state
+    bool syncLog();       // Commits and fsyncs pending log records; false if the write failed
+
+    // === Snapshots ===
+    bool restoreSnapshot(const std::string &path); // Call before enableWriteAheadLog()
+    bool writeSnapshot(const std::string &path, bool background = true);
+    void setSnapshotPolicy(const std::string &path, int everyOperations);
+    bool isSnapshotInProgress(); // Also reaps a finished background writer
 
     // === Metrics Access ===
     int getUrgentQueueSize() const { return urgentDeliveries.size(); }
     int getStandardQueueSize() const { return standardDeliveries.size(); }
     int getFragileQueueSize() const { return fragileDeliveries.size(); }
+    const std::vector<Delivery> &getQueueData(DeliveryType type) const; // Heap order
     int getTotalQueueSize() const { return urgentDeliveries.size() + standardDeliveries.size() + fragileDeliveries.size(); }
-    const std::vector<Delivery> &getProcessedDeliveries() const { return processedDeliveries; }
+    const std::deque<Delivery> &getProcessedDeliveries() const { return processedDeliveries; }
+    const DeliveryMetrics &getMetrics() const { return metrics; }
+    const OperationLatency &getLatency() const { return latency; }
+    void resetLatency() { latency.reset(); }
 };
 
 #endif // DELIVERY_MANAGER_H
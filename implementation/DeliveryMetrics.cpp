@@ -0,0 +1,289 @@
+﻿#include "DeliveryMetrics.h"
+#include "Delivery.h"
+#include <algorithm>
+#include <cmath>
+#include <iomanip>
+
+void RunningStats::add(double x)
+{
+    ++n;
+    double delta = x - mean;
+    mean += delta / n;
+    m2 += delta * (x - mean);
+    if (n == 1 || x < minValue) minValue = x;
+    if (n == 1 || x > maxValue) maxValue = x;
+}
+
+void RunningStats::reset()
+{
+    n = 0;
+    mean = 0.0;
+    m2 = 0.0;
+    minValue = 0.0;
+    maxValue = 0.0;
+}
+
+double RunningStats::getStdDev() const
+{
+    return std::sqrt(getVariance());
+}
+
+int LogLinearHistogram::bucketIndex(uint64_t value)
+{
+    if (value < 2 * SUB_BUCKETS) {
+        return static_cast<int>(value);
+    }
+    int msb = 63 - __builtin_clzll(value);
+    int exponent = msb - SUB_BUCKET_BITS;
+    // Values of 2^63 and up would index past the table; they share the last bucket
+    return std::min(exponent * SUB_BUCKETS + static_cast<int>(value >> exponent), BUCKET_COUNT - 1);
+}
+
+uint64_t LogLinearHistogram::bucketLowerBound(int index)
+{
+    if (index < 2 * SUB_BUCKETS) {
+        return static_cast<uint64_t>(index);
+    }
+    int exponent = index / SUB_BUCKETS - 1;
+    uint64_t mantissa = static_cast<uint64_t>(index % SUB_BUCKETS + SUB_BUCKETS);
+    return mantissa << exponent;
+}
+
+uint64_t LogLinearHistogram::bucketUpperBound(int index)
+{
+    if (index < 2 * SUB_BUCKETS) {
+        return static_cast<uint64_t>(index);
+    }
+    if (index >= BUCKET_COUNT - 1) {
+        return UINT64_MAX; // The last bucket also takes everything from 2^63 up
+    }
+    int exponent = index / SUB_BUCKETS - 1;
+    return bucketLowerBound(index) + ((uint64_t(1) << exponent) - 1);
+}
+
+void LogLinearHistogram::record(uint64_t value)
+{
+    ++counts[bucketIndex(value)];
+    ++total;
+    if (value > maxValue) maxValue = value;
+}
+
+void LogLinearHistogram::recordCount(uint64_t value, uint64_t count)
+{
+    if (count == 0) return;
+    counts[bucketIndex(value)] += count;
+    total += count;
+    if (value > maxValue) maxValue = value;
+}
+
+void LogLinearHistogram::merge(const LogLinearHistogram &other)
+{
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        counts[i] += other.counts[i];
+    }
+    total += other.total;
+    maxValue = std::max(maxValue, other.maxValue);
+}
+
+void LogLinearHistogram::reset()
+{
+    std::fill(counts.begin(), counts.end(), 0);
+    total = 0;
+    maxValue = 0;
+}
+
+uint64_t LogLinearHistogram::percentile(double quantile) const
+{
+    if (total == 0) return 0;
+    if (quantile <= 0.0) quantile = 0.0;
+    if (quantile >= 1.0) return maxValue;
+
+    uint64_t rank = static_cast<uint64_t>(std::ceil(quantile * total));
+    if (rank == 0) rank = 1;
+    uint64_t seen = 0;
+    for (int i = 0; i < BUCKET_COUNT; ++i) {
+        seen += counts[i];
+        if (seen >= rank) {
+            uint64_t upper = bucketUpperBound(i);
+            return upper < maxValue ? upper : maxValue;
+        }
+    }
+    return maxValue;
+}
+
+void DeliveryMetrics::recordArrival(DeliveryType type)
+{
+    ++perType[type].arrivals;
+}
+
+void DeliveryMetrics::recordDispatch(const Delivery &delivery)
+{
+    TypeMetrics &m = perType[delivery.getType()];
+    double waitSeconds = std::difftime(delivery.getServiceStartTime(), delivery.getEntryTime());
+    double serviceSeconds = std::difftime(delivery.getServiceEndTime(), delivery.getServiceStartTime());
+    if (waitSeconds < 0) waitSeconds = 0;
+    if (serviceSeconds < 0) serviceSeconds = 0;
+
+    ++m.processed;
+    if (delivery.estimatedDeliveryTime > 0) m.dispatchedMinutes += delivery.estimatedDeliveryTime;
+    m.waitStats.add(waitSeconds / 60.0);
+    m.serviceStats.add(serviceSeconds / 60.0);
+    m.waitHistogram.record(static_cast<uint64_t>(waitSeconds * 1000.0));
+    m.serviceHistogram.record(static_cast<uint64_t>(serviceSeconds * 1000.0));
+
+    if (firstDispatch == 0) firstDispatch = delivery.getServiceStartTime();
+    lastDispatch = delivery.getServiceStartTime();
+}
+
+void DeliveryMetrics::recordCancellation(DeliveryType type)
+{
+    ++perType[type].cancelled;
+}
+
+void DeliveryMetrics::recordLateness(DeliveryType type, double latenessSeconds)
+{
+    TypeMetrics &m = perType[type];
+    m.latenessStats.add(latenessSeconds / 60.0);
+    if (latenessSeconds > 0) ++m.deadlineMisses;
+    m.tardinessHistogram.record(latenessSeconds > 0 ? static_cast<uint64_t>(latenessSeconds * 1000.0) : 0);
+}
+
+void DeliveryMetrics::recordDispatchBatch(size_t deliveries)
+{
+    batchStats.add(static_cast<double>(deliveries));
+    batchHistogram.record(deliveries);
+}
+
+void DeliveryMetrics::reset()
+{
+    for (int i = 0; i < TYPE_COUNT; ++i) {
+        perType[i] = TypeMetrics();
+    }
+    firstDispatch = 0;
+    lastDispatch = 0;
+    batchStats.reset();
+    batchHistogram.reset();
+}
+
+MetricsTotals DeliveryMetrics::getTotals() const
+{
+    MetricsTotals totals;
+    for (int i = 0; i < TYPE_COUNT; ++i) {
+        const TypeMetrics &m = perType[i];
+        TypeTotals &t = totals.perType[i];
+        t.arrivals = m.arrivals;
+        t.processed = m.processed;
+        t.cancelled = m.cancelled;
+        t.dispatchedMinutes = m.dispatchedMinutes;
+        t.deadlineMisses = m.deadlineMisses;
+        t.deadlineDrops = m.deadlineDrops;
+    }
+    totals.firstDispatch = firstDispatch;
+    totals.lastDispatch = lastDispatch;
+    return totals;
+}
+
+void DeliveryMetrics::restoreTotals(const MetricsTotals &totals)
+{
+    for (int i = 0; i < TYPE_COUNT; ++i) {
+        TypeMetrics &m = perType[i];
+        const TypeTotals &t = totals.perType[i];
+        m.arrivals = t.arrivals;
+        m.processed = t.processed;
+        m.cancelled = t.cancelled;
+        m.dispatchedMinutes = t.dispatchedMinutes;
+        m.deadlineMisses = t.deadlineMisses;
+        m.deadlineDrops = t.deadlineDrops;
+    }
+    firstDispatch = totals.firstDispatch;
+    lastDispatch = totals.lastDispatch;
+}
+
+uint64_t DeliveryMetrics::getTotalArrivals() const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < TYPE_COUNT; ++i) total += perType[i].arrivals;
+    return total;
+}
+
+uint64_t DeliveryMetrics::getTotalProcessed() const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < TYPE_COUNT; ++i) total += perType[i].processed;
+    return total;
+}
+
+uint64_t DeliveryMetrics::getTotalCancelled() const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < TYPE_COUNT; ++i) total += perType[i].cancelled;
+    return total;
+}
+
+double DeliveryMetrics::getThroughputPerMinute() const
+{
+    uint64_t processed = getTotalProcessed();
+    double minutes = std::difftime(lastDispatch, firstDispatch) / 60.0;
+    if (processed == 0) return 0.0;
+    if (minutes <= 0.0) return static_cast<double>(processed); // everything within the first minute
+    return processed / minutes;
+}
+
+double DeliveryMetrics::getCapacityShare(DeliveryType type) const
+{
+    uint64_t total = 0;
+    for (int i = 0; i < TYPE_COUNT; ++i) total += perType[i].dispatchedMinutes;
+    return total ? static_cast<double>(perType[type].dispatchedMinutes) / total : 0.0;
+}
+
+void DeliveryMetrics::printSummary(std::ostream &out) const
+{
+    static const char *names[TYPE_COUNT] = {"Urgent", "Standard", "Fragile"};
+
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+
+    out << "--- Streaming Statistics (minutes) ---\n";
+    for (int i = 0; i < TYPE_COUNT; ++i) {
+        const TypeMetrics &m = perType[i];
+        out << names[i] << ": arrived=" << m.arrivals
+            << " processed=" << m.processed
+            << " cancelled=" << m.cancelled << "\n";
+        if (m.processed == 0) continue;
+        out << "  share   dispatches=" << 100.0 * m.processed / getTotalProcessed()
+            << "% capacity=" << 100.0 * getCapacityShare(static_cast<DeliveryType>(i))
+            << "% (" << m.dispatchedMinutes << " estimated minutes)\n";
+        out << "  wait    mean=" << m.waitStats.getMean()
+            << " sd=" << m.waitStats.getStdDev()
+            << " p50=" << m.waitHistogram.percentile(0.50) / 60000.0
+            << " p90=" << m.waitHistogram.percentile(0.90) / 60000.0
+            << " p99=" << m.waitHistogram.percentile(0.99) / 60000.0
+            << " max=" << m.waitHistogram.getMax() / 60000.0 << "\n";
+        out << "  service mean=" << m.serviceStats.getMean()
+            << " sd=" << m.serviceStats.getStdDev()
+            << " p50=" << m.serviceHistogram.percentile(0.50) / 60000.0
+            << " p90=" << m.serviceHistogram.percentile(0.90) / 60000.0
+            << " p99=" << m.serviceHistogram.percentile(0.99) / 60000.0
+            << " max=" << m.serviceHistogram.getMax() / 60000.0 << "\n";
+        if (m.latenessStats.count() == 0) continue;
+        out << "  deadline missed=" << m.deadlineMisses
+            << " (" << 100.0 * m.deadlineMisses / m.latenessStats.count() << "%)"
+            << " dropped=" << m.deadlineDrops
+            << " lateness mean=" << m.latenessStats.getMean()
+            << " max=" << m.latenessStats.getMax()
+            << " tardiness p90=" << m.tardinessHistogram.percentile(0.90) / 60000.0
+            << " p99=" << m.tardinessHistogram.percentile(0.99) / 60000.0 << "\n";
+    }
+    if (batchStats.count() > 0) {
+        out << "Batches: trips=" << batchStats.count()
+            << " deliveries/trip mean=" << batchStats.getMean()
+            << " p50=" << batchHistogram.percentile(0.50)
+            << " p90=" << batchHistogram.percentile(0.90)
+            << " max=" << batchHistogram.getMax() << "\n";
+    }
+    out << "Throughput: " << getThroughputPerMinute() << " deliveries/minute\n";
+
+    out.flags(flags);
+    out.precision(precision);
+}
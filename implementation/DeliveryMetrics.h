@@ -0,0 +1,144 @@
+﻿#ifndef DELIVERY_METRICS_H
+#define DELIVERY_METRICS_H
+
+#include <cstdint>
+#include <ctime>
+#include <ostream>
+#include <vector>
+#include "DeliveryTypes.h"
+
+class Delivery;
+
+// Online mean / variance using Welford's algorithm (O(1) memory)
+class RunningStats
+{
+private:
+    uint64_t n;
+    double mean;
+    double m2;
+    double minValue;
+    double maxValue;
+
+public:
+    RunningStats() { reset(); }
+
+    void add(double x);
+    void reset();
+
+    uint64_t count() const { return n; }
+    double getMean() const { return mean; }
+    double getVariance() const { return n > 1 ? m2 / (n - 1) : 0.0; }
+    double getStdDev() const;
+    double getMin() const { return n ? minValue : 0.0; }
+    double getMax() const { return n ? maxValue : 0.0; }
+};
+
+// Log-linear (HDR style) histogram over non-negative integer values.
+// Values below 2 * SUB_BUCKETS are stored exactly, larger values land in
+// one of SUB_BUCKETS linear slots per power of two (~3% relative error).
+class LogLinearHistogram
+{
+public:
+    static const int SUB_BUCKET_BITS = 5;
+    static const int SUB_BUCKETS = 1 << SUB_BUCKET_BITS;
+    static const int BUCKET_COUNT = (64 - SUB_BUCKET_BITS) * SUB_BUCKETS;
+
+    static int bucketIndex(uint64_t value);
+    static uint64_t bucketLowerBound(int index);
+    static uint64_t bucketUpperBound(int index);
+
+private:
+    std::vector<uint64_t> counts;
+    uint64_t total;
+    uint64_t maxValue;
+
+public:
+    LogLinearHistogram() : counts(BUCKET_COUNT, 0), total(0), maxValue(0) {}
+
+    void record(uint64_t value);
+    void recordCount(uint64_t value, uint64_t count); // count samples of the same value
+    void merge(const LogLinearHistogram &other); // Adds other's samples, e.g. per-thread histograms
+    void reset();
+
+    uint64_t count() const { return total; }
+    uint64_t getMax() const { return maxValue; }
+    // Highest value equivalent to the given quantile (0.0 - 1.0)
+    uint64_t percentile(double quantile) const;
+};
+
+// Everything tracked for one delivery class
+struct TypeMetrics
+{
+    uint64_t arrivals = 0;
+    uint64_t processed = 0;
+    uint64_t cancelled = 0;
+    uint64_t dispatchedMinutes = 0;    // Sum of estimatedDeliveryTime over processed deliveries
+    uint64_t deadlineMisses = 0;       // Processed deliveries projected to finish after their SLA deadline
+    uint64_t deadlineDrops = 0;        // Cancelled by the EDF scheduler as too late (also in cancelled)
+    RunningStats waitStats;            // minutes
+    RunningStats serviceStats;         // minutes
+    LogLinearHistogram waitHistogram;  // milliseconds
+    LogLinearHistogram serviceHistogram; // milliseconds
+    RunningStats latenessStats;        // minutes, projected finish - deadline (negative when early)
+    LogLinearHistogram tardinessHistogram; // milliseconds, lateness clamped at 0
+};
+
+// Lifetime counters of one class, without the distributions
+struct TypeTotals
+{
+    uint64_t arrivals = 0;
+    uint64_t processed = 0;
+    uint64_t cancelled = 0;
+    uint64_t dispatchedMinutes = 0;
+    uint64_t deadlineMisses = 0;
+    uint64_t deadlineDrops = 0;
+};
+
+// Counters a compacted write-ahead log carries across the history it drops
+struct MetricsTotals
+{
+    TypeTotals perType[3];
+    time_t firstDispatch = 0;
+    time_t lastDispatch = 0;
+};
+
+// Streaming statistics over every dispatched delivery. All updates are O(1)
+// and memory stays constant no matter how long the system runs.
+class DeliveryMetrics
+{
+private:
+    static const int TYPE_COUNT = 3;
+    TypeMetrics perType[TYPE_COUNT];
+    time_t firstDispatch;
+    time_t lastDispatch;
+    RunningStats batchStats;          // Deliveries per processNextBatch() trip
+    LogLinearHistogram batchHistogram;
+
+public:
+    DeliveryMetrics() : firstDispatch(0), lastDispatch(0) {}
+
+    void recordArrival(DeliveryType type);
+    void recordDispatch(const Delivery &delivery);
+    void recordCancellation(DeliveryType type);
+    void recordLateness(DeliveryType type, double latenessSeconds);
+    void recordDeadlineDrop(DeliveryType type) { ++perType[type].deadlineDrops; }
+    void recordDispatchBatch(size_t deliveries);
+    void reset();
+    MetricsTotals getTotals() const;
+    // Replaces the counters (not the distributions) with saved lifetime totals
+    void restoreTotals(const MetricsTotals &totals);
+
+    const TypeMetrics &forType(DeliveryType type) const { return perType[type]; }
+    uint64_t getTotalArrivals() const;
+    uint64_t getTotalProcessed() const;
+    uint64_t getTotalCancelled() const;
+    double getThroughputPerMinute() const; // processed deliveries per minute since the first dispatch
+    // Fraction of all dispatched estimated minutes (counter capacity) that went to this class
+    double getCapacityShare(DeliveryType type) const;
+    const RunningStats &getBatchStats() const { return batchStats; }
+    const LogLinearHistogram &getBatchHistogram() const { return batchHistogram; }
+
+    void printSummary(std::ostream &out) const;
+};
+
+#endif // DELIVERY_METRICS_H
@@ -0,0 +1,174 @@
+#include "DeliveryPipeline.h"
+#include <chrono>
+#include <thread>
+
+namespace {
+
+typedef std::chrono::steady_clock PipelineClock;
+
+// Where each thread's stages end, by depth: depth 2 pairs decoding with
+// scoring and queueing with dispatch, depth 3 keeps the manager and the
+// sink together
+const int GROUP_END[STAGE_COUNT][STAGE_COUNT] = {
+    {STAGE_COUNT},
+    {STAGE_QUEUE, STAGE_COUNT},
+    {STAGE_SCORE, STAGE_QUEUE, STAGE_COUNT},
+    {STAGE_SCORE, STAGE_QUEUE, STAGE_DISPATCH, STAGE_COUNT}};
+
+double secondsSince(PipelineClock::time_point start)
+{
+    return std::chrono::duration<double>(PipelineClock::now() - start).count();
+}
+
+} // namespace
+
+DeliveryPipeline::DeliveryPipeline(DeliveryManager &deliveryManager, const PipelineOptions &pipelineOptions)
+    : manager(deliveryManager), options(pipelineOptions), rejected(0), elapsedSeconds(0.0)
+{
+    if (options.batchSize < 1) options.batchSize = 1;
+    if (options.ringBatches < 2) options.ringBatches = 2;
+    if (options.depth < 1) options.depth = 1;
+    if (options.depth > STAGE_COUNT) options.depth = STAGE_COUNT;
+}
+
+const char *DeliveryPipeline::stageName(PipelineStage stage)
+{
+    switch (stage) {
+    case STAGE_INGEST: return "ingest";
+    case STAGE_SCORE: return "score";
+    case STAGE_QUEUE: return "queue";
+    case STAGE_DISPATCH: return "dispatch";
+    default: return "unknown";
+    }
+}
+
+bool DeliveryPipeline::ingest(Batch &batch, std::vector<WireDelivery> &records)
+{
+    PipelineClock::time_point start = PipelineClock::now();
+    size_t count = source ? source(records.data(), records.size()) : 0;
+    if (count == 0) return false;
+    time_t now = DeliveryClock::now();
+    batch.reserve(count);
+    for (size_t i = 0; i < count; ++i) {
+        if (isValidWireDelivery(records[i])) batch.push_back(DeliveryManager::decodeWireDelivery(records[i], now));
+        else ++rejected;
+    }
+    PipelineStageStats &s = stats[STAGE_INGEST];
+    ++s.batches;
+    s.deliveries += batch.size();
+    s.busySeconds += secondsSince(start);
+    return true;
+}
+
+void DeliveryPipeline::score(Batch &batch)
+{
+    // One read of the weights and the clock per batch, as addDeliveries() does
+    PipelineClock::time_point start = PipelineClock::now();
+    ScoringWeights weights = ScoringWeights::current();
+    time_t now = DeliveryClock::now();
+    for (Delivery &delivery : batch) delivery.calculatePriorityScore(weights, now);
+    PipelineStageStats &s = stats[STAGE_SCORE];
+    ++s.batches;
+    s.deliveries += batch.size();
+    s.busySeconds += secondsSince(start);
+}
+
+void DeliveryPipeline::queue(Batch &batch)
+{
+    // The batch goes into the manager and comes back out holding what was dispatched
+    PipelineClock::time_point start = PipelineClock::now();
+    PipelineStageStats &s = stats[STAGE_QUEUE];
+    s.deliveries += manager.addScoredDeliveries(batch);
+    for (size_t i = 0; i < options.dispatchPerBatch && manager.hasDeliveries(); ++i) {
+        batch.push_back(manager.processNextDelivery());
+    }
+    ++s.batches;
+    s.busySeconds += secondsSince(start);
+}
+
+bool DeliveryPipeline::drain(Batch &batch)
+{
+    PipelineClock::time_point start = PipelineClock::now();
+    while (batch.size() < options.batchSize && manager.hasDeliveries()) batch.push_back(manager.processNextDelivery());
+    stats[STAGE_QUEUE].busySeconds += secondsSince(start);
+    return !batch.empty();
+}
+
+void DeliveryPipeline::dispatch(Batch &batch)
+{
+    PipelineClock::time_point start = PipelineClock::now();
+    if (sink) sink(batch);
+    PipelineStageStats &s = stats[STAGE_DISPATCH];
+    ++s.batches;
+    s.deliveries += batch.size();
+    batch.clear();
+    s.busySeconds += secondsSince(start);
+}
+
+bool DeliveryPipeline::applyStages(int first, int last, Batch &batch)
+{
+    for (int stage = first; stage < last; ++stage) {
+        switch (stage) {
+        case STAGE_SCORE:
+            score(batch);
+            break;
+        case STAGE_QUEUE:
+            queue(batch);
+            if (batch.empty()) return false; // Nothing dispatched, nothing to pass on
+            break;
+        case STAGE_DISPATCH:
+            dispatch(batch);
+            return false;
+        }
+    }
+    return true;
+}
+
+void DeliveryPipeline::runStages(int first, int last, SpscRing<Batch> *in, SpscRing<Batch> *out)
+{
+    std::vector<WireDelivery> records(first == STAGE_INGEST ? options.batchSize : 0);
+    for (;;) {
+        Batch batch;
+        if (first == STAGE_INGEST) {
+            if (!ingest(batch, records)) break;
+            if (applyStages(STAGE_INGEST + 1, last, batch) && out) out->push(batch);
+        } else {
+            if (!in->pop(batch)) break;
+            if (applyStages(first, last, batch) && out) out->push(batch);
+        }
+    }
+    if (options.drainAtEnd && first <= STAGE_QUEUE && STAGE_QUEUE < last) {
+        Batch batch;
+        while (drain(batch)) {
+            if (applyStages(STAGE_QUEUE + 1, last, batch) && out) out->push(batch);
+            batch = Batch();
+        }
+    }
+    if (out) out->close();
+}
+
+void DeliveryPipeline::run()
+{
+    for (PipelineStageStats &s : stats) s = PipelineStageStats();
+    rejected = 0;
+    const int *ends = GROUP_END[options.depth - 1];
+    rings.clear();
+    for (int i = 0; i + 1 < options.depth; ++i) rings.emplace_back(new SpscRing<Batch>(options.ringBatches));
+
+    // The calling thread takes the first group (the source), one new thread each of the rest
+    PipelineClock::time_point start = PipelineClock::now();
+    std::vector<std::thread> threads;
+    for (int group = 1; group < options.depth; ++group) {
+        threads.emplace_back(&DeliveryPipeline::runStages, this, ends[group - 1], ends[group], rings[group - 1].get(),
+                             group + 1 < options.depth ? rings[group].get() : nullptr);
+    }
+    runStages(STAGE_INGEST, ends[0], nullptr, rings.empty() ? nullptr : rings[0].get());
+    for (std::thread &thread : threads) thread.join();
+    elapsedSeconds = secondsSince(start);
+
+    // A ring's full waits belong to the stage feeding it, its empty waits to the one draining it
+    for (int i = 0; i + 1 < options.depth; ++i) {
+        stats[ends[i] - 1].fullWaits = rings[i]->getFullWaits();
+        stats[ends[i]].emptyWaits = rings[i]->getEmptyWaits();
+    }
+}
@@ -0,0 +1,92 @@
+#ifndef DELIVERY_PIPELINE_H
+#define DELIVERY_PIPELINE_H
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+#include "DeliveryManager.h"
+#include "SpscRing.h"
+#include "WireFormat.h"
+
+enum PipelineStage {
+    STAGE_INGEST,   // Pull wire records from the source, validate and decode them
+    STAGE_SCORE,    // Score each batch against one read of the weights and clock
+    STAGE_QUEUE,    // Insert into the DeliveryManager and pick what to dispatch
+    STAGE_DISPATCH, // Hand dispatched deliveries to the sink
+    STAGE_COUNT
+};
+
+struct PipelineOptions {
+    size_t batchSize = 256;        // Records per batch passed between stages
+    size_t ringBatches = 64;       // Batches a ring holds before its producer waits
+    int depth = STAGE_COUNT;       // Threads the stages are spread over, 1..4
+    size_t dispatchPerBatch = 0;   // Deliveries the queue stage dispatches after each insert
+    bool drainAtEnd = false;       // Dispatch whatever is still queued once the source ends
+};
+
+// What one stage did during run(); busy time excludes waiting on the rings
+struct PipelineStageStats {
+    uint64_t batches = 0;
+    uint64_t deliveries = 0;      // Decoded, scored, inserted or handed to the sink
+    double busySeconds = 0.0;
+    uint64_t fullWaits = 0;       // Times its output ring was full (backpressure)
+    uint64_t emptyWaits = 0;      // Times its input ring was empty
+};
+
+// Ingest -> score -> queue -> dispatch, each stage on its own thread,
+// connected by bounded SPSC rings of batches.
+//
+// The DeliveryManager is only ever touched by the queue stage's thread, so
+// it needs no locking; the other stages work on batches they own outright.
+// With depth below 4, neighbouring stages share a thread and hand batches
+// over directly (depth 1 is the whole path inline on the calling thread),
+// which is the baseline the threaded runs are measured against.
+class DeliveryPipeline
+{
+public:
+    // Fills up to max records and returns how many; 0 ends the input
+    typedef std::function<size_t(WireDelivery *out, size_t max)> Source;
+    // Receives each batch of dispatched deliveries, in dispatch order
+    typedef std::function<void(std::vector<Delivery> &dispatched)> Sink;
+
+private:
+    typedef std::vector<Delivery> Batch;
+
+    DeliveryManager &manager;
+    PipelineOptions options;
+    Source source;
+    Sink sink;
+    std::vector<std::unique_ptr<SpscRing<Batch>>> rings; // rings[i] connects thread i to thread i + 1
+    PipelineStageStats stats[STAGE_COUNT];
+    uint64_t rejected;                                   // Invalid records dropped while decoding
+    double elapsedSeconds;
+
+    bool ingest(Batch &batch, std::vector<WireDelivery> &records); // False at the end of the input
+    void score(Batch &batch);
+    void queue(Batch &batch);
+    void dispatch(Batch &batch);
+    bool drain(Batch &batch); // End of input: the next drainAtEnd batch, false when nothing is left
+    bool applyStages(int first, int last, Batch &batch); // Stages first..last-1; false when nothing is left to pass on
+    void runStages(int first, int last, SpscRing<Batch> *in, SpscRing<Batch> *out); // One thread's share
+
+public:
+    DeliveryPipeline(DeliveryManager &manager, const PipelineOptions &options);
+    DeliveryPipeline(const DeliveryPipeline &) = delete;
+    DeliveryPipeline &operator=(const DeliveryPipeline &) = delete;
+
+    void setSource(Source s) { source = std::move(s); }
+    void setSink(Sink s) { sink = std::move(s); } // Optional; dispatched deliveries are dropped without one
+
+    // Runs until the source ends and every batch has left the last stage.
+    // The manager must not be used by anyone else meanwhile.
+    void run();
+
+    const PipelineStageStats &getStageStats(PipelineStage stage) const { return stats[stage]; }
+    uint64_t getRejected() const { return rejected; }
+    double getElapsedSeconds() const { return elapsedSeconds; }
+    int getDepth() const { return options.depth; }
+    static const char *stageName(PipelineStage stage);
+};
+
+#endif // DELIVERY_PIPELINE_H
@@ -7,6 +7,9 @@ enum DeliveryType {
     FRAGILE
 };
 
+// A set of classes (and so of queues), bit 1 << DeliveryType each
+const unsigned char ALL_DELIVERY_CLASSES = (1 << URGENT) | (1 << STANDARD) | (1 << FRAGILE);
+
 #endif // DELIVERY_TYPES_H
 
 
@@ -0,0 +1,24 @@
+#ifndef DISPATCH_ORDER_H
+#define DISPATCH_ORDER_H
+
+#include <cstdint>
+#include <string>
+
+// Element of a cross-class dispatch order (SCHEDULER_EDF, SCHEDULER_SJF).
+// It names a delivery that lives in one of DeliveryManager's class queues;
+// the queue and slot are looked up through the ID index when the entry
+// reaches the top, and entries whose delivery has left (or been re-added)
+// are skipped.
+struct DispatchOrderEntry {
+    double key;         // Smallest first: the deadline, or the aged job length
+    uint64_t sequence;  // Arrival order among equal keys
+    std::string deliveryId;
+
+    bool operator<(const DispatchOrderEntry &other) const
+    {
+        return key != other.key ? key < other.key : sequence < other.sequence;
+    }
+    bool operator>(const DispatchOrderEntry &other) const { return other < *this; }
+};
+
+#endif // DISPATCH_ORDER_H
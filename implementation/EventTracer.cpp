@@ -0,0 +1,207 @@
+#include "EventTracer.h"
+#include <cinttypes>
+
+namespace {
+
+// FNV-1a, so the sampled set is the same on every platform and run
+uint32_t hashId(const std::string &id)
+{
+    uint32_t hash = 2166136261u;
+    for (unsigned char c : id) {
+        hash ^= c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+void appendNumber(std::string &out, uint64_t value)
+{
+    char text[24];
+    int length = std::snprintf(text, sizeof(text), "%" PRIu64, value);
+    out.append(text, length);
+}
+
+void appendNumber(std::string &out, double value)
+{
+    char text[32];
+    int length = std::snprintf(text, sizeof(text), "%.4g", value);
+    out.append(text, length);
+}
+
+const char *typeName(DeliveryType type)
+{
+    switch (type) {
+    case URGENT:
+        return "urgent";
+    case STANDARD:
+        return "standard";
+    case FRAGILE:
+        return "fragile";
+    default:
+        return "unknown";
+    }
+}
+
+} // namespace
+
+EventTracer::EventTracer()
+    : file(nullptr), bufferLimit(0), failed(false), sampleThreshold(0), tickStride(1), eventsWritten(0)
+{
+}
+
+EventTracer::~EventTracer()
+{
+    close();
+}
+
+bool EventTracer::open(const std::string &path, const TracerOptions &options)
+{
+    close();
+    file = std::fopen(path.c_str(), "wb");
+    if (!file) return false;
+
+    double rate = options.sampleRate;
+    if (!(rate > 0.0)) rate = 1e-9;
+    if (rate > 1.0) rate = 1.0;
+    sampleThreshold = rate >= 1.0 ? UINT32_MAX : static_cast<uint32_t>(rate * 4294967296.0);
+    tickStride = static_cast<int>(1.0 / rate + 0.5);
+    if (tickStride < 1) tickStride = 1;
+    bufferLimit = options.bufferBytes > 4096 ? options.bufferBytes : 4096;
+    buffer.clear();
+    buffer.reserve(bufferLimit + 512);
+    failed = false;
+    eventsWritten = 0;
+    origin = std::chrono::steady_clock::now();
+
+    buffer += "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n";
+    buffer += "{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"args\":{\"name\":\"Smart Queue simulation\"}},\n";
+    buffer += "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":1,\"args\":{\"name\":\"simulation\"}}";
+    return true;
+}
+
+bool EventTracer::close()
+{
+    if (!file) return !failed;
+    buffer += "\n]}\n";
+    flushBuffer();
+    if (std::fclose(file) != 0) failed = true;
+    file = nullptr;
+    return !failed;
+}
+
+uint64_t EventTracer::now() const
+{
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - origin).count());
+}
+
+bool EventTracer::isDeliverySampled(const std::string &id) const
+{
+    return file && (sampleThreshold == UINT32_MAX || hashId(id) < sampleThreshold);
+}
+
+void EventTracer::endEvent()
+{
+    buffer += '}';
+    ++eventsWritten;
+    if (buffer.size() >= bufferLimit) flushBuffer();
+}
+
+void EventTracer::flushBuffer()
+{
+    if (buffer.empty()) return;
+    if (std::fwrite(buffer.data(), 1, buffer.size(), file) != buffer.size()) failed = true;
+    buffer.clear();
+}
+
+void EventTracer::appendString(const std::string &text)
+{
+    buffer += '"';
+    for (unsigned char c : text) {
+        if (c == '"' || c == '\\') {
+            buffer += '\\';
+            buffer += static_cast<char>(c);
+        } else if (c < 0x20) {
+            char escaped[8];
+            std::snprintf(escaped, sizeof(escaped), "\\u%04x", c);
+            buffer += escaped;
+        } else {
+            buffer += static_cast<char>(c);
+        }
+    }
+    buffer += '"';
+}
+
+void EventTracer::complete(const char *name, uint64_t start, uint64_t end, int tick)
+{
+    if (!file) return;
+    beginEvent();
+    buffer += "\"name\":\"";
+    buffer += name;
+    buffer += "\",\"cat\":\"tick\",\"ph\":\"X\",\"pid\":1,\"tid\":1,\"ts\":";
+    appendNumber(buffer, start);
+    buffer += ",\"dur\":";
+    appendNumber(buffer, end > start ? end - start : 0);
+    buffer += ",\"args\":{\"tick\":";
+    appendNumber(buffer, static_cast<uint64_t>(tick));
+    buffer += '}';
+    endEvent();
+}
+
+void EventTracer::queueSizes(uint64_t at, int urgent, int standard, int fragile)
+{
+    if (!file) return;
+    beginEvent();
+    buffer += "\"name\":\"queue sizes\",\"ph\":\"C\",\"pid\":1,\"ts\":";
+    appendNumber(buffer, at);
+    buffer += ",\"args\":{\"urgent\":";
+    appendNumber(buffer, static_cast<uint64_t>(urgent));
+    buffer += ",\"standard\":";
+    appendNumber(buffer, static_cast<uint64_t>(standard));
+    buffer += ",\"fragile\":";
+    appendNumber(buffer, static_cast<uint64_t>(fragile));
+    buffer += '}';
+    endEvent();
+}
+
+void EventTracer::deliveryEvent(const Delivery &delivery, const char *name, char phase)
+{
+    beginEvent();
+    buffer += "\"name\":\"";
+    buffer += name;
+    buffer += "\",\"cat\":\"delivery\",\"ph\":\"";
+    buffer += phase;
+    buffer += "\",\"pid\":1,\"tid\":1,\"ts\":";
+    appendNumber(buffer, now());
+    buffer += ",\"id\":";
+    appendString(delivery.deliveryId);
+    if (phase == 'b') {
+        buffer += ",\"args\":{\"type\":\"";
+        buffer += typeName(delivery.deliveryType);
+        buffer += "\",\"priority\":";
+        appendNumber(buffer, delivery.priorityScore);
+        buffer += '}';
+    }
+    endEvent();
+}
+
+void EventTracer::deliveryEntered(const Delivery &delivery)
+{
+    if (!isDeliverySampled(delivery.deliveryId)) return;
+    deliveryEvent(delivery, "lifetime", 'b');
+    deliveryEvent(delivery, "waiting", 'b');
+}
+
+void EventTracer::deliveryStarted(const Delivery &delivery)
+{
+    if (!isDeliverySampled(delivery.deliveryId)) return;
+    deliveryEvent(delivery, "waiting", 'e');
+    deliveryEvent(delivery, "service", 'b');
+}
+
+void EventTracer::deliveryFinished(const Delivery &delivery)
+{
+    if (!isDeliverySampled(delivery.deliveryId)) return;
+    deliveryEvent(delivery, "service", 'e');
+    deliveryEvent(delivery, "lifetime", 'e');
+}
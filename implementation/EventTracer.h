@@ -0,0 +1,92 @@
+#ifndef EVENT_TRACER_H
+#define EVENT_TRACER_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include "Delivery.h"
+
+struct TracerOptions {
+    double sampleRate = 1.0;      // Fraction of deliveries and ticks traced (0 < rate <= 1)
+    size_t bufferBytes = 1 << 20; // Events are written out in chunks of about this size
+};
+
+// Writes Chrome trace-event JSON (chrome://tracing, ui.perfetto.dev).
+//
+// Timestamps are microseconds of steady_clock since open(). Tick phases are
+// complete ("X") events on the simulation thread; each delivery is an async
+// "lifetime" span with nested "waiting" (entry to service start) and
+// "service" (start to end) spans, keyed by its ID so no per-delivery state is
+// kept here.
+//
+// Sampling is deterministic: a delivery is traced when a hash of its ID falls
+// under sampleRate, so all three of its events are kept or dropped together,
+// and one tick in every 1 / sampleRate is traced. Not thread-safe.
+class EventTracer {
+private:
+    std::FILE *file;
+    std::string buffer;
+    size_t bufferLimit;
+    bool failed;
+    uint32_t sampleThreshold; // Deliveries whose ID hash is below this are traced
+    int tickStride;
+    std::chrono::steady_clock::time_point origin;
+    uint64_t eventsWritten;
+
+    void beginEvent() { buffer += ",\n{"; }
+    void endEvent();
+    void appendString(const std::string &text); // JSON-escaped, quoted
+    void deliveryEvent(const Delivery &delivery, const char *name, char phase);
+    void flushBuffer();
+
+public:
+    EventTracer();
+    ~EventTracer();
+    EventTracer(const EventTracer &) = delete;
+    EventTracer &operator=(const EventTracer &) = delete;
+
+    bool open(const std::string &path, const TracerOptions &options = TracerOptions());
+    bool close(); // Finishes the JSON document; false if any write failed
+    bool isOpen() const { return file != nullptr; }
+
+    uint64_t now() const; // Microseconds since open()
+    bool isTickSampled(int tick) const { return file && tick % tickStride == 0; }
+    bool isDeliverySampled(const std::string &id) const;
+
+    // Tick phase from start to end (microseconds from now())
+    void complete(const char *name, uint64_t start, uint64_t end, int tick);
+    // Queue lengths as a counter track
+    void queueSizes(uint64_t at, int urgent, int standard, int fragile);
+
+    void deliveryEntered(const Delivery &delivery);  // Opens lifetime and waiting
+    void deliveryStarted(const Delivery &delivery);  // Closes waiting, opens service
+    void deliveryFinished(const Delivery &delivery); // Closes service and lifetime
+
+    uint64_t getEventsWritten() const { return eventsWritten; }
+};
+
+// Records one tick phase as a complete event; does nothing when the tracer
+// is null or the tick is not sampled
+class TraceSpan {
+private:
+    EventTracer *tracer;
+    const char *name;
+    int tick;
+    uint64_t start;
+
+public:
+    TraceSpan(EventTracer *tracer, const char *name, int tick)
+        : tracer(tracer && tracer->isTickSampled(tick) ? tracer : nullptr), name(name), tick(tick),
+          start(this->tracer ? this->tracer->now() : 0)
+    {
+    }
+    ~TraceSpan()
+    {
+        if (tracer) tracer->complete(name, start, tracer->now(), tick);
+    }
+    TraceSpan(const TraceSpan &) = delete;
+    TraceSpan &operator=(const TraceSpan &) = delete;
+};
+
+#endif // EVENT_TRACER_H
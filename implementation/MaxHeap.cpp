@@ -2,7 +2,9 @@
 
 
 #include "MaxHeap.h"
-#include <algorithm> // For std::swap
+#include <algorithm> // For std::swap, std::is_heap
+#include <functional> // For std::less, std::greater
+#include <iterator> // For std::back_inserter
 #include <stdexcept> // For std::out_of_range
 #include "Delivery.h" // Include Delivery.h for explicit instantiation
 
@@ -21,7 +23,7 @@ void MaxHeap<T>::heapifyDown(int i) {
     }
 
     if (largest != i) {
-        std::swap(heap[i], heap[largest]);
+        swapNodes(i, largest);
         heapifyDown(largest);
     }
 }
@@ -29,29 +31,90 @@ void MaxHeap<T>::heapifyDown(int i) {
 template <typename T>
 void MaxHeap<T>::heapifyUp(int i) {
     while (i != 0 && heap[parent(i)] < heap[i]) {
-        std::swap(heap[i], heap[parent(i)]);
+        swapNodes(i, parent(i));
         i = parent(i);
     }
 }
 
 template <typename T>
 void MaxHeap<T>::insert(T value) {
-    heap.push_back(value);
+    heap.push_back(std::move(value));
+    notifyMoved(heap.size() - 1);
     heapifyUp(heap.size() - 1);
 }
 
+template <typename T>
+void MaxHeap<T>::insertBatch(std::vector<T> items) {
+    if (items.size() > heap.size()) {
+        std::vector<T> merged = std::move(heap);
+        merged.reserve(merged.size() + items.size());
+        std::move(items.begin(), items.end(), std::back_inserter(merged));
+        buildHeap(std::move(merged));
+        return;
+    }
+    for (T &item : items) {
+        insert(std::move(item));
+    }
+}
+
+template <typename T>
+void MaxHeap<T>::buildHeap(std::vector<T> items) {
+    heap = std::move(items);
+    PositionObserver saved = observer;
+    observer = nullptr; // Report final positions once instead of every swap
+    for (int i = static_cast<int>(heap.size()) / 2 - 1; i >= 0; --i) {
+        heapifyDown(i);
+    }
+    observer = saved;
+    notifyAll();
+}
+
+template <typename T>
+void MaxHeap<T>::adoptHeap(std::vector<T> items) {
+    if (std::is_heap(items.begin(), items.end(), std::less<T>())) {
+        heap = std::move(items);
+        notifyAll();
+    } else {
+        buildHeap(std::move(items));
+    }
+}
+
 template <typename T>
 T MaxHeap<T>::extractMax() {
     if (isEmpty()) {
         throw std::out_of_range("Heap is empty");
     }
-    T root = heap[0];
-    heap[0] = heap.back();
+    T root = std::move(heap[0]);
+    if (heap.size() > 1) {
+        heap[0] = std::move(heap.back());
+    }
     heap.pop_back();
-    heapifyDown(0);
+    if (!heap.empty()) {
+        notifyMoved(0);
+        heapifyDown(0);
+    }
     return root;
 }
 
+template <typename T>
+T MaxHeap<T>::removeAt(int index) {
+    if (index < 0 || index >= static_cast<int>(heap.size())) {
+        throw std::out_of_range("Heap index out of range");
+    }
+    T removed = std::move(heap[index]);
+    int last = static_cast<int>(heap.size()) - 1;
+    if (index != last) {
+        heap[index] = std::move(heap.back());
+        heap.pop_back();
+        notifyMoved(index);
+        heapifyDown(index);
+        heapifyUp(index);
+    } else {
+        heap.pop_back();
+    }
+    return removed;
+}
+
 template <typename T>
 T MaxHeap<T>::peekMax() {
     if (isEmpty()) {
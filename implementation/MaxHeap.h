@@ -5,13 +5,32 @@
 #define MAXHEAP_H
 
 #include <vector>
+#include <utility>
 #include <iostream>
 
 // Templated MaxHeap class
 template <typename T>
 class MaxHeap {
+public:
+    // Called with the element and its new index whenever an element lands in a slot
+    typedef void (*PositionObserver)(void *context, const T &value, int index);
+
 private:
     std::vector<T> heap;
+    PositionObserver observer = nullptr;
+    void *observerContext = nullptr;
+
+    void notifyMoved(int i) {
+        if (observer) observer(observerContext, heap[i], i);
+    }
+    void notifyAll() {
+        for (int i = 0; observer && i < static_cast<int>(heap.size()); ++i) notifyMoved(i);
+    }
+    void swapNodes(int a, int b) {
+        std::swap(heap[a], heap[b]);
+        notifyMoved(a);
+        notifyMoved(b);
+    }
 
     // Helper functions to get parent, left child, and right child indices
     int parent(int i) { return (i - 1) / 2; }
@@ -32,6 +51,28 @@ public:
     // Insert a new element into the heap
     void insert(T value);
 
+    // Insert many elements: one bottom-up rebuild when the batch outnumbers
+    // the heap, otherwise individual inserts
+    void insertBatch(std::vector<T> items);
+
+    // Replace the contents with the given items and heapify bottom-up in O(n)
+    void buildHeap(std::vector<T> items);
+
+    // Take over an array that is already in heap order (e.g. from a snapshot);
+    // falls back to buildHeap if it is not
+    void adoptHeap(std::vector<T> items);
+
+    // Remove the element at the given index (e.g. found through a position observer)
+    T removeAt(int index);
+
+    // Element at the given index, in heap order
+    const T &at(int index) const { return heap[index]; }
+
+    void setPositionObserver(PositionObserver newObserver, void *context) {
+        observer = newObserver;
+        observerContext = context;
+    }
+
     // Extract the maximum element from the heap
     T extractMax();
 
@@ -1,8 +1,11 @@
 #include "MinHeap.h"
-#include <algorithm> // For std::swap
+#include <algorithm> // For std::swap, std::is_heap
+#include <functional> // For std::less, std::greater
+#include <iterator> // For std::back_inserter
 #include <stdexcept> // For std::out_of_range
 #include "Delivery.h" // Include Delivery.h for explicit instantiation
 #include "DeliveryTypes.h"
+#include "DispatchOrder.h"
 
 template <typename T>
 void MinHeap<T>::heapifyDown(int i) {
@@ -19,7 +22,7 @@ void MinHeap<T>::heapifyDown(int i) {
     }
 
     if (smallest != i) {
-        std::swap(heap[i], heap[smallest]);
+        swapNodes(i, smallest);
         heapifyDown(smallest);
     }
 }
@@ -27,29 +30,90 @@ void MinHeap<T>::heapifyDown(int i) {
 template <typename T>
 void MinHeap<T>::heapifyUp(int i) {
     while (i != 0 && heap[parent(i)] > heap[i]) {
-        std::swap(heap[i], heap[parent(i)]);
+        swapNodes(i, parent(i));
         i = parent(i);
     }
 }
 
 template <typename T>
 void MinHeap<T>::insert(T value) {
-    heap.push_back(value);
+    heap.push_back(std::move(value));
+    notifyMoved(heap.size() - 1);
     heapifyUp(heap.size() - 1);
 }
 
+template <typename T>
+void MinHeap<T>::insertBatch(std::vector<T> items) {
+    if (items.size() > heap.size()) {
+        std::vector<T> merged = std::move(heap);
+        merged.reserve(merged.size() + items.size());
+        std::move(items.begin(), items.end(), std::back_inserter(merged));
+        buildHeap(std::move(merged));
+        return;
+    }
+    for (T &item : items) {
+        insert(std::move(item));
+    }
+}
+
+template <typename T>
+void MinHeap<T>::buildHeap(std::vector<T> items) {
+    heap = std::move(items);
+    PositionObserver saved = observer;
+    observer = nullptr; // Report final positions once instead of every swap
+    for (int i = static_cast<int>(heap.size()) / 2 - 1; i >= 0; --i) {
+        heapifyDown(i);
+    }
+    observer = saved;
+    notifyAll();
+}
+
+template <typename T>
+void MinHeap<T>::adoptHeap(std::vector<T> items) {
+    if (std::is_heap(items.begin(), items.end(), std::greater<T>())) {
+        heap = std::move(items);
+        notifyAll();
+    } else {
+        buildHeap(std::move(items));
+    }
+}
+
 template <typename T>
 T MinHeap<T>::extractMin() {
     if (isEmpty()) {
         throw std::out_of_range("Heap is empty");
     }
-    T root = heap[0];
-    heap[0] = heap.back();
+    T root = std::move(heap[0]);
+    if (heap.size() > 1) {
+        heap[0] = std::move(heap.back());
+    }
     heap.pop_back();
-    heapifyDown(0);
+    if (!heap.empty()) {
+        notifyMoved(0);
+        heapifyDown(0);
+    }
     return root;
 }
 
+template <typename T>
+T MinHeap<T>::removeAt(int index) {
+    if (index < 0 || index >= static_cast<int>(heap.size())) {
+        throw std::out_of_range("Heap index out of range");
+    }
+    T removed = std::move(heap[index]);
+    int last = static_cast<int>(heap.size()) - 1;
+    if (index != last) {
+        heap[index] = std::move(heap.back());
+        heap.pop_back();
+        notifyMoved(index);
+        heapifyDown(index);
+        heapifyUp(index);
+    } else {
+        heap.pop_back();
+    }
+    return removed;
+}
+
 template <typename T>
 T MinHeap<T>::peekMin() {
     if (isEmpty()) {
@@ -70,5 +134,6 @@ int MinHeap<T>::size() const {
 
 // Explicit template instantiation for Delivery type
 template class MinHeap<Delivery>;
+template class MinHeap<DispatchOrderEntry>; // DeliveryManager's EDF and SJF orders
 
 
@@ -0,0 +1,156 @@
+#include "OperationLatency.h"
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+
+double timestampTicksPerNanosecond()
+{
+#ifdef SQS_HAVE_TSC
+    static const double ticksPerNanosecond = [] {
+        auto begin = std::chrono::steady_clock::now();
+        uint64_t first = readTimestamp();
+        std::chrono::steady_clock::time_point end;
+        do {
+            end = std::chrono::steady_clock::now();
+        } while (end - begin < std::chrono::milliseconds(10));
+        uint64_t last = readTimestamp();
+        double nanos = static_cast<double>(std::chrono::duration_cast<std::chrono::nanoseconds>(end - begin).count());
+        return static_cast<double>(last - first) / nanos;
+    }();
+    return ticksPerNanosecond;
+#else
+    return 1.0;
+#endif
+}
+
+void AtomicHistogram::snapshot(LogLinearHistogram &out) const
+{
+    out.reset();
+    uint64_t maximum = maxValue.load(std::memory_order_relaxed);
+    int maxBucket = maximum ? LogLinearHistogram::bucketIndex(maximum) : -1;
+    for (int i = 0; i < LogLinearHistogram::BUCKET_COUNT; ++i) {
+        uint64_t n = counts[i].load(std::memory_order_relaxed);
+        if (n == 0) continue;
+        if (i == maxBucket) {
+            // One sample at the exact maximum so getMax() is not rounded to the bucket
+            out.recordCount(LogLinearHistogram::bucketLowerBound(i), n - 1);
+            out.record(maximum);
+        } else {
+            out.recordCount(LogLinearHistogram::bucketLowerBound(i), n);
+        }
+    }
+}
+
+void AtomicHistogram::reset()
+{
+    for (int i = 0; i < LogLinearHistogram::BUCKET_COUNT; ++i) {
+        counts[i].store(0, std::memory_order_relaxed);
+    }
+    sum.store(0, std::memory_order_relaxed);
+    maxValue.store(0, std::memory_order_relaxed);
+}
+
+const char *OperationLatency::operationName(LatencyOperation op)
+{
+    switch (op) {
+    case LATENCY_ADD:
+        return "add_delivery";
+    case LATENCY_PROCESS:
+        return "process_next_delivery";
+    case LATENCY_UPDATE_PRIORITIES:
+        return "update_priorities";
+    case LATENCY_CANCEL:
+        return "cancel_delivery_by_id";
+    default:
+        return "unknown";
+    }
+}
+
+void OperationLatency::reset()
+{
+    for (int i = 0; i < LATENCY_OPERATION_COUNT; ++i) {
+        histograms[i].reset();
+    }
+}
+
+void OperationLatency::printSummary(std::ostream &out) const
+{
+    if (!ENABLED) {
+        out << "Operation latency: disabled at compile time (SQS_DISABLE_LATENCY_METRICS)\n";
+        return;
+    }
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::fixed << std::setprecision(2);
+
+    double ticksPerMicro = timestampTicksPerNanosecond() * 1000.0;
+    LogLinearHistogram h;
+    out << "--- Operation Latency (microseconds) ---\n";
+    for (int i = 0; i < LATENCY_OPERATION_COUNT; ++i) {
+        histograms[i].snapshot(h);
+        out << std::left << std::setw(22) << operationName(static_cast<LatencyOperation>(i)) << std::right
+            << " n=" << h.count();
+        if (h.count() > 0) {
+            out << " p50=" << h.percentile(0.50) / ticksPerMicro
+                << " p99=" << h.percentile(0.99) / ticksPerMicro
+                << " p999=" << h.percentile(0.999) / ticksPerMicro
+                << " max=" << h.getMax() / ticksPerMicro;
+        }
+        out << "\n";
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+void OperationLatency::writePrometheus(std::ostream &out) const
+{
+    static const double quantiles[] = {0.5, 0.9, 0.99, 0.999};
+    double ticksPerSecond = timestampTicksPerNanosecond() * 1e9;
+    LogLinearHistogram snapshots[LATENCY_OPERATION_COUNT];
+    for (int i = 0; i < LATENCY_OPERATION_COUNT; ++i) {
+        histograms[i].snapshot(snapshots[i]);
+    }
+
+    std::ios::fmtflags flags = out.flags();
+    std::streamsize precision = out.precision();
+    out << std::setprecision(9);
+
+    out << "# HELP sqs_operation_latency_seconds Time spent in DeliveryManager operations.\n";
+    out << "# TYPE sqs_operation_latency_seconds summary\n";
+    for (int i = 0; i < LATENCY_OPERATION_COUNT; ++i) {
+        const char *name = operationName(static_cast<LatencyOperation>(i));
+        for (double q : quantiles) {
+            out << "sqs_operation_latency_seconds{operation=\"" << name << "\",quantile=\"" << q << "\"} "
+                << snapshots[i].percentile(q) / ticksPerSecond << "\n";
+        }
+        out << "sqs_operation_latency_seconds_sum{operation=\"" << name << "\"} "
+            << histograms[i].getSum() / ticksPerSecond << "\n";
+        out << "sqs_operation_latency_seconds_count{operation=\"" << name << "\"} " << snapshots[i].count() << "\n";
+    }
+    out << "# HELP sqs_operation_latency_max_seconds Slowest DeliveryManager operation since start or reset.\n";
+    out << "# TYPE sqs_operation_latency_max_seconds gauge\n";
+    for (int i = 0; i < LATENCY_OPERATION_COUNT; ++i) {
+        out << "sqs_operation_latency_max_seconds{operation=\"" << operationName(static_cast<LatencyOperation>(i))
+            << "\"} " << snapshots[i].getMax() / ticksPerSecond << "\n";
+    }
+
+    out.flags(flags);
+    out.precision(precision);
+}
+
+bool OperationLatency::writePrometheusFile(const std::string &path) const
+{
+    // Scrapers (e.g. node_exporter's textfile collector) must never see a half-written file
+    std::string tempPath = path + ".tmp";
+    {
+        std::ofstream file(tempPath, std::ios::trunc);
+        if (!file) return false;
+        writePrometheus(file);
+        file.flush();
+        if (!file) return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    return !ec;
+}
@@ -0,0 +1,120 @@
+#ifndef OPERATION_LATENCY_H
+#define OPERATION_LATENCY_H
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include "DeliveryMetrics.h"
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>
+#define SQS_HAVE_TSC 1
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#define SQS_HAVE_TSC 1
+#endif
+
+enum LatencyOperation {
+    LATENCY_ADD,               // addDelivery
+    LATENCY_PROCESS,           // processNextDelivery
+    LATENCY_UPDATE_PRIORITIES, // updatePriorities
+    LATENCY_CANCEL,            // cancelDeliveryById
+    LATENCY_OPERATION_COUNT
+};
+
+// Raw timestamp for timing short sections: the TSC on x86 (invariant on
+// anything recent), steady_clock nanoseconds elsewhere
+inline uint64_t readTimestamp()
+{
+#ifdef SQS_HAVE_TSC
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(
+        std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// Timestamp ticks per nanosecond, measured once against steady_clock (the
+// first call spins for about 10 ms on x86)
+double timestampTicksPerNanosecond();
+
+// LogLinearHistogram buckets as relaxed atomics, so any thread can record
+// without a lock while another takes a snapshot
+class AtomicHistogram
+{
+private:
+    std::atomic<uint64_t> counts[LogLinearHistogram::BUCKET_COUNT];
+    std::atomic<uint64_t> sum;
+    std::atomic<uint64_t> maxValue;
+
+public:
+    AtomicHistogram() { reset(); }
+    AtomicHistogram(const AtomicHistogram &) = delete;
+    AtomicHistogram &operator=(const AtomicHistogram &) = delete;
+
+    void record(uint64_t value)
+    {
+        counts[LogLinearHistogram::bucketIndex(value)].fetch_add(1, std::memory_order_relaxed);
+        sum.fetch_add(value, std::memory_order_relaxed);
+        uint64_t seen = maxValue.load(std::memory_order_relaxed);
+        while (value > seen && !maxValue.compare_exchange_weak(seen, value, std::memory_order_relaxed)) {
+        }
+    }
+
+    // Copies the buckets into out (which is reset first). Samples recorded
+    // during the copy may or may not be included.
+    void snapshot(LogLinearHistogram &out) const;
+    uint64_t getSum() const { return sum.load(std::memory_order_relaxed); }
+    void reset();
+};
+
+// Per-operation latency histograms for DeliveryManager, in timestamp ticks.
+// Building with SQS_DISABLE_LATENCY_METRICS turns LatencyScope into an
+// empty object, so the operations carry no timing code at all.
+class OperationLatency
+{
+private:
+    AtomicHistogram histograms[LATENCY_OPERATION_COUNT];
+
+public:
+#ifdef SQS_DISABLE_LATENCY_METRICS
+    static const bool ENABLED = false;
+#else
+    static const bool ENABLED = true;
+#endif
+
+    static const char *operationName(LatencyOperation op); // e.g. "add_delivery"
+
+    void record(LatencyOperation op, uint64_t ticks) { histograms[op].record(ticks); }
+    void reset();
+
+    // Raw ticks; divide by timestampTicksPerNanosecond() for time
+    void snapshot(LatencyOperation op, LogLinearHistogram &ticks) const { histograms[op].snapshot(ticks); }
+    void printSummary(std::ostream &out) const;       // count, p50/p99/p999/max per operation
+    void writePrometheus(std::ostream &out) const;    // Text exposition format, as a summary in seconds
+    bool writePrometheusFile(const std::string &path) const; // Written to path + ".tmp", then renamed over path
+};
+
+// Times one operation from construction to destruction
+class LatencyScope
+{
+#ifndef SQS_DISABLE_LATENCY_METRICS
+private:
+    OperationLatency &latency;
+    LatencyOperation op;
+    uint64_t start;
+
+public:
+    LatencyScope(OperationLatency &latency, LatencyOperation op) : latency(latency), op(op), start(readTimestamp()) {}
+    ~LatencyScope() { latency.record(op, readTimestamp() - start); }
+#else
+public:
+    LatencyScope(OperationLatency &, LatencyOperation) {}
+#endif
+    LatencyScope(const LatencyScope &) = delete;
+    LatencyScope &operator=(const LatencyScope &) = delete;
+};
+
+#endif // OPERATION_LATENCY_H
@@ -34,9 +34,36 @@ public:
     // Insert an element into the priority queue
     void enqueue(T value) {
         if (type == MIN_HEAP) {
-            minHeap.insert(value);
+            minHeap.insert(std::move(value));
         } else {
-            maxHeap.insert(value);
+            maxHeap.insert(std::move(value));
+        }
+    }
+
+    // Add a batch of elements in one call (bulk heapify for large batches)
+    void enqueueBatch(std::vector<T> items) {
+        if (type == MIN_HEAP) {
+            minHeap.insertBatch(std::move(items));
+        } else {
+            maxHeap.insertBatch(std::move(items));
+        }
+    }
+
+    // Replace the contents in one bulk heapify (used when rebuilding from a log or snapshot)
+    void assign(std::vector<T> items) {
+        if (type == MIN_HEAP) {
+            minHeap.buildHeap(std::move(items));
+        } else {
+            maxHeap.buildHeap(std::move(items));
+        }
+    }
+
+    // Take over an array that is already in heap order (snapshot restore)
+    void adopt(std::vector<T> items) {
+        if (type == MIN_HEAP) {
+            minHeap.adoptHeap(std::move(items));
+        } else {
+            maxHeap.adoptHeap(std::move(items));
         }
     }
 
@@ -49,6 +76,26 @@ public:
         }
     }
 
+    // Remove the element at a heap index reported through the position observer
+    T removeAt(int index) {
+        if (type == MIN_HEAP) {
+            return minHeap.removeAt(index);
+        } else {
+            return maxHeap.removeAt(index);
+        }
+    }
+
+    // Element at a heap index
+    const T& at(int index) const {
+        return (type == MIN_HEAP) ? minHeap.at(index) : maxHeap.at(index);
+    }
+
+    // Both heaps share the observer signature
+    void setPositionObserver(typename MaxHeap<T>::PositionObserver observer, void* context) {
+        minHeap.setPositionObserver(observer, context);
+        maxHeap.setPositionObserver(observer, context);
+    }
+
     // Return the highest priority element without removing it
     T peek() {
         if (type == MIN_HEAP) {
@@ -0,0 +1,203 @@
+#include "QueueRank.h"
+#include <algorithm>
+#include "Delivery.h"
+
+uint32_t QueueRank::nextPriority()
+{
+    // xorshift64; the tree only needs the priorities to be independent of the keys
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    return static_cast<uint32_t>(seed >> 32);
+}
+
+int32_t QueueRank::allocate(const Delivery &delivery)
+{
+    Node node{delivery.priorityScore, delivery.entryTime, delivery.deliveryId, nextPriority(), 1, NIL, NIL};
+    if (!freeNodes.empty()) {
+        int32_t n = freeNodes.back();
+        freeNodes.pop_back();
+        nodes[n] = std::move(node);
+        return n;
+    }
+    nodes.push_back(std::move(node));
+    return static_cast<int32_t>(nodes.size() - 1);
+}
+
+bool QueueRank::before(const Node &a, double score, time_t entryTime, const std::string &id) const
+{
+    if (a.score != score) return a.score > score;
+    if (a.entryTime != entryTime) return a.entryTime < entryTime;
+    return a.id < id;
+}
+
+void QueueRank::split(int32_t n, const Delivery &delivery, int32_t &less, int32_t &rest)
+{
+    if (n == NIL) {
+        less = rest = NIL;
+        return;
+    }
+    if (before(nodes[n], delivery.priorityScore, delivery.entryTime, delivery.deliveryId)) {
+        int32_t right;
+        split(nodes[n].right, delivery, right, rest);
+        nodes[n].right = right;
+        less = n;
+    } else {
+        int32_t left;
+        split(nodes[n].left, delivery, less, left);
+        nodes[n].left = left;
+        rest = n;
+    }
+    update(n);
+}
+
+int32_t QueueRank::merge(int32_t a, int32_t b)
+{
+    if (a == NIL) return b;
+    if (b == NIL) return a;
+    if (nodes[a].priority > nodes[b].priority) {
+        int32_t right = merge(nodes[a].right, b);
+        nodes[a].right = right;
+        update(a);
+        return a;
+    }
+    int32_t left = merge(a, nodes[b].left);
+    nodes[b].left = left;
+    update(b);
+    return b;
+}
+
+void QueueRank::insert(const Delivery &delivery)
+{
+    int32_t n = allocate(delivery); // Before the split: it may move the nodes
+    int32_t less, rest;
+    split(root, delivery, less, rest);
+    root = merge(merge(less, n), rest);
+}
+
+int32_t QueueRank::eraseFrom(int32_t n, const Delivery &delivery, bool &found)
+{
+    if (n == NIL) return NIL;
+    Node &node = nodes[n];
+    if (node.score == delivery.priorityScore && node.entryTime == delivery.entryTime && node.id == delivery.deliveryId) {
+        found = true;
+        freeNodes.push_back(n);
+        node.id.clear();
+        return merge(node.left, node.right);
+    }
+    if (before(node, delivery.priorityScore, delivery.entryTime, delivery.deliveryId)) {
+        int32_t right = eraseFrom(node.right, delivery, found);
+        nodes[n].right = right;
+    } else {
+        int32_t left = eraseFrom(node.left, delivery, found);
+        nodes[n].left = left;
+    }
+    update(n);
+    return n;
+}
+
+bool QueueRank::erase(const Delivery &delivery)
+{
+    bool found = false;
+    root = eraseFrom(root, delivery, found);
+    return found;
+}
+
+uint32_t QueueRank::fixSizes(int32_t n)
+{
+    if (n == NIL) return 0;
+    nodes[n].size = 1 + fixSizes(nodes[n].left) + fixSizes(nodes[n].right);
+    return nodes[n].size;
+}
+
+void QueueRank::assign(const std::vector<Delivery> &deliveries)
+{
+    clear();
+    std::vector<const Delivery *> sorted;
+    sorted.reserve(deliveries.size());
+    for (const Delivery &delivery : deliveries) sorted.push_back(&delivery);
+    std::sort(sorted.begin(), sorted.end(), [this](const Delivery *a, const Delivery *b) {
+        Node key{a->priorityScore, a->entryTime, a->deliveryId, 0, 0, NIL, NIL};
+        return before(key, b->priorityScore, b->entryTime, b->deliveryId);
+    });
+
+    // Keys arrive in order, so the treap is the Cartesian tree of the
+    // priorities, built along its right spine in O(n)
+    nodes.reserve(sorted.size());
+    std::vector<int32_t> spine;
+    for (const Delivery *delivery : sorted) {
+        int32_t n = allocate(*delivery);
+        int32_t last = NIL;
+        while (!spine.empty() && nodes[spine.back()].priority < nodes[n].priority) {
+            last = spine.back();
+            spine.pop_back();
+        }
+        nodes[n].left = last;
+        if (!spine.empty()) nodes[spine.back()].right = n;
+        spine.push_back(n);
+    }
+    root = spine.empty() ? NIL : spine.front();
+    fixSizes(root);
+}
+
+void QueueRank::clear()
+{
+    nodes.clear();
+    freeNodes.clear();
+    root = NIL;
+}
+
+size_t QueueRank::rankOf(const Delivery &delivery) const
+{
+    size_t rank = 0;
+    for (int32_t n = root; n != NIL;) {
+        if (before(nodes[n], delivery.priorityScore, delivery.entryTime, delivery.deliveryId)) {
+            rank += sizeOf(nodes[n].left) + 1;
+            n = nodes[n].right;
+        } else {
+            n = nodes[n].left;
+        }
+    }
+    return rank;
+}
+
+size_t QueueRank::countAbove(double score) const
+{
+    size_t count = 0;
+    for (int32_t n = root; n != NIL;) {
+        if (nodes[n].score > score) {
+            count += sizeOf(nodes[n].left) + 1;
+            n = nodes[n].right;
+        } else {
+            n = nodes[n].left;
+        }
+    }
+    return count;
+}
+
+std::vector<std::string> QueueRank::page(size_t offset, size_t limit) const
+{
+    // Descend to the offset-th node, stacking the ancestors still to come,
+    // then walk in order from there
+    std::vector<std::string> ids;
+    std::vector<int32_t> pending;
+    size_t skip = offset;
+    for (int32_t n = root; n != NIL;) {
+        size_t left = sizeOf(nodes[n].left);
+        if (skip <= left) {
+            pending.push_back(n);
+            if (skip == left) break;
+            n = nodes[n].left;
+        } else {
+            skip -= left + 1;
+            n = nodes[n].right;
+        }
+    }
+    while (!pending.empty() && ids.size() < limit) {
+        int32_t n = pending.back();
+        pending.pop_back();
+        ids.push_back(nodes[n].id);
+        for (int32_t m = nodes[n].right; m != NIL; m = nodes[m].left) pending.push_back(m);
+    }
+    return ids;
+}
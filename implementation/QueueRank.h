@@ -0,0 +1,68 @@
+#ifndef QUEUE_RANK_H
+#define QUEUE_RANK_H
+
+#include <cstdint>
+#include <ctime>
+#include <string>
+#include <vector>
+
+class Delivery;
+
+// Result of DeliveryManager::getQueuePosition
+struct QueuePosition {
+    bool queued = false;
+    int queue = -1;           // DeliveryType of the queue holding it
+    size_t rank = 0;          // Deliveries ahead of it in that queue, 0 = next
+    size_t queueSize = 0;
+    double etaMinutes = -1.0; // Until a counter takes it at the queue's observed dispatch rate, -1 before any dispatch
+};
+
+// Order-statistic treap over one queue's deliveries, in dispatch order
+// within the queue: highest score first, then oldest, then by ID. Every
+// node knows its subtree size, so rank, count-above and paging are O(log n)
+// (plus the page) instead of a copy and sort of the heap array. Nodes live
+// in one vector with a free list; the tree holds a copy of the ordering key,
+// so a delivery must be erased with the score it was inserted with.
+class QueueRank {
+private:
+    static const int32_t NIL = -1;
+
+    struct Node {
+        double score;
+        time_t entryTime;
+        std::string id;
+        uint32_t priority; // Random, max-heap ordered
+        uint32_t size;     // Nodes in this subtree
+        int32_t left;
+        int32_t right;
+    };
+    std::vector<Node> nodes;
+    std::vector<int32_t> freeNodes;
+    int32_t root;
+    uint64_t seed;
+
+    uint32_t nextPriority();
+    int32_t allocate(const Delivery &delivery);
+    uint32_t sizeOf(int32_t n) const { return n == NIL ? 0 : nodes[n].size; }
+    void update(int32_t n) { nodes[n].size = 1 + sizeOf(nodes[n].left) + sizeOf(nodes[n].right); }
+    bool before(const Node &a, double score, time_t entryTime, const std::string &id) const;
+    void split(int32_t n, const Delivery &delivery, int32_t &less, int32_t &rest); // less: ordered before delivery
+    int32_t merge(int32_t a, int32_t b);
+    int32_t eraseFrom(int32_t n, const Delivery &delivery, bool &found);
+    uint32_t fixSizes(int32_t n);
+
+public:
+    QueueRank() : root(NIL), seed(0x9e3779b97f4a7c15ull) {}
+
+    void insert(const Delivery &delivery);
+    bool erase(const Delivery &delivery);
+    void assign(const std::vector<Delivery> &deliveries); // O(n log n) sort, then an O(n) build
+    void clear();
+
+    size_t size() const { return sizeOf(root); }
+    size_t rankOf(const Delivery &delivery) const;  // Deliveries ordered before it
+    size_t countAbove(double score) const;          // Deliveries scoring strictly higher
+    std::vector<std::string> page(size_t offset, size_t limit) const; // IDs in dispatch order
+};
+
+#endif // QUEUE_RANK_H
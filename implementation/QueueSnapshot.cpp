@@ -0,0 +1,280 @@
+#include "QueueSnapshot.h"
+#include "ConfigurationManager.h"
+#include <algorithm>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <system_error>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+const char SNAPSHOT_MAGIC[8] = {'S', 'Q', 'S', 'N', 'A', 'P', '0', '1'};
+const uint32_t SNAPSHOT_VERSION = 2; // 2 added the processed history and metric totals
+const uint32_t ENDIAN_MARKER = 0x01020304;
+
+uint64_t align8(uint64_t value) {
+    return (value + 7) & ~uint64_t(7);
+}
+
+bool writeAll(std::FILE *file, const void *data, size_t bytes) {
+    return bytes == 0 || std::fwrite(data, 1, bytes, file) == bytes;
+}
+
+bool padTo(std::FILE *file, uint64_t &position, uint64_t offset) {
+    static const char zeros[8] = {0};
+    while (position < offset) {
+        size_t n = static_cast<size_t>(std::min<uint64_t>(8, offset - position));
+        if (!writeAll(file, zeros, n)) return false;
+        position += n;
+    }
+    return true;
+}
+
+// Streams one section of fixed-width records, appending its strings to the blob
+bool writeRecords(std::FILE *file, uint64_t &position, const std::vector<Delivery> &deliveries,
+                  uint64_t &blobBytes) {
+    std::vector<SnapshotRecord> chunk;
+    chunk.reserve(4096);
+    for (size_t i = 0; i < deliveries.size(); ++i) {
+        const Delivery &d = deliveries[i];
+        SnapshotRecord r;
+        std::memset(&r, 0, sizeof(r));
+        r.idOffset = blobBytes;
+        r.idLength = static_cast<uint32_t>(d.deliveryId.size());
+        blobBytes += r.idLength;
+        r.destinationOffset = blobBytes;
+        r.destinationLength = static_cast<uint32_t>(d.destination.size());
+        blobBytes += r.destinationLength;
+        r.priorityScore = d.priorityScore;
+        r.entryTime = static_cast<int64_t>(d.entryTime);
+        r.estimatedDeliveryTime = d.estimatedDeliveryTime;
+        r.deliveryType = static_cast<uint8_t>(d.deliveryType);
+        chunk.push_back(r);
+        if (chunk.size() == chunk.capacity() || i + 1 == deliveries.size()) {
+            if (!writeAll(file, chunk.data(), chunk.size() * sizeof(SnapshotRecord))) return false;
+            position += chunk.size() * sizeof(SnapshotRecord);
+            chunk.clear();
+        }
+    }
+    return true;
+}
+
+bool writeStrings(std::FILE *file, uint64_t &position, const std::vector<Delivery> &deliveries) {
+    std::vector<char> buffer;
+    buffer.reserve(1 << 20);
+    for (const Delivery &d : deliveries) {
+        buffer.insert(buffer.end(), d.deliveryId.begin(), d.deliveryId.end());
+        buffer.insert(buffer.end(), d.destination.begin(), d.destination.end());
+        if (buffer.size() >= (1 << 20)) {
+            if (!writeAll(file, buffer.data(), buffer.size())) return false;
+            position += buffer.size();
+            buffer.clear();
+        }
+    }
+    if (!writeAll(file, buffer.data(), buffer.size())) return false;
+    position += buffer.size();
+    return true;
+}
+
+} // namespace
+
+bool writeQueueSnapshot(const std::string &path, const std::vector<Delivery> *queues[3],
+                        const std::vector<Delivery> &cancelledOldestFirst,
+                        const std::vector<Delivery> &processedOldestFirst, const MetricsTotals &totals,
+                        uint64_t walLsn)
+{
+    const std::vector<Delivery> *sections[SNAPSHOT_SECTION_COUNT] = {
+        queues[SNAPSHOT_URGENT], queues[SNAPSHOT_STANDARD], queues[SNAPSHOT_FRAGILE], &cancelledOldestFirst,
+        &processedOldestFirst};
+    std::vector<std::pair<std::string, double>> settings = ConfigurationManager::getSettings();
+
+    SnapshotHeader header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC));
+    header.version = SNAPSHOT_VERSION;
+    header.endianMarker = ENDIAN_MARKER;
+    header.walLsn = walLsn;
+    header.configVersion = ConfigurationManager::getVersion();
+    for (int t = 0; t < 3; ++t) {
+        const TypeTotals &from = totals.perType[t];
+        SnapshotTypeTotals &to = header.totals[t];
+        to.arrivals = from.arrivals;
+        to.processed = from.processed;
+        to.cancelled = from.cancelled;
+        to.dispatchedMinutes = from.dispatchedMinutes;
+        to.deadlineMisses = from.deadlineMisses;
+        to.deadlineDrops = from.deadlineDrops;
+    }
+    header.firstDispatch = static_cast<int64_t>(totals.firstDispatch);
+    header.lastDispatch = static_cast<int64_t>(totals.lastDispatch);
+
+    uint64_t offset = align8(sizeof(SnapshotHeader));
+    for (int s = 0; s < SNAPSHOT_SECTION_COUNT; ++s) {
+        header.recordCount[s] = sections[s]->size();
+        header.recordOffset[s] = offset;
+        offset += header.recordCount[s] * sizeof(SnapshotRecord);
+    }
+    header.serviceTimesOffset = offset;
+    offset += processedOldestFirst.size() * sizeof(SnapshotServiceTimes);
+    header.settingCount = settings.size();
+    header.settingOffset = offset;
+    offset += settings.size() * sizeof(SnapshotSetting);
+    header.blobOffset = offset;
+
+    std::string tempPath = path + ".tmp";
+    std::FILE *file = std::fopen(tempPath.c_str(), "wb");
+    if (!file) return false;
+
+    bool ok = writeAll(file, &header, sizeof(header));
+    uint64_t position = sizeof(header);
+    ok = ok && padTo(file, position, header.recordOffset[0]);
+    uint64_t blobBytes = 0;
+    for (int s = 0; ok && s < SNAPSHOT_SECTION_COUNT; ++s) {
+        ok = writeRecords(file, position, *sections[s], blobBytes);
+    }
+    for (size_t i = 0; ok && i < processedOldestFirst.size(); ++i) {
+        SnapshotServiceTimes times;
+        times.serviceStartTime = static_cast<int64_t>(processedOldestFirst[i].getServiceStartTime());
+        times.serviceEndTime = static_cast<int64_t>(processedOldestFirst[i].getServiceEndTime());
+        ok = writeAll(file, &times, sizeof(times));
+        position += sizeof(times);
+    }
+    for (size_t i = 0; ok && i < settings.size(); ++i) {
+        SnapshotSetting setting;
+        std::memset(&setting, 0, sizeof(setting));
+        std::strncpy(setting.key, settings[i].first.c_str(), sizeof(setting.key) - 1);
+        setting.value = settings[i].second;
+        ok = writeAll(file, &setting, sizeof(setting));
+        position += sizeof(setting);
+    }
+    for (int s = 0; ok && s < SNAPSHOT_SECTION_COUNT; ++s) {
+        ok = writeStrings(file, position, *sections[s]);
+    }
+
+    // Patch in the blob size now that it is known; the rename below publishes the file
+    header.blobBytes = blobBytes;
+    ok = ok && std::fseek(file, 0, SEEK_SET) == 0 && writeAll(file, &header, sizeof(header));
+    ok = ok && std::fflush(file) == 0;
+#ifndef _WIN32
+    ok = ok && fsync(fileno(file)) == 0;
+#endif
+    if (std::fclose(file) != 0) ok = false;
+    if (!ok) {
+        std::remove(tempPath.c_str());
+        return false;
+    }
+
+    std::error_code ec;
+    std::filesystem::rename(tempPath, path, ec);
+    return !ec;
+}
+
+bool readQueueSnapshot(const std::string &path, SnapshotContents &contents)
+{
+    const unsigned char *base = nullptr;
+    size_t size = 0;
+    std::vector<unsigned char> fallback;
+#ifndef _WIN32
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) return false;
+    struct stat st;
+    if (fstat(fd, &st) != 0 || st.st_size < static_cast<off_t>(sizeof(SnapshotHeader))) {
+        ::close(fd);
+        return false;
+    }
+    size = static_cast<size_t>(st.st_size);
+    void *addr = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);
+    if (addr == MAP_FAILED) return false;
+    madvise(addr, size, MADV_SEQUENTIAL);
+    base = static_cast<const unsigned char *>(addr);
+#else
+    std::FILE *file = std::fopen(path.c_str(), "rb");
+    if (!file) return false;
+    std::fseek(file, 0, SEEK_END);
+    long fileSize = std::ftell(file);
+    std::fseek(file, 0, SEEK_SET);
+    if (fileSize < static_cast<long>(sizeof(SnapshotHeader))) {
+        std::fclose(file);
+        return false;
+    }
+    fallback.resize(fileSize);
+    size = std::fread(fallback.data(), 1, fileSize, file);
+    std::fclose(file);
+    base = fallback.data();
+#endif
+
+    const SnapshotHeader *header = reinterpret_cast<const SnapshotHeader *>(base);
+    bool valid = std::memcmp(header->magic, SNAPSHOT_MAGIC, sizeof(SNAPSHOT_MAGIC)) == 0 &&
+                 header->version == SNAPSHOT_VERSION && header->endianMarker == ENDIAN_MARKER &&
+                 header->blobOffset + header->blobBytes <= size &&
+                 header->settingOffset + header->settingCount * sizeof(SnapshotSetting) <= size &&
+                 header->serviceTimesOffset + header->recordCount[SNAPSHOT_PROCESSED] * sizeof(SnapshotServiceTimes) <= size;
+    for (int s = 0; valid && s < SNAPSHOT_SECTION_COUNT; ++s) {
+        valid = header->recordOffset[s] + header->recordCount[s] * sizeof(SnapshotRecord) <= size;
+    }
+
+    if (valid) {
+        const char *blob = reinterpret_cast<const char *>(base + header->blobOffset);
+        for (int s = 0; valid && s < SNAPSHOT_SECTION_COUNT; ++s) {
+            std::vector<Delivery> &out = (s == SNAPSHOT_CANCELLED)   ? contents.cancelled
+                                         : (s == SNAPSHOT_PROCESSED) ? contents.processed
+                                                                     : contents.queues[s];
+            const SnapshotRecord *records = reinterpret_cast<const SnapshotRecord *>(base + header->recordOffset[s]);
+            out.clear();
+            out.reserve(header->recordCount[s]);
+            for (uint64_t i = 0; i < header->recordCount[s]; ++i) {
+                const SnapshotRecord &r = records[i];
+                if (r.idOffset + r.idLength > header->blobBytes ||
+                    r.destinationOffset + r.destinationLength > header->blobBytes || r.deliveryType > FRAGILE) {
+                    valid = false;
+                    break;
+                }
+                out.emplace_back(std::string(blob + r.idOffset, r.idLength),
+                                 std::string(blob + r.destinationOffset, r.destinationLength),
+                                 static_cast<DeliveryType>(r.deliveryType), r.estimatedDeliveryTime);
+                Delivery &d = out.back();
+                d.priorityScore = r.priorityScore;
+                d.entryTime = static_cast<time_t>(r.entryTime);
+            }
+        }
+        const SnapshotServiceTimes *times =
+            reinterpret_cast<const SnapshotServiceTimes *>(base + header->serviceTimesOffset);
+        for (size_t i = 0; valid && i < contents.processed.size(); ++i) {
+            contents.processed[i].setServiceStartTime(static_cast<time_t>(times[i].serviceStartTime));
+            contents.processed[i].setServiceEndTime(static_cast<time_t>(times[i].serviceEndTime));
+        }
+        for (int t = 0; t < 3; ++t) {
+            const SnapshotTypeTotals &from = header->totals[t];
+            TypeTotals &to = contents.totals.perType[t];
+            to.arrivals = from.arrivals;
+            to.processed = from.processed;
+            to.cancelled = from.cancelled;
+            to.dispatchedMinutes = from.dispatchedMinutes;
+            to.deadlineMisses = from.deadlineMisses;
+            to.deadlineDrops = from.deadlineDrops;
+        }
+        contents.totals.firstDispatch = static_cast<time_t>(header->firstDispatch);
+        contents.totals.lastDispatch = static_cast<time_t>(header->lastDispatch);
+        const SnapshotSetting *settings = reinterpret_cast<const SnapshotSetting *>(base + header->settingOffset);
+        contents.settings.clear();
+        for (uint64_t i = 0; valid && i < header->settingCount; ++i) {
+            contents.settings.emplace_back(std::string(settings[i].key, strnlen(settings[i].key, sizeof(settings[i].key))),
+                                           settings[i].value);
+        }
+        contents.walLsn = header->walLsn;
+        contents.configVersion = header->configVersion;
+    }
+
+#ifndef _WIN32
+    munmap(const_cast<unsigned char *>(base), size);
+#endif
+    return valid;
+}
@@ -0,0 +1,101 @@
+#ifndef QUEUE_SNAPSHOT_H
+#define QUEUE_SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include <utility>
+#include <vector>
+#include "Delivery.h"
+#include "DeliveryMetrics.h"
+
+// Binary checkpoint of the queue state (".snap" files).
+//
+// The three heap arrays are stored exactly in heap order as fixed-width
+// SnapshotRecords, followed by the cancelled log and the processed history
+// (both oldest first), the service times of the processed history, the
+// configuration and a blob holding every ID and destination string. The
+// lifetime metric totals sit in the header. A restored array is therefore
+// already a valid heap and can be adopted as is.
+struct SnapshotRecord {
+    uint64_t idOffset;          // Into the string blob
+    uint64_t destinationOffset;
+    uint32_t idLength;
+    uint32_t destinationLength;
+    double priorityScore;
+    int64_t entryTime;
+    int32_t estimatedDeliveryTime;
+    uint8_t deliveryType;
+    uint8_t reserved[3];
+};
+static_assert(sizeof(SnapshotRecord) == 48, "SnapshotRecord layout must stay fixed");
+
+// Parallel to the SNAPSHOT_PROCESSED records
+struct SnapshotServiceTimes {
+    int64_t serviceStartTime;
+    int64_t serviceEndTime;
+};
+static_assert(sizeof(SnapshotServiceTimes) == 16, "SnapshotServiceTimes layout must stay fixed");
+
+// One class of MetricsTotals
+struct SnapshotTypeTotals {
+    uint64_t arrivals;
+    uint64_t processed;
+    uint64_t cancelled;
+    uint64_t dispatchedMinutes;
+    uint64_t deadlineMisses;
+    uint64_t deadlineDrops;
+};
+
+struct SnapshotSetting {
+    char key[40];
+    double value;
+};
+static_assert(sizeof(SnapshotSetting) == 48, "SnapshotSetting layout must stay fixed");
+
+enum SnapshotSection {
+    SNAPSHOT_URGENT,
+    SNAPSHOT_STANDARD,
+    SNAPSHOT_FRAGILE,
+    SNAPSHOT_CANCELLED,
+    SNAPSHOT_PROCESSED,
+    SNAPSHOT_SECTION_COUNT
+};
+
+struct SnapshotHeader {
+    char magic[8];              // "SQSNAP01"
+    uint32_t version;
+    uint32_t endianMarker;
+    uint64_t walLsn;            // Last write-ahead log record reflected in the snapshot
+    uint64_t configVersion;
+    uint64_t recordCount[SNAPSHOT_SECTION_COUNT];
+    uint64_t recordOffset[SNAPSHOT_SECTION_COUNT];
+    uint64_t settingCount;
+    uint64_t settingOffset;
+    uint64_t serviceTimesOffset; // recordCount[SNAPSHOT_PROCESSED] entries
+    uint64_t blobOffset;
+    uint64_t blobBytes;
+    SnapshotTypeTotals totals[3];
+    int64_t firstDispatch;
+    int64_t lastDispatch;
+};
+
+struct SnapshotContents {
+    std::vector<Delivery> queues[3];   // Indexed by SnapshotSection, heap order
+    std::vector<Delivery> cancelled;   // Oldest first
+    std::vector<Delivery> processed;   // Oldest first, with service times
+    MetricsTotals totals;
+    std::vector<std::pair<std::string, double>> settings;
+    uint64_t walLsn = 0;
+    uint64_t configVersion = 0;
+};
+
+// Writes to path + ".tmp" and renames it over path once complete
+bool writeQueueSnapshot(const std::string &path, const std::vector<Delivery> *queues[3],
+                        const std::vector<Delivery> &cancelledOldestFirst,
+                        const std::vector<Delivery> &processedOldestFirst, const MetricsTotals &totals,
+                        uint64_t walLsn);
+
+// Maps the file and materialises its contents
+bool readQueueSnapshot(const std::string &path, SnapshotContents &contents);
+
+#endif // QUEUE_SNAPSHOT_H
@@ -1,72 +1,189 @@
 #include "ReportManager.h"
+#include "ColumnarExport.h"
 #include <iostream>
 #include <iomanip>
 #include <algorithm>
-#include <fstream>
+#include <charconv>
+#include <system_error>
+#include <cstdio>
+#include <cstring>
+#include <deque>
+#include <iterator>
 
-void ReportManager::generateReport(const std::string& filterType, const std::string& sortCriteria) const
+namespace {
+
+struct ReportRow {
+    double key;            // Sort key, precomputed once per row
+    const Delivery* delivery;
+};
+
+const char* typeName(DeliveryType type) {
+    switch (type) {
+        case URGENT: return "urgent";
+        case STANDARD: return "standard";
+        case FRAGILE: return "fragile";
+    }
+    return "unknown";
+}
+
+char* appendText(char* out, const std::string& text) {
+    std::memcpy(out, text.data(), text.size());
+    return out + text.size();
+}
+
+char* appendText(char* out, const char* text) {
+    size_t len = std::strlen(text);
+    std::memcpy(out, text, len);
+    return out + len;
+}
+
+// Longest "%.2f" of a double: sign, 309 integer digits, point and 2 decimals
+const size_t MAX_FIXED2_SIZE = 313;
+
+char* appendFixed2(char* out, char* end, double value) {
+    std::to_chars_result result = std::to_chars(out, end, value, std::chars_format::fixed, 2);
+    if (result.ec != std::errc()) {
+        // Not reached while rows reserve MAX_FIXED2_SIZE per number; never write a wrong value
+        char text[MAX_FIXED2_SIZE + 1];
+        int written = std::snprintf(text, sizeof(text), "%.2f", value);
+        size_t length = std::min<size_t>(written > 0 ? written : 0, end - out);
+        std::memcpy(out, text, length);
+        return out + length;
+    }
+    return result.ptr;
+}
+
+} // namespace
+
+void ReportManager::generateReport(const std::string& filterType, const std::string& sortCriteria,
+                                   size_t topN, bool echoRows) const
 {
     std::cout << "\n=== Detailed Delivery Report ===" << std::endl;
 
-    const std::vector<Delivery>& deliveries = deliveryManager.getProcessedDeliveries();
-    std::vector<Delivery> filtered;
-
-    // Filter by type if specified
-    if (!filterType.empty()) {
-        for (const Delivery& d : deliveries) {
-            std::string typeStr;
-            switch (d.getType()) {
-                case URGENT: typeStr = "urgent"; break;
-                case STANDARD: typeStr = "standard"; break;
-                case FRAGILE: typeStr = "fragile"; break;
-            }
-            if (typeStr == filterType) {
-                filtered.push_back(d);
-            }
+    const std::deque<Delivery>& deliveries = deliveryManager.getProcessedDeliveries();
+    bool byWaitingTime = (sortCriteria == "waiting_time");
+
+    // Filter by type if specified; rows point into the history instead of copying it
+    bool filterEnabled = !filterType.empty();
+    int wantedType = -1; // An unknown filter matches nothing
+    if (filterType == "urgent") wantedType = URGENT;
+    else if (filterType == "standard") wantedType = STANDARD;
+    else if (filterType == "fragile") wantedType = FRAGILE;
+
+    std::vector<ReportRow> rows;
+    rows.reserve(deliveries.size());
+    for (const Delivery& d : deliveries) {
+        if (filterEnabled && d.getType() != wantedType) {
+            continue;
         }
-    } else {
-        filtered = deliveries;
+        double key = byWaitingTime ? std::difftime(d.getServiceStartTime(), d.getEntryTime())
+                                   : d.getPriorityScore();
+        rows.push_back({key, &d});
     }
 
-    // Sort by criteria
-    if (sortCriteria == "waiting_time") {
-        std::sort(filtered.begin(), filtered.end(), [](const Delivery &a, const Delivery &b) {
-            double waitTimeA = std::difftime(a.getServiceStartTime(), a.getEntryTime());
-            double waitTimeB = std::difftime(b.getServiceStartTime(), b.getEntryTime());
-            return waitTimeA > waitTimeB; // Descending order
-        });
-    } else {
-        // Default sort by priority score
-        std::sort(filtered.begin(), filtered.end(), [](const Delivery &a, const Delivery &b) {
-            return a.getPriorityScore() > b.getPriorityScore();
-        });
+    // Sort by criteria (descending); only the requested top N rows are ordered
+    auto descending = [](const ReportRow& a, const ReportRow& b) { return a.key > b.key; };
+    if (topN > 0 && topN < rows.size()) {
+        std::nth_element(rows.begin(), rows.begin() + topN, rows.end(), descending);
+        rows.resize(topN);
     }
+    std::sort(rows.begin(), rows.end(), descending);
 
-    std::ofstream outFile("delivery_report.csv");
-    outFile << "ID,Type,Priority,Wait Time,Service Time\n";
+    std::FILE* outFile = std::fopen("delivery_report.csv", "wb");
+    if (!outFile) {
+        std::cout << "Could not open delivery_report.csv for writing" << std::endl;
+        return;
+    }
+    std::setvbuf(outFile, nullptr, _IONBF, 0); // Chunks below are already large
+
+    // Leave room for one row (three numbers, type, separators) past the flush threshold
+    const size_t maxRowSize = 3 * MAX_FIXED2_SIZE + 32;
+    writeBuffer.resize(WRITE_CHUNK_SIZE + maxRowSize);
+    char* const begin = writeBuffer.data();
+    char* const flushAt = begin + WRITE_CHUNK_SIZE;
+    char* const end = begin + writeBuffer.size();
+    char* out = appendText(begin, "ID,Type,Priority,Wait Time,Service Time\n");
 
-    for (const Delivery &d : filtered) {
+    std::ios::fmtflags flags = std::cout.flags();
+    if (echoRows) std::cout << std::fixed << std::setprecision(2);
+
+    for (const ReportRow& row : rows) {
+        const Delivery& d = *row.delivery;
         double waitTime = std::difftime(d.getServiceStartTime(), d.getEntryTime()) / 60.0; // Convert to minutes
         double serviceTime = std::difftime(d.getServiceEndTime(), d.getServiceStartTime()) / 60.0; // Convert to minutes
+        const char* typeStr = typeName(d.getType());
+
+        if (d.deliveryId.size() > static_cast<size_t>(flushAt - out)) {
+            // ID does not fit in the current chunk: flush and write it directly
+            std::fwrite(begin, 1, out - begin, outFile);
+            out = begin;
+            std::fwrite(d.deliveryId.data(), 1, d.deliveryId.size(), outFile);
+        } else {
+            out = appendText(out, d.deliveryId);
+        }
+        *out++ = ',';
+        out = appendText(out, typeStr);
+        *out++ = ',';
+        out = appendFixed2(out, end, d.getPriorityScore());
+        *out++ = ',';
+        out = appendFixed2(out, end, waitTime);
+        *out++ = ',';
+        out = appendFixed2(out, end, serviceTime);
+        *out++ = '\n';
 
-        std::string typeStr;
-        switch (d.getType()) {
-            case URGENT: typeStr = "urgent"; break;
-            case STANDARD: typeStr = "standard"; break;
-            case FRAGILE: typeStr = "fragile"; break;
+        if (out >= flushAt) {
+            std::fwrite(begin, 1, out - begin, outFile);
+            out = begin;
         }
 
-        outFile << d.getId() << ","
-                << typeStr << ","
-                << std::fixed << std::setprecision(2) << d.getPriorityScore() << ","
-                << waitTime << ","
-                << serviceTime << "\n";
+        if (echoRows) {
+            std::cout << "ID=" << d.getId() << " | " << typeStr << " | "
+                      << waitTime << " min wait | " << serviceTime << " min service" << "\n";
+        }
+    }
 
-        std::cout << "ID=" << d.getId() << " | " << typeStr << " | " 
-                  << waitTime << " min wait | " << serviceTime << " min service" << std::endl;
+    if (out != begin) {
+        std::fwrite(begin, 1, out - begin, outFile);
     }
+    std::fclose(outFile);
+    std::cout.flags(flags);
+
+    std::cout << "Report has been saved to delivery_report.csv (" << rows.size() << " rows)" << std::endl;
 
-    outFile.close();
-    std::cout << "Report has been saved to delivery_report.csv" << std::endl;
+    // Percentiles come from the streaming metrics, so they cover every processed
+    // delivery even when only the most recent ones are kept for the rows above.
+    deliveryManager.getMetrics().printSummary(std::cout);
 }
 
+bool ReportManager::exportColumnar(const std::string& processedPath, const std::string& cancelledPath) const
+{
+    const std::deque<Delivery>& processed = deliveryManager.getProcessedDeliveries();
+    std::vector<const Delivery*> rows;
+    rows.reserve(processed.size());
+    for (const Delivery& d : processed) rows.push_back(&d);
+    if (!writeColumnarFile(processedPath, rows, COLUMNAR_PROCESSED)) {
+        std::cout << "Could not write " << processedPath << std::endl;
+        return false;
+    }
+
+    // The full history, archived pages included, most recent first; a deque
+    // keeps the rows in place while later pages are appended
+    const size_t pageSize = 4096;
+    std::deque<Delivery> cancelled;
+    for (uint64_t offset = 0; offset < deliveryManager.getCancelledCount(); offset += pageSize) {
+        std::vector<Delivery> page = deliveryManager.getCancelledPage(offset, pageSize);
+        if (page.empty()) break;
+        cancelled.insert(cancelled.end(), std::make_move_iterator(page.begin()), std::make_move_iterator(page.end()));
+    }
+    rows.clear();
+    rows.reserve(cancelled.size());
+    for (const Delivery& d : cancelled) rows.push_back(&d);
+    if (!writeColumnarFile(cancelledPath, rows, COLUMNAR_CANCELLED)) {
+        std::cout << "Could not write " << cancelledPath << std::endl;
+        return false;
+    }
+
+    std::cout << "Columnar export saved to " << processedPath << " (" << processed.size() << " rows) and "
+              << cancelledPath << " (" << cancelled.size() << " rows)" << std::endl;
+    return true;
+}
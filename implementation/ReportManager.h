@@ -5,18 +5,27 @@
 #include "DeliveryManager.h"
 #include <vector>
 #include <string>
+#include <cstddef>
 #include <algorithm>
 
 class ReportManager
 {
 private:
     const DeliveryManager& deliveryManager;
+    mutable std::vector<char> writeBuffer; // Reused between reports, flushed with one write per chunk
 
 public:
+    static const size_t WRITE_CHUNK_SIZE = 1 << 20;
+
     ReportManager(const DeliveryManager& dm) : deliveryManager(dm) {}
-    void generateReport(const std::string& filterType = "", const std::string& sortCriteria = "") const;
-};
 
-#endif
+    // topN == 0 writes every matching row; echoRows also prints each row to the console
+    void generateReport(const std::string& filterType = "", const std::string& sortCriteria = "",
+                        size_t topN = 0, bool echoRows = true) const;
 
+    // Columnar binary (.sqc) files of the processed history and the cancelled log
+    bool exportColumnar(const std::string& processedPath = "processed_deliveries.sqc",
+                        const std::string& cancelledPath = "cancelled_deliveries.sqc") const;
+};
 
+#endif
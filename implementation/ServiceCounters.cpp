@@ -0,0 +1,138 @@
+#include "ServiceCounters.h"
+#include <algorithm>
+#include <cctype>
+#include <cerrno>
+#include <cmath>
+#include <cstdlib>
+#include <sstream>
+#include <stdexcept>
+
+namespace {
+
+inline int lowestBit(uint64_t word)
+{
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(word);
+#else
+    int bit = 0;
+    while (!(word & 1)) {
+        word >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+int skillCount(uint8_t skills)
+{
+    return ((skills >> URGENT) & 1) + ((skills >> STANDARD) & 1) + ((skills >> FRAGILE) & 1);
+}
+
+} // namespace
+
+bool parseCounterProfiles(const std::string &spec, std::vector<CounterProfile> &profiles)
+{
+    profiles.clear();
+    std::stringstream in(spec);
+    std::string group;
+    while (std::getline(in, group, ',')) {
+        CounterProfile profile;
+        profile.skills = 0;
+        size_t pos = 0;
+        for (; pos < group.size() && std::isalpha(static_cast<unsigned char>(group[pos])); ++pos) {
+            switch (std::toupper(static_cast<unsigned char>(group[pos]))) {
+            case 'U': profile.skills |= SKILL_URGENT; break;
+            case 'S': profile.skills |= SKILL_STANDARD; break;
+            case 'F': profile.skills |= SKILL_FRAGILE; break;
+            default: return false;
+            }
+        }
+        if (profile.skills == 0) return false;
+        long count = 1;
+        while (pos < group.size()) {
+            char kind = group[pos++];
+            const char *start = group.c_str() + pos;
+            char *end = nullptr;
+            if (kind == '@') {
+                profile.speed = std::strtod(start, &end);
+                if (end == start || !std::isfinite(profile.speed) || profile.speed <= 0.0) return false;
+            } else if (kind == '*') {
+                // A whole number of counters; "*0.5" or "*1e20" are errors, not 0 or an overflow
+                if (!std::isdigit(static_cast<unsigned char>(*start))) return false;
+                errno = 0;
+                count = std::strtol(start, &end, 10);
+                if (errno == ERANGE || count <= 0 || count > CounterPool::MAX_COUNTERS) return false;
+            } else {
+                return false;
+            }
+            pos = end - group.c_str();
+        }
+        if (profiles.size() + count > static_cast<size_t>(CounterPool::MAX_COUNTERS)) return false;
+        std::ostringstream name;
+        name << skillLetters(profile.skills) << "@" << profile.speed;
+        profile.name = name.str();
+        profiles.insert(profiles.end(), count, profile);
+    }
+    return !profiles.empty();
+}
+
+std::string skillLetters(uint8_t skills)
+{
+    std::string letters;
+    if (skills & SKILL_URGENT) letters += 'U';
+    if (skills & SKILL_STANDARD) letters += 'S';
+    if (skills & SKILL_FRAGILE) letters += 'F';
+    return letters;
+}
+
+CounterPool::CounterPool(std::vector<CounterProfile> profiles) : counters(std::move(profiles)), idle(0)
+{
+    if (counters.size() > static_cast<size_t>(MAX_COUNTERS)) {
+        throw std::length_error("CounterPool: more than MAX_COUNTERS counters");
+    }
+    std::stable_sort(counters.begin(), counters.end(), [](const CounterProfile &a, const CounterProfile &b) {
+        if (a.speed != b.speed) return a.speed > b.speed;
+        return skillCount(a.skills) < skillCount(b.skills);
+    });
+    size_t words = (counters.size() + 63) / 64;
+    for (int skill = 0; skill < 3; ++skill) {
+        idleWords[skill].assign(words, 0);
+        idleSummary[skill] = 0;
+    }
+    for (int c = 0; c < size(); ++c) setIdle(c, true);
+}
+
+void CounterPool::setIdle(int counter, bool value)
+{
+    int word = counter / 64;
+    uint64_t bit = 1ULL << (counter % 64);
+    for (int skill = 0; skill < 3; ++skill) {
+        if (!(counters[counter].skills & (1 << skill))) continue;
+        uint64_t &w = idleWords[skill][word];
+        w = value ? (w | bit) : (w & ~bit);
+        if (w) idleSummary[skill] |= 1ULL << word;
+        else idleSummary[skill] &= ~(1ULL << word);
+    }
+    idle += value ? 1 : -1;
+}
+
+int CounterPool::acquire(DeliveryType type)
+{
+    if (!idleSummary[type]) return -1;
+    int word = lowestBit(idleSummary[type]);
+    int counter = word * 64 + lowestBit(idleWords[type][word]);
+    setIdle(counter, false);
+    return counter;
+}
+
+void CounterPool::release(int counter)
+{
+    setIdle(counter, true);
+}
+
+uint8_t CounterPool::coveredSkills() const
+{
+    uint8_t skills = 0;
+    for (const CounterProfile &counter : counters) skills |= counter.skills;
+    return skills;
+}
@@ -0,0 +1,68 @@
+#ifndef SERVICE_COUNTERS_H
+#define SERVICE_COUNTERS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "DeliveryTypes.h"
+
+// Skill bits, one per DeliveryType
+const uint8_t SKILL_URGENT = 1 << URGENT;
+const uint8_t SKILL_STANDARD = 1 << STANDARD;
+const uint8_t SKILL_FRAGILE = 1 << FRAGILE;
+const uint8_t SKILL_ALL = ALL_DELIVERY_CLASSES;
+
+// One service counter: which delivery classes it can handle and how fast.
+// A delivery occupies it for estimatedDeliveryTime / speed minutes.
+struct CounterProfile {
+    std::string name;
+    uint8_t skills = SKILL_ALL;
+    double speed = 1.0;
+};
+
+// Parses "SKILLS[@SPEED][*COUNT],..." where SKILLS is any of U, S and F,
+// e.g. "USF*2,F@1.5,U@0.8*2". SPEED is a positive number and COUNT a
+// positive integer. False on a malformed spec or one with more than
+// CounterPool::MAX_COUNTERS counters in total.
+bool parseCounterProfiles(const std::string &spec, std::vector<CounterProfile> &profiles);
+std::string skillLetters(uint8_t skills);
+
+// Idle counters, routed by skill in O(1).
+//
+// Counters are renumbered best first (fastest, then the fewest skills, so
+// generalists stay free for work only they can take). Each skill keeps a
+// two-level bitset of its idle counters: a summary word marks the non-empty
+// 64-bit words, so finding the best idle counter for a class is two
+// count-trailing-zeros, whatever the number of counters (up to 4096).
+class CounterPool
+{
+public:
+    static const int MAX_COUNTERS = 64 * 64;
+
+private:
+    std::vector<CounterProfile> counters; // Best first
+    std::vector<uint64_t> idleWords[3];   // Per skill, bit i = counter i idle and able
+    uint64_t idleSummary[3];              // Per skill, bit w = idleWords[skill][w] != 0
+    int idle;
+
+    void setIdle(int counter, bool value);
+
+public:
+    explicit CounterPool(std::vector<CounterProfile> profiles); // Throws std::length_error past MAX_COUNTERS
+
+    int acquire(DeliveryType type); // Best idle counter that can take type, now busy; -1 if none
+    void release(int counter);      // Idle again
+
+    bool hasIdleFor(DeliveryType type) const { return idleSummary[type] != 0; }
+    uint8_t idleSkills() const // Classes some idle counter can take
+    {
+        return (idleSummary[URGENT] ? SKILL_URGENT : 0) | (idleSummary[STANDARD] ? SKILL_STANDARD : 0) |
+               (idleSummary[FRAGILE] ? SKILL_FRAGILE : 0);
+    }
+    int idleCount() const { return idle; }
+    int size() const { return static_cast<int>(counters.size()); }
+    const CounterProfile &profile(int counter) const { return counters[counter]; }
+    uint8_t coveredSkills() const; // Classes at least one counter can take
+};
+
+#endif // SERVICE_COUNTERS_H
@@ -1,9 +1,23 @@
 #include "SimulationManager.h"
 #include <iostream>
+#include <cmath>
 #include <cstdlib>
 #include <ctime>
 #include <thread>
 #include <chrono>
+#include <iomanip>
+
+namespace {
+
+// The simulation's minute ticks drive DeliveryClock, so waiting times and
+// scores are in simulated minutes
+time_t simulationNow = 0;
+time_t simulationClock() { return simulationNow; }
+
+const int DESTINATION_ZONES = 20;
+const int BATCH_STOP_MINUTES = 5; // Each extra delivery on a trip: the drive is shared, the drop-off is not
+
+} // namespace
 
 void SimulationManager::runSimulation()
 {
@@ -11,40 +25,121 @@ void SimulationManager::runSimulation()
     float arrivalRate = ConfigurationManager::getSimulationArrivalRate();
     int serviceCounters = ConfigurationManager::getSimulationCounters();
 
-    std::cout << "Starting simulation for " << duration << " minutes with arrival rate " << arrivalRate << " and " << serviceCounters << " counters." << std::endl;
+    // Each counter serves one trip at a time, for its longest estimate
+    // divided by the counter's speed plus a stop per extra delivery, and
+    // only the classes it is skilled for. A trip is a single delivery unless
+    // batch_max_extra lets it take others bound for the same destination.
+    std::vector<CounterProfile> profiles = counterProfiles;
+    if (profiles.empty()) {
+        if (serviceCounters > CounterPool::MAX_COUNTERS) {
+            std::cout << "Simulating " << CounterPool::MAX_COUNTERS << " service counters, the most supported (configured: "
+                      << serviceCounters << ")\n";
+            serviceCounters = CounterPool::MAX_COUNTERS;
+        }
+        profiles.assign(serviceCounters, CounterProfile());
+    }
+    CounterPool pool(profiles);
+    std::vector<CounterStats> counterStats(pool.size());
+    std::vector<int> busyUntil(pool.size(), -1); // -1 while idle
+    std::vector<std::vector<Delivery>> inService(pool.size());
+    LogLinearHistogram waits[3];    // Minutes from entry to counter
+    LogLinearHistogram tripSizes;   // Deliveries per trip
+    for (int type = URGENT; type <= FRAGILE; ++type) {
+        if (!(pool.coveredSkills() & (1 << type))) {
+            std::cout << "Warning: no counter can serve " << skillLetters(1 << type) << " deliveries." << std::endl;
+        }
+    }
+
+    // Simulated time ends at the wall clock, so deliveries left queued keep sensible ages
+    time_t simulationStart = time(0) - static_cast<time_t>(duration) * 60;
+    DeliveryClock::setSource(&simulationClock);
+
+    std::cout << "Starting simulation for " << duration << " minutes with arrival rate " << arrivalRate << " and " << pool.size() << " counters." << std::endl;
+
+    auto startService = [&](int counter, std::vector<Delivery> &trip) {
+        const CounterProfile &profile = pool.profile(counter);
+        int longest = 0;
+        for (const Delivery &delivery : trip) {
+            if (delivery.estimatedDeliveryTime > longest) longest = delivery.estimatedDeliveryTime;
+        }
+        int minutes = static_cast<int>(std::ceil(longest / profile.speed)) +
+                      BATCH_STOP_MINUTES * static_cast<int>(trip.size() - 1);
+        if (minutes < 1) minutes = 1;
+        busyUntil[counter] = currentSimTime + minutes;
+        counterStats[counter].busyMinutes += minutes;
+        tripSizes.record(trip.size());
+        for (Delivery &delivery : trip) {
+            double waited = std::difftime(simulationNow, delivery.entryTime) / 60.0;
+            waits[delivery.getType()].record(static_cast<uint64_t>(waited > 0 ? waited : 0));
+            delivery.setServiceStartTime(simulationNow);
+            delivery.setServiceEndTime(simulationNow + static_cast<time_t>(minutes) * 60);
+            if (tracer) tracer->deliveryStarted(delivery);
+            std::cout << "Processed: ID=" << delivery.deliveryId << " (P=" << delivery.priorityScore << ") to "
+                      << delivery.destination << " at counter " << counter << " [" << profile.name << "] for "
+                      << minutes << " min" << std::endl;
+        }
+        inService[counter] = std::move(trip);
+    };
 
     for (currentSimTime = 0; currentSimTime < duration; ++currentSimTime)
     {
+        simulationNow = simulationStart + static_cast<time_t>(currentSimTime) * 60;
         std::cout << "\n--- Time: " << currentSimTime << " minutes ---\n";
 
         // 1. Generate new arrivals
         if ((static_cast<float>(rand()) / RAND_MAX) < arrivalRate)
         {
+            TraceSpan span(tracer, "arrivals", currentSimTime);
             Delivery new_delivery = generateRandomDelivery();
             deliveryManager.addDelivery(new_delivery);
+            if (tracer) tracer->deliveryEntered(new_delivery);
             std::cout << "New Arrival: ID=" << new_delivery.deliveryId << " (P=" << new_delivery.priorityScore << ")" << std::endl;
         }
 
         // 2. Process deliveries
-        for (int i = 0; i < serviceCounters; ++i)
         {
-            if (deliveryManager.hasDeliveries())
+            TraceSpan span(tracer, "processing", currentSimTime);
+            for (int counter = 0; counter < pool.size(); ++counter)
             {
-                Delivery processed_delivery = deliveryManager.processNextDelivery();
-                processed_delivery.setServiceEndTime(time(0)); // Set service end time
-                std::cout << "Processed: ID=" << processed_delivery.deliveryId << " (P=" << processed_delivery.priorityScore << ")" << std::endl;
+                if (busyUntil[counter] >= 0 && busyUntil[counter] <= currentSimTime)
+                {
+                    for (const Delivery &delivery : inService[counter])
+                    {
+                        if (tracer) tracer->deliveryFinished(delivery);
+                        ++counterStats[counter].served;
+                    }
+                    ++counterStats[counter].trips;
+                    busyUntil[counter] = -1;
+                    pool.release(counter);
+                }
             }
-            else
+            // Dispatch in the scheduler's order among the classes some idle
+            // counter can take, each delivery to the best such counter. A
+            // class whose counters are all busy stays queued rather than
+            // holding up the others.
+            for (uint8_t skills = pool.idleSkills(); skills && deliveryManager.hasDeliveries(skills); skills = pool.idleSkills())
             {
-                break;
+                std::vector<Delivery> trip = deliveryManager.processNextBatch(skills);
+                startService(pool.acquire(deliveryManager.getLastDispatchQueue()), trip);
             }
         }
 
         // 3. Update priorities and apply fairness boost
-        deliveryManager.updatePriorities();
+        {
+            TraceSpan span(tracer, "updatePriorities", currentSimTime);
+            deliveryManager.updatePriorities();
+        }
 
         // 4. Merge queues if necessary
-        deliveryManager.mergeQueues();
+        {
+            TraceSpan span(tracer, "mergeQueues", currentSimTime);
+            deliveryManager.mergeQueues();
+        }
+        if (tracer && tracer->isTickSampled(currentSimTime))
+        {
+            tracer->queueSizes(tracer->now(), deliveryManager.getUrgentQueueSize(),
+                               deliveryManager.getStandardQueueSize(), deliveryManager.getFragileQueueSize());
+        }
 
         // 5. Display queue states
         std::cout << "Urgent Queue Size: " << deliveryManager.getUrgentQueueSize() << std::endl;
@@ -55,14 +150,64 @@ void SimulationManager::runSimulation()
         std::this_thread::sleep_for(std::chrono::milliseconds(100));
     }
 
+    DeliveryClock::setSource(nullptr);
+    int stillInService = 0;
+    for (int counter = 0; counter < pool.size(); ++counter)
+    {
+        if (busyUntil[counter] >= 0) ++stillInService;
+    }
+
     std::cout << "Simulation finished." << std::endl;
+    printCounterReport(pool, counterStats, waits, tripSizes, stillInService);
     reportManager.generateReport();
 }
 
+void SimulationManager::printCounterReport(const CounterPool &pool, const std::vector<CounterStats> &counters,
+                                           const LogLinearHistogram (&waits)[3], const LogLinearHistogram &tripSizes,
+                                           int inService) const
+{
+    static const char *names[3] = {"Urgent", "Standard", "Fragile"};
+    int duration = currentSimTime > 0 ? currentSimTime : 1;
+    uint64_t served = 0;
+    uint64_t trips = 0;
+    std::ios::fmtflags flags = std::cout.flags();
+    std::streamsize precision = std::cout.precision();
+    std::cout << std::fixed << std::setprecision(1);
+
+    std::cout << "--- Counters ---\n";
+    for (int counter = 0; counter < pool.size(); ++counter)
+    {
+        const CounterStats &stats = counters[counter];
+        served += stats.served;
+        trips += stats.trips;
+        long long busy = stats.busyMinutes < duration ? stats.busyMinutes : duration;
+        std::cout << "Counter " << counter << " [" << pool.profile(counter).name << "]: served=" << stats.served
+                  << " trips=" << stats.trips << " busy=" << 100.0 * busy / duration << "%\n";
+    }
+    std::cout << "Completed " << served << " deliveries in " << duration << " minutes ("
+              << served * 60.0 / duration << " per hour); " << inService << " still in service\n";
+    if (tripSizes.count() > 0)
+    {
+        std::cout << "Trips: " << trips << ", " << static_cast<double>(served) / (trips ? trips : 1)
+                  << " deliveries per trip; batch size p50=" << tripSizes.percentile(0.50)
+                  << " p90=" << tripSizes.percentile(0.90) << " max=" << tripSizes.getMax() << "\n";
+    }
+    std::cout << "Wait for a counter (minutes):\n";
+    for (int type = URGENT; type <= FRAGILE; ++type)
+    {
+        const LogLinearHistogram &h = waits[type];
+        if (h.count() == 0) continue;
+        std::cout << "  " << names[type] << ": n=" << h.count() << " p50=" << h.percentile(0.50)
+                  << " p90=" << h.percentile(0.90) << " p99=" << h.percentile(0.99) << " max=" << h.getMax() << "\n";
+    }
+    std::cout.flags(flags);
+    std::cout.precision(precision);
+}
+
 Delivery SimulationManager::generateRandomDelivery()
 {
-    std::string id = "D" + std::to_string(rand() % 10000);
-    std::string dest = "Random Destination";
+    std::string id = "D" + std::to_string(nextDeliveryNumber++);
+    std::string dest = "Zone " + std::to_string(rand() % DESTINATION_ZONES + 1);
     DeliveryType type = static_cast<DeliveryType>(rand() % 3);
     int estTime = rand() % 120 + 10; // 10 to 129 minutes
     return Delivery(id, dest, type, estTime);
@@ -8,6 +8,8 @@
 #include "DeliveryManager.h"
 #include "ReportManager.h"
 #include "ConfigurationManager.h"
+#include "EventTracer.h"
+#include "ServiceCounters.h"
 
 class SimulationManager
 {
@@ -15,16 +17,34 @@ private:
     DeliveryManager &deliveryManager;
     ReportManager &reportManager;
     int currentSimTime;
+    EventTracer *tracer; // Optional, not owned
+    uint64_t nextDeliveryNumber; // Seeded from the clock so IDs stay unique across restarts with a recovered queue
+    std::vector<CounterProfile> counterProfiles; // Empty: simulationCounters interchangeable counters at speed 1
+
+    // What one run's counters did, for the end-of-run report
+    struct CounterStats {
+        uint64_t served = 0;
+        uint64_t trips = 0;
+        long long busyMinutes = 0;
+    };
+    void printCounterReport(const CounterPool &pool, const std::vector<CounterStats> &counters,
+                            const LogLinearHistogram (&waits)[3], const LogLinearHistogram &tripSizes,
+                            int inService) const;
 
 public:
     SimulationManager(DeliveryManager &dm, ReportManager &rm) : deliveryManager(dm),
                                                                 reportManager(rm),
-                                                                currentSimTime(0) {}
+                                                                currentSimTime(0),
+                                                                tracer(nullptr),
+                                                                nextDeliveryNumber(static_cast<uint64_t>(time(0)) * 1000) {}
 
     void runSimulation();
     Delivery generateRandomDelivery();
+    void setTracer(EventTracer *t) { tracer = t; } // Tick phases and delivery lifetimes; null turns it off
+    // Heterogeneous counters (see ServiceCounters.h); empty restores the default
+    void setCounterProfiles(const std::vector<CounterProfile> &profiles) { counterProfiles = profiles; }
 
-    int getProcessedDeliveriesCount() const { return deliveryManager.getProcessedDeliveries().size(); }
+    int getProcessedDeliveriesCount() const { return static_cast<int>(deliveryManager.getMetrics().getTotalProcessed()); }
     int getQueueSize() const { return deliveryManager.getTotalQueueSize(); }
 };
 
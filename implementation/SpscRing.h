@@ -0,0 +1,114 @@
+#ifndef SPSC_RING_H
+#define SPSC_RING_H
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+// Bounded lock-free queue between exactly one producer thread and one
+// consumer thread.
+//
+// Capacity is rounded up to a power of two and the indices run freely, so
+// a slot is index & mask. Each side owns one index on its own cache line
+// and keeps a cached copy of the other side's, so it only touches the
+// shared line when the ring looks full (producer) or empty (consumer).
+// push() and pop() wait when they cannot proceed, which is the
+// backpressure: a slow consumer stalls its producer instead of letting the
+// queue grow. Items are moved in and out, so a slot can hold a whole batch.
+template <typename T>
+class SpscRing
+{
+private:
+    static const size_t CACHE_LINE = 64;
+
+    alignas(CACHE_LINE) std::atomic<size_t> head; // Next slot to pop; written by the consumer
+    size_t tailCache;                             // Consumer's last view of tail
+    uint64_t emptyWaits;                          // pop() calls that found nothing to take
+
+    alignas(CACHE_LINE) std::atomic<size_t> tail; // Next slot to push; written by the producer
+    size_t headCache;                             // Producer's last view of head
+    uint64_t fullWaits;                           // push() calls that found the ring full
+
+    alignas(CACHE_LINE) std::atomic<bool> closed;
+    std::vector<T> slots;
+    size_t mask;
+
+    static void backOff(unsigned &spins)
+    {
+        // Spin briefly for a consumer that is about to catch up, then give the
+        // core away (on a single core spinning only delays the other side)
+        if (++spins < 64) return;
+        std::this_thread::yield();
+    }
+
+public:
+    explicit SpscRing(size_t capacity)
+        : head(0), tailCache(0), emptyWaits(0), tail(0), headCache(0), fullWaits(0), closed(false)
+    {
+        size_t size = 2;
+        while (size < capacity) size <<= 1;
+        slots.resize(size);
+        mask = size - 1;
+    }
+    SpscRing(const SpscRing &) = delete;
+    SpscRing &operator=(const SpscRing &) = delete;
+
+    // Producer side
+    bool tryPush(T &item)
+    {
+        size_t t = tail.load(std::memory_order_relaxed);
+        if (t - headCache > mask) {
+            headCache = head.load(std::memory_order_acquire);
+            if (t - headCache > mask) return false;
+        }
+        slots[t & mask] = std::move(item);
+        tail.store(t + 1, std::memory_order_release);
+        return true;
+    }
+
+    void push(T &item)
+    {
+        if (tryPush(item)) return;
+        ++fullWaits;
+        unsigned spins = 0;
+        while (!tryPush(item)) backOff(spins);
+    }
+
+    void close() { closed.store(true, std::memory_order_release); } // No more pushes; pop() drains, then fails
+
+    // Consumer side
+    bool tryPop(T &out)
+    {
+        size_t h = head.load(std::memory_order_relaxed);
+        if (h == tailCache) {
+            tailCache = tail.load(std::memory_order_acquire);
+            if (h == tailCache) return false;
+        }
+        out = std::move(slots[h & mask]);
+        head.store(h + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Waits for an item; false once the ring is closed and drained
+    bool pop(T &out)
+    {
+        if (tryPop(out)) return true;
+        ++emptyWaits;
+        unsigned spins = 0;
+        for (;;) {
+            // closed is read before the last look, so a push made before close() is never missed
+            bool wasClosed = closed.load(std::memory_order_acquire);
+            if (tryPop(out)) return true;
+            if (wasClosed) return false;
+            backOff(spins);
+        }
+    }
+
+    size_t capacity() const { return slots.size(); }
+    uint64_t getFullWaits() const { return fullWaits; }   // Read by the producer, or after both sides are done
+    uint64_t getEmptyWaits() const { return emptyWaits; } // Read by the consumer, or after both sides are done
+};
+
+#endif // SPSC_RING_H
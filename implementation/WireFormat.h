@@ -0,0 +1,100 @@
+#ifndef WIRE_FORMAT_H
+#define WIRE_FORMAT_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include "DeliveryTypes.h"
+
+// Fixed-layout delivery records for bulk ingest.
+//
+// A batch frame is a WireBatchHeader followed by recordCount WireDelivery
+// records; the receiver answers each frame with a WireBatchAck. Every field
+// is little-endian and naturally aligned, so a buffer holding a frame can be
+// read in place through these structs without a decode step. Frame sizes
+// are multiples of 16 bytes, which keeps back-to-back frames aligned.
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "WireFormat.h reads records in place and needs a little-endian host"
+#endif
+
+const uint32_t WIRE_BATCH_MAGIC = 0x42575153; // "SQWB" read as a little-endian u32
+const uint16_t WIRE_BATCH_VERSION = 1;
+const size_t WIRE_FIELD_CHARS = 24;           // id/destination, NUL-padded, not necessarily terminated
+
+struct WireDelivery {
+    char id[WIRE_FIELD_CHARS];
+    char destination[WIRE_FIELD_CHARS];
+    int32_t estimatedDeliveryTime; // Minutes
+    uint8_t deliveryType;          // DeliveryType
+    uint8_t reserved[3];
+    int64_t entryTime;             // Unix seconds; 0 means "when ingested"
+};
+
+struct WireBatchHeader {
+    uint32_t magic;
+    uint16_t version;
+    uint16_t reserved;
+    uint32_t recordCount;
+    uint32_t reserved2;
+};
+
+struct WireBatchAck {
+    uint32_t accepted;
+    uint32_t rejected; // Records that failed isValidWireDelivery()
+};
+
+static_assert(sizeof(WireDelivery) == 64, "WireDelivery layout is part of the wire format");
+static_assert(sizeof(WireBatchHeader) == 16, "WireBatchHeader layout is part of the wire format");
+static_assert(sizeof(WireBatchAck) == 8, "WireBatchAck layout is part of the wire format");
+
+inline size_t wireFrameBytes(uint32_t recordCount)
+{
+    return sizeof(WireBatchHeader) + static_cast<size_t>(recordCount) * sizeof(WireDelivery);
+}
+
+inline void initWireBatchHeader(WireBatchHeader &header, uint32_t recordCount)
+{
+    std::memset(&header, 0, sizeof(header));
+    header.magic = WIRE_BATCH_MAGIC;
+    header.version = WIRE_BATCH_VERSION;
+    header.recordCount = recordCount;
+}
+
+inline bool isWireBatchHeader(const WireBatchHeader &header)
+{
+    return header.magic == WIRE_BATCH_MAGIC && header.version == WIRE_BATCH_VERSION;
+}
+
+// Copies s into a fixed field; longer strings are truncated
+inline void setWireString(char (&field)[WIRE_FIELD_CHARS], const std::string &s)
+{
+    size_t n = s.size() < WIRE_FIELD_CHARS ? s.size() : WIRE_FIELD_CHARS;
+    std::memcpy(field, s.data(), n);
+    std::memset(field + n, 0, WIRE_FIELD_CHARS - n);
+}
+
+inline std::string wireString(const char (&field)[WIRE_FIELD_CHARS])
+{
+    size_t n = 0;
+    while (n < WIRE_FIELD_CHARS && field[n] != '\0') ++n;
+    return std::string(field, n);
+}
+
+inline void encodeWireDelivery(WireDelivery &out, const std::string &id, const std::string &destination,
+                               DeliveryType type, int estimatedDeliveryTime, int64_t entryTime = 0)
+{
+    setWireString(out.id, id);
+    setWireString(out.destination, destination);
+    out.estimatedDeliveryTime = estimatedDeliveryTime;
+    out.deliveryType = static_cast<uint8_t>(type);
+    std::memset(out.reserved, 0, sizeof(out.reserved));
+    out.entryTime = entryTime;
+}
+
+inline bool isValidWireDelivery(const WireDelivery &record)
+{
+    return record.id[0] != '\0' && record.deliveryType <= FRAGILE && record.estimatedDeliveryTime >= 0;
+}
+
+#endif // WIRE_FORMAT_H
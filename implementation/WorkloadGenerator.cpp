@@ -0,0 +1,211 @@
+#include "WorkloadGenerator.h"
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+
+namespace {
+
+// splitmix64 finalizer: a good 64-bit mix of a counter
+inline uint64_t mix64(uint64_t z)
+{
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+    return z ^ (z >> 31);
+}
+
+const uint64_t GOLDEN_GAMMA = 0x9E3779B97F4A7C15ULL;
+const int DRAWS_PER_RECORD = 2; // Destination; type (low 32 bits) and estimate (high 16 bits)
+const double TWO_PI = 6.283185307179586;
+const int ESTIMATE_TABLE_SIZE = 65536;
+
+} // namespace
+
+WorkloadGenerator::WorkloadGenerator(const WorkloadOptions &workloadOptions)
+    : options(workloadOptions), attributeSeed(mix64(workloadOptions.seed)),
+      state(mix64(workloadOptions.seed ^ GOLDEN_GAMMA) | 1), sequence(workloadOptions.firstSequence), generated(0),
+      clock(0.0), rate(0.0), rateUntil(-1.0)
+{
+    if (options.startTime == 0) options.startTime = static_cast<int64_t>(time(0));
+    if (options.destinationCount == 0) options.destinationCount = 1;
+    if (options.estimateMax < 1) options.estimateMax = 1;
+    if (options.estimateMax > 65535) options.estimateMax = 65535;
+    if (!(options.arrivalRate > 0.0)) options.arrivalRate = 1.0;
+    if (!(options.burstPeriod > 0.0)) options.burstPeriod = 60.0;
+
+    double totalWeight = 0.0;
+    for (int t = 0; t < 3; ++t) {
+        if (options.typeWeights[t] < 0.0) options.typeWeights[t] = 0.0;
+        totalWeight += options.typeWeights[t];
+    }
+    if (totalWeight <= 0.0) {
+        options.typeWeights[STANDARD] = 1.0;
+        totalWeight = 1.0;
+    }
+    typeThreshold[0] = options.typeWeights[0] / totalWeight;
+    typeThreshold[1] = typeThreshold[0] + options.typeWeights[1] / totalWeight;
+
+    // IDs are prefix + up to 20 digits, so the prefix keeps at most 4 of the 24 characters
+    idPrefixLength = options.idPrefix.size() < 4 ? options.idPrefix.size() : 4;
+    std::memcpy(idPrefix, options.idPrefix.data(), idPrefixLength);
+
+    destinationNames.assign(static_cast<size_t>(options.destinationCount) * WIRE_FIELD_CHARS, '\0');
+    for (uint32_t i = 0; i < options.destinationCount; ++i) {
+        std::snprintf(&destinationNames[static_cast<size_t>(i) * WIRE_FIELD_CHARS], WIRE_FIELD_CHARS, "DEST-%06u", i);
+    }
+    buildAliasTable();
+    buildEstimateTable();
+}
+
+void WorkloadGenerator::buildAliasTable()
+{
+    // Vose's alias method: every slot holds at most two outcomes, so a draw
+    // is one random number regardless of how skewed the weights are
+    uint32_t n = options.destinationCount;
+    std::vector<double> scaled(n);
+    double total = 0.0;
+    for (uint32_t i = 0; i < n; ++i) {
+        scaled[i] = 1.0 / std::pow(static_cast<double>(i + 1), options.zipfExponent);
+        total += scaled[i];
+    }
+    std::vector<uint32_t> small, large;
+    for (uint32_t i = 0; i < n; ++i) {
+        scaled[i] *= n / total;
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+    }
+    aliasTable.resize(n);
+    for (uint32_t i = 0; i < n; ++i) aliasTable[i] = AliasSlot{0xFFFFFFFFu, i};
+    while (!small.empty() && !large.empty()) {
+        uint32_t s = small.back();
+        uint32_t l = large.back();
+        small.pop_back();
+        aliasTable[s] = AliasSlot{static_cast<uint32_t>(scaled[s] * 4294967295.0), l};
+        scaled[l] -= 1.0 - scaled[s];
+        if (scaled[l] < 1.0) {
+            large.pop_back();
+            small.push_back(l);
+        }
+    }
+    // Whatever is left is 1 up to rounding and keeps its own slot
+}
+
+double WorkloadGenerator::estimateCdf(double minutes) const
+{
+    switch (options.estimate) {
+    case ESTIMATE_EXPONENTIAL:
+        return options.estimateA > 0.0 ? 1.0 - std::exp(-minutes / options.estimateA) : 1.0;
+    case ESTIMATE_LOGNORMAL:
+        if (options.estimateB <= 0.0) return minutes >= std::exp(options.estimateA) ? 1.0 : 0.0;
+        return 0.5 * std::erfc(-(std::log(minutes) - options.estimateA) / (options.estimateB * std::sqrt(2.0)));
+    default: {
+        // Whole minutes a..b, each equally likely
+        double width = options.estimateB - options.estimateA + 1.0;
+        if (width <= 0.0) return minutes > options.estimateA ? 1.0 : 0.0;
+        double p = (minutes - options.estimateA) / width;
+        return p < 0.0 ? 0.0 : p > 1.0 ? 1.0 : p;
+    }
+    }
+}
+
+void WorkloadGenerator::buildEstimateTable()
+{
+    // An estimate is the continuous value rounded down and clamped to
+    // 1..estimateMax, so P(estimate <= m) = CDF(m + 1) below the cap.
+    // Entry i holds the estimate at quantile (i + 0.5) / size.
+    estimateTable.resize(ESTIMATE_TABLE_SIZE);
+    int minutes = 1;
+    double below = estimateCdf(minutes + 1.0);
+    for (int i = 0; i < ESTIMATE_TABLE_SIZE; ++i) {
+        double u = (i + 0.5) / ESTIMATE_TABLE_SIZE;
+        while (minutes < options.estimateMax && below <= u) {
+            ++minutes;
+            below = estimateCdf(minutes + 1.0);
+        }
+        estimateTable[i] = static_cast<uint16_t>(minutes);
+    }
+}
+
+double WorkloadGenerator::nextGap()
+{
+    if (options.arrival == ARRIVAL_CONSTANT) return 1.0 / options.arrivalRate;
+    if (clock >= rateUntil) {
+        // The rate is piecewise constant, so the trigonometry runs per window, not per record
+        rate = options.arrivalRate;
+        if (options.arrival == ARRIVAL_BURSTY) {
+            double periodStart = std::floor(clock / options.burstPeriod) * options.burstPeriod;
+            double burstEnd = periodStart + options.burstDuty * options.burstPeriod;
+            if (clock < burstEnd) {
+                rate *= options.burstFactor;
+                rateUntil = burstEnd;
+            } else {
+                rateUntil = periodStart + options.burstPeriod;
+            }
+        } else if (options.arrival == ARRIVAL_DIURNAL) {
+            rate *= 1.0 + options.diurnalAmplitude * std::sin(TWO_PI * clock / 86400.0);
+            if (rate < options.arrivalRate * 0.01) rate = options.arrivalRate * 0.01;
+            rateUntil = clock + 1.0; // One-second steps of a 24 h curve
+        } else {
+            rateUntil = 1e300;
+        }
+    }
+    return -std::log(1.0 - toUnit(nextRandom())) / rate;
+}
+
+void WorkloadGenerator::fillAttributes(WireDelivery *out, size_t count, uint64_t first) const
+{
+    // The ID is prefix + decimal sequence number, formatted once and then
+    // incremented in place
+    char id[WIRE_FIELD_CHARS];
+    std::memset(id, 0, sizeof(id));
+    std::memcpy(id, idPrefix, idPrefixLength);
+    int length = std::snprintf(id + idPrefixLength, sizeof(id) - idPrefixLength, "%llu",
+                               static_cast<unsigned long long>(first));
+    size_t end = idPrefixLength + length;
+
+    uint64_t typeLimit[2] = {static_cast<uint64_t>(typeThreshold[0] * 4294967296.0),
+                             static_cast<uint64_t>(typeThreshold[1] * 4294967296.0)};
+    for (size_t i = 0; i < count; ++i) {
+        WireDelivery &record = out[i];
+        std::memcpy(record.id, id, WIRE_FIELD_CHARS);
+
+        uint64_t counter = attributeSeed + (first + i) * DRAWS_PER_RECORD * GOLDEN_GAMMA;
+        uint64_t r = mix64(counter + GOLDEN_GAMMA);
+        uint32_t slot = static_cast<uint32_t>(((r >> 32) * options.destinationCount) >> 32);
+        const AliasSlot &entry = aliasTable[slot];
+        uint32_t destination = static_cast<uint32_t>(r) < entry.threshold ? slot : entry.alias;
+        std::memcpy(record.destination, &destinationNames[static_cast<size_t>(destination) * WIRE_FIELD_CHARS],
+                    WIRE_FIELD_CHARS);
+
+        r = mix64(counter + 2 * GOLDEN_GAMMA);
+        uint64_t typeBits = r & 0xFFFFFFFFu;
+        record.deliveryType = static_cast<uint8_t>(typeBits < typeLimit[0] ? URGENT : typeBits < typeLimit[1] ? STANDARD : FRAGILE);
+        record.estimatedDeliveryTime = estimateTable[r >> 48];
+        std::memset(record.reserved, 0, sizeof(record.reserved));
+
+        size_t pos = end;
+        while (pos > idPrefixLength && id[pos - 1] == '9') id[--pos] = '0';
+        if (pos > idPrefixLength) {
+            ++id[pos - 1];
+        } else if (end < WIRE_FIELD_CHARS) {
+            // 99 -> 100: shift in a leading 1
+            std::memmove(id + idPrefixLength + 1, id + idPrefixLength, end - idPrefixLength);
+            id[idPrefixLength] = '1';
+            ++end;
+        }
+    }
+}
+
+void WorkloadGenerator::fillArrivals(WireDelivery *out, size_t count)
+{
+    for (size_t i = 0; i < count; ++i) {
+        clock += nextGap();
+        out[i].entryTime = options.startTime + static_cast<int64_t>(clock);
+    }
+    generated += count;
+}
+
+void WorkloadGenerator::fill(WireDelivery *out, size_t count)
+{
+    fillAttributes(out, count, sequence);
+    sequence += count;
+    fillArrivals(out, count);
+}
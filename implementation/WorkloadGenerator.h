@@ -0,0 +1,106 @@
+#ifndef WORKLOAD_GENERATOR_H
+#define WORKLOAD_GENERATOR_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include "WireFormat.h"
+
+enum EstimateDistribution {
+    ESTIMATE_UNIFORM,     // a..b minutes
+    ESTIMATE_EXPONENTIAL, // mean a minutes
+    ESTIMATE_LOGNORMAL    // exp(N(a, b)) minutes
+};
+
+enum ArrivalPattern {
+    ARRIVAL_CONSTANT, // Exactly arrivalRate per second
+    ARRIVAL_POISSON,  // Exponential gaps around arrivalRate
+    ARRIVAL_BURSTY,   // Poisson, burstFactor times faster for burstDuty of every burstPeriod
+    ARRIVAL_DIURNAL   // Poisson, rate swinging by diurnalAmplitude over a 24 h sine
+};
+
+struct WorkloadOptions {
+    uint64_t seed = 1;
+    std::string idPrefix = "W";         // Up to 4 characters; IDs are prefix + sequence number
+    uint64_t firstSequence = 0;
+    double typeWeights[3] = {0.2, 0.5, 0.3}; // Indexed by DeliveryType; need not sum to 1
+    uint32_t destinationCount = 1000;   // "DEST-<rank>", rank 0 the most popular
+    double zipfExponent = 1.0;          // 0 makes destinations uniform
+    EstimateDistribution estimate = ESTIMATE_UNIFORM;
+    double estimateA = 10.0;
+    double estimateB = 130.0;
+    int estimateMax = 1440;             // Estimates are clamped to 1..estimateMax (at most 65535) minutes
+    ArrivalPattern arrival = ARRIVAL_POISSON;
+    double arrivalRate = 100.0;         // Mean arrivals per second
+    double burstFactor = 10.0;
+    double burstPeriod = 60.0;          // Seconds
+    double burstDuty = 0.1;
+    double diurnalAmplitude = 0.8;      // 0..1
+    int64_t startTime = 0;              // Unix seconds of the first arrival; 0 = now
+};
+
+// Deterministic synthetic delivery stream written straight into WireDelivery
+// records (see WireFormat.h).
+//
+// Everything per record is O(1) with no transcendental math: destinations
+// come from a Vose alias table over the Zipf weights, names are pre-rendered,
+// estimates are read from a 65536-entry quantile table of the chosen
+// distribution (whole minutes, so the table is exact to 1/65536), and IDs
+// are decimal counters. A record's attributes depend only on the seed and
+// its sequence number (counter-based splitmix64, two draws per record), so
+// fillAttributes() can run on any number of threads over disjoint ranges.
+// Arrival times form one sequential process in fillArrivals(). The same
+// options always produce the same stream, however it is split up.
+class WorkloadGenerator {
+private:
+    WorkloadOptions options;
+    uint64_t attributeSeed;
+    uint64_t state;          // xorshift64* for arrival gaps
+    uint64_t sequence;       // Next sequence number fill() uses
+    uint64_t generated;      // Records given arrival times
+    double clock;            // Seconds since startTime
+    double rate;             // Current arrival rate, recomputed once it expires...
+    double rateUntil;        // ...at this clock value
+    double typeThreshold[2]; // Cumulative type weights, scaled to [0, 1)
+    struct AliasSlot {
+        uint32_t threshold; // Keep this slot when the low 32 random bits are below it...
+        uint32_t alias;     // ...otherwise take this one
+    };
+    std::vector<AliasSlot> aliasTable;
+    std::vector<uint16_t> estimateTable; // Minutes at each 1/65536 quantile
+    std::vector<char> destinationNames; // destinationCount fields of WIRE_FIELD_CHARS
+    char idPrefix[WIRE_FIELD_CHARS];
+    size_t idPrefixLength;
+
+    uint64_t nextRandom()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+    static double toUnit(uint64_t r) { return (r >> 11) * (1.0 / 9007199254740992.0); } // [0, 1)
+
+    void buildAliasTable();
+    void buildEstimateTable();
+    double estimateCdf(double minutes) const;
+    double nextGap();
+
+public:
+    explicit WorkloadGenerator(const WorkloadOptions &options);
+
+    // Next count records of the stream
+    void fill(WireDelivery *out, size_t count);
+
+    // The two halves of fill(), for parallel generation: IDs, destinations,
+    // types and estimates for sequence numbers first.. (thread-safe), then
+    // entryTime for the next count records in stream order
+    void fillAttributes(WireDelivery *out, size_t count, uint64_t first) const;
+    void fillArrivals(WireDelivery *out, size_t count);
+
+    uint64_t getGenerated() const { return generated; }
+    double getElapsedSeconds() const { return clock; } // Simulated arrival clock
+    const WorkloadOptions &getOptions() const { return options; }
+};
+
+#endif // WORKLOAD_GENERATOR_H
@@ -0,0 +1,295 @@
+#include "WriteAheadLog.h"
+#include "BinaryIO.h"
+#include "Delivery.h"
+#include <filesystem>
+#include <system_error>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+namespace {
+
+const size_t FRAME_HEADER_BYTES = 8;
+const uint32_t MAX_RECORD_BYTES = 1 << 20;
+
+void storeU32(char *out, uint32_t v)
+{
+    for (int i = 0; i < 4; ++i) out[i] = static_cast<char>(v >> (8 * i));
+}
+
+bool decodeRecord(const unsigned char *payload, uint32_t length, WalRecord &record)
+{
+    ByteReader in(payload, length);
+    record.type = static_cast<WalRecordType>(in.u8());
+    record.lsn = in.u64();
+    switch (record.type) {
+    case WAL_ADD:
+        record.deliveryType = static_cast<DeliveryType>(in.u8());
+        record.estimatedDeliveryTime = in.i32();
+        record.priorityScore = in.f64();
+        record.entryTime = static_cast<time_t>(in.i64());
+        record.deliveryId = in.view16();
+        record.destination = in.view16();
+        break;
+    case WAL_DISPATCH:
+        record.entryTime = static_cast<time_t>(in.i64());
+        record.serviceStartTime = static_cast<time_t>(in.i64());
+        record.serviceEndTime = static_cast<time_t>(in.i64());
+        record.deliveryId = in.view16();
+        break;
+    case WAL_CANCEL:
+        record.entryTime = static_cast<time_t>(in.i64());
+        record.deliveryId = in.view16();
+        break;
+    case WAL_CONFIG:
+        record.configValue = in.f64();
+        record.configKey = in.view16();
+        break;
+    case WAL_CHECKPOINT:
+        break;
+    case WAL_METRICS:
+        for (int t = 0; t < 3; ++t) {
+            TypeTotals &type = record.totals.perType[t];
+            type.arrivals = in.u64();
+            type.processed = in.u64();
+            type.cancelled = in.u64();
+            type.dispatchedMinutes = in.u64();
+            type.deadlineMisses = in.u64();
+            type.deadlineDrops = in.u64();
+        }
+        record.totals.firstDispatch = static_cast<time_t>(in.i64());
+        record.totals.lastDispatch = static_cast<time_t>(in.i64());
+        break;
+    default:
+        return false;
+    }
+    return in.ok();
+}
+
+} // namespace
+
+bool WriteAheadLog::open(const std::string &logPath, const WalOptions &walOptions, uint64_t validBytes, uint64_t lastLsn)
+{
+    close();
+    path = logPath;
+    options = walOptions;
+    nextLsn = lastLsn + 1;
+
+    // Cut off a torn tail so new records follow the last intact one
+    std::error_code ec;
+    if (std::filesystem::exists(path, ec) && std::filesystem::file_size(path, ec) > validBytes) {
+        std::filesystem::resize_file(path, validBytes, ec);
+        if (ec) return false;
+    }
+
+    file = std::fopen(path.c_str(), "ab");
+    if (!file) return false;
+    // Records are already grouped in pending; without a stdio buffer a failed
+    // write leaves nothing behind that a later flush could append past the cut
+    std::setvbuf(file, nullptr, _IONBF, 0);
+    fileBytes = validBytes;
+    compactedBytes = validBytes;
+    writeFailed = false;
+    pending.reserve(options.groupCommitBytes + 4096);
+    return true;
+}
+
+void WriteAheadLog::close()
+{
+    if (!file) return;
+    flush(true);
+    std::fclose(file);
+    file = nullptr;
+}
+
+void WriteAheadLog::beginRecord(WalRecordType type)
+{
+    if (pending.empty()) oldestPending = std::chrono::steady_clock::now();
+    pending.resize(pending.size() + FRAME_HEADER_BYTES); // length + CRC, filled in by endRecord
+    putU8(pending, type);
+    putU64(pending, nextLsn++);
+}
+
+void WriteAheadLog::endRecord(size_t frameStart)
+{
+    const char *payload = pending.data() + frameStart + FRAME_HEADER_BYTES;
+    uint32_t length = static_cast<uint32_t>(pending.size() - frameStart - FRAME_HEADER_BYTES);
+    storeU32(pending.data() + frameStart, length);
+    storeU32(pending.data() + frameStart + 4, crc32(payload, length));
+
+    ++pendingRecords;
+    if (pending.size() >= options.groupCommitBytes || pendingRecords >= options.groupCommitRecords ||
+        (options.groupCommitMillis > 0 &&
+         std::chrono::steady_clock::now() - oldestPending >= std::chrono::milliseconds(options.groupCommitMillis))) {
+        flush(false);
+    }
+}
+
+void WriteAheadLog::logAdd(const Delivery &delivery)
+{
+    if (!file) return;
+    size_t frameStart = pending.size();
+    beginRecord(WAL_ADD);
+    putU8(pending, static_cast<uint8_t>(delivery.deliveryType));
+    putI32(pending, delivery.estimatedDeliveryTime);
+    putF64(pending, delivery.priorityScore);
+    putI64(pending, delivery.entryTime);
+    putString16(pending, delivery.deliveryId);
+    putString16(pending, delivery.destination);
+    endRecord(frameStart);
+}
+
+void WriteAheadLog::logDispatch(const Delivery &delivery)
+{
+    if (!file) return;
+    size_t frameStart = pending.size();
+    beginRecord(WAL_DISPATCH);
+    putI64(pending, delivery.entryTime);
+    putI64(pending, delivery.serviceStartTime);
+    putI64(pending, delivery.serviceEndTime);
+    putString16(pending, delivery.deliveryId);
+    endRecord(frameStart);
+}
+
+void WriteAheadLog::logCancel(const Delivery &delivery)
+{
+    if (!file) return;
+    size_t frameStart = pending.size();
+    beginRecord(WAL_CANCEL);
+    putI64(pending, delivery.entryTime);
+    putString16(pending, delivery.deliveryId);
+    endRecord(frameStart);
+}
+
+void WriteAheadLog::logConfig(const std::string &key, double value)
+{
+    if (!file) return;
+    size_t frameStart = pending.size();
+    beginRecord(WAL_CONFIG);
+    putF64(pending, value);
+    putString16(pending, key);
+    endRecord(frameStart);
+}
+
+void WriteAheadLog::logCheckpoint()
+{
+    if (!file) return;
+    size_t frameStart = pending.size();
+    beginRecord(WAL_CHECKPOINT);
+    endRecord(frameStart);
+}
+
+void WriteAheadLog::logMetrics(const MetricsTotals &totals)
+{
+    if (!file) return;
+    size_t frameStart = pending.size();
+    beginRecord(WAL_METRICS);
+    for (const TypeTotals &type : totals.perType) {
+        putU64(pending, type.arrivals);
+        putU64(pending, type.processed);
+        putU64(pending, type.cancelled);
+        putU64(pending, type.dispatchedMinutes);
+        putU64(pending, type.deadlineMisses);
+        putU64(pending, type.deadlineDrops);
+    }
+    putI64(pending, totals.firstDispatch);
+    putI64(pending, totals.lastDispatch);
+    endRecord(frameStart);
+}
+
+bool WriteAheadLog::flush(bool sync)
+{
+    if (!file) return false;
+    if (!pending.empty()) {
+        if (commitHook) commitHook(commitHookContext);
+        size_t written = std::fwrite(pending.data(), 1, pending.size(), file);
+        if (std::fflush(file) != 0 || written != pending.size()) {
+            // Drop the partial group so a retry appends whole frames after the last commit
+            std::clearerr(file);
+            std::error_code ec;
+            std::filesystem::resize_file(path, fileBytes, ec);
+            writeFailed = true;
+            return false;
+        }
+        fileBytes += pending.size();
+        pending.clear();
+        pendingRecords = 0;
+        ++flushesSinceSync;
+    }
+
+    if (sync || (options.fsyncEveryFlushes > 0 && flushesSinceSync >= options.fsyncEveryFlushes)) {
+        if (flushesSinceSync > 0) {
+#ifdef _WIN32
+            int synced = _commit(_fileno(file));
+#else
+            int synced = fsync(fileno(file));
+#endif
+            if (synced != 0) {
+                writeFailed = true;
+                return false;
+            }
+        }
+        flushesSinceSync = 0;
+    }
+    writeFailed = false;
+    return true;
+}
+
+bool WriteAheadLog::replay(const std::string &logPath, const std::function<void(const WalRecord &)> &apply,
+                           uint64_t &validBytes, uint64_t &lastLsn)
+{
+    validBytes = 0;
+    lastLsn = 0;
+    std::FILE *in = std::fopen(logPath.c_str(), "rb");
+    if (!in) {
+        std::error_code ec;
+        return !std::filesystem::exists(logPath, ec); // A missing log is an empty log
+    }
+
+    std::vector<unsigned char> buffer(4 << 20);
+    size_t begin = 0, end = 0;
+    bool eof = false;
+    WalRecord record;
+
+    while (true) {
+        // Make sure a whole frame is buffered, refilling as needed
+        size_t available = end - begin;
+        uint32_t length = 0;
+        if (available >= FRAME_HEADER_BYTES) {
+            ByteReader header(buffer.data() + begin, FRAME_HEADER_BYTES);
+            length = header.u32();
+            if (length == 0 || length > MAX_RECORD_BYTES) break; // Corrupt tail
+        }
+        size_t needed = available >= FRAME_HEADER_BYTES ? FRAME_HEADER_BYTES + length : FRAME_HEADER_BYTES;
+        if (available < needed) {
+            if (eof) break; // Torn tail
+            if (begin > 0) {
+                std::copy(buffer.begin() + begin, buffer.begin() + end, buffer.begin());
+                end -= begin;
+                begin = 0;
+            }
+            if (buffer.size() < needed) buffer.resize(needed);
+            size_t got = std::fread(buffer.data() + end, 1, buffer.size() - end, in);
+            end += got;
+            if (got == 0) eof = true;
+            continue;
+        }
+
+        ByteReader header(buffer.data() + begin, FRAME_HEADER_BYTES);
+        header.u32();
+        uint32_t checksum = header.u32();
+        const unsigned char *payload = buffer.data() + begin + FRAME_HEADER_BYTES;
+        if (crc32(payload, length) != checksum || !decodeRecord(payload, length, record)) break;
+
+        apply(record);
+        lastLsn = record.lsn;
+        begin += FRAME_HEADER_BYTES + length;
+        validBytes += FRAME_HEADER_BYTES + length;
+    }
+
+    std::fclose(in);
+    return true;
+}
@@ -0,0 +1,125 @@
+#ifndef WRITE_AHEAD_LOG_H
+#define WRITE_AHEAD_LOG_H
+
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <ctime>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+#include "DeliveryMetrics.h"
+#include "DeliveryTypes.h"
+
+class Delivery;
+
+enum WalRecordType : uint8_t {
+    WAL_ADD = 1,
+    WAL_DISPATCH = 2,
+    WAL_CANCEL = 3,
+    WAL_CONFIG = 4,
+    WAL_CHECKPOINT = 5,
+    WAL_METRICS = 6
+};
+
+// Called at the start of every group commit that writes records
+typedef void (*WalCommitHook)(void *context);
+
+struct WalOptions {
+    size_t groupCommitBytes = 64 * 1024; // Flush once this many bytes are pending...
+    int groupCommitRecords = 512;        // ...or this many records, whichever comes first,
+    int groupCommitMillis = 200;         // ...or on the first append once the oldest pending record is this old (0 = off)
+    int fsyncEveryFlushes = 1;           // fsync after every Nth flush (0 = leave it to the OS)
+    uint64_t checkpointBytes = 256ull * 1024 * 1024; // Compact past this size, or twice the last compacted size (0 = manual only)
+};
+
+// One decoded log record. Only the fields used by its type are meaningful;
+// the string views point into the replay buffer and are valid during the callback only.
+struct WalRecord {
+    WalRecordType type = WAL_CHECKPOINT;
+    uint64_t lsn = 0;
+    std::string_view deliveryId;
+    std::string_view destination;
+    DeliveryType deliveryType = STANDARD;
+    int estimatedDeliveryTime = 0;
+    double priorityScore = 0.0;
+    time_t entryTime = 0;
+    time_t serviceStartTime = 0;
+    time_t serviceEndTime = 0;
+    std::string_view configKey;
+    double configValue = 0.0;
+    MetricsTotals totals;
+};
+
+// Append-only, checksummed log of queue events.
+//
+// Each record is framed as [u32 payload length][u32 CRC-32 of payload][payload].
+// Appends are buffered and written as one group commit when the batch limits
+// in WalOptions are reached (or on flush()), so a crash can lose at most the
+// last unflushed group; a torn or corrupt tail is detected by the checksum and
+// cut off during replay. The age limit is only checked on append, so an idle
+// owner calls flush() (DeliveryManager::syncLog) from its own timer or loop.
+class WriteAheadLog {
+private:
+    std::string path;
+    WalOptions options;
+    std::FILE *file;
+    std::vector<char> pending;
+    int pendingRecords;
+    int flushesSinceSync;
+    uint64_t nextLsn;
+    uint64_t fileBytes;
+    uint64_t compactedBytes; // Log size when opened, i.e. right after the last compaction
+    bool writeFailed;
+    std::chrono::steady_clock::time_point oldestPending;
+    WalCommitHook commitHook;
+    void *commitHookContext;
+
+    void beginRecord(WalRecordType type);
+    void endRecord(size_t frameStart);
+
+public:
+    WriteAheadLog() : file(nullptr), pendingRecords(0), flushesSinceSync(0), nextLsn(1), fileBytes(0), compactedBytes(0), writeFailed(false), commitHook(nullptr), commitHookContext(nullptr) {}
+    ~WriteAheadLog() { close(); }
+    WriteAheadLog(const WriteAheadLog &) = delete;
+    WriteAheadLog &operator=(const WriteAheadLog &) = delete;
+
+    // Opens the log for appending; validBytes/lastLsn come from a prior replay()
+    bool open(const std::string &logPath, const WalOptions &walOptions, uint64_t validBytes, uint64_t lastLsn);
+    void close();
+    bool isOpen() const { return file != nullptr; }
+    // Lets the owner make side files durable before the records that refer to them
+    void setCommitHook(WalCommitHook hook, void *context)
+    {
+        commitHook = hook;
+        commitHookContext = context;
+    }
+
+    void logAdd(const Delivery &delivery);
+    void logDispatch(const Delivery &delivery);
+    void logCancel(const Delivery &delivery);
+    void logConfig(const std::string &key, double value);
+    void logCheckpoint();
+    void logMetrics(const MetricsTotals &totals);
+
+    // Group commit of everything pending. Returns false if the write or fsync
+    // failed; the records stay pending and the file is cut back to the last commit.
+    bool flush(bool sync);
+    bool hasFailed() const { return writeFailed; }
+    bool needsCheckpoint() const
+    {
+        return options.checkpointBytes > 0 && fileBytes >= std::max(options.checkpointBytes, 2 * compactedBytes);
+    }
+    uint64_t getLastLsn() const { return nextLsn - 1; }
+    const std::string &getPath() const { return path; }
+    const WalOptions &getOptions() const { return options; }
+
+    // Reads every valid record in order. Returns false only if the file exists
+    // but cannot be read; validBytes is the length of the intact prefix.
+    static bool replay(const std::string &logPath, const std::function<void(const WalRecord &)> &apply,
+                       uint64_t &validBytes, uint64_t &lastLsn);
+};
+
+#endif // WRITE_AHEAD_LOG_H
@@ -0,0 +1,207 @@
+#include "BenchHarness.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <iostream>
+#include <thread>
+
+namespace {
+
+typedef std::chrono::steady_clock Clock;
+
+struct Summary {
+    double min, median, mean, max, stddev; // ns per operation
+};
+
+Summary summarize(const BenchResult &r)
+{
+    std::vector<double> ns;
+    for (double s : r.seconds) ns.push_back(s * 1e9 / (r.operations > 0 ? r.operations : 1));
+    std::sort(ns.begin(), ns.end());
+    Summary sum = {0, 0, 0, 0, 0};
+    if (ns.empty()) return sum;
+    sum.min = ns.front();
+    sum.max = ns.back();
+    sum.median = ns.size() % 2 ? ns[ns.size() / 2] : (ns[ns.size() / 2 - 1] + ns[ns.size() / 2]) / 2;
+    for (double v : ns) sum.mean += v;
+    sum.mean /= ns.size();
+    for (double v : ns) sum.stddev += (v - sum.mean) * (v - sum.mean);
+    sum.stddev = std::sqrt(sum.stddev / ns.size());
+    return sum;
+}
+
+void writeNumber(std::ostream &out, double value)
+{
+    char buffer[32];
+    std::snprintf(buffer, sizeof(buffer), "%.3f", value);
+    out << buffer;
+}
+
+} // namespace
+
+BenchRunner::BenchRunner(const BenchOptions &options) : options(options)
+{
+    if (this->options.repetitions < 1) this->options.repetitions = 1;
+    if (this->options.warmup < 0) this->options.warmup = 0;
+    if (!options.counters) return;
+
+    counters.reset(new PerfCounters());
+    if (!counters->open()) {
+        std::cerr << "Performance counters unavailable (" << counters->getUnavailableReason()
+                  << "); reporting wall-clock times only" << std::endl;
+        counters.reset();
+        return;
+    }
+    std::string missing;
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (!counters->available(static_cast<PerfCounterId>(i))) {
+            missing += missing.empty() ? "" : ", ";
+            missing += PerfCounters::name(static_cast<PerfCounterId>(i));
+        }
+    }
+    if (!missing.empty()) {
+        std::cerr << "Some performance counters unavailable (" << missing << "; " << counters->getUnavailableReason()
+                  << ")" << std::endl;
+    }
+}
+
+bool BenchRunner::enabled(const std::string &name) const
+{
+    return options.filter.empty() || name.find(options.filter) != std::string::npos;
+}
+
+std::vector<long long> BenchRunner::sizes() const
+{
+    std::vector<long long> out;
+    for (long long n = 1; n <= options.maxSize; n *= 10) {
+        if (n >= options.minSize) out.push_back(n);
+    }
+    return out;
+}
+
+void BenchRunner::run(const std::string &name, long long size, long long operations, const Step &setup,
+                      const Step &body)
+{
+    if (!enabled(name)) return;
+    BenchResult result = {name, size, 1, operations, {}};
+    result.counted = counters != nullptr;
+    for (int rep = 0; rep < options.warmup + options.repetitions; ++rep) {
+        setup();
+        if (counters) counters->start();
+        Clock::time_point start = Clock::now();
+        body();
+        double seconds = std::chrono::duration<double>(Clock::now() - start).count();
+        if (counters) counters->stop();
+        if (rep < options.warmup) continue;
+        result.seconds.push_back(seconds);
+        for (int i = 0; counters && i < PERF_COUNTER_COUNT; ++i) {
+            result.counterTotals[i] += counters->value(static_cast<PerfCounterId>(i));
+        }
+    }
+    report(result);
+    results.push_back(result);
+}
+
+void BenchRunner::runParallel(const std::string &name, long long size, long long operationsPerThread, int threads,
+                              const ThreadStep &setup, const ThreadStep &body)
+{
+    if (!enabled(name)) return;
+    BenchResult result = {name, size, threads, operationsPerThread * threads, {}};
+    for (int rep = 0; rep < options.warmup + options.repetitions; ++rep) {
+        for (int t = 0; t < threads; ++t) setup(t);
+
+        // Threads are started first and released together, so thread start-up is not timed
+        std::atomic<int> ready(0);
+        std::atomic<bool> go(false);
+        std::vector<Clock::time_point> finished(threads);
+        std::vector<std::thread> workers;
+        for (int t = 0; t < threads; ++t) {
+            workers.emplace_back([&, t]() {
+                ready.fetch_add(1);
+                while (!go.load(std::memory_order_acquire)) std::this_thread::yield();
+                body(t);
+                finished[t] = Clock::now();
+            });
+        }
+        while (ready.load() < threads) std::this_thread::yield();
+        Clock::time_point start = Clock::now();
+        go.store(true, std::memory_order_release);
+        for (std::thread &w : workers) w.join();
+        double seconds = std::chrono::duration<double>(*std::max_element(finished.begin(), finished.end()) - start).count();
+        if (rep >= options.warmup) result.seconds.push_back(seconds);
+    }
+    report(result);
+    results.push_back(result);
+}
+
+void BenchRunner::report(const BenchResult &result) const
+{
+    Summary s = summarize(result);
+    char line[256];
+    std::snprintf(line, sizeof(line), "%-40s %10lld %3d thr %10.1f ns/op (median) %10.1f min %10.1f max %8.1f sd",
+                  result.name.c_str(), result.size, result.threads, s.median, s.min, s.max, s.stddev);
+    std::cerr << line;
+    if (result.counted) {
+        double ops = static_cast<double>(result.operations) * result.seconds.size();
+        const PerfCounterId shown[] = {PERF_INSTRUCTIONS, PERF_L1D_MISSES, PERF_LLC_MISSES, PERF_BRANCH_MISSES,
+                                       PERF_PAGE_FAULTS};
+        const char *labels[] = {"instr", "L1d-miss", "LLC-miss", "br-miss", "faults"};
+        if (counters->available(PERF_CYCLES) && counters->available(PERF_INSTRUCTIONS) && result.counterTotals[PERF_CYCLES] > 0) {
+            std::snprintf(line, sizeof(line), "  IPC %.2f", result.counterTotals[PERF_INSTRUCTIONS] / result.counterTotals[PERF_CYCLES]);
+            std::cerr << line;
+        }
+        for (int i = 0; i < 5; ++i) {
+            if (!counters->available(shown[i])) continue;
+            std::snprintf(line, sizeof(line), "  %s/op %.2f", labels[i], result.counterTotals[shown[i]] / ops);
+            std::cerr << line;
+        }
+    }
+    std::cerr << std::endl; // stderr, so JSON on stdout stays clean
+}
+
+void BenchRunner::writeJson(std::ostream &out) const
+{
+    out << "{\n  \"benchmark\": \"sqs_bench\",\n  \"timestamp\": " << static_cast<long long>(std::time(nullptr))
+        << ",\n  \"warmup\": " << options.warmup << ",\n  \"repetitions\": " << options.repetitions
+        << ",\n  \"results\": [";
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult &r = results[i];
+        Summary s = summarize(r);
+        out << (i > 0 ? ",\n" : "\n") << "    {\"name\": \"" << r.name << "\", \"size\": " << r.size
+            << ", \"threads\": " << r.threads << ", \"operations\": " << r.operations << ", \"ns_per_op\": {\"min\": ";
+        writeNumber(out, s.min);
+        out << ", \"median\": ";
+        writeNumber(out, s.median);
+        out << ", \"mean\": ";
+        writeNumber(out, s.mean);
+        out << ", \"max\": ";
+        writeNumber(out, s.max);
+        out << ", \"stddev\": ";
+        writeNumber(out, s.stddev);
+        out << "}, \"seconds\": [";
+        for (size_t k = 0; k < r.seconds.size(); ++k) {
+            if (k > 0) out << ", ";
+            char buffer[32];
+            std::snprintf(buffer, sizeof(buffer), "%.9f", r.seconds[k]);
+            out << buffer;
+        }
+        out << "]";
+        if (r.counted) {
+            // Per operation; null for counters this machine does not provide
+            double ops = static_cast<double>(r.operations) * r.seconds.size();
+            out << ", \"counters_per_op\": {";
+            for (int c = 0; c < PERF_COUNTER_COUNT; ++c) {
+                PerfCounterId id = static_cast<PerfCounterId>(c);
+                out << (c > 0 ? ", " : "") << "\"" << PerfCounters::name(id) << "\": ";
+                if (counters && counters->available(id)) writeNumber(out, r.counterTotals[c] / ops);
+                else out << "null";
+            }
+            out << "}";
+        }
+        out << "}";
+    }
+    out << "\n  ]\n}\n";
+}
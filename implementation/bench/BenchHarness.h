@@ -0,0 +1,77 @@
+#ifndef BENCH_HARNESS_H
+#define BENCH_HARNESS_H
+
+#include <functional>
+#include <memory>
+#include <ostream>
+#include <string>
+#include <vector>
+#include "PerfCounters.h"
+
+// Minimal timing harness for sqs_bench: untimed setup before every
+// repetition, warm-up repetitions that are discarded, and a summary per
+// case (min/median/mean/max/stddev of ns per operation) as a table and JSON.
+// With counters on, single-threaded cases also report hardware counter
+// values per operation, summed over the measured repetitions.
+
+struct BenchOptions {
+    int warmup = 1;
+    int repetitions = 5;
+    long long minSize = 100;
+    long long maxSize = 1000000;  // Up to 1e7; the largest sizes need a few GB
+    std::vector<int> threads;     // Non-empty: also run the thread-scaling cases
+    std::string filter;           // Only cases whose name contains this
+    std::string jsonPath;         // Empty: no JSON; "-": stdout
+    bool counters = false;        // perf_event_open counters around each measured region
+};
+
+struct BenchResult {
+    std::string name;
+    long long size;
+    int threads;
+    long long operations;         // Per repetition, summed over threads
+    std::vector<double> seconds;  // One per measured repetition
+    bool counted = false;         // counterTotals is filled in
+    double counterTotals[PERF_COUNTER_COUNT] = {};
+};
+
+class BenchRunner {
+public:
+    typedef std::function<void()> Step;
+    typedef std::function<void(int thread)> ThreadStep;
+
+private:
+    BenchOptions options;
+    std::vector<BenchResult> results;
+    std::unique_ptr<PerfCounters> counters; // Null when off or nothing could be opened
+
+    void report(const BenchResult &result) const;
+
+public:
+    explicit BenchRunner(const BenchOptions &options);
+
+    const BenchOptions &getOptions() const { return options; }
+    bool enabled(const std::string &name) const;
+    std::vector<long long> sizes() const; // Powers of ten from minSize to maxSize
+
+    // Times `body` (which performs `operations` operations) after `setup`,
+    // warm-up + repetitions times
+    void run(const std::string &name, long long size, long long operations, const Step &setup, const Step &body);
+
+    // Same, with `threads` threads running body(t) together; the time is
+    // from the common start to the last thread finishing
+    void runParallel(const std::string &name, long long size, long long operationsPerThread, int threads,
+                     const ThreadStep &setup, const ThreadStep &body);
+
+    const std::vector<BenchResult> &getResults() const { return results; }
+    void writeJson(std::ostream &out) const;
+};
+
+// Keeps the compiler from discarding a computed value
+template <typename T>
+inline void doNotOptimize(const T &value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+#endif // BENCH_HARNESS_H
@@ -0,0 +1,133 @@
+#include "PerfCounters.h"
+#include <cerrno>
+#include <cstring>
+
+#ifdef __linux__
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace {
+
+#ifdef __linux__
+struct CounterConfig {
+    uint32_t type;
+    uint64_t config;
+};
+
+uint64_t cacheConfig(uint64_t cache, uint64_t op, uint64_t result)
+{
+    return cache | (op << 8) | (result << 16);
+}
+
+CounterConfig configFor(int id)
+{
+    switch (id) {
+    case PERF_CYCLES: return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES};
+    case PERF_INSTRUCTIONS: return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS};
+    case PERF_L1D_MISSES:
+        return {PERF_TYPE_HW_CACHE,
+                cacheConfig(PERF_COUNT_HW_CACHE_L1D, PERF_COUNT_HW_CACHE_OP_READ, PERF_COUNT_HW_CACHE_RESULT_MISS)};
+    case PERF_LLC_MISSES: return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES};
+    case PERF_BRANCH_MISSES: return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES};
+    default: return {PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS};
+    }
+}
+#endif
+
+} // namespace
+
+PerfCounters::PerfCounters()
+{
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        fds[i] = -1;
+        values[i] = 0;
+    }
+}
+
+PerfCounters::~PerfCounters()
+{
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (fds[i] >= 0) ::close(fds[i]);
+    }
+#endif
+}
+
+const char *PerfCounters::name(PerfCounterId id)
+{
+    switch (id) {
+    case PERF_CYCLES: return "cycles";
+    case PERF_INSTRUCTIONS: return "instructions";
+    case PERF_L1D_MISSES: return "l1d_misses";
+    case PERF_LLC_MISSES: return "llc_misses";
+    case PERF_BRANCH_MISSES: return "branch_misses";
+    default: return "page_faults";
+    }
+}
+
+bool PerfCounters::anyAvailable() const
+{
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (fds[i] >= 0) return true;
+    }
+    return false;
+}
+
+bool PerfCounters::open()
+{
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (fds[i] >= 0) continue;
+        CounterConfig c = configFor(i);
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = c.type;
+        attr.config = c.config;
+        attr.disabled = 1;
+        attr.exclude_kernel = 1; // Allowed at perf_event_paranoid <= 2
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+        fds[i] = static_cast<int>(syscall(SYS_perf_event_open, &attr, 0, -1, -1, 0));
+        if (fds[i] < 0 && unavailableReason.empty()) {
+            // ENOENT: no such event here (common in VMs/containers); EACCES/EPERM: perf_event_paranoid or seccomp
+            unavailableReason = std::string(name(static_cast<PerfCounterId>(i))) + ": " + std::strerror(errno);
+        }
+    }
+    return anyAvailable();
+#else
+    unavailableReason = "perf_event_open needs Linux";
+    return false;
+#endif
+}
+
+void PerfCounters::start()
+{
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (fds[i] < 0) continue;
+        ioctl(fds[i], PERF_EVENT_IOC_RESET, 0);
+        ioctl(fds[i], PERF_EVENT_IOC_ENABLE, 0);
+    }
+#endif
+}
+
+void PerfCounters::stop()
+{
+#ifdef __linux__
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        if (fds[i] >= 0) ioctl(fds[i], PERF_EVENT_IOC_DISABLE, 0);
+    }
+    for (int i = 0; i < PERF_COUNTER_COUNT; ++i) {
+        values[i] = 0;
+        if (fds[i] < 0) continue;
+        uint64_t data[3] = {0, 0, 0}; // value, time enabled, time running
+        if (::read(fds[i], data, sizeof(data)) != static_cast<ssize_t>(sizeof(data))) continue;
+        values[i] = data[2] > 0 && data[2] < data[1] ? static_cast<double>(data[0]) * data[1] / data[2]
+                                                     : static_cast<double>(data[0]);
+    }
+#endif
+}
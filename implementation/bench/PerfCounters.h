@@ -0,0 +1,47 @@
+#ifndef PERF_COUNTERS_H
+#define PERF_COUNTERS_H
+
+#include <cstdint>
+#include <string>
+
+// Hardware counters around a measured region, through perf_event_open
+// (Linux only). Each counter is opened on its own for the calling thread,
+// user space only, so one the CPU or container does not offer just stays
+// unavailable while the rest still count. Values are scaled when the kernel
+// had to multiplex counters.
+
+enum PerfCounterId {
+    PERF_CYCLES,
+    PERF_INSTRUCTIONS,
+    PERF_L1D_MISSES,
+    PERF_LLC_MISSES,
+    PERF_BRANCH_MISSES,
+    PERF_PAGE_FAULTS,      // Software event; usually available even where the others are not
+    PERF_COUNTER_COUNT
+};
+
+class PerfCounters {
+private:
+    int fds[PERF_COUNTER_COUNT];
+    double values[PERF_COUNTER_COUNT];
+    std::string unavailableReason;
+
+public:
+    PerfCounters();
+    ~PerfCounters();
+    PerfCounters(const PerfCounters &) = delete;
+    PerfCounters &operator=(const PerfCounters &) = delete;
+
+    bool open();            // False if no counter at all could be opened
+    void start();           // Reset and enable
+    void stop();            // Disable and read into value()
+
+    bool available(PerfCounterId id) const { return fds[id] >= 0; }
+    bool anyAvailable() const;
+    double value(PerfCounterId id) const { return values[id]; }
+    const std::string &getUnavailableReason() const { return unavailableReason; } // First open() failure
+
+    static const char *name(PerfCounterId id); // JSON key, e.g. "llc_misses"
+};
+
+#endif // PERF_COUNTERS_H
@@ -0,0 +1,164 @@
+// Measures DeliveryPipeline throughput at each pipeline depth.
+//
+//   pipeline_bench [--count 1000000] [--batch 256] [--ring 64] [--depths 1,2,3,4]
+//                  [--dispatch-per-batch BATCH] [--repetitions 3]
+//
+// The records come from WorkloadGenerator and are generated up front, so the
+// ingest stage only copies and decodes them. By default the queue stage
+// dispatches as many deliveries as each batch inserts, which keeps the heaps
+// at a steady size, and drains the rest at the end. The sink encodes every
+// dispatched delivery back into a WireDelivery, standing in for the outbound
+// side of a real dispatcher. Each run uses a fresh DeliveryManager; the best
+// of --repetitions is reported with the stage breakdown of that run.
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../DeliveryPipeline.h"
+#include "../WorkloadGenerator.h"
+
+namespace {
+
+volatile uint64_t outboundChecksum; // Keeps the sink's encoding from being optimised out
+
+struct BenchOptions {
+    size_t count = 1000000;
+    PipelineOptions pipeline;
+    bool dispatchSet = false;
+    std::vector<int> depths = {1, 2, 3, 4};
+    int repetitions = 3;
+};
+
+struct RunResult {
+    double seconds = 0.0;
+    PipelineStageStats stages[STAGE_COUNT];
+    uint64_t dispatched = 0;
+};
+
+RunResult runOnce(const std::vector<WireDelivery> &records, PipelineOptions options)
+{
+    DeliveryManager manager;
+    manager.setVerbose(false);
+    DeliveryPipeline pipeline(manager, options);
+
+    size_t next = 0;
+    pipeline.setSource([&records, &next](WireDelivery *out, size_t max) {
+        size_t n = records.size() - next < max ? records.size() - next : max;
+        std::memcpy(out, records.data() + next, n * sizeof(WireDelivery));
+        next += n;
+        return n;
+    });
+    uint64_t dispatched = 0;
+    uint64_t checksum = 0;
+    std::vector<WireDelivery> outbound;
+    pipeline.setSink([&](std::vector<Delivery> &batch) {
+        outbound.resize(batch.size());
+        for (size_t i = 0; i < batch.size(); ++i) {
+            const Delivery &d = batch[i];
+            encodeWireDelivery(outbound[i], d.deliveryId, d.destination, d.getType(), d.estimatedDeliveryTime,
+                               static_cast<int64_t>(d.getServiceStartTime()));
+            checksum += static_cast<unsigned char>(outbound[i].id[0]);
+        }
+        dispatched += batch.size();
+    });
+    pipeline.run();
+
+    RunResult result;
+    result.seconds = pipeline.getElapsedSeconds();
+    for (int s = 0; s < STAGE_COUNT; ++s) result.stages[s] = pipeline.getStageStats(static_cast<PipelineStage>(s));
+    result.dispatched = dispatched;
+    outboundChecksum = checksum;
+    return result;
+}
+
+bool parseDepths(const std::string &text, std::vector<int> &depths)
+{
+    std::stringstream in(text);
+    std::string part;
+    depths.clear();
+    while (std::getline(in, part, ',')) {
+        int depth = std::atoi(part.c_str());
+        if (depth < 1 || depth > STAGE_COUNT) return false;
+        depths.push_back(depth);
+    }
+    return !depths.empty();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << flag << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (flag == "--count") options.count = static_cast<size_t>(std::atof(value.c_str()));
+        else if (flag == "--batch") options.pipeline.batchSize = static_cast<size_t>(std::atol(value.c_str()));
+        else if (flag == "--ring") options.pipeline.ringBatches = static_cast<size_t>(std::atol(value.c_str()));
+        else if (flag == "--repetitions") options.repetitions = std::atoi(value.c_str());
+        else if (flag == "--dispatch-per-batch") {
+            options.pipeline.dispatchPerBatch = static_cast<size_t>(std::atol(value.c_str()));
+            options.dispatchSet = true;
+        } else if (flag == "--depths") {
+            if (!parseDepths(value, options.depths)) {
+                std::cerr << "Depths are 1 to " << STAGE_COUNT << ", e.g. 1,2,4\n";
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+    if (options.pipeline.batchSize < 1) options.pipeline.batchSize = 1;
+    if (!options.dispatchSet) options.pipeline.dispatchPerBatch = options.pipeline.batchSize;
+    if (options.repetitions < 1) options.repetitions = 1;
+    options.pipeline.drainAtEnd = true;
+
+    ConfigurationManager::initialize();
+    WorkloadOptions workload;
+    workload.arrival = ARRIVAL_CONSTANT;
+    workload.arrivalRate = 1000.0;
+    std::vector<WireDelivery> records(options.count);
+    WorkloadGenerator(workload).fill(records.data(), records.size());
+
+    std::cout << options.count << " deliveries, batches of " << options.pipeline.batchSize << ", rings of "
+              << options.pipeline.ringBatches << " batches, " << options.pipeline.dispatchPerBatch
+              << " dispatched per batch, " << std::thread::hardware_concurrency() << " hardware threads\n";
+    std::cout << "Busy is each stage's share of the run; waits count full output / empty input rings\n";
+    std::cout << std::fixed;
+    std::cout << "depth  Mdeliveries/s";
+    for (int s = 0; s < STAGE_COUNT; ++s) {
+        std::cout << std::setw(20) << DeliveryPipeline::stageName(static_cast<PipelineStage>(s));
+    }
+    std::cout << "\n";
+    for (int depth : options.depths) {
+        PipelineOptions pipelineOptions = options.pipeline;
+        pipelineOptions.depth = depth;
+        RunResult best;
+        for (int r = 0; r < options.repetitions; ++r) {
+            RunResult result = runOnce(records, pipelineOptions);
+            if (r == 0 || result.seconds < best.seconds) best = result;
+        }
+        std::cout << std::setw(5) << depth << std::setw(15) << std::setprecision(3)
+                  << best.dispatched / best.seconds / 1e6;
+        for (int s = 0; s < STAGE_COUNT; ++s) {
+            const PipelineStageStats &stage = best.stages[s];
+            std::ostringstream cell;
+            cell << std::fixed << std::setprecision(0) << 100.0 * stage.busySeconds / best.seconds << "% "
+                 << stage.fullWaits << "/" << stage.emptyWaits;
+            std::cout << std::setw(20) << cell.str();
+        }
+        std::cout << "\n";
+        if (best.dispatched != options.count) std::cout << "  only " << best.dispatched << " deliveries came out\n";
+    }
+    return 0;
+}
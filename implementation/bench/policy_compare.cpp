@@ -0,0 +1,267 @@
+// Compares dispatch policies on identical simulated traffic.
+//
+//   policy_compare [--hours 720] [--counters 20] [--load 0.95] [--seed 1]
+//                  [--policies strict,drr,edf,sjf] [--aging 0.1]
+//                  [--rescore-every 1] [--per-class]
+//                  [--counter-profiles USF*18,U@2*2]
+//
+// A discrete-event simulation in simulated seconds (DeliveryClock): Poisson
+// arrivals from WorkloadGenerator (uniform 10-129 minute estimates, 20/50/30
+// urgent/standard/fragile), --counters counters that each stay busy for a
+// delivery's estimated minutes, and updatePriorities() every --rescore-every
+// simulated minutes as SimulationManager does. --load is the offered counter
+// utilisation. Arrivals stop after --hours and the queue is then drained,
+// so starved deliveries show up in the tail rather than being left out.
+// Every policy sees the same arrival stream. --counter-profiles replaces the
+// --counters identical counters with skilled ones at different speeds (see
+// ServiceCounters.h), routed the way SimulationManager routes them; the
+// offered load is still computed against --counters.
+#include <cmath>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <queue>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "../DeliveryManager.h"
+#include "../ServiceCounters.h"
+#include "../WorkloadGenerator.h"
+
+namespace {
+
+time_t simulatedNow = 0;
+time_t simulatedClock() { return simulatedNow; }
+
+const time_t SIMULATION_EPOCH = 1700000000; // Fixed, so runs are reproducible
+
+struct Policy {
+    const char *name;
+    SchedulerMode mode;
+};
+const Policy POLICIES[] = {
+    {"strict", SCHEDULER_STRICT}, {"drr", SCHEDULER_DRR}, {"edf", SCHEDULER_EDF}, {"sjf", SCHEDULER_SJF}};
+
+struct SimulationOptions {
+    double hours = 720.0;
+    int counters = 20;
+    double load = 0.95;
+    uint64_t seed = 1;
+    double aging = 0.1;
+    int rescoreEvery = 1; // Simulated minutes, 0 = never
+    bool perClass = false;
+    std::string counterProfiles; // Empty: --counters generalists at speed 1
+};
+
+std::vector<WireDelivery> generateArrivals(const SimulationOptions &options)
+{
+    WorkloadOptions workload;
+    workload.seed = options.seed;
+    workload.idPrefix = "P";
+    workload.startTime = SIMULATION_EPOCH;
+    workload.arrival = ARRIVAL_POISSON;
+    workload.estimate = ESTIMATE_UNIFORM;
+    workload.estimateA = 10;
+    workload.estimateB = 129;
+    double meanServiceSeconds = 69.5 * 60.0;
+    workload.arrivalRate = options.load * options.counters / meanServiceSeconds;
+
+    WorkloadGenerator generator(workload);
+    std::vector<WireDelivery> arrivals;
+    time_t end = SIMULATION_EPOCH + static_cast<time_t>(options.hours * 3600.0);
+    WireDelivery record;
+    for (;;) {
+        generator.fill(&record, 1);
+        if (record.entryTime >= end) break;
+        arrivals.push_back(record);
+    }
+    return arrivals;
+}
+
+struct SimulationResult {
+    LogLinearHistogram waits[3]; // Seconds from entry to a counter
+    double waitSum[3] = {0.0, 0.0, 0.0};
+    uint64_t missed[3] = {0, 0, 0}; // Finished after entry + class SLA
+    uint64_t served = 0;
+    double busySeconds = 0.0;
+    double makespanSeconds = 0.0;
+    size_t unserved = 0; // Left queued with no counter able to take them
+};
+
+void simulate(const std::vector<WireDelivery> &arrivals, const Policy &policy, const SimulationOptions &options,
+              const std::vector<CounterProfile> &profiles, SimulationResult &result)
+{
+    DeliveryManager manager;
+    manager.setVerbose(false);
+    ConfigurationManager::applySetting("scheduler_mode", policy.mode);
+    ConfigurationManager::applySetting("sjf_aging", options.aging);
+
+    CounterPool pool(profiles);
+    typedef std::pair<time_t, int> Finish; // Time, counter
+    std::priority_queue<Finish, std::vector<Finish>, std::greater<Finish>> finishing;
+
+    auto start = [&](int counter, const Delivery &delivery) {
+        time_t seconds = static_cast<time_t>(std::ceil(delivery.estimatedDeliveryTime * 60.0 / pool.profile(counter).speed));
+        time_t finish = simulatedNow + seconds;
+        finishing.push(Finish(finish, counter));
+        DeliveryType type = delivery.getType();
+        double waited = std::difftime(simulatedNow, delivery.entryTime);
+        result.waits[type].record(static_cast<uint64_t>(waited));
+        result.waitSum[type] += waited;
+        if (finish > delivery.entryTime + static_cast<time_t>(ConfigurationManager::getSlaMinutes(type)) * 60) {
+            ++result.missed[type];
+        }
+        result.busySeconds += static_cast<double>(seconds);
+        ++result.served;
+    };
+
+    time_t nextRescore = SIMULATION_EPOCH + options.rescoreEvery * 60;
+    size_t next = 0;
+    simulatedNow = SIMULATION_EPOCH;
+    for (;;) {
+        // Next event: an arrival or a counter finishing
+        bool haveEvent = false;
+        time_t eventTime = 0;
+        if (next < arrivals.size()) {
+            eventTime = static_cast<time_t>(arrivals[next].entryTime);
+            haveEvent = true;
+        }
+        if (!finishing.empty() && (!haveEvent || finishing.top().first < eventTime)) {
+            eventTime = finishing.top().first;
+            haveEvent = true;
+        }
+        if (!haveEvent) break;
+        if (eventTime > simulatedNow) simulatedNow = eventTime;
+
+        if (options.rescoreEvery > 0 && simulatedNow >= nextRescore) {
+            manager.updatePriorities();
+            nextRescore = simulatedNow + options.rescoreEvery * 60;
+        }
+        while (!finishing.empty() && finishing.top().first <= simulatedNow) {
+            pool.release(finishing.top().second);
+            finishing.pop();
+        }
+        while (next < arrivals.size() && static_cast<time_t>(arrivals[next].entryTime) <= simulatedNow) {
+            manager.addDeliveries(&arrivals[next++], 1);
+        }
+
+        // Same routing as SimulationManager: the scheduler's order among the
+        // classes an idle counter can take, to the best such counter
+        for (uint8_t skills = pool.idleSkills(); skills && manager.hasDeliveries(skills); skills = pool.idleSkills()) {
+            Delivery delivery = manager.processNextDelivery(skills);
+            start(pool.acquire(manager.getLastDispatchQueue()), delivery);
+        }
+    }
+    result.makespanSeconds = std::difftime(simulatedNow, SIMULATION_EPOCH);
+    result.unserved = static_cast<size_t>(manager.getTotalQueueSize());
+}
+
+void report(const char *name, const SimulationResult &result, int counters, bool perClass)
+{
+    static const char *classNames[3] = {"urgent", "standard", "fragile"};
+    LogLinearHistogram waits;
+    double waitSum = 0.0;
+    uint64_t missed = 0;
+    for (int t = URGENT; t <= FRAGILE; ++t) {
+        waits.merge(result.waits[t]);
+        waitSum += result.waitSum[t];
+        missed += result.missed[t];
+    }
+    auto row = [](const std::string &label, double meanSeconds, const LogLinearHistogram &h, uint64_t missedCount) {
+        double n = h.count() ? static_cast<double>(h.count()) : 1.0;
+        std::cout << std::left << std::setw(16) << label << std::right << std::setw(9) << meanSeconds / n / 60.0
+                  << std::setw(9) << h.percentile(0.50) / 60.0 << std::setw(9) << h.percentile(0.90) / 60.0
+                  << std::setw(9) << h.percentile(0.99) / 60.0 << std::setw(9) << h.getMax() / 60.0
+                  << std::setw(8) << 100.0 * missedCount / n << "%";
+    };
+    double hours = result.makespanSeconds > 0 ? result.makespanSeconds / 3600.0 : 1.0;
+    row(name, waitSum, waits, missed);
+    std::cout << std::setw(9) << result.served / hours << std::setw(8)
+              << 100.0 * result.busySeconds / (result.makespanSeconds * counters + 1e-9) << "%\n";
+    for (int t = URGENT; perClass && t <= FRAGILE; ++t) {
+        row(std::string("  ") + classNames[t], result.waitSum[t], result.waits[t], result.missed[t]);
+        std::cout << "\n";
+    }
+    if (result.unserved > 0) std::cout << "  " << result.unserved << " deliveries left with no counter able to take them\n";
+}
+
+bool parsePolicies(const std::string &text, std::vector<Policy> &policies)
+{
+    std::stringstream in(text);
+    std::string part;
+    policies.clear();
+    while (std::getline(in, part, ',')) {
+        bool known = false;
+        for (const Policy &p : POLICIES) {
+            if (part == p.name) {
+                policies.push_back(p);
+                known = true;
+            }
+        }
+        if (!known) return false;
+    }
+    return !policies.empty();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    SimulationOptions options;
+    std::vector<Policy> policies(std::begin(POLICIES), std::end(POLICIES));
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (flag == "--per-class") {
+            options.perClass = true;
+            continue;
+        }
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << flag << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (flag == "--hours") options.hours = std::atof(value.c_str());
+        else if (flag == "--counters") options.counters = std::atoi(value.c_str());
+        else if (flag == "--load") options.load = std::atof(value.c_str());
+        else if (flag == "--seed") options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (flag == "--aging") options.aging = std::atof(value.c_str());
+        else if (flag == "--rescore-every") options.rescoreEvery = std::atoi(value.c_str());
+        else if (flag == "--counter-profiles") options.counterProfiles = value;
+        else if (flag == "--policies") {
+            if (!parsePolicies(value, policies)) {
+                std::cerr << "Unknown policy in " << value << " (strict, drr, edf, sjf)\n";
+                return 1;
+            }
+        } else {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+    if (options.counters < 1) options.counters = 1;
+    if (options.counters > CounterPool::MAX_COUNTERS) {
+        std::cerr << "--counters is limited to " << CounterPool::MAX_COUNTERS << "\n";
+        return 1;
+    }
+    std::vector<CounterProfile> profiles(options.counters, CounterProfile());
+    if (!options.counterProfiles.empty() && !parseCounterProfiles(options.counterProfiles, profiles)) {
+        std::cerr << "Bad counter profiles " << options.counterProfiles << " (expected e.g. USF*18,U@2*2)\n";
+        return 1;
+    }
+
+    DeliveryClock::setSource(&simulatedClock);
+    std::vector<WireDelivery> arrivals = generateArrivals(options);
+    std::cout << arrivals.size() << " arrivals over " << options.hours << " h, load " << options.load
+              << " of " << options.counters << " counters, SJF aging " << options.aging << "\n";
+    if (!options.counterProfiles.empty()) std::cout << "Counters: " << options.counterProfiles << "\n";
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Waits in minutes      mean      p50      p90      p99      max  SLA miss   done/h    busy\n";
+    for (const Policy &policy : policies) {
+        SimulationResult result;
+        simulate(arrivals, policy, options, profiles, result);
+        report(policy.name, result, static_cast<int>(profiles.size()), options.perClass);
+    }
+    DeliveryClock::setSource(nullptr);
+    return 0;
+}
@@ -0,0 +1,347 @@
+// Microbenchmarks for the heaps, PriorityQueue and DeliveryManager.
+//
+//   sqs_bench [--min-size 100] [--max-size 1000000] [--repetitions 5]
+//             [--warmup 1] [--threads 1,2,4] [--filter NAME] [--json FILE|-]
+//             [--counters on]
+//
+// Sizes run in powers of ten from --min-size to --max-size (1e7 is the
+// intended ceiling and needs roughly 3 GB). Each case builds a structure of
+// the given size untimed, then times a fixed number of operations on it.
+// --threads adds the scaling cases: the engine has no shared concurrent
+// queue, so each thread drives its own instance and the result shows how
+// independent shards scale on this machine.
+// --counters on reads cycles, instructions, L1d/LLC misses, branch misses
+// and page faults around each single-threaded case (see PerfCounters.h).
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <memory>
+#include <sstream>
+#include <string>
+#include <vector>
+#include "BenchHarness.h"
+#include "../DeliveryManager.h"
+#include "../MaxHeap.h"
+#include "../MinHeap.h"
+#include "../PriorityQueue.h"
+
+namespace {
+
+const long long HEAP_OPS = 100000;     // Operations per repetition, capped at the structure size
+const long long MANAGER_OPS = 10000;
+const long long SCALING_SIZE = 100000; // Per-thread structure size in the scaling cases
+
+// xorshift64*: deterministic across runs and platforms, unlike rand()
+class BenchRandom {
+private:
+    uint64_t state;
+
+public:
+    explicit BenchRandom(uint64_t seed) : state(seed ? seed : 1) {}
+    uint64_t next()
+    {
+        state ^= state >> 12;
+        state ^= state << 25;
+        state ^= state >> 27;
+        return state * 2685821657736338717ULL;
+    }
+};
+
+std::vector<Delivery> makeDeliveries(long long count, const std::string &prefix, uint64_t seed)
+{
+    ScoringWeights weights = ScoringWeights::current();
+    time_t now = time(0);
+    BenchRandom random(seed);
+    std::vector<Delivery> out;
+    out.reserve(count);
+    for (long long i = 0; i < count; ++i) {
+        uint64_t r = random.next();
+        Delivery d(prefix + std::to_string(i), "Zone" + std::to_string(r % 64), static_cast<DeliveryType>(r % 3),
+                   static_cast<int>(5 + (r >> 8) % 120));
+        d.entryTime = now - static_cast<time_t>((r >> 16) % 7200); // Spread waiting times over two hours
+        d.calculatePriorityScore(weights, now);
+        out.push_back(std::move(d));
+    }
+    return out;
+}
+
+std::vector<WireDelivery> toWire(const std::vector<Delivery> &deliveries, bool skipUrgent = false)
+{
+    std::vector<WireDelivery> out(deliveries.size());
+    for (size_t i = 0; i < deliveries.size(); ++i) {
+        const Delivery &d = deliveries[i];
+        DeliveryType type = skipUrgent && d.deliveryType == URGENT ? STANDARD : d.deliveryType;
+        encodeWireDelivery(out[i], d.deliveryId, d.destination, type, d.estimatedDeliveryTime, d.entryTime);
+    }
+    return out;
+}
+
+struct MaxHeapOps {
+    typedef MaxHeap<Delivery> Heap;
+    static const char *name() { return "MaxHeap"; }
+    static Delivery extract(Heap &h) { return h.extractMax(); }
+    static Delivery peek(Heap &h) { return h.peekMax(); }
+};
+
+struct MinHeapOps {
+    typedef MinHeap<Delivery> Heap;
+    static const char *name() { return "MinHeap"; }
+    static Delivery extract(Heap &h) { return h.extractMin(); }
+    static Delivery peek(Heap &h) { return h.peekMin(); }
+};
+
+template <typename Ops>
+void benchHeap(BenchRunner &runner, long long size, const std::vector<Delivery> &base, const std::vector<Delivery> &extra)
+{
+    typename Ops::Heap heap;
+    std::vector<Delivery> pending;
+    long long ops = std::min<long long>(size, HEAP_OPS);
+    std::string prefix = Ops::name();
+
+    runner.run(prefix + "/insert", size, ops,
+               [&]() {
+                   heap.buildHeap(base);
+                   pending.assign(extra.begin(), extra.begin() + ops);
+               },
+               [&]() {
+                   for (Delivery &d : pending) heap.insert(std::move(d));
+               });
+    runner.run(prefix + "/extract", size, ops,
+               [&]() { heap.buildHeap(base); },
+               [&]() {
+                   for (long long i = 0; i < ops; ++i) {
+                       Delivery d = Ops::extract(heap);
+                       doNotOptimize(d);
+                   }
+               });
+    runner.run(prefix + "/peek", size, HEAP_OPS,
+               [&]() {
+                   if (heap.size() != size) heap.buildHeap(base);
+               },
+               [&]() {
+                   for (long long i = 0; i < HEAP_OPS; ++i) {
+                       Delivery d = Ops::peek(heap);
+                       doNotOptimize(d);
+                   }
+               });
+}
+
+void benchPriorityQueue(BenchRunner &runner, HeapType backend, long long size, const std::vector<Delivery> &base,
+                        const std::vector<Delivery> &extra)
+{
+    PriorityQueue<Delivery> queue(backend);
+    std::vector<Delivery> pending;
+    long long ops = std::min<long long>(size, HEAP_OPS);
+    std::string prefix = std::string("PriorityQueue/") + (backend == MAX_HEAP ? "MAX_HEAP" : "MIN_HEAP");
+
+    auto fill = [&]() {
+        queue.assign(base);
+        pending.assign(extra.begin(), extra.begin() + ops);
+    };
+    runner.run(prefix + "/enqueue", size, ops, fill, [&]() {
+        for (Delivery &d : pending) queue.enqueue(std::move(d));
+    });
+    runner.run(prefix + "/enqueueBatch", size, ops, fill, [&]() { queue.enqueueBatch(std::move(pending)); });
+    runner.run(prefix + "/dequeue", size, ops, fill, [&]() {
+        for (long long i = 0; i < ops; ++i) {
+            Delivery d = queue.dequeue();
+            doNotOptimize(d);
+        }
+    });
+    runner.run(prefix + "/peek", size, HEAP_OPS, fill, [&]() {
+        for (long long i = 0; i < HEAP_OPS; ++i) {
+            Delivery d = queue.peek();
+            doNotOptimize(d);
+        }
+    });
+}
+
+std::unique_ptr<DeliveryManager> makeManager(const std::vector<WireDelivery> &records)
+{
+    std::unique_ptr<DeliveryManager> manager(new DeliveryManager());
+    manager->setVerbose(false);
+    manager->addDeliveries(records.data(), records.size());
+    return manager;
+}
+
+void benchManager(BenchRunner &runner, long long size, const std::vector<Delivery> &base,
+                  const std::vector<Delivery> &extra)
+{
+    std::vector<WireDelivery> baseWire = toWire(base);
+    std::vector<WireDelivery> extraWire = toWire(extra);
+    std::unique_ptr<DeliveryManager> manager;
+    std::vector<Delivery> pending;
+    long long ops = std::min<long long>(size, MANAGER_OPS);
+
+    runner.run("DeliveryManager/addDelivery", size, ops,
+               [&]() {
+                   manager.reset();
+                   manager = makeManager(baseWire);
+                   pending.assign(extra.begin(), extra.begin() + ops);
+               },
+               [&]() {
+                   for (Delivery &d : pending) manager->addDelivery(d);
+               });
+    runner.run("DeliveryManager/addDeliveries", size, ops,
+               [&]() {
+                   manager.reset();
+                   manager = makeManager(baseWire);
+               },
+               [&]() { manager->addDeliveries(extraWire.data(), ops); });
+    runner.run("DeliveryManager/processNextDelivery", size, ops,
+               [&]() {
+                   manager.reset();
+                   manager = makeManager(baseWire);
+               },
+               [&]() {
+                   for (long long i = 0; i < ops; ++i) {
+                       Delivery d = manager->processNextDelivery();
+                       doNotOptimize(d);
+                   }
+               });
+
+    // Cancel a pseudo-random spread of distinct queued IDs through the index
+    std::vector<size_t> order(base.size());
+    for (size_t i = 0; i < order.size(); ++i) order[i] = i;
+    BenchRandom random(size);
+    std::vector<std::string> cancelIds;
+    for (long long i = 0; i < ops; ++i) {
+        std::swap(order[i], order[i + random.next() % (order.size() - i)]);
+        cancelIds.push_back(base[order[i]].deliveryId);
+    }
+    runner.run("DeliveryManager/cancelDeliveryById", size, ops,
+               [&]() {
+                   manager.reset();
+                   manager = makeManager(baseWire);
+               },
+               [&]() {
+                   for (const std::string &id : cancelIds) manager->cancelDeliveryById(id);
+               });
+
+    // Whole-queue operations: reported per delivery touched
+    runner.run("DeliveryManager/updatePriorities", size, size,
+               [&]() {
+                   if (!manager || manager->getTotalQueueSize() != size) {
+                       manager.reset();
+                       manager = makeManager(baseWire);
+                   }
+               },
+               [&]() { manager->updatePriorities(); });
+    std::vector<WireDelivery> noUrgent = toWire(base, true);
+    runner.run("DeliveryManager/mergeQueues", size, size,
+               [&]() {
+                   manager.reset();
+                   manager = makeManager(noUrgent);
+               },
+               [&]() { manager->mergeQueues(); });
+    manager.reset();
+}
+
+void benchScaling(BenchRunner &runner, const std::vector<int> &threadCounts)
+{
+    long long size = std::min<long long>(SCALING_SIZE, runner.getOptions().maxSize);
+    long long ops = std::min<long long>(size, MANAGER_OPS);
+    int maxThreads = 1;
+    for (int t : threadCounts) maxThreads = std::max(maxThreads, t);
+
+    std::vector<std::vector<Delivery>> base(maxThreads), extra(maxThreads);
+    std::vector<std::vector<WireDelivery>> baseWire(maxThreads);
+    for (int t = 0; t < maxThreads; ++t) {
+        base[t] = makeDeliveries(size, "T" + std::to_string(t) + "-", 1000 + t);
+        extra[t] = makeDeliveries(ops, "X" + std::to_string(t) + "-", 2000 + t);
+        baseWire[t] = toWire(base[t]);
+    }
+
+    std::vector<std::unique_ptr<PriorityQueue<Delivery>>> queues(maxThreads);
+    std::vector<std::vector<Delivery>> pending(maxThreads);
+    std::vector<std::unique_ptr<DeliveryManager>> managers(maxThreads);
+    for (int threads : threadCounts) {
+        if (threads < 1) continue;
+        runner.runParallel("Scaling/PriorityQueue enqueue+dequeue", size, 2 * ops, threads,
+                           [&](int t) {
+                               queues[t].reset(new PriorityQueue<Delivery>(MAX_HEAP));
+                               queues[t]->assign(base[t]);
+                               pending[t].assign(extra[t].begin(), extra[t].end());
+                           },
+                           [&](int t) {
+                               for (Delivery &d : pending[t]) queues[t]->enqueue(std::move(d));
+                               for (long long i = 0; i < ops; ++i) {
+                                   Delivery d = queues[t]->dequeue();
+                                   doNotOptimize(d);
+                               }
+                           });
+        runner.runParallel("Scaling/DeliveryManager add+process", size, 2 * ops, threads,
+                           [&](int t) {
+                               managers[t].reset(); // Constructed here, on one thread: initialisation touches shared settings
+                               managers[t] = makeManager(baseWire[t]);
+                               pending[t].assign(extra[t].begin(), extra[t].end());
+                           },
+                           [&](int t) {
+                               for (Delivery &d : pending[t]) managers[t]->addDelivery(d);
+                               for (long long i = 0; i < ops; ++i) {
+                                   Delivery d = managers[t]->processNextDelivery();
+                                   doNotOptimize(d);
+                               }
+                           });
+    }
+}
+
+std::vector<int> parseThreadList(const std::string &text)
+{
+    std::vector<int> out;
+    std::stringstream in(text);
+    std::string item;
+    while (std::getline(in, item, ',')) {
+        int n = std::atoi(item.c_str());
+        if (n > 0) out.push_back(n);
+    }
+    return out;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    BenchOptions options;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--min-size") options.minSize = static_cast<long long>(std::atof(value.c_str()));
+        else if (flag == "--max-size") options.maxSize = static_cast<long long>(std::atof(value.c_str()));
+        else if (flag == "--repetitions") options.repetitions = std::atoi(value.c_str());
+        else if (flag == "--warmup") options.warmup = std::atoi(value.c_str());
+        else if (flag == "--threads") options.threads = parseThreadList(value);
+        else if (flag == "--filter") options.filter = value;
+        else if (flag == "--json") options.jsonPath = value;
+        else if (flag == "--counters") options.counters = value == "on" || value == "1";
+        else {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+
+    ConfigurationManager::initialize();
+    BenchRunner runner(options);
+    for (long long size : runner.sizes()) {
+        std::vector<Delivery> base = makeDeliveries(size, "B", size);
+        std::vector<Delivery> extra = makeDeliveries(std::min<long long>(size, HEAP_OPS), "E", size + 1);
+        benchHeap<MaxHeapOps>(runner, size, base, extra);
+        benchHeap<MinHeapOps>(runner, size, base, extra);
+        benchPriorityQueue(runner, MAX_HEAP, size, base, extra);
+        benchPriorityQueue(runner, MIN_HEAP, size, base, extra);
+        benchManager(runner, size, base, extra);
+    }
+    if (!options.threads.empty()) benchScaling(runner, options.threads);
+
+    if (options.jsonPath == "-") {
+        runner.writeJson(std::cout);
+    } else if (!options.jsonPath.empty()) {
+        std::ofstream out(options.jsonPath);
+        if (!out) {
+            std::cerr << "Could not write " << options.jsonPath << "\n";
+            return 1;
+        }
+        runner.writeJson(out);
+    }
+    return 0;
+}
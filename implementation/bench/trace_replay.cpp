@@ -0,0 +1,192 @@
+// Replays a captured trace (DeliveryManager::startTraceCapture) into a fresh
+// DeliveryManager and reports throughput and per-operation latency.
+//
+//   trace_replay TRACE [--pace max|original] [--repeat N]
+//
+// The trace is decoded up front, so only the engine is timed. --pace max
+// issues operations back to back; --pace original waits until each one's
+// recorded offset, reproducing the arrival pattern. Entry times keep their
+// recorded offset from the wall clock, so waiting-time scoring sees the same
+// ages it did live. A dispatch that finds every queue empty (possible when
+// scoring changes alter which IDs a later cancel still finds) is skipped and
+// counted. --repeat runs the whole trace N times, each on a new manager.
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../ArrivalTrace.h"
+#include "../DeliveryManager.h"
+#include "../OperationLatency.h"
+
+namespace {
+
+struct ReplayOp {
+    ArrivalTraceEventType type;
+    uint64_t offsetNanos;
+    size_t item; // Index into adds, batches or cancelIds
+};
+
+struct DecodedTrace {
+    std::vector<ReplayOp> ops;
+    std::vector<Delivery> adds;
+    std::vector<std::vector<WireDelivery>> batches;
+    std::vector<std::string> cancelIds;
+    std::vector<int64_t> addEntryOffsets;   // Parallel to adds
+    std::vector<std::vector<int64_t>> batchEntryOffsets;
+    uint64_t events = 0;
+};
+
+const int OP_KINDS = 4; // Indexed by ArrivalTraceEventType - 1
+const char *const OP_NAMES[OP_KINDS] = {"add", "dispatch", "cancel", "batch"};
+
+bool decode(const std::string &path, DecodedTrace &trace)
+{
+    int64_t startUnixNanos = 0;
+    return ArrivalTraceWriter::read(path, [&trace](const ArrivalTraceEvent &e) {
+        ++trace.events;
+        if (e.type == TRACE_ADD && e.inBatch) {
+            WireDelivery record;
+            encodeWireDelivery(record, std::string(e.deliveryId), std::string(e.destination), e.deliveryType,
+                               e.estimatedDeliveryTime, 0);
+            trace.batches.back().push_back(record);
+            trace.batchEntryOffsets.back().push_back(e.entryOffsetSeconds);
+            return;
+        }
+        ReplayOp op{e.type, e.offsetNanos, 0};
+        switch (e.type) {
+        case TRACE_ADD:
+            op.item = trace.adds.size();
+            trace.adds.emplace_back(std::string(e.deliveryId), std::string(e.destination), e.deliveryType,
+                                    e.estimatedDeliveryTime);
+            trace.addEntryOffsets.push_back(e.entryOffsetSeconds);
+            break;
+        case TRACE_CANCEL:
+            op.item = trace.cancelIds.size();
+            trace.cancelIds.emplace_back(e.deliveryId);
+            break;
+        case TRACE_BATCH:
+            op.item = trace.batches.size();
+            trace.batches.emplace_back();
+            trace.batches.back().reserve(e.batchSize);
+            trace.batchEntryOffsets.emplace_back();
+            break;
+        default:
+            break;
+        }
+        trace.ops.push_back(op);
+    }, startUnixNanos);
+}
+
+struct ReplayResult {
+    LogLinearHistogram latency[OP_KINDS]; // Timestamp ticks
+    double seconds = 0.0;
+    uint64_t skippedDispatches = 0;
+    int queued = 0;
+};
+
+void replay(DecodedTrace &trace, bool originalPace, ReplayResult &result)
+{
+    DeliveryManager manager;
+    manager.setVerbose(false);
+    auto start = std::chrono::steady_clock::now();
+    for (const ReplayOp &op : trace.ops) {
+        if (originalPace) std::this_thread::sleep_until(start + std::chrono::nanoseconds(op.offsetNanos));
+        uint64_t began = 0;
+        switch (op.type) {
+        case TRACE_ADD: {
+            Delivery delivery = trace.adds[op.item];
+            delivery.entryTime = time(0) + trace.addEntryOffsets[op.item];
+            began = readTimestamp();
+            manager.addDelivery(delivery);
+            break;
+        }
+        case TRACE_DISPATCH:
+            began = readTimestamp();
+            if (!manager.hasDeliveries()) {
+                ++result.skippedDispatches;
+                continue;
+            }
+            manager.processNextDelivery();
+            break;
+        case TRACE_CANCEL:
+            began = readTimestamp();
+            manager.cancelDeliveryById(trace.cancelIds[op.item]);
+            break;
+        case TRACE_BATCH: {
+            std::vector<WireDelivery> &batch = trace.batches[op.item];
+            int64_t now = time(0);
+            for (size_t i = 0; i < batch.size(); ++i) {
+                batch[i].entryTime = now + trace.batchEntryOffsets[op.item][i];
+            }
+            began = readTimestamp();
+            manager.addDeliveries(batch.data(), batch.size());
+            break;
+        }
+        }
+        result.latency[op.type - 1].record(readTimestamp() - began);
+    }
+    result.seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    result.queued = manager.getTotalQueueSize();
+}
+
+void report(const DecodedTrace &trace, const ReplayResult &result)
+{
+    double ticksPerMicro = timestampTicksPerNanosecond() * 1000.0;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << trace.events << " events (" << trace.ops.size() << " operations) in " << result.seconds << " s: "
+              << std::setprecision(0) << trace.events / result.seconds << " events/s, " << trace.ops.size() / result.seconds
+              << " operations/s\n"
+              << std::setprecision(2);
+    std::cout << "Latency (us):\n";
+    for (int k = 0; k < OP_KINDS; ++k) {
+        const LogLinearHistogram &h = result.latency[k];
+        if (h.count() == 0) continue;
+        std::cout << "  " << std::left << std::setw(9) << OP_NAMES[k] << std::right << " n=" << h.count()
+                  << " p50=" << h.percentile(0.50) / ticksPerMicro << " p99=" << h.percentile(0.99) / ticksPerMicro
+                  << " p999=" << h.percentile(0.999) / ticksPerMicro << " max=" << h.getMax() / ticksPerMicro << "\n";
+    }
+    if (result.skippedDispatches > 0) {
+        std::cout << "Skipped " << result.skippedDispatches << " dispatches on empty queues\n";
+    }
+    std::cout << "Left queued: " << result.queued << "\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    if (argc < 2 || argv[1][0] == '-') {
+        std::cerr << "Usage: trace_replay TRACE [--pace max|original] [--repeat N]\n";
+        return 1;
+    }
+    std::string path = argv[1];
+    bool originalPace = false;
+    int repeat = 1;
+    for (int i = 2; i + 1 < argc; i += 2) {
+        if (std::strcmp(argv[i], "--pace") == 0) originalPace = std::strcmp(argv[i + 1], "original") == 0;
+        else if (std::strcmp(argv[i], "--repeat") == 0) repeat = std::atoi(argv[i + 1]);
+        else {
+            std::cerr << "Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    srand(1); // Service times are random; fixed for comparable runs
+    ConfigurationManager::initialize();
+    DecodedTrace trace;
+    if (!decode(path, trace)) {
+        std::cerr << "Could not read trace " << path << "\n";
+        return 1;
+    }
+    for (int r = 0; r < repeat; ++r) {
+        ReplayResult result;
+        replay(trace, originalPace, result);
+        if (repeat > 1) std::cout << "--- Run " << r + 1 << " ---\n";
+        report(trace, result);
+    }
+    return 0;
+}
@@ -0,0 +1,192 @@
+// Synthetic workload generator: WireFormat.h batch frames on stdout or a file.
+//
+//   workload_gen [--count 1000000] [--batch 4096] [--output FILE|-] [--seed 1]
+//                [--id-prefix W] [--first-id 0] [--types 0.2,0.5,0.3]
+//                [--destinations 1000] [--zipf 1.0]
+//                [--estimate uniform:10:130|exponential:MEAN|lognormal:MU:SIGMA]
+//                [--arrival constant:RATE|poisson:RATE|bursty:RATE:FACTOR:PERIOD:DUTY|diurnal:RATE:AMPLITUDE]
+//                [--start UNIX_SECONDS] [--threads 1]
+//
+// The output is the byte stream sqs_ingest expects, so it can be piped
+// through `sqs_ingest_client --input -` or saved and replayed. --types are
+// urgent, standard and fragile weights. Arrival times go into each record's
+// entryTime. --threads fills record attributes in parallel; the output is
+// byte-identical for any thread count. The rate achieved is printed on
+// stderr.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../WorkloadGenerator.h"
+
+namespace {
+
+// "name:a:b:..." into the name and up to four numbers
+bool parseSpec(const std::string &text, std::string &name, double (&values)[4], int &count)
+{
+    std::stringstream in(text);
+    std::getline(in, name, ':');
+    count = 0;
+    std::string part;
+    while (std::getline(in, part, ':')) {
+        if (count == 4) return false;
+        char *end = nullptr;
+        values[count++] = std::strtod(part.c_str(), &end);
+        if (end == part.c_str() || *end != '\0') return false;
+    }
+    return true;
+}
+
+bool parseEstimate(const std::string &text, WorkloadOptions &options)
+{
+    std::string name;
+    double v[4];
+    int n;
+    if (!parseSpec(text, name, v, n)) return false;
+    if (name == "uniform" && n == 2) options.estimate = ESTIMATE_UNIFORM;
+    else if (name == "exponential" && n == 1) options.estimate = ESTIMATE_EXPONENTIAL;
+    else if (name == "lognormal" && n == 2) options.estimate = ESTIMATE_LOGNORMAL;
+    else return false;
+    options.estimateA = v[0];
+    if (n > 1) options.estimateB = v[1];
+    return true;
+}
+
+bool parseArrival(const std::string &text, WorkloadOptions &options)
+{
+    std::string name;
+    double v[4];
+    int n;
+    if (!parseSpec(text, name, v, n) || n < 1) return false;
+    options.arrivalRate = v[0];
+    if (name == "constant" && n == 1) options.arrival = ARRIVAL_CONSTANT;
+    else if (name == "poisson" && n == 1) options.arrival = ARRIVAL_POISSON;
+    else if (name == "bursty" && n == 4) {
+        options.arrival = ARRIVAL_BURSTY;
+        options.burstFactor = v[1];
+        options.burstPeriod = v[2];
+        options.burstDuty = v[3];
+    } else if (name == "diurnal" && n == 2) {
+        options.arrival = ARRIVAL_DIURNAL;
+        options.diurnalAmplitude = v[1];
+    } else {
+        return false;
+    }
+    return true;
+}
+
+bool parseTypes(const std::string &text, WorkloadOptions &options)
+{
+    std::stringstream in(text);
+    std::string part;
+    int t = 0;
+    while (std::getline(in, part, ',')) {
+        if (t == 3) return false;
+        options.typeWeights[t++] = std::atof(part.c_str());
+    }
+    return t == 3;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    WorkloadOptions options;
+    unsigned long long count = 1000000;
+    uint32_t batch = 4096;
+    std::string outputPath = "-";
+    int threads = 1;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        bool ok = true;
+        if (flag == "--count") count = static_cast<unsigned long long>(std::atof(value.c_str()));
+        else if (flag == "--batch") batch = static_cast<uint32_t>(std::atoi(value.c_str()));
+        else if (flag == "--output") outputPath = value;
+        else if (flag == "--seed") options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (flag == "--id-prefix") options.idPrefix = value;
+        else if (flag == "--first-id") options.firstSequence = std::strtoull(value.c_str(), nullptr, 10);
+        else if (flag == "--types") ok = parseTypes(value, options);
+        else if (flag == "--destinations") options.destinationCount = static_cast<uint32_t>(std::atoi(value.c_str()));
+        else if (flag == "--zipf") options.zipfExponent = std::atof(value.c_str());
+        else if (flag == "--estimate") ok = parseEstimate(value, options);
+        else if (flag == "--arrival") ok = parseArrival(value, options);
+        else if (flag == "--start") options.startTime = std::strtoll(value.c_str(), nullptr, 10);
+        else if (flag == "--threads") threads = std::atoi(value.c_str());
+        else {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+        if (!ok) {
+            std::cerr << "Bad value for " << flag << ": " << value << "\n";
+            return 1;
+        }
+    }
+    if (batch < 1) batch = 1;
+    if (batch > 65536) batch = 65536; // sqs_ingest's frame limit
+    if (threads < 1) threads = 1;
+
+    std::FILE *out = outputPath == "-" ? stdout : std::fopen(outputPath.c_str(), "wb");
+    if (!out) {
+        std::cerr << "Could not open " << outputPath << "\n";
+        return 1;
+    }
+
+    WorkloadGenerator generator(options);
+    // One round is framesPerRound frames: attributes in parallel, then arrival
+    // times and the write in stream order
+    const int framesPerRound = threads * 4;
+    std::vector<std::vector<char>> frames(framesPerRound, std::vector<char>(wireFrameBytes(batch)));
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    unsigned long long written = 0;
+    while (written < count) {
+        uint32_t sizes[256];
+        int roundFrames = 0;
+        unsigned long long planned = written;
+        while (roundFrames < framesPerRound && roundFrames < 256 && planned < count) {
+            sizes[roundFrames] = count - planned < batch ? static_cast<uint32_t>(count - planned) : batch;
+            planned += sizes[roundFrames++];
+        }
+        auto records = [&frames](int f) {
+            return reinterpret_cast<WireDelivery *>(frames[f].data() + sizeof(WireBatchHeader));
+        };
+        auto fillFrames = [&](int worker) {
+            uint64_t first = options.firstSequence + written;
+            for (int f = 0; f < roundFrames; ++f) {
+                if (f % threads == worker) generator.fillAttributes(records(f), sizes[f], first);
+                first += sizes[f];
+            }
+        };
+        std::vector<std::thread> workers;
+        for (int w = 1; w < threads && w < roundFrames; ++w) workers.emplace_back(fillFrames, w);
+        fillFrames(0);
+        for (std::thread &t : workers) t.join();
+
+        for (int f = 0; f < roundFrames; ++f) {
+            initWireBatchHeader(*reinterpret_cast<WireBatchHeader *>(frames[f].data()), sizes[f]);
+            generator.fillArrivals(records(f), sizes[f]);
+            size_t bytes = wireFrameBytes(sizes[f]);
+            if (std::fwrite(frames[f].data(), 1, bytes, out) != bytes) {
+                std::cerr << "Write failed after " << written << " records\n";
+                return 1;
+            }
+            written += sizes[f];
+        }
+    }
+    if (std::fflush(out) != 0 || (out != stdout && std::fclose(out) != 0)) {
+        std::cerr << "Write failed\n";
+        return 1;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cerr << "Generated " << written << " deliveries in " << elapsed << " s ("
+              << static_cast<unsigned long long>(written / elapsed) << " records/s, "
+              << static_cast<unsigned long long>(written * sizeof(WireDelivery) / elapsed / (1 << 20)) << " MB/s); "
+              << "arrivals span " << generator.getElapsedSeconds() << " s\n";
+    return 0;
+}
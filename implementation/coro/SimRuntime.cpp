@@ -0,0 +1,162 @@
+#include "SimRuntime.h"
+#include <new>
+
+void *FramePool::allocate(size_t bytes)
+{
+    ++liveFrames;
+    liveBytes += bytes;
+    if (liveBytes > peakBytes) peakBytes = liveBytes;
+    if (bytes > MAX_POOLED) {
+        reservedBytes += bytes;
+        return ::operator new(bytes);
+    }
+    size_t sizeClass = (bytes + GRANULE - 1) / GRANULE;
+    if (FreeFrame *frame = freeLists[sizeClass]) {
+        freeLists[sizeClass] = frame->next;
+        return frame;
+    }
+    size_t rounded = sizeClass * GRANULE;
+    if (slabLeft < rounded) {
+        // The tail of the old slab is given up; it is under one frame
+        slab = static_cast<char *>(::operator new(SLAB_BYTES));
+        slabLeft = SLAB_BYTES;
+        reservedBytes += SLAB_BYTES;
+    }
+    void *frame = slab;
+    slab += rounded;
+    slabLeft -= rounded;
+    return frame;
+}
+
+void FramePool::release(void *frame, size_t bytes)
+{
+    --liveFrames;
+    liveBytes -= bytes;
+    if (bytes > MAX_POOLED) {
+        reservedBytes -= bytes;
+        ::operator delete(frame);
+        return;
+    }
+    size_t sizeClass = (bytes + GRANULE - 1) / GRANULE;
+    FreeFrame *free = static_cast<FreeFrame *>(frame);
+    free->next = freeLists[sizeClass];
+    freeLists[sizeClass] = free;
+}
+
+Actor::promise_type::~promise_type()
+{
+    if (simulation) simulation->forget(*this);
+}
+
+bool Simulation::DeliveryAwaiter::await_ready()
+{
+    // Something already queued is taken without suspending
+    if (!simulation.manager.hasDeliveries(classes)) return false;
+    delivery.emplace(simulation.manager.processNextDelivery(classes));
+    return true;
+}
+
+Simulation::Simulation(DeliveryManager &deliveryManager, time_t start)
+    : manager(deliveryManager), now(start), sequence(0), waitingCount(0), actors(nullptr), liveActors(0),
+      peakActors(0), spawned(0), resumes(0)
+{
+    current = this;
+    DeliveryClock::setSource(&Simulation::clock);
+}
+
+Simulation::~Simulation()
+{
+    // Destroying a frame runs its promise destructor, which unlinks it
+    while (actors) std::coroutine_handle<Actor::promise_type>::from_promise(*actors).destroy();
+    if (current == this) {
+        DeliveryClock::setSource(nullptr);
+        current = nullptr;
+    }
+}
+
+void Simulation::spawn(Actor actor)
+{
+    std::coroutine_handle<Actor::promise_type> h = actor.handle;
+    actor.handle = nullptr;
+    Actor::promise_type &promise = h.promise();
+    promise.simulation = this;
+    promise.next = actors;
+    if (actors) actors->previous = &promise;
+    actors = &promise;
+    ++spawned;
+    if (++liveActors > peakActors) peakActors = liveActors;
+    schedule(h, now);
+}
+
+void Simulation::forget(Actor::promise_type &promise)
+{
+    if (promise.previous) promise.previous->next = promise.next;
+    else actors = promise.next;
+    if (promise.next) promise.next->previous = promise.previous;
+    --liveActors;
+}
+
+void Simulation::schedule(std::coroutine_handle<> h, time_t at)
+{
+    timers.push(Timer{at, sequence++, h});
+}
+
+void Simulation::run()
+{
+    while (!timers.empty()) {
+        Timer next = timers.top();
+        timers.pop();
+        if (next.at > now) now = next.at;
+        ++resumes;
+        next.handle.resume();
+    }
+}
+
+void Simulation::runUntil(time_t end)
+{
+    while (!timers.empty() && timers.top().at <= end) {
+        Timer next = timers.top();
+        timers.pop();
+        if (next.at > now) now = next.at;
+        ++resumes;
+        next.handle.resume();
+    }
+    if (end > now) now = end;
+}
+
+void Simulation::waitForDelivery(DeliveryAwaiter *awaiter, std::coroutine_handle<> h)
+{
+    waiting[awaiter->classes & ALL_DELIVERY_CLASSES].push_back(Waiter{awaiter, h, sequence++});
+    ++waitingCount;
+}
+
+void Simulation::addDelivery(Delivery &delivery)
+{
+    manager.addDelivery(delivery);
+    serveWaitingCounters();
+}
+
+bool Simulation::withdraw(const std::string &deliveryId)
+{
+    if (manager.findDelivery(deliveryId).status != STATUS_QUEUED) return false;
+    return manager.cancelDeliveryById(deliveryId);
+}
+
+void Simulation::serveWaitingCounters()
+{
+    // One list per class set (at most seven), so finding the longest-waiting
+    // counter that can take something queued does not scan the counters
+    while (waitingCount > 0) {
+        int best = -1;
+        for (int classes = 1; classes <= ALL_DELIVERY_CLASSES; ++classes) {
+            if (waiting[classes].empty() || !manager.hasDeliveries(static_cast<unsigned char>(classes))) continue;
+            if (best < 0 || waiting[classes].front().sequence < waiting[best].front().sequence) best = classes;
+        }
+        if (best < 0) return;
+        Waiter waiter = waiting[best].front();
+        waiting[best].pop_front();
+        --waitingCount;
+        waiter.awaiter->delivery.emplace(manager.processNextDelivery(static_cast<unsigned char>(best)));
+        schedule(waiter.handle, now);
+    }
+}
@@ -0,0 +1,192 @@
+#ifndef SIM_RUNTIME_H
+#define SIM_RUNTIME_H
+
+// Coroutine simulation runtime (C++20; the rest of the tree stays C++17).
+
+#include <coroutine>
+#include <cstddef>
+#include <cstdint>
+#include <ctime>
+#include <deque>
+#include <optional>
+#include <queue>
+#include <string>
+#include <vector>
+#include "../DeliveryManager.h"
+
+class Simulation;
+
+// Coroutine frames come from per-size free lists carved out of 64 KB slabs,
+// so an actor costs its frame and no allocator header, and spawning and
+// finishing many short-lived actors does not go back to malloc each time.
+// Single-threaded, like the simulation.
+class FramePool
+{
+public:
+    static void *allocate(size_t bytes);
+    static void release(void *frame, size_t bytes);
+
+    static size_t getLiveFrames() { return liveFrames; }
+    static size_t getLiveBytes() { return liveBytes; } // Frame sizes as the compiler asked for them
+    static size_t getPeakBytes() { return peakBytes; }
+    static size_t getReservedBytes() { return reservedBytes; } // Slabs plus oversized frames
+
+private:
+    static const size_t GRANULE = 16;
+    static const size_t MAX_POOLED = 1024; // Larger frames go straight to operator new
+    static const size_t SLAB_BYTES = 64 * 1024;
+
+    struct FreeFrame {
+        FreeFrame *next;
+    };
+    inline static FreeFrame *freeLists[MAX_POOLED / GRANULE + 1] = {};
+    inline static char *slab = nullptr;
+    inline static size_t slabLeft = 0;
+    inline static size_t liveFrames = 0;
+    inline static size_t liveBytes = 0;
+    inline static size_t peakBytes = 0;
+    inline static size_t reservedBytes = 0;
+};
+
+// A simulated actor: a coroutine that runs on Simulation's single thread and
+// suspends on virtual-time delays and on the delivery queue. It starts when
+// handed to Simulation::spawn() and frees its frame when its body returns;
+// actors still suspended when the Simulation goes away are destroyed then.
+class Actor
+{
+public:
+    struct promise_type {
+        Simulation *simulation = nullptr;
+        promise_type *previous = nullptr; // Simulation's list of live actors
+        promise_type *next = nullptr;
+
+        Actor get_return_object() { return Actor(std::coroutine_handle<promise_type>::from_promise(*this)); }
+        std::suspend_always initial_suspend() noexcept { return {}; }
+        std::suspend_never final_suspend() noexcept { return {}; }
+        void return_void() {}
+        void unhandled_exception() { throw; } // Out of Simulation::run(); the frame is freed with the Simulation
+        ~promise_type();
+
+        static void *operator new(size_t bytes) { return FramePool::allocate(bytes); }
+        static void operator delete(void *frame, size_t bytes) { FramePool::release(frame, bytes); }
+    };
+
+    Actor(Actor &&other) noexcept : handle(other.handle) { other.handle = nullptr; }
+    Actor(const Actor &) = delete;
+    Actor &operator=(const Actor &) = delete;
+    ~Actor()
+    {
+        if (handle) handle.destroy(); // Never spawned
+    }
+
+private:
+    std::coroutine_handle<promise_type> handle;
+
+    explicit Actor(std::coroutine_handle<promise_type> h) : handle(h) {}
+    friend class Simulation;
+};
+
+// Single-threaded discrete-event scheduler in virtual seconds.
+//
+// Actors wait on a timer heap (co_await delay/until) or, as counters, for a
+// delivery of the classes they serve (co_await nextDelivery). Nothing ever
+// blocks a thread: run() resumes one actor at a time in time order, actors
+// due at the same second in the order they were scheduled. While it exists
+// the Simulation drives DeliveryClock, so entry times, scoring and SLAs all
+// run in virtual time.
+class Simulation
+{
+public:
+    class DelayAwaiter
+    {
+    private:
+        Simulation &simulation;
+        time_t wakeAt;
+
+    public:
+        DelayAwaiter(Simulation &s, time_t at) : simulation(s), wakeAt(at) {}
+        bool await_ready() const noexcept { return false; } // Even a zero delay lets others due now go first
+        void await_suspend(std::coroutine_handle<> h) { simulation.schedule(h, wakeAt); }
+        void await_resume() const noexcept {}
+    };
+
+    class DeliveryAwaiter
+    {
+    private:
+        Simulation &simulation;
+        unsigned char classes;
+        std::optional<Delivery> delivery;
+
+        friend class Simulation;
+
+    public:
+        DeliveryAwaiter(Simulation &s, unsigned char c) : simulation(s), classes(c) {}
+        bool await_ready();
+        void await_suspend(std::coroutine_handle<> h) { simulation.waitForDelivery(this, h); }
+        Delivery await_resume() { return std::move(*delivery); }
+    };
+
+    Simulation(DeliveryManager &manager, time_t start);
+    ~Simulation(); // Destroys the actors still suspended and gives DeliveryClock back the wall clock
+    Simulation(const Simulation &) = delete;
+    Simulation &operator=(const Simulation &) = delete;
+
+    void spawn(Actor actor); // Runs from the current time, after whatever is already due
+    void run();              // Until no actor has a timer left
+    void runUntil(time_t end);
+
+    DelayAwaiter delay(int64_t seconds) { return DelayAwaiter(*this, now + (seconds > 0 ? seconds : 0)); }
+    DelayAwaiter until(time_t at) { return DelayAwaiter(*this, at > now ? at : now); }
+    // The next delivery of those classes in the manager's scheduling order,
+    // once one is queued; counters waiting for the same class are served
+    // in the order they started waiting
+    DeliveryAwaiter nextDelivery(unsigned char classes) { return DeliveryAwaiter(*this, classes); }
+
+    void addDelivery(Delivery &delivery); // Queues it and hands it to a waiting counter if one can take it
+    bool withdraw(const std::string &deliveryId); // Cancels it if it is still queued
+
+    time_t getNow() const { return now; }
+    DeliveryManager &getManager() { return manager; }
+    uint64_t getResumes() const { return resumes; }
+    size_t getLiveActors() const { return liveActors; }
+    size_t getPeakActors() const { return peakActors; }
+    uint64_t getSpawned() const { return spawned; }
+    size_t getWaitingCounters() const { return waitingCount; }
+
+private:
+    struct Timer {
+        time_t at;
+        uint64_t sequence;
+        std::coroutine_handle<> handle;
+        bool operator>(const Timer &other) const { return at != other.at ? at > other.at : sequence > other.sequence; }
+    };
+    struct Waiter {
+        DeliveryAwaiter *awaiter;
+        std::coroutine_handle<> handle;
+        uint64_t sequence;
+    };
+
+    DeliveryManager &manager;
+    time_t now;
+    uint64_t sequence;
+    std::priority_queue<Timer, std::vector<Timer>, std::greater<Timer>> timers;
+    std::deque<Waiter> waiting[ALL_DELIVERY_CLASSES + 1]; // By class set, oldest first
+    size_t waitingCount;
+    Actor::promise_type *actors; // Live ones, most recently spawned first
+    size_t liveActors;
+    size_t peakActors;
+    uint64_t spawned;
+    uint64_t resumes;
+
+    inline static Simulation *current = nullptr; // The one DeliveryClock reads
+    static time_t clock() { return current->now; }
+
+    void schedule(std::coroutine_handle<> h, time_t at);
+    void waitForDelivery(DeliveryAwaiter *awaiter, std::coroutine_handle<> h);
+    void serveWaitingCounters();
+    void forget(Actor::promise_type &promise);
+
+    friend struct Actor::promise_type;
+};
+
+#endif // SIM_RUNTIME_H
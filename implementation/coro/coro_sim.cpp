@@ -0,0 +1,217 @@
+// Actor-based depot simulation on the coroutine runtime (SimRuntime.h).
+//
+//   coro_sim [--hours 24] [--arrivals-per-hour 80] [--sources 1] [--seed 1]
+//            [--counter-profiles USF*100] [--steps 1] [--step-overhead 0]
+//            [--break-every 0] [--break-minutes 15] [--patience 0]
+//            [--rescore-every 1]
+//
+// Every counter, arrival source and (with --patience) customer is a
+// coroutine on one thread:
+//   - an arrival source replays a Poisson WorkloadGenerator stream,
+//     co_awaiting each arrival's entry time;
+//   - a counter co_awaits the next delivery it has the skills for, serves it
+//     in --steps equal steps with --step-overhead seconds of hand-over each,
+//     and after every --break-every deliveries takes --break-minutes off;
+//   - a customer queues its delivery and, if it has not reached a counter
+//     within --patience minutes, withdraws it (reneging).
+// A housekeeping actor calls updatePriorities() every --rescore-every
+// simulated minutes, as SimulationManager does. Arrivals stop after --hours
+// and the run ends once every queued delivery has been served or withdrawn.
+//
+// Build (C++20, from implementation/):
+//   g++ -std=c++20 -O2 coro/coro_sim.cpp coro/SimRuntime.cpp $(ls *.cpp | grep -v '^main.cpp$') -o coro_sim
+#include <chrono>
+#include <cmath>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+#include "SimRuntime.h"
+#include "../ServiceCounters.h"
+#include "../WorkloadGenerator.h"
+
+namespace {
+
+const time_t SIMULATION_EPOCH = 1700000000; // Fixed, so runs are reproducible
+
+struct ScenarioOptions {
+    double hours = 24.0;
+    double arrivalsPerHour = 80.0; // About 93% of the default counters (69.5-minute mean estimate)
+    int sources = 1;
+    uint64_t seed = 1;
+    std::string counterProfiles = "USF*100";
+    int steps = 1;
+    int stepOverheadSeconds = 0;
+    int breakEvery = 0; // Deliveries between breaks, 0 = no breaks
+    int breakMinutes = 15;
+    int patienceMinutes = 0; // 0 = customers never leave
+    int rescoreEvery = 1;    // Minutes, 0 = never
+};
+
+struct ScenarioStats {
+    LogLinearHistogram waits[3]; // Seconds from entry to a counter
+    uint64_t served = 0;
+    uint64_t reneged = 0;
+    uint64_t breaks = 0;
+    double busySeconds = 0.0;
+    size_t peakQueued = 0;
+    bool arrivalsDone = false;
+    int sourcesLeft = 0;
+};
+
+Actor customer(Simulation &sim, WireDelivery record, int patienceSeconds, ScenarioStats &stats)
+{
+    std::string id = wireString(record.id);
+    Delivery delivery = DeliveryManager::decodeWireDelivery(record, sim.getNow());
+    sim.addDelivery(delivery);
+    co_await sim.delay(patienceSeconds);
+    if (sim.withdraw(id)) ++stats.reneged;
+}
+
+Actor arrivalSource(Simulation &sim, WorkloadOptions workload, time_t end, const ScenarioOptions &options,
+                    ScenarioStats &stats)
+{
+    WorkloadGenerator generator(workload);
+    WireDelivery record;
+    for (;;) {
+        generator.fill(&record, 1);
+        if (record.entryTime >= end) break;
+        co_await sim.until(static_cast<time_t>(record.entryTime));
+        if (options.patienceMinutes > 0) {
+            sim.spawn(customer(sim, record, options.patienceMinutes * 60, stats));
+        } else {
+            Delivery delivery = DeliveryManager::decodeWireDelivery(record, sim.getNow());
+            sim.addDelivery(delivery);
+        }
+        size_t queued = static_cast<size_t>(sim.getManager().getTotalQueueSize());
+        if (queued > stats.peakQueued) stats.peakQueued = queued;
+    }
+    if (--stats.sourcesLeft == 0) stats.arrivalsDone = true;
+}
+
+Actor counter(Simulation &sim, CounterProfile profile, const ScenarioOptions &options, ScenarioStats &stats)
+{
+    int sinceBreak = 0;
+    for (;;) {
+        Delivery delivery = co_await sim.nextDelivery(profile.skills);
+        stats.waits[delivery.getType()].record(static_cast<uint64_t>(std::difftime(sim.getNow(), delivery.entryTime)));
+        time_t started = sim.getNow();
+
+        // The estimate covers the handling; each step adds its hand-over
+        int64_t handling = static_cast<int64_t>(std::ceil(delivery.estimatedDeliveryTime * 60.0 / profile.speed));
+        for (int step = 0; step < options.steps; ++step) {
+            int64_t share = handling / options.steps + (step < handling % options.steps ? 1 : 0);
+            co_await sim.delay(share + options.stepOverheadSeconds);
+        }
+        stats.busySeconds += std::difftime(sim.getNow(), started);
+        ++stats.served;
+
+        if (options.breakEvery > 0 && ++sinceBreak >= options.breakEvery) {
+            sinceBreak = 0;
+            ++stats.breaks;
+            co_await sim.delay(static_cast<int64_t>(options.breakMinutes) * 60);
+        }
+    }
+}
+
+Actor housekeeping(Simulation &sim, const ScenarioOptions &options, ScenarioStats &stats)
+{
+    while (!stats.arrivalsDone || sim.getManager().hasDeliveries()) {
+        co_await sim.delay(static_cast<int64_t>(options.rescoreEvery) * 60);
+        sim.getManager().updatePriorities();
+    }
+}
+
+void report(const Simulation &sim, const ScenarioStats &stats, size_t counters, double wallSeconds)
+{
+    static const char *names[3] = {"urgent", "standard", "fragile"};
+    double simulatedHours = std::difftime(sim.getNow(), SIMULATION_EPOCH) / 3600.0;
+    std::cout << std::fixed << std::setprecision(1);
+    std::cout << "Simulated " << simulatedHours << " h: served " << stats.served << ", reneged " << stats.reneged
+              << ", breaks " << stats.breaks << ", counters busy "
+              << 100.0 * stats.busySeconds / (simulatedHours * 3600.0 * counters + 1e-9) << "%, peak queue "
+              << stats.peakQueued << "\n";
+    std::cout << "Wait for a counter (minutes):\n";
+    for (int type = URGENT; type <= FRAGILE; ++type) {
+        const LogLinearHistogram &h = stats.waits[type];
+        if (h.count() == 0) continue;
+        std::cout << "  " << std::left << std::setw(9) << names[type] << std::right << " n=" << h.count()
+                  << " p50=" << h.percentile(0.50) / 60.0 << " p90=" << h.percentile(0.90) / 60.0
+                  << " p99=" << h.percentile(0.99) / 60.0 << " max=" << h.getMax() / 60.0 << "\n";
+    }
+    double perActor = sim.getPeakActors() ? static_cast<double>(FramePool::getPeakBytes()) / sim.getPeakActors() : 0.0;
+    std::cout << "Actors: " << sim.getSpawned() << " spawned, " << sim.getPeakActors() << " alive at peak, "
+              << std::setprecision(0) << perActor << " frame bytes each at peak ("
+              << FramePool::getReservedBytes() / 1024 << " KB reserved)\n";
+    std::cout << std::setprecision(2) << sim.getResumes() << " resumes in " << wallSeconds << " s ("
+              << sim.getResumes() / wallSeconds / 1e6 << " M/s)\n";
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    ScenarioOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string flag = argv[i];
+        if (i + 1 >= argc) {
+            std::cerr << "Missing value for " << flag << "\n";
+            return 1;
+        }
+        std::string value = argv[++i];
+        if (flag == "--hours") options.hours = std::atof(value.c_str());
+        else if (flag == "--arrivals-per-hour") options.arrivalsPerHour = std::atof(value.c_str());
+        else if (flag == "--sources") options.sources = std::atoi(value.c_str());
+        else if (flag == "--seed") options.seed = std::strtoull(value.c_str(), nullptr, 10);
+        else if (flag == "--counter-profiles") options.counterProfiles = value;
+        else if (flag == "--steps") options.steps = std::atoi(value.c_str());
+        else if (flag == "--step-overhead") options.stepOverheadSeconds = std::atoi(value.c_str());
+        else if (flag == "--break-every") options.breakEvery = std::atoi(value.c_str());
+        else if (flag == "--break-minutes") options.breakMinutes = std::atoi(value.c_str());
+        else if (flag == "--patience") options.patienceMinutes = std::atoi(value.c_str());
+        else if (flag == "--rescore-every") options.rescoreEvery = std::atoi(value.c_str());
+        else {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+    if (options.sources < 1) options.sources = 1;
+    if (options.steps < 1) options.steps = 1;
+    std::vector<CounterProfile> profiles;
+    if (!parseCounterProfiles(options.counterProfiles, profiles)) {
+        std::cerr << "Bad counter profiles " << options.counterProfiles << " (expected e.g. USF*8,U@2*2)\n";
+        return 1;
+    }
+
+    ConfigurationManager::initialize();
+    DeliveryManager manager;
+    manager.setVerbose(false);
+    ScenarioStats stats;
+    stats.sourcesLeft = options.sources;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    {
+        Simulation sim(manager, SIMULATION_EPOCH);
+        time_t end = SIMULATION_EPOCH + static_cast<time_t>(options.hours * 3600.0);
+        for (int s = 0; s < options.sources; ++s) {
+            WorkloadOptions workload;
+            workload.seed = options.seed + s;
+            workload.idPrefix = "A" + std::to_string(s);
+            workload.startTime = SIMULATION_EPOCH;
+            workload.arrival = ARRIVAL_POISSON;
+            workload.estimate = ESTIMATE_UNIFORM;
+            workload.estimateA = 10;
+            workload.estimateB = 129;
+            workload.arrivalRate = options.arrivalsPerHour / options.sources / 3600.0;
+            sim.spawn(arrivalSource(sim, workload, end, options, stats));
+        }
+        for (const CounterProfile &profile : profiles) sim.spawn(counter(sim, profile, options, stats));
+        if (options.rescoreEvery > 0) sim.spawn(housekeeping(sim, options, stats));
+        sim.run();
+        double wallSeconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cout << options.sources << " arrival sources at " << options.arrivalsPerHour << "/h for " << options.hours
+                  << " h, counters " << options.counterProfiles << "\n";
+        report(sim, stats, profiles.size(), wallSeconds);
+    }
+    return 0;
+}
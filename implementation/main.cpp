@@ -9,23 +9,92 @@
 #include "AdminConsole.h"
 #include "SimulationManager.h"
 #include "ReportManager.h"
+#include "EventTracer.h"
+#include <cstring>
 
 // Explicit template instantiations
 template class MinHeap<Delivery>;
 template class MaxHeap<Delivery>;
 template class PriorityQueue<Delivery>;
 
-int main() {
+// Usage: delivery [--trace FILE.json] [--trace-sample RATE] [--capture FILE]
+//                 [--counter-profiles SPEC]
+// --trace writes simulation runs as Chrome trace events (open the file in
+// ui.perfetto.dev or chrome://tracing); --trace-sample keeps that fraction
+// of deliveries and ticks, e.g. 0.01 for long runs. --capture records every
+// add, dispatch and cancel for bench/trace_replay. --counter-profiles gives
+// the simulation skilled counters with speeds, e.g. "USF*2,F@1.5,U@0.8"
+// (see ServiceCounters.h).
+int main(int argc, char **argv) {
     srand(time(0)); // Seed for random number generation
 
+    std::string tracePath;
+    TracerOptions traceOptions;
+    std::string capturePath;
+    std::vector<CounterProfile> counterProfiles;
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 == argc) {
+            std::cerr << "Missing value for " << argv[i] << "\n"
+                      << "Usage: delivery [--trace FILE.json] [--trace-sample RATE] [--capture FILE]"
+                      << " [--counter-profiles SPEC]\n";
+            return 1;
+        }
+        if (std::strcmp(argv[i], "--trace") == 0) tracePath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--trace-sample") == 0) traceOptions.sampleRate = std::atof(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--capture") == 0) capturePath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--counter-profiles") == 0) {
+            if (!parseCounterProfiles(argv[i + 1], counterProfiles)) {
+                std::cerr << "Bad counter profiles " << argv[i + 1] << " (expected e.g. USF*2,F@1.5,U@0.8)\n";
+                return 1;
+            }
+        }
+        else {
+            std::cerr << "Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
     ConfigurationManager::initialize(); // Initialize static members of ConfigurationManager
 
     DeliveryManager deliveryManager;
+    // Recover queued and cancelled deliveries from the previous run (latest snapshot
+    // plus the log tail after it), then keep logging and snapshotting
+    if (deliveryManager.restoreSnapshot("delivery_queue.snap")) {
+        std::cout << "Loaded snapshot delivery_queue.snap\n";
+    }
+    deliveryManager.setSnapshotPolicy("delivery_queue.snap", 10000);
+    if (deliveryManager.enableWriteAheadLog("delivery_queue.wal")) {
+        std::cout << "Recovered " << deliveryManager.getTotalQueueSize() << " queued deliveries from delivery_queue.wal\n";
+    } else {
+        std::cout << "Could not open delivery_queue.wal; running without crash recovery\n";
+    }
+    if (!deliveryManager.enableCancelledSpill("cancelled_deliveries.log")) {
+        std::cout << "Could not open cancelled_deliveries.log; older cancellations will not be archived\n";
+    }
+    if (!capturePath.empty() && !deliveryManager.startTraceCapture(capturePath)) {
+        std::cout << "Could not open " << capturePath << "; running without trace capture\n";
+    }
     ReportManager reportManager(deliveryManager);
     SimulationManager simulationManager(deliveryManager, reportManager);
+    simulationManager.setCounterProfiles(counterProfiles);
+    EventTracer tracer;
+    if (!tracePath.empty()) {
+        if (tracer.open(tracePath, traceOptions)) {
+            simulationManager.setTracer(&tracer);
+            std::cout << "Tracing simulation runs to " << tracePath << "\n";
+        } else {
+            std::cout << "Could not open " << tracePath << "; running without tracing\n";
+        }
+    }
     AdminConsole adminConsole(deliveryManager, simulationManager, reportManager);
 
     adminConsole.start();
+    if (!deliveryManager.stopTraceCapture()) {
+        std::cout << "Trace capture " << capturePath << " is incomplete (write failed)\n";
+    }
+    if (tracer.isOpen() && !tracer.close()) {
+        std::cout << "Trace file " << tracePath << " is incomplete (write failed)\n";
+    }
 
     return 0;
 }
@@ -0,0 +1,40 @@
+"""Builds the sqs_engine extension from the C++ sources in implementation/.
+
+    pip install ./implementation/python          # or, from this directory:
+    python setup.py build_ext --inplace
+"""
+import glob
+import os
+import sys
+
+from setuptools import Extension, setup
+
+HERE = os.path.dirname(os.path.abspath(__file__))
+ENGINE_DIR = os.path.dirname(HERE)
+
+# Every engine translation unit except the console program's main()
+engine_sources = sorted(
+    os.path.relpath(path, HERE)
+    for path in glob.glob(os.path.join(ENGINE_DIR, "*.cpp"))
+    if os.path.basename(path) != "main.cpp"
+)
+
+if sys.platform == "win32":
+    compile_args = ["/std:c++17", "/O2", "/EHsc"]
+else:
+    compile_args = ["-std=c++17", "-O2"]
+
+setup(
+    name="sqs_engine",
+    version="1.0.0",
+    description="In-process Python bindings for the Smart Queue Management System engine",
+    ext_modules=[
+        Extension(
+            "sqs_engine",
+            sources=["sqs_engine.cpp"] + engine_sources,
+            include_dirs=[ENGINE_DIR],
+            extra_compile_args=compile_args,
+            language="c++",
+        )
+    ],
+)
@@ -0,0 +1,547 @@
+// CPython extension exposing the C++ delivery engine in-process.
+//
+//   import sqs_engine
+//   engine = sqs_engine.Engine()
+//   engine.add("D1", "Cairo", "URGENT", 30)
+//   engine.process()            # -> (delivery dict, "urgent") or None
+//
+// Built on the raw C API (see setup.py). All engine state, including the
+// static ConfigurationManager, is guarded by one lock. Every call releases
+// the GIL before taking it and builds its Python result only after letting
+// it go, so other Python threads keep running meanwhile, and no thread ever
+// waits for the lock while holding the GIL (which, with a finalizer such as
+// Engine_dealloc taking the lock, could deadlock).
+#define PY_SSIZE_T_CLEAN
+#include <Python.h>
+
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <ctime>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <vector>
+#include "../DeliveryManager.h"
+#include "../ReportManager.h"
+
+namespace {
+
+std::mutex engineLock;
+
+// Runs work under engineLock with the GIL released. work must not touch
+// Python objects; copy what the result needs and build it afterwards.
+template <typename Work>
+void withEngine(Work work)
+{
+    Py_BEGIN_ALLOW_THREADS
+    {
+        std::lock_guard<std::mutex> guard(engineLock);
+        work();
+    }
+    Py_END_ALLOW_THREADS
+}
+
+const char *typeName(DeliveryType type)
+{
+    switch (type) {
+    case URGENT: return "URGENT";
+    case FRAGILE: return "FRAGILE";
+    default: return "STANDARD";
+    }
+}
+
+const char *queueName(DeliveryType type)
+{
+    switch (type) {
+    case URGENT: return "urgent";
+    case FRAGILE: return "fragile";
+    default: return "standard";
+    }
+}
+
+const char *statusName(DeliveryStatus status)
+{
+    switch (status) {
+    case STATUS_QUEUED: return "queued";
+    case STATUS_PROCESSED: return "processed";
+    case STATUS_CANCELLED: return "cancelled";
+    default: return "unknown";
+    }
+}
+
+// Accepts "URGENT"/"urgent"/... or the enum value
+bool parseType(PyObject *value, DeliveryType &type)
+{
+    if (PyLong_Check(value)) {
+        long v = PyLong_AsLong(value);
+        if (v < URGENT || v > FRAGILE) return false;
+        type = static_cast<DeliveryType>(v);
+        return true;
+    }
+    if (!PyUnicode_Check(value)) return false;
+    const char *text = PyUnicode_AsUTF8(value);
+    if (!text) {
+        PyErr_Clear();
+        return false;
+    }
+    std::string name(text);
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    if (name == "URGENT") type = URGENT;
+    else if (name == "STANDARD") type = STANDARD;
+    else if (name == "FRAGILE") type = FRAGILE;
+    else return false;
+    return true;
+}
+
+PyObject *deliveryToDict(const Delivery &d)
+{
+    std::tm utc;
+    time_t entry = d.entryTime;
+#ifdef _WIN32
+    gmtime_s(&utc, &entry);
+#else
+    gmtime_r(&entry, &utc);
+#endif
+    char timestamp[32];
+    std::strftime(timestamp, sizeof(timestamp), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    return Py_BuildValue("{s:s#,s:s#,s:s,s:i,s:d,s:s}",
+                         "id", d.deliveryId.data(), static_cast<Py_ssize_t>(d.deliveryId.size()),
+                         "destination", d.destination.data(), static_cast<Py_ssize_t>(d.destination.size()),
+                         "type", typeName(d.deliveryType),
+                         "estimatedTime", d.estimatedDeliveryTime,
+                         "priorityScore", d.priorityScore,
+                         "timestamp", timestamp);
+}
+
+PyObject *deliveriesToList(const std::vector<Delivery> &deliveries)
+{
+    PyObject *list = PyList_New(static_cast<Py_ssize_t>(deliveries.size()));
+    if (!list) return nullptr;
+    for (size_t i = 0; i < deliveries.size(); ++i) {
+        PyObject *item = deliveryToDict(deliveries[i]);
+        if (!item) {
+            Py_DECREF(list);
+            return nullptr;
+        }
+        PyList_SET_ITEM(list, static_cast<Py_ssize_t>(i), item);
+    }
+    return list;
+}
+
+struct EngineObject {
+    PyObject_HEAD
+    DeliveryManager *manager;
+    ReportManager *reports;
+};
+
+PyObject *Engine_new(PyTypeObject *type, PyObject *, PyObject *)
+{
+    EngineObject *self = reinterpret_cast<EngineObject *>(type->tp_alloc(type, 0));
+    if (self) {
+        self->manager = nullptr;
+        self->reports = nullptr;
+    }
+    return reinterpret_cast<PyObject *>(self);
+}
+
+int Engine_init(EngineObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"wal", "verbose", nullptr};
+    const char *walPath = nullptr;
+    int verbose = 0;
+    if (!PyArg_ParseTupleAndKeywords(args, kwargs, "|zp", const_cast<char **>(keywords), &walPath, &verbose)) {
+        return -1;
+    }
+    bool opened = true;
+    withEngine([&]() {
+        delete self->reports;
+        delete self->manager;
+        self->reports = nullptr;
+        self->manager = new DeliveryManager();
+        self->manager->setVerbose(verbose != 0);
+        self->reports = new ReportManager(*self->manager);
+        if (walPath) opened = self->manager->enableWriteAheadLog(walPath);
+    });
+    if (!opened) {
+        PyErr_Format(PyExc_OSError, "could not open write-ahead log %s", walPath);
+        return -1;
+    }
+    return 0;
+}
+
+void Engine_dealloc(EngineObject *self)
+{
+    withEngine([&]() {
+        delete self->reports;
+        delete self->manager;
+    });
+    Py_TYPE(self)->tp_free(reinterpret_cast<PyObject *>(self));
+}
+
+bool ready(EngineObject *self)
+{
+    if (self->manager) return true;
+    PyErr_SetString(PyExc_RuntimeError, "Engine is not initialised");
+    return false;
+}
+
+PyObject *Engine_add(EngineObject *self, PyObject *args)
+{
+    const char *id, *destination;
+    PyObject *typeValue;
+    int estimatedTime;
+    if (!ready(self) || !PyArg_ParseTuple(args, "ssOi", &id, &destination, &typeValue, &estimatedTime)) return nullptr;
+    DeliveryType type;
+    if (!parseType(typeValue, type)) {
+        PyErr_SetString(PyExc_ValueError, "Invalid delivery type");
+        return nullptr;
+    }
+    Delivery delivery(id, destination, type, estimatedTime);
+    withEngine([&]() { self->manager->addDelivery(delivery); });
+    return deliveryToDict(delivery);
+}
+
+// add_batch(iterable of (id, destination, type, estimated_time)) -> count
+PyObject *Engine_add_batch(EngineObject *self, PyObject *items)
+{
+    if (!ready(self)) return nullptr;
+    PyObject *sequence = PySequence_Fast(items, "add_batch expects a sequence of tuples");
+    if (!sequence) return nullptr;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(sequence);
+    std::vector<Delivery> batch;
+    batch.reserve(static_cast<size_t>(n));
+    for (Py_ssize_t i = 0; i < n; ++i) {
+        PyObject *item = PySequence_Fast_GET_ITEM(sequence, i);
+        const char *id, *destination;
+        PyObject *typeValue;
+        int estimatedTime;
+        DeliveryType type;
+        if (!PyArg_ParseTuple(item, "ssOi", &id, &destination, &typeValue, &estimatedTime)) {
+            Py_DECREF(sequence);
+            return nullptr;
+        }
+        if (!parseType(typeValue, type)) {
+            Py_DECREF(sequence);
+            PyErr_Format(PyExc_ValueError, "Invalid delivery type in item %zd", i);
+            return nullptr;
+        }
+        batch.emplace_back(id, destination, type, estimatedTime);
+    }
+    Py_DECREF(sequence);
+
+    // One bulk insert, scored against one read of the weights and the clock, like addDeliveries()
+    withEngine([&]() {
+        ScoringWeights weights = ScoringWeights::current();
+        time_t now = DeliveryClock::now();
+        for (Delivery &d : batch) {
+            d.entryTime = now;
+            d.calculatePriorityScore(weights, now);
+        }
+        self->manager->addScoredDeliveries(batch);
+    });
+    return PyLong_FromSsize_t(n);
+}
+
+PyObject *Engine_process(EngineObject *self, PyObject *)
+{
+    if (!ready(self)) return nullptr;
+    std::vector<Delivery> processed; // Empty when every queue was empty
+    DeliveryType source = URGENT;
+    withEngine([&]() {
+        if (!self->manager->hasDeliveries()) return;
+        processed.push_back(self->manager->processNextDelivery());
+        source = self->manager->getLastDispatchQueue();
+    });
+    if (processed.empty()) Py_RETURN_NONE;
+    PyObject *dict = deliveryToDict(processed.front());
+    if (!dict) return nullptr;
+    return Py_BuildValue("(Ns)", dict, queueName(source));
+}
+
+// process_batch(n) -> list of up to n processed deliveries
+PyObject *Engine_process_batch(EngineObject *self, PyObject *args)
+{
+    Py_ssize_t limit;
+    if (!ready(self) || !PyArg_ParseTuple(args, "n", &limit)) return nullptr;
+    std::vector<Delivery> processed;
+    withEngine([&]() {
+        processed.reserve(static_cast<size_t>(std::max<Py_ssize_t>(0, std::min<Py_ssize_t>(limit, self->manager->getTotalQueueSize()))));
+        for (Py_ssize_t i = 0; i < limit && self->manager->hasDeliveries(); ++i) {
+            processed.push_back(self->manager->processNextDelivery());
+        }
+    });
+    return deliveriesToList(processed);
+}
+
+PyObject *Engine_cancel(EngineObject *self, PyObject *args)
+{
+    const char *id;
+    if (!ready(self) || !PyArg_ParseTuple(args, "s", &id)) return nullptr;
+    bool cancelled = false;
+    withEngine([&]() { cancelled = self->manager->cancelDeliveryById(id); });
+    return PyBool_FromLong(cancelled);
+}
+
+PyObject *Engine_find(EngineObject *self, PyObject *args)
+{
+    const char *id;
+    if (!ready(self) || !PyArg_ParseTuple(args, "s", &id)) return nullptr;
+    DeliveryLookup lookup;
+    std::vector<Delivery> queued; // Copy of the delivery, lookup.delivery dangles once the lock is released
+    withEngine([&]() {
+        lookup = self->manager->findDelivery(id);
+        if (lookup.status == STATUS_QUEUED) queued.push_back(*lookup.delivery);
+    });
+    if (lookup.status == STATUS_UNKNOWN) Py_RETURN_NONE;
+    if (lookup.status != STATUS_QUEUED) return Py_BuildValue("{s:s}", "status", statusName(lookup.status));
+    PyObject *delivery = deliveryToDict(queued.front());
+    if (!delivery) return nullptr;
+    return Py_BuildValue("{s:s,s:s,s:i,s:d,s:N}", "status", statusName(lookup.status),
+                         "queue", queueName(static_cast<DeliveryType>(lookup.queue)), "slot", lookup.slot,
+                         "priorityScore", lookup.priorityScore, "delivery", delivery);
+}
+
+PyObject *Engine_position(EngineObject *self, PyObject *args)
+{
+    const char *id;
+    if (!ready(self) || !PyArg_ParseTuple(args, "s", &id)) return nullptr;
+    QueuePosition position;
+    withEngine([&]() { position = self->manager->getQueuePosition(id); });
+    if (!position.queued) Py_RETURN_NONE;
+    PyObject *eta = Py_None; // No dispatches yet to estimate from
+    if (position.etaMinutes >= 0.0) {
+        eta = PyFloat_FromDouble(position.etaMinutes);
+        if (!eta) return nullptr;
+    } else {
+        Py_INCREF(eta);
+    }
+    return Py_BuildValue("{s:s,s:n,s:n,s:N}", "queue", queueName(static_cast<DeliveryType>(position.queue)), "rank",
+                         static_cast<Py_ssize_t>(position.rank), "queueSize", static_cast<Py_ssize_t>(position.queueSize),
+                         "etaMinutes", eta);
+}
+
+PyObject *Engine_page(EngineObject *self, PyObject *args)
+{
+    PyObject *typeValue;
+    Py_ssize_t offset = 0, limit = 20;
+    if (!ready(self) || !PyArg_ParseTuple(args, "O|nn", &typeValue, &offset, &limit)) return nullptr;
+    DeliveryType type;
+    if (!parseType(typeValue, type) || offset < 0 || limit < 0) {
+        PyErr_SetString(PyExc_ValueError, "Invalid delivery type, offset or limit");
+        return nullptr;
+    }
+    std::vector<Delivery> items;
+    withEngine([&]() { items = self->manager->getQueuePage(type, static_cast<size_t>(offset), static_cast<size_t>(limit)); });
+    return deliveriesToList(items);
+}
+
+// {"urgent": [...], "fragile": [...], "standard": [...]}, each highest score first
+PyObject *Engine_queues(EngineObject *self, PyObject *)
+{
+    if (!ready(self)) return nullptr;
+    const DeliveryType order[3] = {URGENT, FRAGILE, STANDARD};
+    std::vector<Delivery> items[3];
+    withEngine([&]() {
+        for (int i = 0; i < 3; ++i) {
+            items[i] = self->manager->getQueuePage(order[i], 0, self->manager->getQueueData(order[i]).size());
+        }
+    });
+    PyObject *result = PyDict_New();
+    if (!result) return nullptr;
+    for (int i = 0; i < 3; ++i) {
+        PyObject *list = deliveriesToList(items[i]);
+        if (!list || PyDict_SetItemString(result, queueName(order[i]), list) != 0) {
+            Py_XDECREF(list);
+            Py_DECREF(result);
+            return nullptr;
+        }
+        Py_DECREF(list);
+    }
+    return result;
+}
+
+PyObject *Engine_processed(EngineObject *self, PyObject *args)
+{
+    Py_ssize_t limit = 10;
+    if (!ready(self) || !PyArg_ParseTuple(args, "|n", &limit)) return nullptr;
+    std::vector<Delivery> newestFirst;
+    withEngine([&]() {
+        const std::deque<Delivery> &history = self->manager->getProcessedDeliveries();
+        size_t shown = limit < 0 ? history.size() : std::min(history.size(), static_cast<size_t>(limit));
+        newestFirst.assign(history.rbegin(), history.rbegin() + shown);
+    });
+    return deliveriesToList(newestFirst);
+}
+
+PyObject *Engine_stats(EngineObject *self, PyObject *)
+{
+    if (!ready(self)) return nullptr;
+    int urgent = 0, fragile = 0, standard = 0;
+    long long pending = 0, processed = 0;
+    unsigned long long cancelled = 0;
+    withEngine([&]() {
+        const DeliveryManager &m = *self->manager;
+        urgent = m.getUrgentQueueSize();
+        fragile = m.getFragileQueueSize();
+        standard = m.getStandardQueueSize();
+        pending = m.getTotalQueueSize();
+        processed = static_cast<long long>(m.getMetrics().getTotalProcessed());
+        cancelled = static_cast<unsigned long long>(m.getMetrics().getTotalCancelled());
+    });
+    return Py_BuildValue("{s:{s:i,s:i,s:i,s:L},s:L,s:L,s:K}",
+                         "pending", "urgent", urgent, "fragile", fragile, "standard", standard, "total", pending,
+                         "processed", processed, "total", pending + processed, "cancelled", cancelled);
+}
+
+PyObject *Engine_update_priorities(EngineObject *self, PyObject *)
+{
+    if (!ready(self)) return nullptr;
+    withEngine([&]() { self->manager->updatePriorities(); });
+    Py_RETURN_NONE;
+}
+
+PyObject *Engine_merge_queues(EngineObject *self, PyObject *)
+{
+    if (!ready(self)) return nullptr;
+    withEngine([&]() { self->manager->mergeQueues(); });
+    Py_RETURN_NONE;
+}
+
+// generate_report(filter_type="", sort_by="", top_n=0, echo=False): writes delivery_report.csv
+PyObject *Engine_generate_report(EngineObject *self, PyObject *args, PyObject *kwargs)
+{
+    static const char *keywords[] = {"filter_type", "sort_by", "top_n", "echo", nullptr};
+    const char *filterType = "";
+    const char *sortBy = "";
+    Py_ssize_t topN = 0;
+    int echo = 0;
+    if (!ready(self) ||
+        !PyArg_ParseTupleAndKeywords(args, kwargs, "|ssnp", const_cast<char **>(keywords), &filterType, &sortBy, &topN, &echo)) {
+        return nullptr;
+    }
+    std::string filter(filterType), sort(sortBy);
+    withEngine([&]() { self->reports->generateReport(filter, sort, static_cast<size_t>(std::max<Py_ssize_t>(0, topN)), echo != 0); });
+    Py_RETURN_NONE;
+}
+
+PyObject *Engine_sync(EngineObject *self, PyObject *)
+{
+    if (!ready(self)) return nullptr;
+    bool synced = false;
+    withEngine([&]() { synced = self->manager->syncLog(); });
+    if (!synced) {
+        PyErr_SetString(PyExc_OSError, "could not commit the write-ahead log");
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyMethodDef engineMethods[] = {
+    {"add", reinterpret_cast<PyCFunction>(Engine_add), METH_VARARGS,
+     "add(id, destination, type, estimated_time) -> delivery dict"},
+    {"add_batch", reinterpret_cast<PyCFunction>(Engine_add_batch), METH_O,
+     "add_batch(items) -> count; items are (id, destination, type, estimated_time); runs without the GIL"},
+    {"process", reinterpret_cast<PyCFunction>(Engine_process), METH_NOARGS,
+     "process() -> (delivery dict, source queue) or None when every queue is empty"},
+    {"process_batch", reinterpret_cast<PyCFunction>(Engine_process_batch), METH_VARARGS,
+     "process_batch(n) -> list of up to n processed deliveries; runs without the GIL"},
+    {"cancel", reinterpret_cast<PyCFunction>(Engine_cancel), METH_VARARGS, "cancel(id) -> bool"},
+    {"find", reinterpret_cast<PyCFunction>(Engine_find), METH_VARARGS, "find(id) -> status dict or None"},
+    {"position", reinterpret_cast<PyCFunction>(Engine_position), METH_VARARGS,
+     "position(id) -> {'queue', 'rank', 'queueSize', 'etaMinutes'} or None when not queued; O(log n)"},
+    {"page", reinterpret_cast<PyCFunction>(Engine_page), METH_VARARGS,
+     "page(type, offset=0, limit=20) -> queued deliveries of that queue in dispatch order; O(log n + limit)"},
+    {"queues", reinterpret_cast<PyCFunction>(Engine_queues), METH_NOARGS,
+     "queues() -> {'urgent': [...], 'fragile': [...], 'standard': [...]}, highest score first"},
+    {"processed", reinterpret_cast<PyCFunction>(Engine_processed), METH_VARARGS,
+     "processed(limit=10) -> most recent processed deliveries, newest first (limit < 0: all retained)"},
+    {"stats", reinterpret_cast<PyCFunction>(Engine_stats), METH_NOARGS, "stats() -> pending/processed counts"},
+    {"update_priorities", reinterpret_cast<PyCFunction>(Engine_update_priorities), METH_NOARGS,
+     "Recalculate scores and apply the fairness boost"},
+    {"merge_queues", reinterpret_cast<PyCFunction>(Engine_merge_queues), METH_NOARGS,
+     "Move waiting deliveries into an empty urgent queue"},
+    {"generate_report", reinterpret_cast<PyCFunction>(Engine_generate_report), METH_VARARGS | METH_KEYWORDS,
+     "generate_report(filter_type='', sort_by='', top_n=0, echo=False): write delivery_report.csv"},
+    {"sync", reinterpret_cast<PyCFunction>(Engine_sync), METH_NOARGS, "Commit and fsync the write-ahead log"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+PyTypeObject EngineType = {PyVarObject_HEAD_INIT(nullptr, 0)};
+
+PyObject *module_get_settings(PyObject *, PyObject *)
+{
+    std::vector<std::pair<std::string, double>> settings;
+    withEngine([&]() { settings = ConfigurationManager::getSettings(); });
+    PyObject *result = PyDict_New();
+    if (!result) return nullptr;
+    for (const auto &setting : settings) {
+        PyObject *value = PyFloat_FromDouble(setting.second);
+        if (!value || PyDict_SetItemString(result, setting.first.c_str(), value) != 0) {
+            Py_XDECREF(value);
+            Py_DECREF(result);
+            return nullptr;
+        }
+        Py_DECREF(value);
+    }
+    return result;
+}
+
+PyObject *module_set_setting(PyObject *, PyObject *args)
+{
+    const char *key;
+    double value;
+    if (!PyArg_ParseTuple(args, "sd", &key, &value)) return nullptr;
+    // Settings are stored as int or float; anything else has no defined conversion
+    if (!std::isfinite(value) || std::fabs(value) > INT_MAX) {
+        PyErr_Format(PyExc_ValueError, "setting %s must be a finite number within the int range", key);
+        return nullptr;
+    }
+    bool known = false;
+    withEngine([&]() { known = ConfigurationManager::updateSetting(key, value); });
+    if (!known) {
+        PyErr_Format(PyExc_KeyError, "unknown setting %s", key);
+        return nullptr;
+    }
+    Py_RETURN_NONE;
+}
+
+PyMethodDef moduleMethods[] = {
+    {"get_settings", module_get_settings, METH_NOARGS, "get_settings() -> {key: value} of the engine configuration"},
+    {"set_setting", module_set_setting, METH_VARARGS,
+     "set_setting(key, value), e.g. ('weight.urgency', 1.5) or ('max_wait_time', 20)"},
+    {nullptr, nullptr, 0, nullptr}
+};
+
+PyModuleDef engineModule = {
+    PyModuleDef_HEAD_INIT, "sqs_engine", "In-process bindings for the Smart Queue C++ delivery engine.", -1,
+    moduleMethods, nullptr, nullptr, nullptr, nullptr
+};
+
+} // namespace
+
+PyMODINIT_FUNC PyInit_sqs_engine(void)
+{
+    ConfigurationManager::initialize();
+
+    EngineType.tp_name = "sqs_engine.Engine";
+    EngineType.tp_doc = "Engine(wal=None, verbose=False): a DeliveryManager with its ReportManager";
+    EngineType.tp_basicsize = sizeof(EngineObject);
+    EngineType.tp_flags = Py_TPFLAGS_DEFAULT;
+    EngineType.tp_new = Engine_new;
+    EngineType.tp_init = reinterpret_cast<initproc>(Engine_init);
+    EngineType.tp_dealloc = reinterpret_cast<destructor>(Engine_dealloc);
+    EngineType.tp_methods = engineMethods;
+    if (PyType_Ready(&EngineType) < 0) return nullptr;
+
+    PyObject *module = PyModule_Create(&engineModule);
+    if (!module) return nullptr;
+    Py_INCREF(&EngineType);
+    if (PyModule_AddObject(module, "Engine", reinterpret_cast<PyObject *>(&EngineType)) < 0) {
+        Py_DECREF(&EngineType);
+        Py_DECREF(module);
+        return nullptr;
+    }
+    return module;
+}
@@ -0,0 +1,190 @@
+#include "ChangeFeed.h"
+#include "DeliveryService.h"
+#include "Json.h"
+#include <algorithm>
+#include <cstdlib>
+
+const char *const ChangeFeed::ROW_FIELDS =
+    "[\"id\", \"destination\", \"type\", \"estimatedTime\", \"priorityScore\", \"entryTime\", \"queue\"]";
+
+ChangeFeed::ChangeFeed(DeliveryManager &dm, size_t historyLimitBytes)
+    : manager(dm), publishedSeq(dm.getChangeSequence()), historyBytes(0), historyLimitBytes(historyLimitBytes)
+{
+    manager.setChangeListener(&ChangeFeed::onChange, this);
+}
+
+ChangeFeed::~ChangeFeed()
+{
+    manager.setChangeListener(nullptr, nullptr);
+}
+
+void ChangeFeed::onChange(void *context, const DeliveryChange &change)
+{
+    static_cast<ChangeFeed *>(context)->record(change);
+}
+
+void ChangeFeed::record(const DeliveryChange &change)
+{
+    const Delivery &d = *change.delivery;
+    auto found = pendingById.find(d.deliveryId);
+    if (found == pendingById.end()) {
+        found = pendingById.emplace(d.deliveryId, pending.size()).first;
+        pending.push_back(Pending{PENDING_UPSERT, change.type == CHANGE_ADD, change.queue, d});
+    }
+    Pending &p = pending[found->second];
+    p.delivery = d;
+    switch (change.type) {
+    case CHANGE_ADD:
+        if (p.kind == PENDING_DROPPED) p.addedThisInterval = true;
+        p.kind = PENDING_UPSERT;
+        p.queue = change.queue;
+        break;
+    case CHANGE_RESCORE:
+    case CHANGE_MERGE:
+        p.kind = PENDING_UPSERT;
+        p.queue = change.queue;
+        break;
+    case CHANGE_DISPATCH:
+        p.kind = PENDING_DISPATCHED;
+        p.queue = change.fromQueue;
+        break;
+    case CHANGE_CANCEL:
+        p.kind = p.addedThisInterval ? PENDING_DROPPED : PENDING_CANCELLED;
+        p.queue = change.fromQueue;
+        break;
+    }
+}
+
+void ChangeFeed::appendRow(std::string &out, const Delivery &d, int queue)
+{
+    out += "[";
+    appendJsonString(out, d.deliveryId);
+    out += ", ";
+    appendJsonString(out, d.destination);
+    out += ", \"";
+    out += DeliveryService::typeName(d.deliveryType);
+    out += "\", ";
+    appendJsonNumber(out, static_cast<long long>(d.estimatedDeliveryTime));
+    out += ", ";
+    appendJsonNumber(out, d.priorityScore);
+    out += ", ";
+    appendJsonNumber(out, static_cast<long long>(d.entryTime));
+    if (queue >= URGENT && queue <= FRAGILE) {
+        out += ", \"";
+        out += DeliveryService::queueName(static_cast<DeliveryType>(queue));
+        out += "\"]";
+    } else {
+        out += ", null]";
+    }
+}
+
+bool ChangeFeed::publish(std::string &event)
+{
+    uint64_t seq = manager.getChangeSequence();
+    bool anyVisible = false;
+    for (const Pending &p : pending) {
+        if (p.kind != PENDING_DROPPED) anyVisible = true;
+    }
+    if (!anyVisible) {
+        // Nothing a client would see; the next event's range simply starts earlier
+        pending.clear();
+        pendingById.clear();
+        return false;
+    }
+
+    std::string text = "id: ";
+    appendJsonNumber(text, static_cast<long long>(seq));
+    text += "\nevent: delta\ndata: {\"from\": ";
+    appendJsonNumber(text, static_cast<long long>(publishedSeq));
+    text += ", \"seq\": ";
+    appendJsonNumber(text, static_cast<long long>(seq));
+    text += ", \"processedTotal\": ";
+    appendJsonNumber(text, static_cast<long long>(manager.getMetrics().getTotalProcessed()));
+    const PendingKind sections[] = {PENDING_UPSERT, PENDING_DISPATCHED, PENDING_CANCELLED};
+    const char *names[] = {"upsert", "dispatched", "cancelled"};
+    for (int s = 0; s < 3; ++s) {
+        text += ", \"";
+        text += names[s];
+        text += "\": [";
+        bool first = true;
+        for (const Pending &p : pending) {
+            if (p.kind != sections[s]) continue;
+            if (!first) text += ", ";
+            first = false;
+            if (p.kind == PENDING_CANCELLED) {
+                appendJsonString(text, p.delivery.deliveryId); // The client only needs to drop it
+            } else {
+                appendRow(text, p.delivery, p.queue);
+            }
+        }
+        text += "]";
+    }
+    text += "}\n\n";
+
+    pending.clear();
+    pendingById.clear();
+    event += text;
+
+    history.push_back(PublishedEvent{publishedSeq, seq, std::move(text)});
+    historyBytes += history.back().text.size();
+    while (history.size() > 1 && historyBytes > historyLimitBytes) {
+        historyBytes -= history.front().text.size();
+        history.pop_front();
+    }
+    publishedSeq = seq;
+    return true;
+}
+
+void ChangeFeed::resync(const std::string &since, std::string &out) const
+{
+    char *end = nullptr;
+    unsigned long long position = std::strtoull(since.c_str(), &end, 10);
+    bool known = !since.empty() && end && *end == '\0' && position <= manager.getChangeSequence();
+    if (known && position >= publishedSeq) {
+        return; // Up to date; anything newer arrives with the next delta
+    }
+    if (known && !history.empty() && history.front().fromSeq <= position) {
+        for (const PublishedEvent &e : history) {
+            if (e.seq > position) out += e.text;
+        }
+        return;
+    }
+    appendSnapshot(out);
+}
+
+void ChangeFeed::appendSnapshot(std::string &out) const
+{
+    // Rows in heap order: the client keeps its own ordering, and a 1M-entry
+    // queue is not sorted here just to be re-sorted there
+    long long seq = static_cast<long long>(manager.getChangeSequence());
+    out += "id: ";
+    appendJsonNumber(out, seq);
+    out += "\nevent: snapshot\ndata: {\"seq\": ";
+    appendJsonNumber(out, seq);
+    out += ", \"fields\": ";
+    out += ROW_FIELDS;
+    out += ", \"processedTotal\": ";
+    appendJsonNumber(out, static_cast<long long>(manager.getMetrics().getTotalProcessed()));
+    out += ", \"queues\": {";
+    const DeliveryType order[] = {URGENT, FRAGILE, STANDARD};
+    for (int q = 0; q < 3; ++q) {
+        if (q > 0) out += ", ";
+        out += "\"";
+        out += DeliveryService::queueName(order[q]);
+        out += "\": [";
+        const std::vector<Delivery> &heap = manager.getQueueData(order[q]);
+        for (size_t i = 0; i < heap.size(); ++i) {
+            if (i > 0) out += ", ";
+            appendRow(out, heap[i], order[q]);
+        }
+        out += "]";
+    }
+    out += "}, \"processed\": [";
+    const std::deque<Delivery> &processed = manager.getProcessedDeliveries();
+    size_t shown = std::min<size_t>(processed.size(), DeliveryService::PROCESSED_SHOWN);
+    for (size_t i = 0; i < shown; ++i) {
+        if (i > 0) out += ", ";
+        appendRow(out, processed[processed.size() - 1 - i], -1);
+    }
+    out += "]}\n\n";
+}
@@ -0,0 +1,76 @@
+#ifndef CHANGE_FEED_H
+#define CHANGE_FEED_H
+
+#include <deque>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../DeliveryManager.h"
+
+// Turns a DeliveryManager's change stream into Server-Sent Events for the
+// dashboard.
+//
+// Changes are coalesced per delivery ID between publish() calls: a delivery
+// added and re-scored three times in one interval is sent once with its
+// final state, and one added and cancelled in the same interval is not sent
+// at all. Each published event carries the change sequence number it brings
+// a client up to (the SSE id), and recent events are kept so a reconnecting
+// client (Last-Event-ID or ?since=) receives only what it missed. A client
+// with no usable position gets a snapshot instead.
+//
+// Rows are JSON arrays in ROW_FIELDS order:
+//   [id, destination, type, estimatedTime, priorityScore, entryTime, queue]
+// Applying a delta twice, or a delta that overlaps a snapshot, is harmless.
+class ChangeFeed {
+private:
+    enum PendingKind { PENDING_UPSERT, PENDING_DISPATCHED, PENDING_CANCELLED, PENDING_DROPPED };
+
+    struct Pending {
+        PendingKind kind;
+        bool addedThisInterval; // Unseen by clients, so a cancel can drop it outright
+        int queue;              // Current queue, or the one it left
+        Delivery delivery;
+    };
+
+    struct PublishedEvent {
+        uint64_t fromSeq;       // Covers changes (fromSeq, seq]
+        uint64_t seq;
+        std::string text;
+    };
+
+    DeliveryManager &manager;
+    std::vector<Pending> pending;
+    std::unordered_map<std::string, size_t> pendingById; // ID -> index into pending
+    uint64_t publishedSeq;
+    uint64_t processedTotal;
+    std::deque<PublishedEvent> history;
+    size_t historyBytes;
+    size_t historyLimitBytes;
+
+    static void onChange(void *context, const DeliveryChange &change);
+    void record(const DeliveryChange &change);
+    void appendSnapshot(std::string &out) const;
+
+public:
+    static const char *const ROW_FIELDS;
+
+    ChangeFeed(DeliveryManager &dm, size_t historyLimitBytes = 8 << 20);
+    ~ChangeFeed();
+    ChangeFeed(const ChangeFeed &) = delete;
+    ChangeFeed &operator=(const ChangeFeed &) = delete;
+
+    // Appends one "delta" event covering everything since the last call;
+    // false (and nothing appended) when nothing changed
+    bool publish(std::string &event);
+
+    // What a new subscriber needs first: the events after `since` when they
+    // are still retained, otherwise a "snapshot" event
+    void resync(const std::string &since, std::string &out) const;
+
+    uint64_t getPublishedSeq() const { return publishedSeq; }
+    size_t getPendingCount() const { return pendingById.size(); }
+
+    static void appendRow(std::string &out, const Delivery &d, int queue);
+};
+
+#endif // CHANGE_FEED_H
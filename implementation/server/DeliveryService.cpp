@@ -0,0 +1,345 @@
+#include "DeliveryService.h"
+#include "Json.h"
+#include <algorithm>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <cstdio>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+
+namespace {
+
+const char *contentTypeFor(std::string_view path)
+{
+    size_t dot = path.rfind('.');
+    std::string_view ext = dot == std::string_view::npos ? std::string_view() : path.substr(dot + 1);
+    if (ext == "html") return "text/html; charset=utf-8";
+    if (ext == "js") return "application/javascript";
+    if (ext == "css") return "text/css";
+    if (ext == "ico") return "image/x-icon";
+    if (ext == "json") return "application/json";
+    if (ext == "png") return "image/png";
+    if (ext == "svg") return "image/svg+xml";
+    return "application/octet-stream";
+}
+
+void appendTimestamp(std::string &out, time_t t)
+{
+    std::tm utc;
+#ifdef _WIN32
+    gmtime_s(&utc, &t);
+#else
+    gmtime_r(&t, &utc);
+#endif
+    char buffer[32];
+    size_t n = std::strftime(buffer, sizeof(buffer), "%Y-%m-%dT%H:%M:%SZ", &utc);
+    out.push_back('"');
+    out.append(buffer, n);
+    out.push_back('"');
+}
+
+bool parseType(std::string name, DeliveryType &type)
+{
+    std::transform(name.begin(), name.end(), name.begin(), [](unsigned char c) { return static_cast<char>(std::toupper(c)); });
+    if (name == "URGENT") type = URGENT;
+    else if (name == "STANDARD") type = STANDARD;
+    else if (name == "FRAGILE") type = FRAGILE;
+    else return false;
+    return true;
+}
+
+// Value of name=... in a query string, empty when absent (IDs need no percent-decoding)
+std::string queryParam(std::string_view query, std::string_view name)
+{
+    while (!query.empty()) {
+        size_t amp = query.find('&');
+        std::string_view param = query.substr(0, amp);
+        if (param.size() > name.size() && param.substr(0, name.size()) == name && param[name.size()] == '=') {
+            return std::string(param.substr(name.size() + 1));
+        }
+        query = amp == std::string_view::npos ? std::string_view() : query.substr(amp + 1);
+    }
+    return std::string();
+}
+
+} // namespace
+
+DeliveryService::DeliveryService(DeliveryManager &dm, const std::string &staticRoot)
+    : manager(dm), staticRoot(staticRoot), deliveriesBodyValid(false), feed(dm) {}
+
+const char *DeliveryService::typeName(DeliveryType type)
+{
+    switch (type) {
+    case URGENT: return "URGENT";
+    case FRAGILE: return "FRAGILE";
+    default: return "STANDARD";
+    }
+}
+
+const char *DeliveryService::queueName(DeliveryType type)
+{
+    switch (type) {
+    case URGENT: return "urgent";
+    case FRAGILE: return "fragile";
+    default: return "standard";
+    }
+}
+
+void DeliveryService::appendDelivery(std::string &out, const Delivery &d)
+{
+    out += "{\"id\": ";
+    appendJsonString(out, d.deliveryId);
+    out += ", \"destination\": ";
+    appendJsonString(out, d.destination);
+    out += ", \"type\": \"";
+    out += typeName(d.deliveryType);
+    out += "\", \"estimatedTime\": ";
+    appendJsonNumber(out, static_cast<long long>(d.estimatedDeliveryTime));
+    out += ", \"priorityScore\": ";
+    appendJsonNumber(out, d.priorityScore);
+    out += ", \"timestamp\": ";
+    appendTimestamp(out, d.entryTime);
+    out += "}";
+}
+
+void DeliveryService::error(HttpResponse &res, int status, const std::string &message)
+{
+    res.status = status;
+    res.body = "{\"error\": ";
+    appendJsonString(res.body, message);
+    res.body += "}";
+}
+
+void DeliveryService::handle(const HttpRequest &req, HttpResponse &res)
+{
+    std::string_view path = req.path;
+    if (req.method == "OPTIONS") {
+        // CORS preflight, as flask_cors answers it
+        res.status = 204;
+        res.headers = "Access-Control-Allow-Methods: GET, POST, OPTIONS\r\n"
+                      "Access-Control-Allow-Headers: Content-Type\r\n";
+        return;
+    }
+    if (path.substr(0, 4) != "/api") {
+        if (req.method == "GET" && !staticRoot.empty()) {
+            serveStatic(path, res);
+        } else {
+            error(res, 404, "Not found");
+        }
+        return;
+    }
+    path.remove_prefix(4);
+
+    if (path == "/deliveries") {
+        if (req.method == "GET") listDeliveries(res);
+        else if (req.method == "POST") addDelivery(req, res);
+        else error(res, 405, "Method not allowed");
+    } else if (path == "/deliveries/process" || path == "/deliveries/cpp-process") {
+        if (req.method == "POST") processDelivery(res);
+        else error(res, 405, "Method not allowed");
+    } else if (path == "/deliveries/stats") {
+        if (req.method == "GET") stats(res);
+        else error(res, 405, "Method not allowed");
+    } else if (path == "/deliveries/events") {
+        if (req.method == "GET") subscribe(req, res);
+        else error(res, 405, "Method not allowed");
+    } else if (path == "/deliveries/position") {
+        if (req.method == "GET") position(req, res);
+        else error(res, 405, "Method not allowed");
+    } else {
+        error(res, 404, "Not found");
+    }
+}
+
+void DeliveryService::listDeliveries(HttpResponse &res)
+{
+    if (!deliveriesBodyValid) {
+        // Heap arrays are only partially ordered; the API lists each queue
+        // highest score first, read off the manager's order-statistic trees
+        std::string &out = deliveriesBody;
+        out.clear();
+        out += "{\"deliveries\": {";
+        const DeliveryType order[] = {URGENT, FRAGILE, STANDARD};
+        for (int q = 0; q < 3; ++q) {
+            DeliveryType type = order[q];
+            std::vector<Delivery> items = manager.getQueuePage(type, 0, manager.getQueueData(type).size());
+            if (q > 0) out += ", ";
+            out += "\"";
+            out += queueName(type);
+            out += "\": [";
+            for (size_t i = 0; i < items.size(); ++i) {
+                if (i > 0) out += ", ";
+                appendDelivery(out, items[i]);
+            }
+            out += "]";
+        }
+        out += "}, \"processed\": [";
+        const std::deque<Delivery> &processed = manager.getProcessedDeliveries();
+        size_t shown = std::min<size_t>(processed.size(), PROCESSED_SHOWN);
+        for (size_t i = 0; i < shown; ++i) {
+            if (i > 0) out += ", ";
+            appendDelivery(out, processed[processed.size() - 1 - i]);
+        }
+        out += "]}";
+        deliveriesBodyValid = true;
+    }
+    res.body = deliveriesBody;
+}
+
+void DeliveryService::addDelivery(const HttpRequest &req, HttpResponse &res)
+{
+    std::vector<std::pair<std::string, JsonValue>> fields;
+    if (!parseJsonObject(req.body, fields)) {
+        error(res, 400, "Invalid JSON body");
+        return;
+    }
+    const char *required[] = {"id", "destination", "type", "estimatedTime"};
+    const JsonValue *values[4] = {nullptr, nullptr, nullptr, nullptr};
+    for (const auto &field : fields) {
+        for (int i = 0; i < 4; ++i) {
+            if (field.first == required[i]) values[i] = &field.second;
+        }
+    }
+    for (int i = 0; i < 4; ++i) {
+        if (!values[i]) {
+            error(res, 400, std::string("Missing required field: ") + required[i]);
+            return;
+        }
+    }
+    DeliveryType type;
+    if (values[2]->kind != JsonValue::JSON_STRING || !parseType(values[2]->text, type)) {
+        error(res, 400, "Invalid delivery type");
+        return;
+    }
+    if (values[3]->kind != JsonValue::JSON_NUMBER) {
+        error(res, 400, "estimatedTime must be a number");
+        return;
+    }
+    // Checked before the int conversion, which is undefined for NaN or out-of-range values
+    double minutes = values[3]->number;
+    if (!std::isfinite(minutes) || minutes < 0 || minutes > INT_MAX) {
+        error(res, 400, "estimatedTime must be between 0 and 2147483647 minutes");
+        return;
+    }
+
+    Delivery delivery(values[0]->text, values[1]->text, type, static_cast<int>(minutes));
+    manager.addDelivery(delivery); // Scores it with the configured weights
+    deliveriesBodyValid = false;
+
+    res.status = 201;
+    res.body = "{\"message\": ";
+    appendJsonString(res.body, "Delivery " + delivery.deliveryId + " added successfully");
+    res.body += ", \"delivery\": ";
+    appendDelivery(res.body, delivery);
+    res.body += "}";
+}
+
+void DeliveryService::processDelivery(HttpResponse &res)
+{
+    if (!manager.hasDeliveries()) {
+        error(res, 404, "No deliveries to process");
+        return;
+    }
+    Delivery processed = manager.processNextDelivery();
+    DeliveryType source = manager.getLastDispatchQueue();
+    deliveriesBodyValid = false;
+
+    res.body = "{\"message\": ";
+    appendJsonString(res.body, "Processing delivery " + processed.deliveryId);
+    res.body += ", \"delivery\": ";
+    appendDelivery(res.body, processed);
+    res.body += ", \"source_queue\": \"";
+    res.body += queueName(source);
+    res.body += "\"}";
+}
+
+void DeliveryService::stats(HttpResponse &res)
+{
+    long long urgent = manager.getUrgentQueueSize();
+    long long fragile = manager.getFragileQueueSize();
+    long long standard = manager.getStandardQueueSize();
+    long long pending = urgent + fragile + standard;
+    long long processed = static_cast<long long>(manager.getMetrics().getTotalProcessed());
+
+    std::string &out = res.body;
+    out = "{\"pending\": {\"urgent\": ";
+    appendJsonNumber(out, urgent);
+    out += ", \"fragile\": ";
+    appendJsonNumber(out, fragile);
+    out += ", \"standard\": ";
+    appendJsonNumber(out, standard);
+    out += ", \"total\": ";
+    appendJsonNumber(out, pending);
+    out += "}, \"processed\": ";
+    appendJsonNumber(out, processed);
+    out += ", \"total\": ";
+    appendJsonNumber(out, pending + processed);
+    out += "}";
+}
+
+void DeliveryService::position(const HttpRequest &req, HttpResponse &res)
+{
+    std::string id = queryParam(req.query, "id");
+    if (id.empty()) {
+        error(res, 400, "Missing required parameter: id");
+        return;
+    }
+    QueuePosition where = manager.getQueuePosition(id);
+    if (!where.queued) {
+        error(res, 404, "Delivery " + id + " is not queued");
+        return;
+    }
+    std::string &out = res.body;
+    out = "{\"id\": ";
+    appendJsonString(out, id);
+    out += ", \"queue\": \"";
+    out += queueName(static_cast<DeliveryType>(where.queue));
+    out += "\", \"position\": ";
+    appendJsonNumber(out, static_cast<long long>(where.rank + 1));
+    out += ", \"ahead\": ";
+    appendJsonNumber(out, static_cast<long long>(where.rank));
+    out += ", \"queueSize\": ";
+    appendJsonNumber(out, static_cast<long long>(where.queueSize));
+    out += ", \"etaMinutes\": ";
+    if (where.etaMinutes >= 0.0) appendJsonNumber(out, where.etaMinutes);
+    else out += "null"; // Nothing dispatched yet to take a rate from
+    out += "}";
+}
+
+void DeliveryService::subscribe(const HttpRequest &req, HttpResponse &res)
+{
+    // EventSource resends the last id it saw as Last-Event-ID when it reconnects;
+    // ?since= lets a client resume from a position it stored itself
+    std::string since(req.header("Last-Event-ID"));
+    if (since.empty()) since = queryParam(req.query, "since");
+
+    res.stream = true;
+    res.contentType = "text/event-stream";
+    res.headers = "Cache-Control: no-cache\r\nX-Accel-Buffering: no\r\n";
+    res.body = "retry: 1000\n\n";
+    feed.resync(since, res.body);
+}
+
+void DeliveryService::serveStatic(std::string_view path, HttpResponse &res)
+{
+    std::string file(path == "/" || path.empty() ? std::string_view("/index.html") : path);
+    if (file.find("..") != std::string::npos) {
+        error(res, 404, "Not found");
+        return;
+    }
+    auto cached = staticFiles.find(file);
+    if (cached == staticFiles.end()) {
+        std::ifstream in(staticRoot + file, std::ios::binary);
+        if (!in) {
+            error(res, 404, "Not found");
+            return;
+        }
+        std::ostringstream contents;
+        contents << in.rdbuf();
+        cached = staticFiles.emplace(file, contents.str()).first;
+    }
+    res.contentType = contentTypeFor(file);
+    res.body = cached->second;
+}
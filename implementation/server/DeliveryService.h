@@ -0,0 +1,48 @@
+#ifndef DELIVERY_SERVICE_H
+#define DELIVERY_SERVICE_H
+
+#include <string>
+#include <unordered_map>
+#include "HttpServer.h"
+#include "ChangeFeed.h"
+#include "../DeliveryManager.h"
+
+// REST front end over a DeliveryManager, mirroring the Flask blueprint in
+// delivery_gui_web/.../src/routes/delivery.py (same routes under /api, same
+// JSON shapes), plus static files so the existing dashboard can be served as is.
+// GET /api/deliveries/events is a Server-Sent Events stream of queue changes
+// (see ChangeFeed); the server pushes publishChanges() output to it.
+// GET /api/deliveries/position?id= answers "where am I and when": the
+// delivery's place in its queue and an ETA at the observed dispatch rate.
+class DeliveryService {
+private:
+    DeliveryManager &manager;
+    std::string staticRoot;                                  // Empty: API only
+    std::unordered_map<std::string, std::string> staticFiles; // Path -> contents, loaded on first use
+    std::string deliveriesBody;                              // Cached GET /deliveries response
+    bool deliveriesBodyValid;
+    ChangeFeed feed;
+
+    void listDeliveries(HttpResponse &res);
+    void addDelivery(const HttpRequest &req, HttpResponse &res);
+    void processDelivery(HttpResponse &res);
+    void stats(HttpResponse &res);
+    void position(const HttpRequest &req, HttpResponse &res); // GET /api/deliveries/position?id=
+    void subscribe(const HttpRequest &req, HttpResponse &res);
+    void serveStatic(std::string_view path, HttpResponse &res);
+    static void error(HttpResponse &res, int status, const std::string &message);
+
+public:
+    static const int PROCESSED_SHOWN = 10; // Matches the Flask backend's processed list
+
+    DeliveryService(DeliveryManager &dm, const std::string &staticRoot = std::string());
+
+    void handle(const HttpRequest &req, HttpResponse &res);
+    bool publishChanges(std::string &event) { return feed.publish(event); } // Once per refresh interval
+
+    static void appendDelivery(std::string &out, const Delivery &d);
+    static const char *typeName(DeliveryType type);      // "URGENT" ...
+    static const char *queueName(DeliveryType type);     // "urgent" ...
+};
+
+#endif // DELIVERY_SERVICE_H
@@ -0,0 +1,443 @@
+#include "HttpServer.h"
+#include <algorithm>
+#include <chrono>
+#include <cstring>
+#include <cerrno>
+#include <arpa/inet.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t READ_CHUNK = 64 * 1024;
+const size_t MAX_HEADER_BYTES = 16 * 1024;
+const size_t MAX_BODY_BYTES = 1 << 20;
+const size_t MAX_PENDING_OUTPUT = 4 << 20; // Stop parsing and reading pipelined requests beyond this backlog
+const int MAX_EVENTS = 256;
+
+bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+    if (a.size() != b.size()) return false;
+    for (size_t i = 0; i < a.size(); ++i) {
+        char x = a[i], y = b[i];
+        if (x >= 'A' && x <= 'Z') x += 'a' - 'A';
+        if (y >= 'A' && y <= 'Z') y += 'a' - 'A';
+        if (x != y) return false;
+    }
+    return true;
+}
+
+std::string_view trim(std::string_view s)
+{
+    while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+    while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+    return s;
+}
+
+bool containsToken(std::string_view value, std::string_view token)
+{
+    while (!value.empty()) {
+        size_t comma = value.find(',');
+        if (equalsIgnoreCase(trim(value.substr(0, comma)), token)) return true;
+        if (comma == std::string_view::npos) break;
+        value.remove_prefix(comma + 1);
+    }
+    return false;
+}
+
+void appendDecimal(std::string &out, size_t value)
+{
+    char digits[24];
+    int n = 0;
+    do {
+        digits[n++] = static_cast<char>('0' + value % 10);
+        value /= 10;
+    } while (value > 0);
+    while (n > 0) out.push_back(digits[--n]);
+}
+
+} // namespace
+
+std::string_view HttpRequest::header(std::string_view name) const
+{
+    std::string_view rest = headerLines;
+    while (!rest.empty()) {
+        size_t eol = rest.find("\r\n");
+        std::string_view line = rest.substr(0, eol);
+        rest = eol == std::string_view::npos ? std::string_view() : rest.substr(eol + 2);
+        size_t colon = line.find(':');
+        if (colon != std::string_view::npos && equalsIgnoreCase(line.substr(0, colon), name)) {
+            return trim(line.substr(colon + 1));
+        }
+    }
+    return std::string_view();
+}
+
+HttpServer::HttpServer()
+    : listenFd(-1), epollFd(-1), stopping(0), tickIntervalMs(0), openConnections(0), requestsServed(0) {}
+
+void HttpServer::setTickHandler(int intervalMs, TickHandler h)
+{
+    tickIntervalMs = intervalMs > 0 ? intervalMs : 1;
+    tickHandler = std::move(h);
+}
+
+void HttpServer::broadcast(const std::string &data)
+{
+    std::vector<int> fds = streamFds; // flush() may close connections and edit streamFds
+    for (int fd : fds) {
+        if (!connections[fd]) continue;
+        Connection &conn = *connections[fd];
+        if (conn.out.size() - conn.outPos > MAX_PENDING_OUTPUT + conn.streamSlack) {
+            closeConnection(conn); // Too far behind; it reconnects and resyncs
+            continue;
+        }
+        conn.out += data;
+        flush(conn);
+    }
+}
+
+HttpServer::~HttpServer()
+{
+    for (std::unique_ptr<Connection> &conn : connections) {
+        if (conn) ::close(conn->fd);
+    }
+    if (listenFd >= 0) ::close(listenFd);
+    if (epollFd >= 0) ::close(epollFd);
+}
+
+const char *HttpServer::reasonPhrase(int status)
+{
+    switch (status) {
+    case 200: return "OK";
+    case 201: return "Created";
+    case 204: return "No Content";
+    case 400: return "Bad Request";
+    case 404: return "Not Found";
+    case 405: return "Method Not Allowed";
+    case 413: return "Payload Too Large";
+    case 431: return "Request Header Fields Too Large";
+    case 500: return "Internal Server Error";
+    case 501: return "Not Implemented";
+    case 503: return "Service Unavailable";
+    default: return "Unknown";
+    }
+}
+
+bool HttpServer::listen(const std::string &host, int port)
+{
+    listenFd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (listenFd < 0) return false;
+    int yes = 1;
+    setsockopt(listenFd, SOL_SOCKET, SO_REUSEADDR, &yes, sizeof(yes));
+
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(port));
+    if (inet_pton(AF_INET, host.c_str(), &addr.sin_addr) != 1) return false;
+    if (::bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) return false;
+    if (::listen(listenFd, SOMAXCONN) != 0 || !setNonBlocking(listenFd)) return false;
+
+    epollFd = epoll_create1(0);
+    if (epollFd < 0) return false;
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev) == 0;
+}
+
+void HttpServer::run()
+{
+    typedef std::chrono::steady_clock Clock;
+    epoll_event events[MAX_EVENTS];
+    Clock::time_point nextTick = Clock::now() + std::chrono::milliseconds(tickIntervalMs);
+    while (!stopping) {
+        int timeout = 200; // Wake up now and then to notice stop()
+        if (tickHandler) {
+            Clock::time_point now = Clock::now();
+            if (now >= nextTick) {
+                tickHandler();
+                nextTick = now + std::chrono::milliseconds(tickIntervalMs);
+            }
+            long long untilTick = std::chrono::duration_cast<std::chrono::milliseconds>(nextTick - now).count() + 1;
+            timeout = static_cast<int>(std::min<long long>(timeout, untilTick));
+        }
+        int n = epoll_wait(epollFd, events, MAX_EVENTS, timeout);
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnections();
+                continue;
+            }
+            if (fd < 0 || static_cast<size_t>(fd) >= connections.size() || !connections[fd]) continue;
+            Connection &conn = *connections[fd];
+            if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+                closeConnection(conn);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT) {
+                onWritable(conn);
+                if (static_cast<size_t>(fd) >= connections.size() || !connections[fd]) continue;
+            }
+            if (events[i].events & EPOLLIN) {
+                onReadable(conn);
+            }
+        }
+    }
+}
+
+void HttpServer::acceptConnections()
+{
+    while (true) {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) return; // EAGAIN, or out of descriptors until some close
+        int yes = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            ::close(fd);
+            continue;
+        }
+        if (static_cast<size_t>(fd) >= connections.size()) connections.resize(fd + 1);
+        connections[fd].reset(new Connection());
+        connections[fd]->fd = fd;
+        ++openConnections;
+    }
+}
+
+void HttpServer::onReadable(Connection &conn)
+{
+    int fd = conn.fd;
+    bool peerClosed = false;
+    while (true) {
+        size_t used = conn.in.size();
+        conn.in.resize(used + READ_CHUNK);
+        ssize_t got = ::recv(fd, &conn.in[used], READ_CHUNK, 0);
+        conn.in.resize(used + (got > 0 ? got : 0));
+        if (got > 0) {
+            // Enough for one largest request; epoll reports the rest once this is parsed
+            if (static_cast<size_t>(got) < READ_CHUNK || conn.in.size() > MAX_HEADER_BYTES + MAX_BODY_BYTES) break;
+            continue;
+        }
+        if (got == 0) peerClosed = true;
+        else if (errno == EINTR) continue;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK) peerClosed = true;
+        break;
+    }
+
+    if (conn.streaming) {
+        conn.in.clear(); // Nothing more is read from an event stream
+        if (peerClosed) closeConnection(conn);
+        return;
+    }
+    processInput(conn);
+    if (!connections[fd]) return;
+    if (peerClosed && conn.outPos == conn.out.size()) {
+        closeConnection(conn);
+    } else if (peerClosed) {
+        conn.closeAfterWrite = true; // Half-closed: answer what arrived, then close
+    }
+}
+
+void HttpServer::onWritable(Connection &conn)
+{
+    if (!flush(conn)) return;
+    if (!conn.streaming && conn.outPos == conn.out.size() && conn.inPos < conn.in.size()) {
+        processInput(conn); // Resume requests held back by the output backlog
+    }
+}
+
+void HttpServer::processInput(Connection &conn)
+{
+    int fd = conn.fd;
+    while (!conn.closeAfterWrite && !conn.streaming && conn.out.size() - conn.outPos < MAX_PENDING_OUTPUT &&
+           handleOne(conn)) {
+    }
+    if (conn.inPos > 0) {
+        conn.in.erase(0, conn.inPos);
+        conn.inPos = 0;
+    }
+    if (connections[fd]) flush(conn);
+}
+
+bool HttpServer::handleOne(Connection &conn)
+{
+    std::string_view buffered(conn.in.data() + conn.inPos, conn.in.size() - conn.inPos);
+    size_t headerEnd = buffered.find("\r\n\r\n");
+    if (headerEnd == std::string_view::npos) {
+        if (buffered.size() > MAX_HEADER_BYTES) writeError(conn, 431, "Request headers too large");
+        return false;
+    }
+
+    std::string_view head = buffered.substr(0, headerEnd);
+    size_t lineEnd = head.find("\r\n");
+    std::string_view requestLine = head.substr(0, lineEnd);
+    size_t sp1 = requestLine.find(' ');
+    size_t sp2 = sp1 == std::string_view::npos ? sp1 : requestLine.find(' ', sp1 + 1);
+    if (sp2 == std::string_view::npos) {
+        writeError(conn, 400, "Malformed request line");
+        return false;
+    }
+
+    HttpRequest request;
+    request.method = requestLine.substr(0, sp1);
+    std::string_view target = requestLine.substr(sp1 + 1, sp2 - sp1 - 1);
+    std::string_view version = requestLine.substr(sp2 + 1);
+    size_t question = target.find('?');
+    request.path = target.substr(0, question);
+    if (question != std::string_view::npos) request.query = target.substr(question + 1);
+    request.keepAlive = version == "HTTP/1.1";
+
+    size_t contentLength = 0;
+    std::string_view headers = lineEnd == std::string_view::npos ? std::string_view() : head.substr(lineEnd + 2);
+    request.headerLines = headers;
+    while (!headers.empty()) {
+        size_t eol = headers.find("\r\n");
+        std::string_view line = headers.substr(0, eol);
+        headers = eol == std::string_view::npos ? std::string_view() : headers.substr(eol + 2);
+        size_t colon = line.find(':');
+        if (colon == std::string_view::npos) continue;
+        std::string_view name = line.substr(0, colon);
+        std::string_view value = trim(line.substr(colon + 1));
+        if (equalsIgnoreCase(name, "content-length")) {
+            contentLength = 0;
+            for (char c : value) {
+                if (c < '0' || c > '9' || contentLength > MAX_BODY_BYTES) {
+                    writeError(conn, c < '0' || c > '9' ? 400 : 413, "Bad Content-Length");
+                    return false;
+                }
+                contentLength = contentLength * 10 + (c - '0');
+            }
+        } else if (equalsIgnoreCase(name, "connection")) {
+            if (containsToken(value, "close")) request.keepAlive = false;
+            if (containsToken(value, "keep-alive")) request.keepAlive = true;
+        } else if (equalsIgnoreCase(name, "transfer-encoding")) {
+            writeError(conn, 501, "Chunked request bodies are not supported");
+            return false;
+        }
+    }
+    if (contentLength > MAX_BODY_BYTES) {
+        writeError(conn, 413, "Request body too large");
+        return false;
+    }
+
+    size_t total = headerEnd + 4 + contentLength;
+    if (buffered.size() < total) return false; // Body still in flight
+    request.body = buffered.substr(headerEnd + 4, contentLength);
+
+    response.clear();
+    if (handler) {
+        handler(request, response);
+    } else {
+        response.status = 404;
+    }
+    writeResponse(conn, response, request.keepAlive);
+    conn.inPos += total;
+    ++requestsServed;
+    return true;
+}
+
+void HttpServer::writeResponse(Connection &conn, const HttpResponse &res, bool keepAlive)
+{
+    std::string &out = conn.out;
+    out += "HTTP/1.1 ";
+    appendDecimal(out, res.status);
+    out.push_back(' ');
+    out += reasonPhrase(res.status);
+    out += "\r\nContent-Type: ";
+    out += res.contentType;
+    if (!res.stream) {
+        out += "\r\nContent-Length: ";
+        appendDecimal(out, res.body.size());
+    }
+    out += "\r\nAccess-Control-Allow-Origin: *\r\n";
+    out += res.headers;
+    if (res.stream) {
+        conn.streaming = true; // The body runs until the connection closes
+        streamFds.push_back(conn.fd);
+    } else if (!keepAlive) {
+        out += "Connection: close\r\n";
+        conn.closeAfterWrite = true;
+    }
+    out += "\r\n";
+    out += res.body;
+    if (conn.streaming) conn.streamSlack = out.size() - conn.outPos; // A large snapshot may take a while to drain
+}
+
+void HttpServer::writeError(Connection &conn, int status, const char *message)
+{
+    HttpResponse res;
+    res.status = status;
+    res.body = std::string("{\"error\": \"") + message + "\"}";
+    writeResponse(conn, res, false);
+    conn.inPos = conn.in.size(); // The stream can no longer be framed; drop the rest
+}
+
+bool HttpServer::flush(Connection &conn)
+{
+    while (conn.outPos < conn.out.size()) {
+        ssize_t sent = ::send(conn.fd, conn.out.data() + conn.outPos, conn.out.size() - conn.outPos, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn.outPos += sent;
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            // Past the backlog limit nothing more is parsed, so nothing more is read either
+            watch(conn, true, !conn.streaming && conn.out.size() - conn.outPos >= MAX_PENDING_OUTPUT);
+            return true;
+        }
+        closeConnection(conn);
+        return false;
+    }
+
+    conn.out.clear();
+    conn.outPos = 0;
+    conn.streamSlack = 0;
+    watch(conn, false, false);
+    if (conn.closeAfterWrite) {
+        closeConnection(conn);
+        return false;
+    }
+    return true;
+}
+
+void HttpServer::watch(Connection &conn, bool wantWrite, bool pauseRead)
+{
+    if (conn.waitingForWrite == wantWrite && conn.readPaused == pauseRead) return;
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    // EPOLLRDHUP goes with EPOLLIN: left on while paused it would fire on every wait
+    ev.events = (pauseRead ? 0 : EPOLLIN | EPOLLRDHUP) | (wantWrite ? EPOLLOUT : 0);
+    ev.data.fd = conn.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+    conn.waitingForWrite = wantWrite;
+    conn.readPaused = pauseRead;
+}
+
+void HttpServer::closeConnection(Connection &conn)
+{
+    int fd = conn.fd;
+    if (conn.streaming) streamFds.erase(std::find(streamFds.begin(), streamFds.end(), fd));
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections[fd].reset();
+    --openConnections;
+}
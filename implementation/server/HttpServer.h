@@ -0,0 +1,112 @@
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include <csignal>
+#include <functional>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+struct HttpRequest {
+    std::string_view method;
+    std::string_view path;     // Without the query string
+    std::string_view query;
+    std::string_view body;
+    std::string_view headerLines; // Raw "Name: value\r\n" block after the request line
+    bool keepAlive = true;
+
+    std::string_view header(std::string_view name) const; // Case-insensitive; empty if absent
+};
+
+struct HttpResponse {
+    int status = 200;
+    const char *contentType = "application/json";
+    std::string headers;       // Extra "Name: value\r\n" lines
+    std::string body;
+    bool stream = false;       // Keep the connection open after body (no Content-Length) for broadcast()
+
+    void clear()
+    {
+        status = 200;
+        contentType = "application/json";
+        headers.clear();
+        body.clear();
+        stream = false;
+    }
+};
+
+// Single-threaded HTTP/1.1 server on epoll (Linux only).
+//
+// Connections are non-blocking and kept alive; every complete request in a
+// read is handled in order (pipelining) and the responses go out in one
+// send(). A connection stops parsing, and stops reading from its socket,
+// while a large response backlog is pending, and resumes once the socket
+// drains; a client that pipelines without reading cannot grow its input.
+//
+// A response marked `stream` (Server-Sent Events) leaves its connection
+// open; broadcast() then appends to every such connection. A stream client
+// that falls MAX_PENDING_OUTPUT behind is disconnected rather than buffered.
+class HttpServer {
+public:
+    typedef std::function<void(const HttpRequest &, HttpResponse &)> Handler;
+    typedef std::function<void()> TickHandler;
+
+private:
+    struct Connection {
+        int fd;
+        std::string in;
+        size_t inPos = 0;
+        std::string out;
+        size_t outPos = 0;
+        bool closeAfterWrite = false;
+        bool waitingForWrite = false;
+        bool readPaused = false;  // Backlog at MAX_PENDING_OUTPUT: EPOLLIN is off until it drains
+        bool streaming = false;   // Response headers sent; input is ignored from here on
+        size_t streamSlack = 0;   // Initial stream body still unsent, exempt from the broadcast backlog limit
+    };
+
+    int listenFd;
+    int epollFd;
+    volatile std::sig_atomic_t stopping;
+    Handler handler;
+    TickHandler tickHandler;
+    int tickIntervalMs;
+    std::vector<int> streamFds;
+    std::vector<std::unique_ptr<Connection>> connections; // Indexed by fd
+    HttpResponse response;                                // Reused for every request
+    size_t openConnections;
+    unsigned long long requestsServed;
+
+    void acceptConnections();
+    void onReadable(Connection &conn);
+    void onWritable(Connection &conn);
+    void processInput(Connection &conn);
+    bool handleOne(Connection &conn); // False when no complete request is buffered
+    void writeResponse(Connection &conn, const HttpResponse &res, bool keepAlive);
+    void writeError(Connection &conn, int status, const char *message);
+    bool flush(Connection &conn);     // False if the connection was closed
+    void watch(Connection &conn, bool wantWrite, bool pauseRead); // Updates the epoll interest set
+    void closeConnection(Connection &conn);
+
+public:
+    HttpServer();
+    ~HttpServer();
+    HttpServer(const HttpServer &) = delete;
+    HttpServer &operator=(const HttpServer &) = delete;
+
+    void setHandler(Handler h) { handler = std::move(h); }
+    void setTickHandler(int intervalMs, TickHandler h); // Called from run() about every intervalMs
+    void broadcast(const std::string &data);             // To every open stream response
+    bool listen(const std::string &host, int port);
+    void run();                // Returns after stop()
+    void stop() { stopping = 1; } // Safe to call from a signal handler
+
+    size_t getOpenConnections() const { return openConnections; }
+    size_t getOpenStreams() const { return streamFds.size(); }
+    unsigned long long getRequestsServed() const { return requestsServed; }
+
+    static const char *reasonPhrase(int status);
+};
+
+#endif // HTTP_SERVER_H
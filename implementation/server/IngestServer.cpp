@@ -0,0 +1,219 @@
+#include "IngestServer.h"
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+
+const size_t INITIAL_BUFFER_BYTES = 256 * 1024; // Grown to the largest frame a client sends
+const int MAX_EVENTS = 256;
+
+bool setNonBlocking(int fd)
+{
+    int flags = fcntl(fd, F_GETFL, 0);
+    return flags >= 0 && fcntl(fd, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+} // namespace
+
+IngestServer::IngestServer()
+    : listenFd(-1), epollFd(-1), stopping(0), batchesServed(0), recordsAccepted(0) {}
+
+IngestServer::~IngestServer()
+{
+    for (std::unique_ptr<Connection> &conn : connections) {
+        if (conn) ::close(conn->fd);
+    }
+    if (listenFd >= 0) {
+        ::close(listenFd);
+        ::unlink(socketPath.c_str());
+    }
+    if (epollFd >= 0) ::close(epollFd);
+}
+
+bool IngestServer::listen(const std::string &path)
+{
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (path.empty() || path.size() >= sizeof(addr.sun_path)) return false;
+    std::memcpy(addr.sun_path, path.c_str(), path.size());
+
+    listenFd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listenFd < 0) return false;
+    ::unlink(path.c_str()); // Left behind by a server that did not shut down cleanly
+    if (::bind(listenFd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) return false;
+    socketPath = path;
+    if (::listen(listenFd, SOMAXCONN) != 0 || !setNonBlocking(listenFd)) return false;
+
+    epollFd = epoll_create1(0);
+    if (epollFd < 0) return false;
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = EPOLLIN;
+    ev.data.fd = listenFd;
+    return epoll_ctl(epollFd, EPOLL_CTL_ADD, listenFd, &ev) == 0;
+}
+
+void IngestServer::run()
+{
+    epoll_event events[MAX_EVENTS];
+    while (!stopping) {
+        int n = epoll_wait(epollFd, events, MAX_EVENTS, 200); // Wake up now and then to notice stop()
+        if (n < 0 && errno != EINTR) break;
+        for (int i = 0; i < n; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listenFd) {
+                acceptConnections();
+                continue;
+            }
+            if (fd < 0 || static_cast<size_t>(fd) >= connections.size() || !connections[fd]) continue;
+            Connection &conn = *connections[fd];
+            if (events[i].events & EPOLLERR) {
+                closeConnection(conn);
+                continue;
+            }
+            if ((events[i].events & EPOLLOUT) && !flush(conn)) continue;
+            if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLRDHUP)) onReadable(conn);
+        }
+    }
+}
+
+void IngestServer::acceptConnections()
+{
+    while (true) {
+        int fd = ::accept4(listenFd, nullptr, nullptr, SOCK_NONBLOCK);
+        if (fd < 0) return;
+
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+            ::close(fd);
+            continue;
+        }
+        if (static_cast<size_t>(fd) >= connections.size()) connections.resize(fd + 1);
+        connections[fd].reset(new Connection());
+        connections[fd]->fd = fd;
+        connections[fd]->in.resize(INITIAL_BUFFER_BYTES / sizeof(Block));
+    }
+}
+
+void IngestServer::onReadable(Connection &conn)
+{
+    bool peerClosed = false;
+    while (true) {
+        size_t capacity = conn.in.size() * sizeof(Block);
+        unsigned char *buffer = conn.in.front().bytes;
+        ssize_t got = ::recv(conn.fd, buffer + conn.inBytes, capacity - conn.inBytes, 0);
+        if (got > 0) {
+            conn.inBytes += got;
+            if (conn.inBytes == capacity && !processInput(conn)) return; // Make room, then keep reading
+            continue;
+        }
+        if (got == 0) peerClosed = true;
+        else if (errno == EINTR) continue;
+        else if (errno != EAGAIN && errno != EWOULDBLOCK) peerClosed = true;
+        break;
+    }
+
+    if (!processInput(conn)) return;
+    if (peerClosed && conn.outPos == conn.out.size()) {
+        closeConnection(conn);
+    } else if (peerClosed) {
+        conn.closeAfterWrite = true; // Half-closed: ack what arrived, then close
+    }
+}
+
+bool IngestServer::processInput(Connection &conn)
+{
+    unsigned char *buffer = conn.in.front().bytes;
+    size_t pos = 0;
+    while (conn.inBytes - pos >= sizeof(WireBatchHeader)) {
+        const WireBatchHeader *header = reinterpret_cast<const WireBatchHeader *>(buffer + pos);
+        if (!isWireBatchHeader(*header) || header->recordCount > MAX_BATCH) {
+            closeConnection(conn); // The stream can no longer be framed
+            return false;
+        }
+        size_t frameBytes = wireFrameBytes(header->recordCount);
+        if (conn.inBytes - pos < frameBytes) break;
+
+        const WireDelivery *records = reinterpret_cast<const WireDelivery *>(header + 1);
+        size_t accepted = handler ? handler(records, header->recordCount) : 0;
+        WireBatchAck ack;
+        ack.accepted = static_cast<uint32_t>(accepted);
+        ack.rejected = header->recordCount - ack.accepted;
+        conn.out.append(reinterpret_cast<const char *>(&ack), sizeof(ack));
+        ++batchesServed;
+        recordsAccepted += accepted;
+        pos += frameBytes;
+    }
+
+    if (pos > 0) {
+        std::memmove(buffer, buffer + pos, conn.inBytes - pos);
+        conn.inBytes -= pos;
+    }
+    if (conn.inBytes >= sizeof(WireBatchHeader)) {
+        // A frame larger than the buffer is pending; grow to fit it
+        const WireBatchHeader *header = reinterpret_cast<const WireBatchHeader *>(buffer);
+        size_t frameBytes = wireFrameBytes(header->recordCount);
+        if (frameBytes > conn.in.size() * sizeof(Block)) {
+            conn.in.resize((frameBytes + sizeof(Block) - 1) / sizeof(Block));
+        }
+    }
+    return flush(conn);
+}
+
+bool IngestServer::flush(Connection &conn)
+{
+    while (conn.outPos < conn.out.size()) {
+        ssize_t sent = ::send(conn.fd, conn.out.data() + conn.outPos, conn.out.size() - conn.outPos, MSG_NOSIGNAL);
+        if (sent > 0) {
+            conn.outPos += sent;
+            continue;
+        }
+        if (sent < 0 && errno == EINTR) continue;
+        if (sent < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            if (!conn.waitingForWrite) {
+                epoll_event ev;
+                std::memset(&ev, 0, sizeof(ev));
+                ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP;
+                ev.data.fd = conn.fd;
+                epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+                conn.waitingForWrite = true;
+            }
+            return true;
+        }
+        closeConnection(conn);
+        return false;
+    }
+
+    conn.out.clear();
+    conn.outPos = 0;
+    if (conn.waitingForWrite) {
+        epoll_event ev;
+        std::memset(&ev, 0, sizeof(ev));
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = conn.fd;
+        epoll_ctl(epollFd, EPOLL_CTL_MOD, conn.fd, &ev);
+        conn.waitingForWrite = false;
+    }
+    if (conn.closeAfterWrite) {
+        closeConnection(conn);
+        return false;
+    }
+    return true;
+}
+
+void IngestServer::closeConnection(Connection &conn)
+{
+    int fd = conn.fd;
+    epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, nullptr);
+    ::close(fd);
+    connections[fd].reset();
+}
@@ -0,0 +1,70 @@
+#ifndef INGEST_SERVER_H
+#define INGEST_SERVER_H
+
+#include <csignal>
+#include <functional>
+#include <memory>
+#include <string>
+#include <vector>
+#include "../WireFormat.h"
+
+// Single-threaded batch ingest endpoint on a Unix-domain stream socket
+// (Linux only).
+//
+// Clients write WireFormat.h frames back to back; each complete frame is
+// handed to the handler as a pointer into the connection's receive buffer
+// (no copy, no decode) and answered with a WireBatchAck. A frame with a bad
+// magic/version or more than MAX_BATCH records closes the connection.
+class IngestServer {
+public:
+    // Returns how many of the records were accepted
+    typedef std::function<size_t(const WireDelivery *, size_t)> Handler;
+
+    static const uint32_t MAX_BATCH = 65536;
+
+private:
+    struct alignas(16) Block {
+        unsigned char bytes[16];
+    };
+
+    struct Connection {
+        int fd;
+        std::vector<Block> in;  // Frames are multiples of 16 bytes, so each starts block-aligned
+        size_t inBytes = 0;
+        std::string out;
+        size_t outPos = 0;
+        bool closeAfterWrite = false;
+        bool waitingForWrite = false;
+    };
+
+    int listenFd;
+    int epollFd;
+    std::string socketPath;
+    volatile std::sig_atomic_t stopping;
+    Handler handler;
+    std::vector<std::unique_ptr<Connection>> connections; // Indexed by fd
+    unsigned long long batchesServed;
+    unsigned long long recordsAccepted;
+
+    void acceptConnections();
+    void onReadable(Connection &conn);
+    bool processInput(Connection &conn); // False if the connection was closed
+    bool flush(Connection &conn);        // False if the connection was closed
+    void closeConnection(Connection &conn);
+
+public:
+    IngestServer();
+    ~IngestServer();
+    IngestServer(const IngestServer &) = delete;
+    IngestServer &operator=(const IngestServer &) = delete;
+
+    void setHandler(Handler h) { handler = std::move(h); }
+    bool listen(const std::string &path); // Replaces a stale socket file at path
+    void run();                           // Returns after stop()
+    void stop() { stopping = 1; }         // Safe to call from a signal handler
+
+    unsigned long long getBatchesServed() const { return batchesServed; }
+    unsigned long long getRecordsAccepted() const { return recordsAccepted; }
+};
+
+#endif // INGEST_SERVER_H
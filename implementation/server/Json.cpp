@@ -0,0 +1,163 @@
+#include "Json.h"
+#include <cstdlib>
+
+namespace {
+
+class JsonCursor {
+private:
+    std::string_view in;
+    size_t pos;
+
+public:
+    explicit JsonCursor(std::string_view input) : in(input), pos(0) {}
+
+    void skipSpace()
+    {
+        while (pos < in.size() && (in[pos] == ' ' || in[pos] == '\t' || in[pos] == '\n' || in[pos] == '\r')) ++pos;
+    }
+
+    bool atEnd() { skipSpace(); return pos >= in.size(); }
+
+    bool consume(char c)
+    {
+        skipSpace();
+        if (pos < in.size() && in[pos] == c) {
+            ++pos;
+            return true;
+        }
+        return false;
+    }
+
+    char peek() { skipSpace(); return pos < in.size() ? in[pos] : '\0'; }
+
+    static int hexValue(char c)
+    {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    }
+
+    static void appendUtf8(std::string &out, unsigned code)
+    {
+        if (code < 0x80) {
+            out.push_back(static_cast<char>(code));
+        } else if (code < 0x800) {
+            out.push_back(static_cast<char>(0xC0 | (code >> 6)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        } else {
+            out.push_back(static_cast<char>(0xE0 | (code >> 12)));
+            out.push_back(static_cast<char>(0x80 | ((code >> 6) & 0x3F)));
+            out.push_back(static_cast<char>(0x80 | (code & 0x3F)));
+        }
+    }
+
+    bool string(std::string &out)
+    {
+        out.clear();
+        if (!consume('"')) return false;
+        while (pos < in.size()) {
+            char c = in[pos++];
+            if (c == '"') return true;
+            if (c != '\\') {
+                out.push_back(c);
+                continue;
+            }
+            if (pos >= in.size()) return false;
+            char e = in[pos++];
+            switch (e) {
+            case '"': case '\\': case '/': out.push_back(e); break;
+            case 'b': out.push_back('\b'); break;
+            case 'f': out.push_back('\f'); break;
+            case 'n': out.push_back('\n'); break;
+            case 'r': out.push_back('\r'); break;
+            case 't': out.push_back('\t'); break;
+            case 'u': {
+                if (pos + 4 > in.size()) return false;
+                unsigned code = 0;
+                for (int i = 0; i < 4; ++i) {
+                    int h = hexValue(in[pos++]);
+                    if (h < 0) return false;
+                    code = (code << 4) | static_cast<unsigned>(h);
+                }
+                appendUtf8(out, code); // Surrogate pairs are passed through as two code units
+                break;
+            }
+            default:
+                return false;
+            }
+        }
+        return false;
+    }
+
+    // Skips a nested object/array, honouring strings
+    bool skipContainer(std::string &raw)
+    {
+        size_t start = pos;
+        int depth = 0;
+        std::string ignored;
+        while (pos < in.size()) {
+            char c = in[pos];
+            if (c == '"') {
+                if (!string(ignored)) return false;
+                continue;
+            }
+            ++pos;
+            if (c == '{' || c == '[') ++depth;
+            if (c == '}' || c == ']') {
+                if (--depth == 0) {
+                    raw.assign(in.substr(start, pos - start));
+                    return true;
+                }
+            }
+        }
+        return false;
+    }
+
+    bool value(JsonValue &out)
+    {
+        char c = peek();
+        if (c == '"') {
+            out.kind = JsonValue::JSON_STRING;
+            return string(out.text);
+        }
+        if (c == '{' || c == '[') {
+            out.kind = JsonValue::JSON_OTHER;
+            return skipContainer(out.text);
+        }
+        size_t start = pos;
+        while (pos < in.size() && in[pos] != ',' && in[pos] != '}' && in[pos] != ' ' && in[pos] != '\n' &&
+               in[pos] != '\r' && in[pos] != '\t') {
+            ++pos;
+        }
+        out.text.assign(in.substr(start, pos - start));
+        if (out.text == "null") {
+            out.kind = JsonValue::JSON_NULL;
+        } else if (out.text == "true" || out.text == "false") {
+            out.kind = JsonValue::JSON_BOOL;
+            out.number = out.text == "true" ? 1.0 : 0.0;
+        } else {
+            char *end = nullptr;
+            out.number = std::strtod(out.text.c_str(), &end);
+            if (out.text.empty() || end != out.text.c_str() + out.text.size()) return false;
+            out.kind = JsonValue::JSON_NUMBER;
+        }
+        return true;
+    }
+};
+
+} // namespace
+
+bool parseJsonObject(std::string_view input, std::vector<std::pair<std::string, JsonValue>> &fields)
+{
+    fields.clear();
+    JsonCursor cursor(input);
+    if (!cursor.consume('{')) return false;
+    if (cursor.consume('}')) return cursor.atEnd();
+    do {
+        std::pair<std::string, JsonValue> field;
+        if (!cursor.string(field.first) || !cursor.consume(':') || !cursor.value(field.second)) return false;
+        fields.push_back(std::move(field));
+    } while (cursor.consume(','));
+    return cursor.consume('}') && cursor.atEnd();
+}
@@ -0,0 +1,65 @@
+#ifndef SERVER_JSON_H
+#define SERVER_JSON_H
+
+#include <charconv>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+// Just enough JSON for the delivery REST routes: an appending writer and a
+// parser for flat objects of string / number / bool / null values.
+
+inline void appendJsonString(std::string &out, std::string_view s)
+{
+    static const char hex[] = "0123456789abcdef";
+    out.push_back('"');
+    for (char c : s) {
+        switch (c) {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        default:
+            if (static_cast<unsigned char>(c) < 0x20) {
+                out += "\\u00";
+                out.push_back(hex[(c >> 4) & 0xF]);
+                out.push_back(hex[c & 0xF]);
+            } else {
+                out.push_back(c);
+            }
+        }
+    }
+    out.push_back('"');
+}
+
+inline void appendJsonNumber(std::string &out, double value)
+{
+    char buffer[32];
+    std::to_chars_result r = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    if (r.ec != std::errc() || value != value || value - value != 0) {
+        out += "null"; // JSON has no NaN/inf
+    } else {
+        out.append(buffer, r.ptr);
+    }
+}
+
+inline void appendJsonNumber(std::string &out, long long value)
+{
+    char buffer[24];
+    std::to_chars_result r = std::to_chars(buffer, buffer + sizeof(buffer), value);
+    out.append(buffer, r.ptr);
+}
+
+struct JsonValue {
+    enum Kind { JSON_NULL, JSON_BOOL, JSON_NUMBER, JSON_STRING, JSON_OTHER } kind = JSON_NULL;
+    std::string text;   // Unescaped string, or the raw token for other kinds
+    double number = 0.0;
+};
+
+// Parses a flat JSON object into key/value pairs. Nested objects and arrays
+// are accepted but kept only as JSON_OTHER. Returns false on malformed input.
+bool parseJsonObject(std::string_view input, std::vector<std::pair<std::string, JsonValue>> &fields);
+
+#endif // SERVER_JSON_H
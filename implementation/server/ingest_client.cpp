@@ -0,0 +1,180 @@
+// Throughput client for sqs_ingest.
+//
+//   sqs_ingest_client [--socket /tmp/sqs_ingest.sock] [--batch 4096]
+//                     [--batches 256] [--window 4] [--input FILE|-]
+//
+// Sends `batches` frames of `batch` records, keeping up to `window` frames
+// unacknowledged, and reports deliveries per second from first send to
+// last ack. With --input, the frames are read from a file or stdin instead
+// (e.g. piped from bench/workload_gen) and streamed until it ends.
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+#include <vector>
+#include "../WireFormat.h"
+
+namespace {
+
+bool sendAll(int fd, const char *data, size_t size)
+{
+    while (size > 0) {
+        ssize_t n = ::send(fd, data, size, MSG_NOSIGNAL);
+        if (n <= 0) return false;
+        data += n;
+        size -= n;
+    }
+    return true;
+}
+
+// Next frame from a stream of WireFormat frames; false at the end or on a bad header
+bool readFrame(std::FILE *in, std::vector<char> &frame)
+{
+    WireBatchHeader header;
+    if (std::fread(&header, sizeof(header), 1, in) != 1) return false;
+    if (!isWireBatchHeader(header) || header.recordCount > 65536) {
+        std::cerr << "Input is not a stream of batch frames\n";
+        return false;
+    }
+    frame.resize(wireFrameBytes(header.recordCount));
+    std::memcpy(frame.data(), &header, sizeof(header));
+    size_t body = frame.size() - sizeof(header);
+    return std::fread(frame.data() + sizeof(header), 1, body, in) == body;
+}
+
+bool recvAck(int fd, WireBatchAck &ack)
+{
+    char *p = reinterpret_cast<char *>(&ack);
+    size_t got = 0;
+    while (got < sizeof(ack)) {
+        ssize_t n = ::recv(fd, p + got, sizeof(ack) - got, 0);
+        if (n <= 0) return false;
+        got += n;
+    }
+    return true;
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string socketPath = "/tmp/sqs_ingest.sock";
+    uint32_t batch = 4096;
+    int batches = 256;
+    int window = 4;
+    std::string inputPath;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        if (flag == "--socket") socketPath = argv[i + 1];
+        else if (flag == "--batch") batch = static_cast<uint32_t>(std::atoi(argv[i + 1]));
+        else if (flag == "--batches") batches = std::atoi(argv[i + 1]);
+        else if (flag == "--window") window = std::atoi(argv[i + 1]);
+        else if (flag == "--input") inputPath = argv[i + 1];
+        else {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+    if (batch < 1) batch = 1;
+    if (window < 1) window = 1;
+
+    int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, socketPath.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd < 0 || ::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        std::cerr << "Could not connect to " << socketPath << "\n";
+        return 1;
+    }
+
+    if (!inputPath.empty()) {
+        std::FILE *in = inputPath == "-" ? stdin : std::fopen(inputPath.c_str(), "rb");
+        if (!in) {
+            std::cerr << "Could not open " << inputPath << "\n";
+            return 1;
+        }
+        std::vector<char> frame;
+        uint64_t records = 0, accepted = 0, rejected = 0;
+        long long sent = 0, acked = 0;
+        bool more = true;
+        std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+        while (more || acked < sent) {
+            while (more && sent - acked < window) {
+                more = readFrame(in, frame);
+                if (!more) break;
+                if (!sendAll(fd, frame.data(), frame.size())) {
+                    std::cerr << "Send failed\n";
+                    return 1;
+                }
+                records += reinterpret_cast<const WireBatchHeader *>(frame.data())->recordCount;
+                ++sent;
+            }
+            if (acked == sent) continue;
+            WireBatchAck ack;
+            if (!recvAck(fd, ack)) {
+                std::cerr << "Connection closed before all acks arrived\n";
+                return 1;
+            }
+            accepted += ack.accepted;
+            rejected += ack.rejected;
+            ++acked;
+        }
+        double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        ::close(fd);
+        if (in != stdin) std::fclose(in);
+
+        std::cout << "Streamed " << records << " deliveries in " << sent << " frames from " << inputPath << "\n";
+        std::cout << "Accepted " << accepted << ", rejected " << rejected << " in " << elapsed << " s\n";
+        std::cout << "Throughput: " << static_cast<uint64_t>(accepted / elapsed) << " deliveries/s\n";
+        return 0;
+    }
+
+    // Frames are built up front so the measurement covers transport and ingest only
+    std::vector<std::vector<char>> frames(batches);
+    uint64_t seq = 0;
+    for (int b = 0; b < batches; ++b) {
+        std::vector<char> &frame = frames[b];
+        frame.resize(wireFrameBytes(batch));
+        initWireBatchHeader(*reinterpret_cast<WireBatchHeader *>(frame.data()), batch);
+        WireDelivery *records = reinterpret_cast<WireDelivery *>(frame.data() + sizeof(WireBatchHeader));
+        for (uint32_t i = 0; i < batch; ++i, ++seq) {
+            encodeWireDelivery(records[i], "IN" + std::to_string(seq), "Zone" + std::to_string(seq % 17),
+                               static_cast<DeliveryType>(seq % 3), static_cast<int>(10 + seq % 50));
+        }
+    }
+
+    uint64_t accepted = 0, rejected = 0;
+    int sent = 0, acked = 0;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    while (acked < batches) {
+        while (sent < batches && sent - acked < window) {
+            if (!sendAll(fd, frames[sent].data(), frames[sent].size())) {
+                std::cerr << "Send failed\n";
+                return 1;
+            }
+            ++sent;
+        }
+        WireBatchAck ack;
+        if (!recvAck(fd, ack)) {
+            std::cerr << "Connection closed before all acks arrived\n";
+            return 1;
+        }
+        accepted += ack.accepted;
+        rejected += ack.rejected;
+        ++acked;
+    }
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    ::close(fd);
+
+    std::cout << "Sent " << seq << " deliveries in " << batches << " batches of " << batch << " (window " << window
+              << ")\n";
+    std::cout << "Accepted " << accepted << ", rejected " << rejected << " in " << elapsed << " s\n";
+    std::cout << "Throughput: " << static_cast<uint64_t>(accepted / elapsed) << " deliveries/s\n";
+    return 0;
+}
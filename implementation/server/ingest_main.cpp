@@ -0,0 +1,82 @@
+// Batch ingest service: WireFormat.h frames over a Unix-domain socket into a
+// DeliveryManager.
+//
+//   sqs_ingest [--socket /tmp/sqs_ingest.sock] [--wal PATH] [--capture PATH] [--quiet]
+//
+// Each frame becomes one DeliveryManager::addDeliveries() call. On shutdown
+// the service prints the ingest rate and the resulting queue sizes.
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include "IngestServer.h"
+#include "../DeliveryManager.h"
+
+namespace {
+
+IngestServer *runningServer = nullptr;
+
+void onSignal(int)
+{
+    if (runningServer) runningServer->stop();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string socketPath = "/tmp/sqs_ingest.sock";
+    std::string walPath;
+    std::string capturePath;
+    bool quiet = false;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--quiet") == 0) quiet = true;
+        else if (std::strcmp(argv[i], "--socket") == 0 && i + 1 < argc) socketPath = argv[++i];
+        else if (std::strcmp(argv[i], "--wal") == 0 && i + 1 < argc) walPath = argv[++i];
+        else if (std::strcmp(argv[i], "--capture") == 0 && i + 1 < argc) capturePath = argv[++i];
+        else {
+            std::cerr << "Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    srand(time(0));
+    ConfigurationManager::initialize();
+    DeliveryManager deliveryManager;
+    deliveryManager.setVerbose(false);
+    if (!walPath.empty() && !deliveryManager.enableWriteAheadLog(walPath)) {
+        std::cerr << "Could not open " << walPath << "\n";
+        return 1;
+    }
+    if (!capturePath.empty() && !deliveryManager.startTraceCapture(capturePath)) {
+        std::cerr << "Could not open " << capturePath << "\n";
+        return 1;
+    }
+
+    IngestServer server;
+    server.setHandler([&deliveryManager](const WireDelivery *records, size_t count) {
+        return deliveryManager.addDeliveries(records, count);
+    });
+    if (!server.listen(socketPath)) {
+        std::cerr << "Could not listen on " << socketPath << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    runningServer = &server;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    if (!quiet) std::cout << "Smart Queue ingest listening on " << socketPath << std::endl;
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    server.run();
+    double elapsed = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+
+    std::cout << "Ingested " << server.getRecordsAccepted() << " deliveries in " << server.getBatchesServed()
+              << " batches over " << elapsed << " s\n";
+    std::cout << "Queued: urgent " << deliveryManager.getUrgentQueueSize() << ", standard "
+              << deliveryManager.getStandardQueueSize() << ", fragile " << deliveryManager.getFragileQueueSize() << "\n";
+    deliveryManager.syncLog();
+    return 0;
+}
@@ -0,0 +1,202 @@
+// Closed-loop load generator for sqs_server.
+//
+//   sqs_load_test [--host 127.0.0.1] [--port 5001] [--connections 8]
+//                 [--pipeline 16] [--seconds 5] [--mix mixed|add|stats|list]
+//
+// Each connection runs on its own thread and keeps `pipeline` requests in
+// flight: it writes a batch, then reads the batch's responses. "mixed" sends
+// adds, processes and stats reads in a 5:4:1 ratio.
+#include <arpa/inet.h>
+#include <atomic>
+#include <chrono>
+#include <cstring>
+#include <iostream>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+#include "../DeliveryMetrics.h"
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    int port = 5001;
+    int connections = 8;
+    int pipeline = 16;
+    int seconds = 5;
+    std::string mix = "mixed";
+};
+
+struct WorkerResult {
+    LogLinearHistogram latencyMicros;
+    uint64_t ok = 0;
+    uint64_t notFound = 0;
+    uint64_t failed = 0;
+    bool connectionError = false;
+};
+
+typedef std::chrono::steady_clock Clock;
+
+int connectTo(const Options &opts)
+{
+    int fd = ::socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) return -1;
+    sockaddr_in addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(opts.port));
+    inet_pton(AF_INET, opts.host.c_str(), &addr.sin_addr);
+    if (::connect(fd, reinterpret_cast<sockaddr *>(&addr), sizeof(addr)) != 0) {
+        ::close(fd);
+        return -1;
+    }
+    int yes = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &yes, sizeof(yes));
+    return fd;
+}
+
+void appendRequest(std::string &out, const std::string &mix, int worker, uint64_t seq)
+{
+    static const char *types[] = {"URGENT", "STANDARD", "FRAGILE"};
+    int pick = mix == "add" ? 0 : mix == "stats" ? 9 : mix == "list" ? 10 : static_cast<int>(seq % 10);
+    if (pick < 5) {
+        std::string body = "{\"id\": \"LT" + std::to_string(worker) + "-" + std::to_string(seq) +
+                           "\", \"destination\": \"Zone" + std::to_string(seq % 17) + "\", \"type\": \"" +
+                           types[seq % 3] + "\", \"estimatedTime\": " + std::to_string(10 + seq % 50) + "}";
+        out += "POST /api/deliveries HTTP/1.1\r\nHost: localhost\r\nContent-Type: application/json\r\nContent-Length: ";
+        out += std::to_string(body.size());
+        out += "\r\n\r\n";
+        out += body;
+    } else if (pick < 9) {
+        out += "POST /api/deliveries/process HTTP/1.1\r\nHost: localhost\r\nContent-Length: 0\r\n\r\n";
+    } else if (pick == 9) {
+        out += "GET /api/deliveries/stats HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    } else {
+        out += "GET /api/deliveries HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    }
+}
+
+// Returns the size of the first complete response in `in` (0 if incomplete) and its status
+size_t parseResponse(const std::string &in, size_t from, int &status)
+{
+    size_t headerEnd = in.find("\r\n\r\n", from);
+    if (headerEnd == std::string::npos) return 0;
+    status = std::atoi(in.c_str() + from + 9); // "HTTP/1.1 NNN"
+    size_t length = 0;
+    size_t pos = in.find("Content-Length:", from);
+    if (pos != std::string::npos && pos < headerEnd) length = std::strtoul(in.c_str() + pos + 15, nullptr, 10);
+    size_t total = headerEnd + 4 + length - from;
+    return in.size() - from >= total ? total : 0;
+}
+
+void runWorker(const Options &opts, int worker, Clock::time_point deadline, WorkerResult &result)
+{
+    int fd = connectTo(opts);
+    if (fd < 0) {
+        result.connectionError = true;
+        return;
+    }
+    std::string out, in;
+    std::vector<char> chunk(64 * 1024);
+    uint64_t seq = 0;
+    while (Clock::now() < deadline) {
+        out.clear();
+        for (int i = 0; i < opts.pipeline; ++i) appendRequest(out, opts.mix, worker, seq++);
+        Clock::time_point start = Clock::now();
+        for (size_t sent = 0; sent < out.size();) {
+            ssize_t n = ::send(fd, out.data() + sent, out.size() - sent, MSG_NOSIGNAL);
+            if (n <= 0) {
+                result.connectionError = true;
+                ::close(fd);
+                return;
+            }
+            sent += n;
+        }
+
+        int received = 0;
+        size_t pos = 0;
+        in.clear();
+        while (received < opts.pipeline) {
+            int status = 0;
+            size_t size = parseResponse(in, pos, status);
+            if (size == 0) {
+                ssize_t n = ::recv(fd, chunk.data(), chunk.size(), 0);
+                if (n <= 0) {
+                    result.connectionError = true;
+                    ::close(fd);
+                    return;
+                }
+                in.append(chunk.data(), n);
+                continue;
+            }
+            pos += size;
+            ++received;
+            uint64_t micros = std::chrono::duration_cast<std::chrono::microseconds>(Clock::now() - start).count();
+            result.latencyMicros.record(micros);
+            if (status >= 200 && status < 300) ++result.ok;
+            else if (status == 404) ++result.notFound; // Nothing left to process
+            else ++result.failed;
+        }
+    }
+    ::close(fd);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    Options opts;
+    for (int i = 1; i + 1 < argc; i += 2) {
+        std::string flag = argv[i];
+        std::string value = argv[i + 1];
+        if (flag == "--host") opts.host = value;
+        else if (flag == "--port") opts.port = std::atoi(value.c_str());
+        else if (flag == "--connections") opts.connections = std::atoi(value.c_str());
+        else if (flag == "--pipeline") opts.pipeline = std::atoi(value.c_str());
+        else if (flag == "--seconds") opts.seconds = std::atoi(value.c_str());
+        else if (flag == "--mix") opts.mix = value;
+        else {
+            std::cerr << "Unknown option " << flag << "\n";
+            return 1;
+        }
+    }
+    if (opts.connections < 1) opts.connections = 1;
+    if (opts.pipeline < 1) opts.pipeline = 1;
+
+    std::vector<WorkerResult> results(opts.connections);
+    std::vector<std::thread> workers;
+    Clock::time_point start = Clock::now();
+    Clock::time_point deadline = start + std::chrono::seconds(opts.seconds);
+    for (int i = 0; i < opts.connections; ++i) {
+        workers.emplace_back(runWorker, std::cref(opts), i, deadline, std::ref(results[i]));
+    }
+    for (std::thread &t : workers) t.join();
+    double elapsed = std::chrono::duration<double>(Clock::now() - start).count();
+
+    LogLinearHistogram latency;
+    uint64_t ok = 0, notFound = 0, failed = 0;
+    int connectionErrors = 0;
+    for (const WorkerResult &r : results) {
+        latency.merge(r.latencyMicros);
+        ok += r.ok;
+        notFound += r.notFound;
+        failed += r.failed;
+        if (r.connectionError) ++connectionErrors;
+    }
+    uint64_t total = ok + notFound + failed;
+
+    std::cout << "Requests:     " << total << " in " << elapsed << " s (" << opts.connections << " connections, pipeline "
+              << opts.pipeline << ", mix " << opts.mix << ")\n";
+    std::cout << "Throughput:   " << static_cast<uint64_t>(total / elapsed) << " req/s\n";
+    std::cout << "Responses:    " << ok << " 2xx, " << notFound << " 404, " << failed << " other\n";
+    std::cout << "Latency (us): p50 " << latency.percentile(0.50) << ", p90 " << latency.percentile(0.90) << ", p99 "
+              << latency.percentile(0.99) << ", max " << latency.getMax() << "\n";
+    if (connectionErrors > 0) {
+        std::cout << connectionErrors << " connection(s) failed\n";
+    }
+    return connectionErrors > 0 && total == 0 ? 1 : 0;
+}
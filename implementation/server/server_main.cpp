@@ -0,0 +1,114 @@
+// Standalone HTTP service hosting a DeliveryManager.
+//
+//   sqs_server [--host 0.0.0.0] [--port 5001] [--static DIR] [--wal PATH]
+//              [--refresh-ms 250] [--latency-file PATH] [--capture PATH]
+//
+// Serves the same /api/deliveries routes as the Flask backend; point
+// --static at delivery_gui_web/.../src/static to serve the dashboard too.
+// Queue changes are pushed to /api/deliveries/events subscribers once per
+// refresh interval. With --latency-file, the engine's operation latency
+// histograms are rewritten there in Prometheus text format every 10 s.
+// With --wal, pending log records are committed on every refresh tick.
+// --capture records the requests' adds, dispatches and cancels for
+// bench/trace_replay.
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <iostream>
+#include <string>
+#include "HttpServer.h"
+#include "DeliveryService.h"
+
+namespace {
+
+HttpServer *runningServer = nullptr;
+
+void onSignal(int)
+{
+    if (runningServer) runningServer->stop();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    std::string host = "0.0.0.0";
+    int port = 5001;
+    std::string staticRoot;
+    std::string walPath;
+    int refreshMs = 250;
+    std::string latencyPath;
+    std::string capturePath;
+    for (int i = 1; i < argc; i += 2) {
+        if (i + 1 == argc) {
+            std::cerr << "Missing value for " << argv[i] << "\n"
+                      << "Usage: sqs_server [--host 0.0.0.0] [--port 5001] [--static DIR] [--wal PATH]"
+                      << " [--refresh-ms 250] [--latency-file PATH] [--capture PATH]\n";
+            return 1;
+        }
+        if (std::strcmp(argv[i], "--host") == 0) host = argv[i + 1];
+        else if (std::strcmp(argv[i], "--port") == 0) port = std::atoi(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--static") == 0) staticRoot = argv[i + 1];
+        else if (std::strcmp(argv[i], "--wal") == 0) walPath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--refresh-ms") == 0) refreshMs = std::atoi(argv[i + 1]);
+        else if (std::strcmp(argv[i], "--latency-file") == 0) latencyPath = argv[i + 1];
+        else if (std::strcmp(argv[i], "--capture") == 0) capturePath = argv[i + 1];
+        else {
+            std::cerr << "Unknown option " << argv[i] << "\n";
+            return 1;
+        }
+    }
+
+    srand(time(0));
+    ConfigurationManager::initialize();
+    DeliveryManager deliveryManager;
+    deliveryManager.setVerbose(false); // Per-request console output would dominate
+    if (!walPath.empty() && !deliveryManager.enableWriteAheadLog(walPath)) {
+        std::cerr << "Could not open " << walPath << "\n";
+        return 1;
+    }
+    if (!capturePath.empty() && !deliveryManager.startTraceCapture(capturePath)) {
+        std::cerr << "Could not open " << capturePath << "\n";
+        return 1;
+    }
+
+    DeliveryService service(deliveryManager, staticRoot);
+    HttpServer server;
+    server.setHandler([&service](const HttpRequest &req, HttpResponse &res) { service.handle(req, res); });
+    std::string event;
+    int idleTicks = 0;
+    int latencyTicks = 0;
+    server.setTickHandler(refreshMs, [&]() {
+        event.clear();
+        if (service.publishChanges(event)) {
+            idleTicks = 0;
+        } else if (++idleTicks * refreshMs >= 15000) {
+            idleTicks = 0;
+            event = ": keep-alive\n\n"; // Stops idle proxies from closing quiet streams
+        }
+        if (!event.empty() && server.getOpenStreams() > 0) server.broadcast(event);
+        deliveryManager.syncLog(); // Bounds how long an acknowledged request waits in the group commit
+        if (!latencyPath.empty() && ++latencyTicks * refreshMs >= 10000) {
+            latencyTicks = 0;
+            deliveryManager.getLatency().writePrometheusFile(latencyPath);
+        }
+    });
+    if (!server.listen(host, port)) {
+        std::cerr << "Could not listen on " << host << ":" << port << ": " << std::strerror(errno) << "\n";
+        return 1;
+    }
+
+    runningServer = &server;
+    std::signal(SIGINT, onSignal);
+    std::signal(SIGTERM, onSignal);
+    std::cout << "Smart Queue server listening on " << host << ":" << port << std::endl;
+    server.run();
+
+    std::cout << "Served " << server.getRequestsServed() << " requests\n";
+    deliveryManager.syncLog();
+    deliveryManager.stopTraceCapture();
+    if (!latencyPath.empty()) deliveryManager.getLatency().writePrometheusFile(latencyPath);
+    return 0;
+}
@@ -0,0 +1,54 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+#include <filesystem>
+#include <iostream>
+#include <string>
+
+// Minimal checks for the programs in tests/: each failure is printed with
+// its location, and main() returns testResult() so a failing run exits 1.
+inline int &testFailures()
+{
+    static int failures = 0;
+    return failures;
+}
+
+#define CHECK(condition)                                                                      \
+    do {                                                                                      \
+        if (!(condition)) {                                                                   \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK failed: " #condition "\n"; \
+            ++testFailures();                                                                 \
+        }                                                                                     \
+    } while (0)
+
+#define CHECK_EQ(actual, expected)                                                                   \
+    do {                                                                                             \
+        auto actualValue = (actual);                                                                 \
+        auto expectedValue = (expected);                                                             \
+        if (!(actualValue == expectedValue)) {                                                       \
+            std::cerr << __FILE__ << ":" << __LINE__ << ": CHECK_EQ failed: " #actual " == " #expected \
+                      << " (" << actualValue << " vs " << expectedValue << ")\n";                    \
+            ++testFailures();                                                                        \
+        }                                                                                            \
+    } while (0)
+
+inline int testResult(const char *name)
+{
+    if (testFailures() == 0) {
+        std::cout << name << ": all checks passed\n";
+        return 0;
+    }
+    std::cout << name << ": " << testFailures() << " check(s) failed\n";
+    return 1;
+}
+
+// Empty scratch directory for one test's files
+inline std::string scratchDirectory(const std::string &name)
+{
+    std::filesystem::path dir = std::filesystem::temp_directory_path() / ("sqs_" + name);
+    std::filesystem::remove_all(dir);
+    std::filesystem::create_directories(dir);
+    return dir.string();
+}
+
+#endif // TEST_CHECK_H
@@ -0,0 +1,182 @@
+// Round-trip and damage checks for the columnar export (.sqc files).
+//
+//   columnar_test
+//
+// Writes random deliveries with writeColumnarFile, reads them back through
+// ColumnarFile, and compares every column and aggregate() with a direct scan
+// of the source rows. Truncated and corrupted copies must fail to open.
+#include <algorithm>
+#include <cmath>
+#include <cstddef>
+#include <cstdlib>
+#include <cstring>
+#include <filesystem>
+#include <fstream>
+#include <iterator>
+#include <string>
+#include <vector>
+#include "../ColumnarExport.h"
+#include "../Delivery.h"
+#include "TestCheck.h"
+
+namespace {
+
+std::vector<Delivery> makeRows(int count)
+{
+    std::vector<Delivery> rows;
+    for (int i = 0; i < count; ++i) {
+        Delivery d("D" + std::to_string(i * 7919 % 100003), "Zone " + std::to_string(rand() % 13),
+                   static_cast<DeliveryType>(rand() % 3), 10 + rand() % 120);
+        d.priorityScore = (rand() % 100000) / 100.0;
+        d.entryTime = 1700000000 + rand() % 100000;
+        if (rand() % 4 != 0) { // The rest stay unserved, like cancellations
+            d.serviceStartTime = d.entryTime + rand() % 7200;
+            d.serviceEndTime = d.serviceStartTime + 60 * d.estimatedDeliveryTime;
+        } else {
+            d.serviceStartTime = 0;
+            d.serviceEndTime = 0;
+        }
+        rows.push_back(d);
+    }
+    return rows;
+}
+
+ColumnarAggregate scan(const std::vector<Delivery> &rows, const ColumnarFilter &filter)
+{
+    ColumnarAggregate result;
+    double scoreSum = 0.0, waitSum = 0.0, serviceSum = 0.0;
+    uint64_t served = 0;
+    for (const Delivery &d : rows) {
+        if (filter.type >= 0 && d.deliveryType != filter.type) continue;
+        if (!filter.destination.empty() && d.destination != filter.destination) continue;
+        if (d.priorityScore < filter.minScore) continue;
+        if (result.count == 0 || d.priorityScore > result.maxScore) result.maxScore = d.priorityScore;
+        ++result.count;
+        scoreSum += d.priorityScore;
+        if (d.serviceStartTime != 0) {
+            ++served;
+            waitSum += static_cast<double>(d.serviceStartTime - d.entryTime);
+            serviceSum += static_cast<double>(d.serviceEndTime - d.serviceStartTime);
+        }
+    }
+    if (result.count > 0) result.meanScore = scoreSum / result.count;
+    if (served > 0) {
+        result.meanWaitMinutes = waitSum / 60.0 / served;
+        result.meanServiceMinutes = serviceSum / 60.0 / served;
+    }
+    return result;
+}
+
+bool near(double a, double b) { return std::fabs(a - b) <= 1e-9 * std::max(1.0, std::fabs(b)); }
+
+std::vector<char> readAll(const std::string &path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::vector<char>(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+void writeAll(const std::string &path, const std::vector<char> &bytes, size_t length)
+{
+    std::ofstream out(path, std::ios::binary | std::ios::trunc);
+    out.write(bytes.data(), static_cast<std::streamsize>(length));
+}
+
+void roundTrip(const std::string &dir)
+{
+    std::vector<Delivery> rows = makeRows(5000);
+    std::vector<const Delivery *> pointers;
+    for (const Delivery &d : rows) pointers.push_back(&d);
+    std::string path = dir + "/rows.sqc";
+    CHECK(writeColumnarFile(path, pointers, COLUMNAR_PROCESSED));
+
+    ColumnarFile file;
+    CHECK(file.open(path));
+    if (!file.isOpen()) return;
+    CHECK_EQ(file.rowCount(), rows.size());
+    CHECK_EQ(file.source(), COLUMNAR_PROCESSED);
+    for (uint64_t i = 0; i < rows.size(); ++i) {
+        CHECK(file.id(i) == rows[i].deliveryId);
+        CHECK(file.destination(i) == rows[i].destination);
+        CHECK_EQ(static_cast<int>(file.types()[i]), static_cast<int>(rows[i].deliveryType));
+        CHECK_EQ(file.scores()[i], rows[i].priorityScore);
+        CHECK_EQ(file.estimatedTimes()[i], rows[i].estimatedDeliveryTime);
+        CHECK_EQ(file.entryTimes()[i], static_cast<int64_t>(rows[i].entryTime));
+        CHECK_EQ(file.startTimes()[i], static_cast<int64_t>(rows[i].serviceStartTime));
+        CHECK_EQ(file.endTimes()[i], static_cast<int64_t>(rows[i].serviceEndTime));
+    }
+
+    std::vector<ColumnarFilter> filters(5);
+    filters[1].type = URGENT;
+    filters[2].destination = "Zone 3";
+    filters[3].minScore = 500.0;
+    filters[3].type = FRAGILE;
+    filters[4].destination = "Nowhere";
+    for (const ColumnarFilter &filter : filters) {
+        ColumnarAggregate expected = scan(rows, filter);
+        ColumnarAggregate actual = file.aggregate(filter);
+        CHECK_EQ(actual.count, expected.count);
+        CHECK(near(actual.meanScore, expected.meanScore));
+        CHECK_EQ(actual.maxScore, expected.maxScore);
+        CHECK(near(actual.meanWaitMinutes, expected.meanWaitMinutes));
+        CHECK(near(actual.meanServiceMinutes, expected.meanServiceMinutes));
+    }
+
+    std::vector<const Delivery *> none;
+    CHECK(writeColumnarFile(dir + "/empty.sqc", none, COLUMNAR_CANCELLED));
+    ColumnarFile empty;
+    CHECK(empty.open(dir + "/empty.sqc"));
+    if (empty.isOpen()) CHECK_EQ(empty.aggregate(ColumnarFilter()).count, 0u);
+}
+
+void damagedFiles(const std::string &dir)
+{
+    std::vector<Delivery> rows = makeRows(300);
+    std::vector<const Delivery *> pointers;
+    for (const Delivery &d : rows) pointers.push_back(&d);
+    std::string path = dir + "/small.sqc", damaged = dir + "/damaged.sqc";
+    CHECK(writeColumnarFile(path, pointers, COLUMNAR_CANCELLED));
+    std::vector<char> bytes = readAll(path);
+    ColumnarHeader header;
+    std::memcpy(&header, bytes.data(), sizeof(header));
+    uint64_t dataEnd = header.sectionOffset[SECTION_DICT_BLOB] + header.sectionBytes[SECTION_DICT_BLOB];
+
+    // Any cut into the data must be rejected; only the final padding may go
+    for (size_t length = 0; length < bytes.size(); length += 1 + length / 16) {
+        writeAll(damaged, bytes, length);
+        ColumnarFile file;
+        bool opened = file.open(damaged);
+        CHECK(opened == (length >= dataEnd));
+        if (opened) CHECK_EQ(file.aggregate(ColumnarFilter()).count, rows.size());
+    }
+
+    // Header counts that disagree with the sections
+    auto corrupt = [&](size_t offset, const void *value, size_t size) {
+        std::vector<char> copy = bytes;
+        std::memcpy(copy.data() + offset, value, size);
+        writeAll(damaged, copy, copy.size());
+        ColumnarFile file;
+        return file.open(damaged);
+    };
+    uint64_t moreRows = header.rowCount + 1, hugeRows = ~uint64_t(0) / 4;
+    CHECK(!corrupt(offsetof(ColumnarHeader, rowCount), &moreRows, sizeof(moreRows)));
+    CHECK(!corrupt(offsetof(ColumnarHeader, rowCount), &hugeRows, sizeof(hugeRows)));
+    uint64_t fewerNames = header.dictionarySize - 1;
+    CHECK(!corrupt(offsetof(ColumnarHeader, dictionarySize), &fewerNames, sizeof(fewerNames)));
+
+    // A destination code past the dictionary, and an ID offset past the blob
+    uint32_t badCode = static_cast<uint32_t>(header.dictionarySize);
+    CHECK(!corrupt(header.sectionOffset[SECTION_DESTINATION_CODE] + 4 * 17, &badCode, sizeof(badCode)));
+    uint64_t badOffset = header.sectionBytes[SECTION_ID_BLOB] + 1;
+    CHECK(!corrupt(header.sectionOffset[SECTION_ID_OFFSETS] + 8 * header.rowCount, &badOffset, sizeof(badOffset)));
+}
+
+} // namespace
+
+int main()
+{
+    srand(1);
+    std::string dir = scratchDirectory("columnar");
+    roundTrip(dir);
+    damagedFiles(dir);
+    return testResult("columnar_test");
+}
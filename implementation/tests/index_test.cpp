@@ -0,0 +1,163 @@
+// Randomized consistency checks for the delivery ID index.
+//
+//   index_test [--seed 1]
+//
+// Drives DeliveryIndex directly against a map-based model, with a small
+// terminal history so evictions and backward-shift deletes happen often,
+// then drives DeliveryManager and checks findDelivery() for every ID seen.
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <unordered_map>
+#include <vector>
+#include "../DeliveryManager.h"
+#include "TestCheck.h"
+
+namespace {
+
+struct ModelEntry {
+    DeliveryStatus status = STATUS_UNKNOWN;
+    int queue = -1;
+    int slot = -1;
+    uint64_t terminalSequence = 0; // Which terminal event set the status
+};
+
+void indexAgainstModel()
+{
+    const size_t limit = 257;
+    DeliveryIndex index(limit);
+    std::unordered_map<std::string, ModelEntry> model;
+    std::vector<std::string> ids;
+    uint64_t terminalEvents = 0;
+
+    for (int step = 0; step < 200000; ++step) {
+        // Mostly new IDs, sometimes an old one coming back
+        std::string id = ids.empty() || rand() % 4 != 0 ? "P" + std::to_string(ids.size()) : ids[rand() % ids.size()];
+        if (model.find(id) == model.end()) ids.push_back(id);
+        ModelEntry &m = model[id];
+        if (m.status == STATUS_UNKNOWN || rand() % 3 == 0) {
+            m.status = STATUS_QUEUED;
+            m.queue = rand() % 3;
+            m.slot = rand() % 100000;
+            index.setQueued(id, m.queue, m.slot);
+        } else {
+            m.status = rand() % 2 ? STATUS_PROCESSED : STATUS_CANCELLED;
+            m.terminalSequence = terminalEvents++;
+            index.setStatus(id, m.status);
+        }
+
+        if (step % 1000 != 999) continue;
+        size_t expectedSize = 0;
+        for (const std::string &key : ids) {
+            const ModelEntry &e = model[key];
+            bool retained = e.status == STATUS_QUEUED ||
+                            (e.status != STATUS_UNKNOWN && e.terminalSequence + limit >= terminalEvents);
+            DeliveryIndexEntry found;
+            bool hit = index.find(key, found);
+            CHECK_EQ(hit, retained);
+            if (!hit || !retained) continue;
+            ++expectedSize;
+            CHECK_EQ(static_cast<int>(found.status), static_cast<int>(e.status));
+            if (e.status == STATUS_QUEUED) {
+                CHECK_EQ(static_cast<int>(found.queue), e.queue);
+                CHECK_EQ(found.slot, e.slot);
+            }
+        }
+        CHECK_EQ(index.size(), expectedSize); // Evicted IDs leave no entries behind
+    }
+
+    DeliveryIndexEntry found;
+    CHECK(!index.find("never added", found));
+    index.clear();
+    CHECK_EQ(index.size(), 0u);
+    CHECK(!index.find(ids.front(), found));
+}
+
+void managerAgainstModel()
+{
+    DeliveryManager manager;
+    manager.setVerbose(false);
+    std::unordered_map<std::string, DeliveryStatus> model;
+    int next = 0;
+
+    for (int step = 0; step < 20000; ++step) {
+        int action = rand() % 10;
+        if (action < 5 || !manager.hasDeliveries()) {
+            Delivery d("M" + std::to_string(next++), "Zone " + std::to_string(rand() % 5),
+                       static_cast<DeliveryType>(rand() % 3), 10 + rand() % 120);
+            manager.addDelivery(d);
+            model[d.deliveryId] = STATUS_QUEUED;
+        } else if (action < 7) {
+            Delivery d = manager.processNextDelivery();
+            CHECK_EQ(static_cast<int>(model[d.deliveryId]), static_cast<int>(STATUS_QUEUED));
+            model[d.deliveryId] = STATUS_PROCESSED;
+        } else if (action < 9) {
+            std::string id = "M" + std::to_string(rand() % next);
+            bool queued = model[id] == STATUS_QUEUED;
+            CHECK_EQ(manager.cancelDeliveryById(id), queued);
+            if (queued) model[id] = STATUS_CANCELLED;
+        } else if (step % 50 == 0) {
+            manager.mergeQueues(); // Moves deliveries between heaps
+        } else {
+            manager.updatePriorities();
+        }
+
+        if (step % 500 != 499) continue;
+        for (const auto &entry : model) {
+            DeliveryLookup lookup = manager.findDelivery(entry.first);
+            CHECK_EQ(static_cast<int>(lookup.status), static_cast<int>(entry.second));
+            if (entry.second == STATUS_QUEUED && lookup.delivery) {
+                CHECK(lookup.delivery->deliveryId == entry.first);
+            }
+        }
+        CHECK_EQ(static_cast<int>(manager.findDelivery("M-missing").status), static_cast<int>(STATUS_UNKNOWN));
+    }
+}
+
+// Cancelling an ID that is not queued must answer from the index alone: the
+// heaps keep their exact layout and no change is published
+void cancelMissLeavesQueues()
+{
+    DeliveryManager manager;
+    manager.setVerbose(false);
+    for (int i = 0; i < 3000; ++i) {
+        Delivery d("C" + std::to_string(i), "Zone " + std::to_string(i % 5), static_cast<DeliveryType>(rand() % 3),
+                   10 + rand() % 120);
+        manager.addDelivery(d);
+    }
+    std::string processed = manager.processNextDelivery().deliveryId;
+    std::string cancelled = "C" + std::to_string(rand() % 3000);
+    if (cancelled == processed) cancelled = processed == "C0" ? "C1" : "C0";
+    CHECK(manager.cancelDeliveryById(cancelled));
+
+    std::vector<std::string> before[3];
+    for (int q = URGENT; q <= FRAGILE; ++q) {
+        for (const Delivery &d : manager.getQueueData(static_cast<DeliveryType>(q))) before[q].push_back(d.deliveryId);
+    }
+    uint64_t sequence = manager.getChangeSequence();
+    CHECK(!manager.cancelDeliveryById("C-unknown"));
+    CHECK(!manager.cancelDeliveryById(processed));
+    CHECK(!manager.cancelDeliveryById(cancelled));
+    CHECK_EQ(manager.getChangeSequence(), sequence);
+    for (int q = URGENT; q <= FRAGILE; ++q) {
+        std::vector<std::string> after;
+        for (const Delivery &d : manager.getQueueData(static_cast<DeliveryType>(q))) after.push_back(d.deliveryId);
+        CHECK(after == before[q]); // Same heap order, not just the same set
+    }
+    CHECK_EQ(manager.getTotalQueueSize(), 2998);
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned seed = 1;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--seed") == 0) seed = static_cast<unsigned>(std::atoi(argv[++i]));
+    }
+    srand(seed);
+    indexAgainstModel();
+    managerAgainstModel();
+    cancelMissLeavesQueues();
+    return testResult("index_test");
+}
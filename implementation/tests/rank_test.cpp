@@ -0,0 +1,162 @@
+// Randomized consistency checks for the queue rank trees.
+//
+//   rank_test [--seed 1]
+//
+// Drives QueueRank against a sorted vector, with few distinct scores so the
+// age and ID tie-breaks matter, then drives DeliveryManager under every
+// scheduler mode and checks getQueuePosition, getQueuePage and countAbove
+// against a sort of each queue's heap array.
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+#include "../DeliveryManager.h"
+#include "../QueueRank.h"
+#include "../WireFormat.h"
+#include "TestCheck.h"
+
+namespace {
+
+time_t simulatedNow = 1700000000;
+time_t simulatedClock() { return simulatedNow; }
+
+// Dispatch order within a queue, as QueueRank documents it
+bool dispatchedBefore(const Delivery &a, const Delivery &b)
+{
+    if (a.priorityScore != b.priorityScore) return a.priorityScore > b.priorityScore;
+    if (a.entryTime != b.entryTime) return a.entryTime < b.entryTime;
+    return a.deliveryId < b.deliveryId;
+}
+
+size_t countScoresAbove(const std::vector<Delivery> &sorted, double score)
+{
+    return static_cast<size_t>(std::count_if(sorted.begin(), sorted.end(),
+                                             [&](const Delivery &d) { return d.priorityScore > score; }));
+}
+
+void checkTree(const QueueRank &tree, const std::vector<Delivery> &sorted)
+{
+    CHECK_EQ(tree.size(), sorted.size());
+    for (size_t i = 0; i < sorted.size(); i += 1 + sorted.size() / 50) {
+        CHECK_EQ(tree.rankOf(sorted[i]), i);
+    }
+    for (double score : {-1.0, 0.0, 3.0, 7.5, 10.0, 100.0}) {
+        CHECK_EQ(tree.countAbove(score), countScoresAbove(sorted, score));
+    }
+    size_t offset = sorted.empty() ? 0 : static_cast<size_t>(rand()) % (sorted.size() + 2);
+    std::vector<std::string> page = tree.page(offset, 13);
+    size_t expected = offset >= sorted.size() ? 0 : std::min<size_t>(13, sorted.size() - offset);
+    CHECK_EQ(page.size(), expected);
+    for (size_t i = 0; i < page.size() && i < expected; ++i) {
+        CHECK(page[i] == sorted[offset + i].deliveryId);
+    }
+}
+
+void treeAgainstModel()
+{
+    QueueRank tree;
+    std::vector<Delivery> model; // Kept sorted in dispatch order
+    int next = 0;
+    for (int step = 0; step < 60000; ++step) {
+        int action = rand() % 100;
+        if (action < 55 || model.empty()) {
+            Delivery d("R" + std::to_string(next++), "Zone", static_cast<DeliveryType>(rand() % 3), 30);
+            d.priorityScore = rand() % 11;              // Many equal scores...
+            d.entryTime = 1700000000 + rand() % 50;     // ...and equal ages
+            tree.insert(d);
+            model.insert(std::upper_bound(model.begin(), model.end(), d, dispatchedBefore), d);
+        } else if (action < 97) {
+            size_t victim = static_cast<size_t>(rand()) % model.size();
+            CHECK(tree.erase(model[victim]));
+            model.erase(model.begin() + static_cast<std::ptrdiff_t>(victim));
+        } else if (action < 99) {
+            // Bulk rebuild from an unsorted copy, as after a re-score
+            std::vector<Delivery> shuffled = model;
+            std::random_shuffle(shuffled.begin(), shuffled.end());
+            tree.assign(shuffled);
+        } else {
+            tree.clear();
+            model.clear();
+        }
+        if (step % 200 == 0) checkTree(tree, model);
+    }
+    checkTree(tree, model);
+
+    Delivery absent("absent", "Zone", URGENT, 30);
+    CHECK(!tree.erase(absent));
+    CHECK_EQ(tree.size(), model.size());
+}
+
+void managerAgainstSort()
+{
+    for (int mode = SCHEDULER_STRICT; mode <= SCHEDULER_SJF; ++mode) {
+        DeliveryManager manager;
+        manager.setVerbose(false);
+        ConfigurationManager::applySetting("scheduler_mode", mode);
+        ConfigurationManager::applySetting("batch_max_extra", mode % 2 ? 2 : 0);
+        int next = 0;
+        for (int round = 0; round < 1500; ++round) {
+            simulatedNow += 60;
+            for (int k = 0; k < 3; ++k) {
+                Delivery d("D" + std::to_string(next++), "Zone " + std::to_string(rand() % 8),
+                           static_cast<DeliveryType>(rand() % 3), 10 + rand() % 120);
+                manager.addDelivery(d);
+            }
+            if (round % 3 == 0) {
+                std::vector<WireDelivery> wire(4);
+                for (WireDelivery &record : wire) {
+                    encodeWireDelivery(record, "W" + std::to_string(next++), "Zone 1",
+                                       static_cast<DeliveryType>(rand() % 3), 5 + rand() % 100, 0);
+                }
+                manager.addDeliveries(wire.data(), wire.size());
+            }
+            if (round % 7 == 0) manager.cancelDeliveryById("D" + std::to_string(rand() % next));
+            if (round % 5 == 0) manager.updatePriorities();
+            if (round % 11 == 0) manager.mergeQueues();
+            for (int k = 0; k < 2 && manager.hasDeliveries(); ++k) manager.processNextBatch();
+
+            if (round % 25 != 0 && round >= 50) continue;
+            for (int queue = URGENT; queue <= FRAGILE; ++queue) {
+                DeliveryType type = static_cast<DeliveryType>(queue);
+                std::vector<Delivery> sorted = manager.getQueueData(type);
+                std::sort(sorted.begin(), sorted.end(), dispatchedBefore);
+                for (size_t i = 0; i < sorted.size(); i += 1 + sorted.size() / 20) {
+                    QueuePosition position = manager.getQueuePosition(sorted[i].deliveryId);
+                    CHECK(position.queued);
+                    CHECK_EQ(position.queue, queue);
+                    CHECK_EQ(position.rank, i);
+                    CHECK_EQ(position.queueSize, sorted.size());
+                }
+                size_t offset = sorted.size() / 3;
+                std::vector<Delivery> page = manager.getQueuePage(type, offset, 17);
+                CHECK_EQ(page.size(), std::min<size_t>(17, sorted.size() - offset));
+                for (size_t i = 0; i < page.size(); ++i) {
+                    CHECK(page[i].deliveryId == sorted[offset + i].deliveryId);
+                }
+                if (!sorted.empty()) {
+                    double score = sorted[sorted.size() / 2].priorityScore;
+                    CHECK_EQ(manager.countAbove(type, score), countScoresAbove(sorted, score));
+                }
+            }
+        }
+        CHECK(!manager.getQueuePosition("not queued").queued);
+    }
+    ConfigurationManager::initialize();
+}
+
+} // namespace
+
+int main(int argc, char **argv)
+{
+    unsigned seed = 1;
+    for (int i = 1; i + 1 < argc; ++i) {
+        if (std::strcmp(argv[i], "--seed") == 0) seed = static_cast<unsigned>(std::atoi(argv[++i]));
+    }
+    srand(seed);
+    DeliveryClock::setSource(&simulatedClock);
+    ConfigurationManager::initialize();
+    treeAgainstModel();
+    managerAgainstSort();
+    return testResult("rank_test");
+}
@@ -0,0 +1,313 @@
+// Crash-recovery checks for the write-ahead log.
+//
+//   recovery_test
+//
+// Each case drives a DeliveryManager with a log in a scratch directory, then
+// recovers a second manager from what is on disk and compares the two. A
+// crash is simulated by copying the log while records may still be pending.
+#include <algorithm>
+#include <chrono>
+#include <cstdlib>
+#include <deque>
+#include <filesystem>
+#include <string>
+#include <thread>
+#include <vector>
+#include "../DeliveryManager.h"
+#include "TestCheck.h"
+
+namespace {
+
+time_t simulatedNow = 1700000000;
+time_t simulatedClock() { return simulatedNow; }
+
+Delivery makeDelivery(int n)
+{
+    return Delivery("D" + std::to_string(n), "Zone " + std::to_string(n % 7),
+                    static_cast<DeliveryType>(rand() % 3), 10 + rand() % 120);
+}
+
+void checkSameState(const DeliveryManager &recovered, const DeliveryManager &original)
+{
+    CHECK_EQ(recovered.getUrgentQueueSize(), original.getUrgentQueueSize());
+    CHECK_EQ(recovered.getStandardQueueSize(), original.getStandardQueueSize());
+    CHECK_EQ(recovered.getFragileQueueSize(), original.getFragileQueueSize());
+    CHECK_EQ(recovered.getMetrics().getTotalArrivals(), original.getMetrics().getTotalArrivals());
+    CHECK_EQ(recovered.getMetrics().getTotalProcessed(), original.getMetrics().getTotalProcessed());
+    CHECK_EQ(recovered.getMetrics().getTotalCancelled(), original.getMetrics().getTotalCancelled());
+    CHECK_EQ(recovered.getMetrics().getThroughputPerMinute(), original.getMetrics().getThroughputPerMinute());
+}
+
+// Adds only, with a compaction every few hundred records: every add must survive
+void compactionKeepsEveryAdd()
+{
+    std::string log = scratchDirectory("recovery_adds") + "/queue.wal";
+    WalOptions options;
+    options.groupCommitRecords = 1;
+    options.checkpointBytes = 20000;
+
+    DeliveryManager original;
+    original.setVerbose(false);
+    CHECK(original.enableWriteAheadLog(log, options));
+    for (int i = 0; i < 2000; ++i) {
+        Delivery d = makeDelivery(i);
+        original.addDelivery(d);
+    }
+    CHECK(original.syncLog());
+
+    DeliveryManager recovered;
+    recovered.setVerbose(false);
+    CHECK(recovered.enableWriteAheadLog(log, options));
+    CHECK_EQ(recovered.getTotalQueueSize(), 2000);
+    checkSameState(recovered, original);
+}
+
+// Adds, dispatches and cancels with compactions in between. The processed
+// history is capped below the number of dispatches, so the lifetime totals
+// must come from the compacted log's metrics record.
+void compactionMidStream()
+{
+    std::string log = scratchDirectory("recovery_mixed") + "/queue.wal";
+    WalOptions options;
+    options.groupCommitRecords = 16;
+    options.checkpointBytes = 20000;
+
+    DeliveryManager original;
+    original.setVerbose(false);
+    CHECK(original.enableWriteAheadLog(log, options));
+    ConfigurationManager::updateSetting("processed_history_limit", 100); // Logged, so recovery applies it too
+    int next = 0;
+    for (int round = 0; round < 200; ++round) {
+        simulatedNow += 60;
+        for (int k = 0; k < 10; ++k) {
+            Delivery d = makeDelivery(next++);
+            original.addDelivery(d);
+        }
+        for (int k = 0; k < 6 && original.hasDeliveries(); ++k) {
+            original.processNextDelivery();
+        }
+        original.cancelDeliveryById("D" + std::to_string(rand() % next));
+        if (round % 20 == 0) original.updatePriorities();
+    }
+    uint64_t uncompacted = static_cast<uint64_t>(next) * 60;
+    CHECK(original.syncLog());
+    CHECK(std::filesystem::file_size(log) < uncompacted); // At least one compaction ran
+
+    DeliveryManager recovered;
+    recovered.setVerbose(false);
+    CHECK(recovered.enableWriteAheadLog(log, options));
+    checkSameState(recovered, original);
+    CHECK_EQ(recovered.getProcessedDeliveries().size(), original.getProcessedDeliveries().size());
+
+    // Dispatch order survives recovery once both re-score at the same time.
+    // Ties may leave the heaps in either order, so IDs are compared as sets.
+    original.updatePriorities();
+    recovered.updatePriorities();
+    std::vector<std::string> originalIds, recoveredIds;
+    while (original.hasDeliveries() && recovered.hasDeliveries()) {
+        Delivery expected = original.processNextDelivery();
+        Delivery actual = recovered.processNextDelivery();
+        CHECK_EQ(actual.priorityScore, expected.priorityScore);
+        originalIds.push_back(expected.deliveryId);
+        recoveredIds.push_back(actual.deliveryId);
+    }
+    std::sort(originalIds.begin(), originalIds.end());
+    std::sort(recoveredIds.begin(), recoveredIds.end());
+    CHECK(recoveredIds == originalIds);
+    CHECK(!original.hasDeliveries());
+    CHECK(!recovered.hasDeliveries());
+    ConfigurationManager::initialize();
+}
+
+// Snapshot, then crash with records still pending: the snapshot holds LSNs
+// the log never got, and records logged after recovery must not reuse them
+void snapshotThenCrash()
+{
+    std::string dir = scratchDirectory("recovery_snapshot");
+    std::string log = dir + "/queue.wal", crashedLog = dir + "/crashed.wal", snapshot = dir + "/queue.snap";
+    WalOptions options;
+    options.groupCommitRecords = 1000;
+    options.groupCommitBytes = 1 << 20;
+    options.groupCommitMillis = 0;
+
+    int next = 0;
+    {
+        DeliveryManager original;
+        original.setVerbose(false);
+        CHECK(original.enableWriteAheadLog(log, options));
+        for (int i = 0; i < 300; ++i) {
+            Delivery d = makeDelivery(next++);
+            original.addDelivery(d);
+        }
+        CHECK(original.syncLog());
+        for (int i = 0; i < 200; ++i) {
+            Delivery d = makeDelivery(next++);
+            original.addDelivery(d);
+        }
+        CHECK(original.writeSnapshot(snapshot, false));
+        std::filesystem::copy_file(log, crashedLog); // The 200 adds are still pending
+    }
+
+    DeliveryManager restarted;
+    restarted.setVerbose(false);
+    CHECK(restarted.restoreSnapshot(snapshot));
+    CHECK(restarted.enableWriteAheadLog(crashedLog, options));
+    CHECK_EQ(restarted.getTotalQueueSize(), 500);
+    for (int i = 0; i < 50; ++i) {
+        Delivery d = makeDelivery(next++);
+        restarted.addDelivery(d);
+    }
+    for (int i = 0; i < 20; ++i) {
+        restarted.processNextDelivery();
+    }
+    CHECK(restarted.syncLog());
+
+    DeliveryManager recovered;
+    recovered.setVerbose(false);
+    CHECK(recovered.restoreSnapshot(snapshot));
+    CHECK(recovered.enableWriteAheadLog(crashedLog, options));
+    CHECK_EQ(recovered.getTotalQueueSize(), 530);
+    CHECK_EQ(recovered.getUrgentQueueSize(), restarted.getUrgentQueueSize());
+    CHECK_EQ(recovered.getStandardQueueSize(), restarted.getStandardQueueSize());
+    CHECK_EQ(recovered.getFragileQueueSize(), restarted.getFragileQueueSize());
+}
+
+// A quiet log still commits: once the oldest pending record is older than
+// groupCommitMillis, the next append writes the group
+void groupCommitAgeLimit()
+{
+    std::string dir = scratchDirectory("recovery_commit_age");
+    std::string log = dir + "/queue.wal", crashedLog = dir + "/crashed.wal";
+    WalOptions options;
+    options.groupCommitRecords = 1000;
+    options.groupCommitMillis = 20;
+
+    DeliveryManager original;
+    original.setVerbose(false);
+    CHECK(original.enableWriteAheadLog(log, options));
+    Delivery first = makeDelivery(0);
+    original.addDelivery(first);
+    std::this_thread::sleep_for(std::chrono::milliseconds(40));
+    Delivery second = makeDelivery(1);
+    original.addDelivery(second);
+    std::filesystem::copy_file(log, crashedLog); // Crash before any syncLog()
+
+    DeliveryManager recovered;
+    recovered.setVerbose(false);
+    CHECK(recovered.enableWriteAheadLog(crashedLog, options));
+    CHECK_EQ(recovered.getTotalQueueSize(), 2);
+}
+
+// Cancellations evicted from the in-memory ring wait in a spill buffer. Replay
+// does not spill again, so a crash must find them on disk once their
+// evicting cancel is in the log.
+void spilledCancellationsSurviveCrash()
+{
+    std::string dir = scratchDirectory("recovery_spill");
+    std::string log = dir + "/queue.wal", spill = dir + "/cancelled.log";
+    WalOptions options;
+    options.groupCommitRecords = 1;
+
+    DeliveryManager original;
+    original.setVerbose(false);
+    CHECK(original.enableWriteAheadLog(log, options));
+    CHECK(original.enableCancelledSpill(spill));
+    for (int i = 0; i < 1100; ++i) {
+        Delivery d("S" + std::to_string(i), "Zone", static_cast<DeliveryType>(i % 3), 30);
+        original.addDelivery(d);
+    }
+    for (int i = 0; i < 1100; ++i) {
+        CHECK(original.cancelDeliveryById("S" + std::to_string(i))); // 76 evicted, fewer than one spill batch
+    }
+    for (const char *suffix : {"", ".idx"}) {
+        std::filesystem::copy_file(spill + suffix, dir + "/crashed.log" + suffix); // Crash without syncLog()
+    }
+    std::filesystem::copy_file(log, dir + "/crashed.wal");
+
+    DeliveryManager recovered;
+    recovered.setVerbose(false);
+    CHECK(recovered.enableWriteAheadLog(dir + "/crashed.wal", options));
+    CHECK(recovered.enableCancelledSpill(dir + "/crashed.log"));
+    CHECK_EQ(recovered.getCancelledCount(), 1100);
+    std::vector<std::string> ids;
+    for (const Delivery &d : recovered.getCancelledPage(0, 2000)) ids.push_back(d.deliveryId);
+    std::sort(ids.begin(), ids.end());
+    CHECK(std::unique(ids.begin(), ids.end()) == ids.end());
+    CHECK_EQ(ids.size(), 1100);
+}
+
+// Restart from a snapshot and the log after it: the lifetime totals and the
+// processed history were logged before the snapshot, so only it can carry them
+void snapshotKeepsMetricsAndHistory()
+{
+    std::string dir = scratchDirectory("recovery_snapshot_metrics");
+    std::string log = dir + "/queue.wal", snapshot = dir + "/queue.snap";
+    WalOptions options;
+    options.groupCommitRecords = 1;
+
+    DeliveryManager original;
+    original.setVerbose(false);
+    CHECK(original.enableWriteAheadLog(log, options));
+    ConfigurationManager::updateSetting("processed_history_limit", 50);
+    int next = 0;
+    for (int round = 0; round < 40; ++round) {
+        simulatedNow += 60;
+        for (int k = 0; k < 5; ++k) {
+            Delivery d = makeDelivery(next++);
+            original.addDelivery(d);
+        }
+        for (int k = 0; k < 3 && original.hasDeliveries(); ++k) {
+            original.processNextDelivery();
+        }
+        original.cancelDeliveryById("D" + std::to_string(rand() % next));
+    }
+    CHECK(original.writeSnapshot(snapshot, false));
+    for (int k = 0; k < 4; ++k) {
+        Delivery d = makeDelivery(next++);
+        original.addDelivery(d);
+    }
+    original.processNextDelivery();
+    CHECK(original.syncLog());
+
+    DeliveryManager restarted;
+    restarted.setVerbose(false);
+    CHECK(restarted.restoreSnapshot(snapshot));
+    CHECK(restarted.enableWriteAheadLog(log, options));
+    checkSameState(restarted, original);
+    for (int t = URGENT; t <= FRAGILE; ++t) {
+        const TypeMetrics &expected = original.getMetrics().forType(static_cast<DeliveryType>(t));
+        const TypeMetrics &actual = restarted.getMetrics().forType(static_cast<DeliveryType>(t));
+        CHECK_EQ(actual.arrivals, expected.arrivals);
+        CHECK_EQ(actual.processed, expected.processed);
+        CHECK_EQ(actual.cancelled, expected.cancelled);
+        CHECK_EQ(actual.dispatchedMinutes, expected.dispatchedMinutes);
+    }
+    const std::deque<Delivery> &expectedHistory = original.getProcessedDeliveries();
+    const std::deque<Delivery> &history = restarted.getProcessedDeliveries();
+    CHECK_EQ(history.size(), 50);
+    CHECK_EQ(history.size(), expectedHistory.size());
+    for (size_t i = 0; i < history.size() && i < expectedHistory.size(); ++i) {
+        CHECK(history[i].deliveryId == expectedHistory[i].deliveryId);
+        CHECK_EQ(history[i].getServiceStartTime(), expectedHistory[i].getServiceStartTime());
+        CHECK_EQ(history[i].getServiceEndTime(), expectedHistory[i].getServiceEndTime());
+    }
+    CHECK(restarted.findDelivery(expectedHistory.back().deliveryId).status == STATUS_PROCESSED);
+    ConfigurationManager::initialize();
+}
+
+} // namespace
+
+int main()
+{
+    srand(1);
+    DeliveryClock::setSource(&simulatedClock);
+    ConfigurationManager::initialize();
+
+    compactionKeepsEveryAdd();
+    compactionMidStream();
+    snapshotThenCrash();
+    snapshotKeepsMetricsAndHistory();
+    groupCommitAgeLimit();
+    spilledCancellationsSurviveCrash();
+    return testResult("recovery_test");
+}